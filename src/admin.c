@@ -0,0 +1,329 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "admin.h"
+#include "memwatch.h"
+#include "transfer.h"
+#include "config.h"
+#include "logging.h"
+
+static struct {
+    int sock_fd;
+    int conn_fd;               // 正在处理的管理连接(原子访问)，停止时用于唤醒
+    cache_t *cache;
+    threadpool_t *pool;
+    threadpool_t *disk_pool;
+    hitters_t *hitters;
+    char path[108];
+    ino_t inode;               // 本进程创建的socket文件，升级后路径可能已属于新进程
+    pthread_t thread;
+    int running;
+} admin = { .sock_fd = -1, .conn_fd = -1 };
+
+static int pool_threads(threadpool_t *pool) {
+    if (!pool) return 0;
+    pthread_mutex_lock(&pool->lock);
+    int count = pool->thread_count;
+    pthread_mutex_unlock(&pool->lock);
+    return count;
+}
+
+static void print_stats(FILE *out) {
+    cache_t *cache = admin.cache;
+    cache_algorithm_t algorithm = cache_get_algorithm(cache);
+    
+    fprintf(out, "cache-size %zu MB (used %zu MB, %u items)\n",
+            cache_get_max_size(cache) / (1024 * 1024),
+            cache_get_size(cache) / (1024 * 1024), cache_get_count(cache));
+    fprintf(out, "policy %s%s\n", cache->adaptive ? "auto, current " : "",
+            cache_algorithm_name(algorithm));
+    fprintf(out, "admission %s (rejected %lu)\n", cache->sketch ? "on" : "off",
+            cache->admission_rejects);
+    fprintf(out, "hit-ratio %.2f%% objects, %.2f%% bytes\n",
+            cache_object_hit_ratio(cache) * 100, cache_byte_hit_ratio(cache) * 100);
+    fprintf(out, "memory %zu MB (cache with metadata %zu MB, miss buffers %zu KB)\n",
+            cache_get_memory(cache) / (1024 * 1024), cache_get_size(cache) / (1024 * 1024),
+            __atomic_load_n(&cache->buffer_size, __ATOMIC_RELAXED) / 1024);
+    
+    memwatch_stats_t watch;
+    if (memwatch_get_stats(&watch) == 0) {
+        fprintf(out, "memory-watch limit %zu MB, unreclaimable %zu MB, avg10 %.2f, "
+                "budget %zu/%zu MB, shrinks %lu, grows %lu\n",
+                watch.limit / (1024 * 1024), watch.unreclaimable / (1024 * 1024), watch.pressure,
+                watch.budget / (1024 * 1024), watch.ceiling / (1024 * 1024),
+                watch.shrinks, watch.grows);
+    }
+    
+    // 各发送方式的次数，以及每个大小分类中测得的开销(ns/KB)，-表示没有采样
+    transfer_stats_t transfer;
+    transfer_get_stats(&transfer);
+    fprintf(out, "transfer");
+    for (int s = 0; s < TRANSFER_STRATEGY_COUNT; s++) {
+        fprintf(out, " %s %llu (%llu MB)", transfer_strategy_name(s),
+                (unsigned long long)transfer.count[s],
+                (unsigned long long)(transfer.bytes[s] >> 20));
+    }
+    fprintf(out, "\n");
+    for (int c = 0; c < TRANSFER_SIZE_CLASSES; c++) {
+        uint64_t total = 0;
+        for (int s = 0; s < TRANSFER_STRATEGY_COUNT; s++) total += transfer.samples[c][s];
+        if (total == 0) continue;
+        
+        size_t limit = transfer_class_limit(c);
+        char label[32];
+        if (limit) snprintf(label, sizeof(label), "<%zuKB", limit / 1024);
+        else snprintf(label, sizeof(label), ">=%zuKB", transfer_class_limit(c - 1) / 1024);
+        fprintf(out, "transfer-cost %s", label);
+        for (int s = 0; s < TRANSFER_STRATEGY_COUNT; s++) {
+            if (transfer.samples[c][s] == 0) fprintf(out, " %s -", transfer_strategy_name(s));
+            else fprintf(out, " %s %.1f", transfer_strategy_name(s), transfer.cost[c][s] * 1.024);
+        }
+        fprintf(out, "\n");
+    }
+    fprintf(out, "threads %d\n", pool_threads(admin.pool));
+    fprintf(out, "disk-threads %d\n", pool_threads(admin.disk_pool));
+}
+
+static int parse_count(const char *arg, long min, long max, long *value) {
+    if (!arg) return -1;
+    char *end;
+    errno = 0;
+    long n = strtol(arg, &end, 10);
+    if (errno != 0 || end == arg || *end != '\0' || n < min || n > max) return -1;
+    *value = n;
+    return 0;
+}
+
+// 按排序依据列出热点路径: 请求数(±误差) 命中 未命中 字节数 平均耗时 路径
+static const char *print_top(char *arg, char **save, FILE *out) {
+    long n = HITTERS_DEFAULT_TOP;
+    hitters_order_t order = HITTERS_BY_REQUESTS;
+    
+    for (; arg; arg = strtok_r(NULL, " \t\r\n", save)) {
+        if (strcmp(arg, "requests") == 0) order = HITTERS_BY_REQUESTS;
+        else if (strcmp(arg, "misses") == 0) order = HITTERS_BY_MISSES;
+        else if (strcmp(arg, "bytes") == 0) order = HITTERS_BY_BYTES;
+        else if (strcmp(arg, "time") == 0) order = HITTERS_BY_TIME;
+        else if (parse_count(arg, 1, HITTERS_CAPACITY, &n) != 0) {
+            return "usage: top [N] [requests|misses|bytes|time]";
+        }
+    }
+    
+    hitter_t *top = malloc(sizeof(hitter_t) * n);
+    if (!top) return "out of memory";
+    uint64_t total;
+    int count = hitters_top(admin.hitters, order, top, (int)n, &total);
+    
+    fprintf(out, "total %llu requests, top %d\n", (unsigned long long)total, count);
+    for (int i = 0; i < count; i++) {
+        fprintf(out, "%llu ±%llu hits %llu misses %llu bytes %llu avg %lluus %s\n",
+                (unsigned long long)top[i].count, (unsigned long long)top[i].error,
+                (unsigned long long)top[i].hits, (unsigned long long)top[i].misses,
+                (unsigned long long)top[i].bytes,
+                (unsigned long long)(top[i].service_us / (top[i].hits + top[i].misses)),
+                top[i].path);
+    }
+    free(top);
+    return NULL;
+}
+
+// 执行一条命令，成功返回NULL，失败返回错误说明
+static const char *run_command(char *line, FILE *out) {
+    char *save = NULL;
+    char *cmd = strtok_r(line, " \t\r\n", &save);
+    char *arg = strtok_r(NULL, " \t\r\n", &save);
+    long n;
+    
+    if (!cmd) return "empty command";
+    
+    if (strcmp(cmd, "stats") == 0) {
+        print_stats(out);
+        return NULL;
+    }
+    
+    if (strcmp(cmd, "cache-size") == 0) {
+        // 单位MB，缩小时在线淘汰，不清空缓存
+        if (parse_count(arg, 1, 1L << 20, &n) != 0) return "usage: cache-size MB";
+        if (cache_set_max_size(admin.cache, (size_t)n * 1024 * 1024) != 0) {
+            return "size not supported by this cache";
+        }
+        log_message(LOG_INFO, "缓存容量调整为 %ld MB", n);
+        return NULL;
+    }
+    
+    if (strcmp(cmd, "threads") == 0 || strcmp(cmd, "disk-threads") == 0) {
+        threadpool_t *pool = cmd[0] == 't' ? admin.pool : admin.disk_pool;
+        if (!pool) return "pool not running";
+        if (parse_count(arg, 1, MAX_THREADS, &n) != 0) return "thread count out of range";
+        if (threadpool_resize(pool, (int)n) != 0) return "resize failed";
+        log_message(LOG_INFO, "%s 调整为 %ld", cmd, n);
+        return NULL;
+    }
+    
+    if (strcmp(cmd, "policy") == 0) {
+        if (!arg) return "usage: policy lru|lfu|gdsf|auto";
+        if (admin.cache->shared) return "unsupported in shared cache mode";
+        if (strcasecmp(arg, "auto") == 0) {
+            return cache_set_adaptive(admin.cache, 1) == 0 ? NULL : "adaptive mode unavailable";
+        }
+        
+        cache_algorithm_t algorithm;
+        if (strcasecmp(arg, "lru") == 0) algorithm = LRU;
+        else if (strcasecmp(arg, "lfu") == 0) algorithm = LFU;
+        else if (strcasecmp(arg, "gdsf") == 0) algorithm = GDSF;
+        else return "unknown policy";
+        
+        // 手动指定算法时关闭自适应选择
+        if (admin.cache->adaptive) cache_set_adaptive(admin.cache, 0);
+        cache_set_algorithm(admin.cache, algorithm);
+        log_message(LOG_INFO, "缓存算法切换为 %s", cache_algorithm_name(algorithm));
+        return NULL;
+    }
+    
+    if (strcmp(cmd, "admission") == 0) {
+        if (!arg || (strcmp(arg, "on") != 0 && strcmp(arg, "off") != 0)) {
+            return "usage: admission on|off";
+        }
+        return cache_set_admission(admin.cache, arg[1] == 'n') == 0 ? NULL : "admission filter unavailable";
+    }
+    
+    if (strcmp(cmd, "top") == 0) {
+        if (!admin.hitters) return "hot path tracking unavailable";
+        return print_top(arg, &save, out);
+    }
+    
+    if (strcmp(cmd, "hot-list") == 0) {
+        // 写成-W可用的热点列表，下次启动按访问热度预热
+        if (!admin.hitters) return "hot path tracking unavailable";
+        if (!arg) return "usage: hot-list FILE [N]";
+        char *count = strtok_r(NULL, " \t\r\n", &save);
+        n = HITTERS_DEFAULT_TOP;
+        if (count && parse_count(count, 1, HITTERS_CAPACITY, &n) != 0) {
+            return "usage: hot-list FILE [N]";
+        }
+        int written = hitters_dump(admin.hitters, arg, (int)n);
+        if (written < 0) return "cannot write hot list";
+        fprintf(out, "wrote %d paths to %s\n", written, arg);
+        return NULL;
+    }
+    
+    if (strcmp(cmd, "help") == 0) {
+        fprintf(out, "stats\ncache-size MB\nthreads N\ndisk-threads N\n"
+                "policy lru|lfu|gdsf|auto\nadmission on|off\n"
+                "top [N] [requests|misses|bytes|time]\nhot-list FILE [N]\n");
+        return NULL;
+    }
+    
+    return "unknown command";
+}
+
+static void serve_connection(int conn) {
+    // 只接受同一用户的进程
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0 || cred.uid != geteuid()) {
+        close(conn);
+        return;
+    }
+    
+    int out_fd = dup(conn);
+    FILE *in = fdopen(conn, "r");
+    FILE *out = out_fd >= 0 ? fdopen(out_fd, "w") : NULL;
+    if (!in || !out) {
+        if (in) fclose(in);
+        else close(conn);
+        if (out) fclose(out);
+        else if (out_fd >= 0) close(out_fd);
+        return;
+    }
+    
+    char line[ADMIN_MAX_LINE];
+    while (fgets(line, sizeof(line), in)) {
+        const char *error = run_command(line, out);
+        if (error) fprintf(out, "ERR %s\n", error);
+        else fprintf(out, "OK\n");
+        if (fflush(out) != 0) break;
+    }
+    
+    fclose(out);
+    fclose(in);
+}
+
+static void *admin_thread(void *arg) {
+    (void)arg;
+    while (1) {
+        int conn = accept4(admin.sock_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (conn < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;  // admin_stop关闭了socket
+        }
+        
+        __atomic_store_n(&admin.conn_fd, conn, __ATOMIC_RELEASE);
+        serve_connection(conn);
+        __atomic_store_n(&admin.conn_fd, -1, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+int admin_start(const char *path, cache_t *cache, threadpool_t *pool, threadpool_t *disk_pool,
+                hitters_t *hitters) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0) return -1;
+    
+    unlink(path);
+    mode_t old_umask = umask(077);
+    int ret = bind(sock, (struct sockaddr *)&addr, sizeof(addr));
+    umask(old_umask);
+    
+    struct stat st;
+    if (ret != 0 || listen(sock, 4) != 0 || stat(path, &st) != 0) {
+        close(sock);
+        return -1;
+    }
+    
+    admin.sock_fd = sock;
+    admin.cache = cache;
+    admin.pool = pool;
+    admin.disk_pool = disk_pool;
+    admin.hitters = hitters;
+    admin.inode = st.st_ino;
+    snprintf(admin.path, sizeof(admin.path), "%s", path);
+    
+    if (pthread_create(&admin.thread, NULL, admin_thread, NULL) != 0) {
+        close(sock);
+        unlink(path);
+        admin.sock_fd = -1;
+        return -1;
+    }
+    admin.running = 1;
+    return 0;
+}
+
+void admin_stop(void) {
+    if (!admin.running) return;
+    
+    // shutdown唤醒阻塞在accept或读取命令中的线程
+    shutdown(admin.sock_fd, SHUT_RDWR);
+    int conn = __atomic_load_n(&admin.conn_fd, __ATOMIC_ACQUIRE);
+    if (conn >= 0) shutdown(conn, SHUT_RDWR);
+    pthread_join(admin.thread, NULL);
+    close(admin.sock_fd);
+    admin.sock_fd = -1;
+    admin.running = 0;
+    
+    struct stat st;
+    if (stat(admin.path, &st) == 0 && st.st_ino == admin.inode) unlink(admin.path);
+}
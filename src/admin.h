@@ -0,0 +1,16 @@
+#ifndef ADMIN_H
+#define ADMIN_H
+
+#include "cache.h"
+#include "threadpool.h"
+#include "hitters.h"
+
+// 本地管理接口: Unix socket上的行命令协议，运行中调整缓存容量、线程数和策略，查看热点路径
+// 每条命令回复零或多行信息，最后一行为"OK"或"ERR 原因"，例如:
+//   echo "cache-size 256" | nc -U /run/llab.sock
+// hitters为NULL时top和hot-list不可用
+int admin_start(const char *path, cache_t *cache, threadpool_t *pool, threadpool_t *disk_pool,
+                hitters_t *hitters);
+void admin_stop(void);
+
+#endif
@@ -0,0 +1,786 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <dirent.h>
+#include <getopt.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// 端到端性能测试: 每个场景启动一个新的服务器进程，按场景发送请求，
+// 记录吞吐、延迟分位数和服务器的CPU/内存，结果写成JSON并可与基线比较
+
+#define BENCH_DEFAULT_PORT 8190
+#define BENCH_MAX_FILES 64
+#define BENCH_HEADER_MAX 4096
+#define BENCH_START_TIMEOUT_MS 5000          // 等待服务器开始监听的时限
+#define BENCH_RUN_TIMEOUT_MS 60000           // 单个场景的时限，未完成的请求计为错误
+#define BENCH_STOP_TIMEOUT_MS 15000          // SIGTERM后等待服务器排空退出的时限
+#define BENCH_P99_FLOOR_MS 1.0               // p99变化小于该值时不视为退步(避免微秒级抖动误报)
+
+typedef struct {
+    const char *name;
+    const char *path;          // NULL表示轮流请求文档根目录下的所有文件
+    const char *algorithm;     // 服务器的缓存算法(-a)
+    int warm;                  // 1: 测量前先发送一轮预热请求；0: 冷启动，并丢弃文档的页缓存
+    int keep_alive;            // 0: 每个请求新建连接
+    int concurrency;
+    int requests;
+    int cache_percent;         // 服务器缓存容量占文档集大小的百分比(-C)，0表示默认容量
+} scenario_t;
+
+// 场景矩阵: 响应体大小、冷/热缓存、缓存算法、短连接/长连接、并发数
+// 比较LRU和LFU的两个混合场景缓存装不下整个文档集，否则没有淘汰，两种算法的差别测不出来
+static const scenario_t scenarios[] = {
+    {"small-warm-keepalive-c50",  "/small.html",  "lru", 1, 1, 50, 20000, 0},
+    {"medium-warm-keepalive-c50", "/medium.html", "lru", 1, 1, 50, 10000, 0},
+    {"large-warm-keepalive-c50",  "/large.html",  "lru", 1, 1, 50, 2000, 0},
+    {"mixed-cold-keepalive-c50",  NULL,           "lru", 0, 1, 50, 2000, 0},
+    {"mixed-warm-keepalive-c50",  NULL,           "lru", 1, 1, 50, 2000, 20},
+    {"mixed-warm-lfu-c50",        NULL,           "lfu", 1, 1, 50, 2000, 20},
+    {"small-warm-churn-c50",      "/small.html",  "lru", 1, 0, 50, 5000, 0},
+    {"small-warm-keepalive-c1",   "/small.html",  "lru", 1, 1, 1,  5000, 0},
+    {"small-warm-keepalive-c10",  "/small.html",  "lru", 1, 1, 10, 10000, 0},
+    {"small-warm-keepalive-c100", "/small.html",  "lru", 1, 1, 100, 20000, 0},
+    {"small-warm-keepalive-c200", "/small.html",  "lru", 1, 1, 200, 20000, 0},
+};
+
+#define SCENARIO_COUNT (sizeof(scenarios) / sizeof(scenarios[0]))
+
+typedef struct {
+    double seconds;
+    int completed;
+    int errors;
+    unsigned long long bytes;
+    double rps;
+    double mbps;
+    double p50_ms, p90_ms, p99_ms, p999_ms, max_ms;
+    double server_cpu_ms;
+    double cpu_us_per_req;
+    long rss_kb;
+    long peak_rss_kb;
+    size_t cache_kb;           // 服务器缓存容量，0表示默认容量
+} result_t;
+
+// 一个客户端连接: 发送请求后读取响应头，按Content-Length读完响应体
+typedef struct {
+    int fd;
+    int busy;                  // 有未完成的请求
+    int connecting;
+    uint64_t start_ns;
+    char header[BENCH_HEADER_MAX];
+    size_t header_len;
+    long long body_left;       // <0表示还在读取响应头
+    int status;
+} bench_conn_t;
+
+typedef struct {
+    const scenario_t *scenario;
+    struct sockaddr_in addr;
+    char (*paths)[256];
+    int path_count;
+    int epoll_fd;
+    bench_conn_t *conns;
+    int total;                 // 本轮要完成的请求数
+    int issued;
+    int completed;
+    int errors;
+    unsigned long long bytes;
+    uint32_t *latency_us;      // 每个完成请求的延迟
+} load_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// 文件名按URL编码写入请求路径(字母数字和-._~以外的字符写成%XX)
+static int encode_path(char *out, size_t size, const char *name) {
+    static const char hex[] = "0123456789ABCDEF";
+    size_t len = 0;
+    out[len++] = '/';
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        if (len + 4 > size) return -1;
+        if ((*p >= '0' && *p <= '9') || (*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') ||
+            strchr("-._~", *p)) {
+            out[len++] = *p;
+        } else {
+            out[len++] = '%';
+            out[len++] = hex[*p >> 4];
+            out[len++] = hex[*p & 15];
+        }
+    }
+    out[len] = '\0';
+    return 0;
+}
+
+// 收集文档根目录下的常规文件(混合场景轮流请求)，*total_bytes为这些文件的总大小
+static int collect_paths(const char *root, char (*paths)[256], int max, size_t *total_bytes) {
+    DIR *d = opendir(root);
+    if (!d) return -1;
+    
+    int count = 0;
+    struct dirent *entry;
+    *total_bytes = 0;
+    while ((entry = readdir(d)) != NULL && count < max) {
+        char full[1024];
+        struct stat st;
+        snprintf(full, sizeof(full), "%s/%s", root, entry->d_name);
+        if (stat(full, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size == 0) continue;
+        if (encode_path(paths[count], 256, entry->d_name) == 0) {
+            count++;
+            *total_bytes += st.st_size;
+        }
+    }
+    closedir(d);
+    return count;
+}
+
+// 冷启动场景: 丢弃文档在页缓存中的干净页，让服务器真正从磁盘读取
+static void drop_page_cache(const char *root) {
+    DIR *d = opendir(root);
+    if (!d) return;
+    
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        char full[1024];
+        snprintf(full, sizeof(full), "%s/%s", root, entry->d_name);
+        int fd = open(full, O_RDONLY);
+        if (fd < 0) continue;
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+    closedir(d);
+}
+
+// ---------------- 服务器进程 ----------------
+
+// cache_kb为0时使用服务器的默认缓存容量
+static pid_t start_server(const char *server, const char *root, int port, const char *algorithm,
+                          size_t cache_kb) {
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        // 服务器的请求日志输出到stdout，测试时丢弃
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDOUT_FILENO);
+            dup2(null_fd, STDERR_FILENO);
+            close(null_fd);
+        }
+        char port_arg[16], cache_arg[32];
+        snprintf(port_arg, sizeof(port_arg), "%d", port);
+        snprintf(cache_arg, sizeof(cache_arg), "%zuK", cache_kb);
+        if (cache_kb > 0) {
+            execl(server, server, "-p", port_arg, "-d", root, "-a", algorithm, "-C", cache_arg,
+                  (char *)NULL);
+        } else {
+            execl(server, server, "-p", port_arg, "-d", root, "-a", algorithm, (char *)NULL);
+        }
+        _exit(127);
+    }
+    
+    // 等待端口可以连接
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    
+    uint64_t deadline = now_ns() + (uint64_t)BENCH_START_TIMEOUT_MS * 1000000;
+    while (now_ns() < deadline) {
+        int status;
+        if (waitpid(pid, &status, WNOHANG) == pid) return -1;
+        
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+            close(fd);
+            return pid;
+        }
+        if (fd >= 0) close(fd);
+        usleep(20000);
+    }
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    return -1;
+}
+
+static void stop_server(pid_t pid) {
+    kill(pid, SIGTERM);
+    uint64_t deadline = now_ns() + (uint64_t)BENCH_STOP_TIMEOUT_MS * 1000000;
+    while (now_ns() < deadline) {
+        if (waitpid(pid, NULL, WNOHANG) == pid) return;
+        usleep(20000);
+    }
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+}
+
+// 服务器进程累计的CPU时间(毫秒): 各线程schedstat中的运行时间是纳秒精度，
+// 没有schedstat时退回/proc/PID/stat中以时钟滴答计的utime+stime
+static double process_cpu_ms(pid_t pid) {
+    char path[64], buf[1024];
+    snprintf(path, sizeof(path), "/proc/%d/task", (int)pid);
+    DIR *d = opendir(path);
+    if (d) {
+        unsigned long long total_ns = 0;
+        int threads = 0;
+        struct dirent *entry;
+        while ((entry = readdir(d)) != NULL) {
+            if (entry->d_name[0] == '.') continue;
+            char stat_path[300];
+            snprintf(stat_path, sizeof(stat_path), "/proc/%d/task/%s/schedstat", (int)pid, entry->d_name);
+            FILE *fp = fopen(stat_path, "r");
+            unsigned long long ns;
+            if (fp && fscanf(fp, "%llu", &ns) == 1) {
+                total_ns += ns;
+                threads++;
+            }
+            if (fp) fclose(fp);
+        }
+        closedir(d);
+        if (threads > 0) return total_ns / 1e6;
+    }
+    
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    FILE *fp = fopen(path, "r");
+    if (!fp) return 0;
+    size_t n = fread(buf, 1, sizeof(buf) - 1, fp);
+    fclose(fp);
+    buf[n] = '\0';
+    
+    // 进程名可能含空格，从最后一个')'之后解析: utime和stime是第14、15个字段
+    char *p = strrchr(buf, ')');
+    unsigned long utime = 0, stime = 0;
+    if (!p || sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+                     &utime, &stime) != 2) {
+        return 0;
+    }
+    return (utime + stime) * 1000.0 / sysconf(_SC_CLK_TCK);
+}
+
+// /proc/PID/status中的VmRSS(当前)和VmHWM(峰值)，单位KB
+static void process_rss_kb(pid_t pid, long *rss, long *peak) {
+    char path[64], line[256];
+    snprintf(path, sizeof(path), "/proc/%d/status", (int)pid);
+    *rss = *peak = 0;
+    FILE *fp = fopen(path, "r");
+    if (!fp) return;
+    while (fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, "VmRSS:", 6) == 0) *rss = atol(line + 6);
+        else if (strncmp(line, "VmHWM:", 6) == 0) *peak = atol(line + 6);
+    }
+    fclose(fp);
+}
+
+// ---------------- 负载发生器 ----------------
+
+static void close_conn(load_t *load, bench_conn_t *conn) {
+    if (conn->fd >= 0) {
+        epoll_ctl(load->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+        close(conn->fd);
+    }
+    conn->fd = -1;
+    conn->busy = 0;
+    conn->connecting = 0;
+}
+
+static int send_request(load_t *load, bench_conn_t *conn) {
+    const scenario_t *s = load->scenario;
+    const char *path = s->path ? s->path : load->paths[load->issued % load->path_count];
+    char request[512];
+    int len = snprintf(request, sizeof(request),
+                       "GET %s HTTP/1.1\r\nHost: localhost\r\nConnection: %s\r\n\r\n",
+                       path, s->keep_alive ? "keep-alive" : "close");
+    
+    conn->header_len = 0;
+    conn->body_left = -1;
+    conn->status = 0;
+    return write(conn->fd, request, len) == len ? 0 : -1;
+}
+
+// 开始下一个请求: 长连接复用已有的连接，否则新建(延迟包含建立连接的时间)
+static void start_request(load_t *load, bench_conn_t *conn) {
+    if (load->issued >= load->total) return;
+    
+    conn->busy = 1;
+    conn->start_ns = now_ns();
+    load->issued++;
+    
+    if (conn->fd >= 0) {
+        if (send_request(load, conn) == 0) return;
+        close_conn(load, conn);
+        load->errors++;
+        return;
+    }
+    
+    conn->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (conn->fd < 0) {
+        conn->busy = 0;
+        load->errors++;
+        return;
+    }
+    
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLOUT;
+    ev.data.ptr = conn;
+    int ret = connect(conn->fd, (struct sockaddr *)&load->addr, sizeof(load->addr));
+    if ((ret < 0 && errno != EINPROGRESS) ||
+        epoll_ctl(load->epoll_fd, EPOLL_CTL_ADD, conn->fd, &ev) < 0) {
+        close_conn(load, conn);
+        load->errors++;
+        return;
+    }
+    conn->connecting = 1;
+}
+
+// 处理收到的数据，响应完整时返回1，格式错误返回-1
+static int consume(bench_conn_t *conn, const char *data, size_t len, unsigned long long *bytes) {
+    *bytes += len;
+    if (conn->body_left >= 0) {
+        conn->body_left -= len;
+        return conn->body_left <= 0;
+    }
+    
+    size_t room = sizeof(conn->header) - 1 - conn->header_len;
+    size_t n = len < room ? len : room;
+    memcpy(conn->header + conn->header_len, data, n);
+    conn->header_len += n;
+    conn->header[conn->header_len] = '\0';
+    
+    char *end = strstr(conn->header, "\r\n\r\n");
+    if (!end) return n < len ? -1 : 0;
+    
+    if (sscanf(conn->header, "HTTP/%*s %d", &conn->status) != 1) return -1;
+    long long content_length = -1;
+    for (char *line = strstr(conn->header, "\r\n"); line && line < end; line = strstr(line + 2, "\r\n")) {
+        if (strncasecmp(line + 2, "Content-Length:", 15) == 0) {
+            content_length = atoll(line + 17);
+            break;
+        }
+    }
+    if (content_length < 0) return -1;
+    
+    // 响应头之后已经收到的响应体字节
+    size_t head = end + 4 - conn->header;
+    conn->body_left = content_length - (long long)(conn->header_len - head) - (long long)(len - n);
+    return conn->body_left <= 0;
+}
+
+static void handle_readable(load_t *load, bench_conn_t *conn) {
+    // 请求都已完成后服务器关闭空闲的长连接
+    if (!conn->busy) {
+        close_conn(load, conn);
+        return;
+    }
+    
+    char buf[65536];
+    for (;;) {
+        ssize_t n = read(conn->fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) return;
+        
+        int done = n > 0 ? consume(conn, buf, n, &load->bytes) : -1;
+        if (done == 0) continue;
+        
+        if (done > 0 && conn->status == 200) {
+            load->latency_us[load->completed++] = (uint32_t)((now_ns() - conn->start_ns) / 1000);
+        } else {
+            load->errors++;
+        }
+        
+        // 出错或短连接时关闭，长连接继续发送下一个请求
+        conn->busy = 0;
+        if (done < 0 || conn->status != 200 || !load->scenario->keep_alive) close_conn(load, conn);
+        start_request(load, conn);
+        return;
+    }
+}
+
+static void handle_writable(load_t *load, bench_conn_t *conn) {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+    
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = conn;
+    conn->connecting = 0;
+    if (err != 0 || epoll_ctl(load->epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev) < 0 ||
+        send_request(load, conn) != 0) {
+        close_conn(load, conn);
+        load->errors++;
+        start_request(load, conn);
+    }
+}
+
+// 发送total个请求并等待全部完成，返回用时(秒)
+static double run_load(load_t *load, int total) {
+    const scenario_t *s = load->scenario;
+    load->total = total;
+    load->issued = load->completed = load->errors = 0;
+    load->bytes = 0;
+    
+    uint64_t start = now_ns();
+    for (int i = 0; i < s->concurrency; i++) start_request(load, &load->conns[i]);
+    
+    struct epoll_event events[256];
+    uint64_t deadline = start + (uint64_t)BENCH_RUN_TIMEOUT_MS * 1000000;
+    while (load->completed + load->errors < total) {
+        // 连接全部失败时补发请求
+        for (int i = 0; i < s->concurrency; i++) {
+            if (!load->conns[i].busy) start_request(load, &load->conns[i]);
+        }
+        if (now_ns() >= deadline) {
+            load->errors += total - load->completed - load->errors;
+            break;
+        }
+        
+        int n = epoll_wait(load->epoll_fd, events, 256, 100);
+        for (int i = 0; i < n; i++) {
+            bench_conn_t *conn = events[i].data.ptr;
+            if (conn->fd < 0) continue;
+            if (conn->connecting) {
+                if (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) handle_writable(load, conn);
+            } else if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+                handle_readable(load, conn);
+            }
+        }
+    }
+    double seconds = (now_ns() - start) / 1e9;
+    
+    for (int i = 0; i < s->concurrency; i++) close_conn(load, &load->conns[i]);
+    return seconds;
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double percentile_ms(const uint32_t *sorted, int count, double p) {
+    if (count == 0) return 0;
+    int index = (int)(p * (count - 1) + 0.5);
+    return sorted[index] / 1000.0;
+}
+
+static int run_scenario(const scenario_t *s, const char *server, const char *root, int port,
+                        char (*paths)[256], int path_count, size_t doc_bytes, int scale,
+                        result_t *result) {
+    int requests = s->requests / scale > s->concurrency ? s->requests / scale : s->concurrency;
+    if (!s->warm) drop_page_cache(root);
+    
+    size_t cache_kb = 0;
+    if (s->cache_percent > 0) {
+        cache_kb = doc_bytes / 100 * s->cache_percent / 1024;
+        if (cache_kb == 0) cache_kb = 1;
+    }
+    pid_t pid = start_server(server, root, port, s->algorithm, cache_kb);
+    if (pid < 0) {
+        fprintf(stderr, "%s: 服务器启动失败\n", s->name);
+        return -1;
+    }
+    
+    load_t load;
+    memset(&load, 0, sizeof(load));
+    load.scenario = s;
+    load.paths = paths;
+    load.path_count = path_count;
+    load.addr.sin_family = AF_INET;
+    load.addr.sin_port = htons(port);
+    load.addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    load.epoll_fd = epoll_create1(0);
+    load.conns = calloc(s->concurrency, sizeof(bench_conn_t));
+    load.latency_us = malloc(sizeof(uint32_t) * (requests > path_count ? requests : path_count));
+    if (load.epoll_fd < 0 || !load.conns || !load.latency_us) {
+        stop_server(pid);
+        return -1;
+    }
+    for (int i = 0; i < s->concurrency; i++) load.conns[i].fd = -1;
+    
+    // 预热: 每个文件都至少请求过，缓存和页缓存中已有数据
+    if (s->warm) run_load(&load, requests / 10 > path_count ? requests / 10 : path_count);
+    
+    double cpu_before = process_cpu_ms(pid);
+    memset(result, 0, sizeof(*result));
+    result->seconds = run_load(&load, requests);
+    result->server_cpu_ms = process_cpu_ms(pid) - cpu_before;
+    process_rss_kb(pid, &result->rss_kb, &result->peak_rss_kb);
+    result->cache_kb = cache_kb;
+    stop_server(pid);
+    
+    result->completed = load.completed;
+    result->errors = load.errors;
+    result->bytes = load.bytes;
+    result->rps = load.completed / result->seconds;
+    result->mbps = load.bytes / result->seconds / (1024 * 1024);
+    result->cpu_us_per_req = load.completed ? result->server_cpu_ms * 1000 / load.completed : 0;
+    
+    qsort(load.latency_us, load.completed, sizeof(uint32_t), compare_u32);
+    result->p50_ms = percentile_ms(load.latency_us, load.completed, 0.50);
+    result->p90_ms = percentile_ms(load.latency_us, load.completed, 0.90);
+    result->p99_ms = percentile_ms(load.latency_us, load.completed, 0.99);
+    result->p999_ms = percentile_ms(load.latency_us, load.completed, 0.999);
+    result->max_ms = load.completed ? load.latency_us[load.completed - 1] / 1000.0 : 0;
+    
+    close(load.epoll_fd);
+    free(load.conns);
+    free(load.latency_us);
+    return 0;
+}
+
+// ---------------- 结果和基线 ----------------
+
+// 每个场景一行，便于直接diff两次结果，也便于逐行读取基线
+static void write_result(FILE *fp, const scenario_t *s, const result_t *r, int last) {
+    fprintf(fp, "    {\"name\": \"%s\", \"path\": \"%s\", \"algorithm\": \"%s\", "
+            "\"cache\": \"%s\", \"connection\": \"%s\", \"concurrency\": %d, "
+            "\"requests\": %d, \"errors\": %d, \"seconds\": %.3f, \"rps\": %.1f, \"mbps\": %.2f, "
+            "\"p50_ms\": %.3f, \"p90_ms\": %.3f, \"p99_ms\": %.3f, \"p999_ms\": %.3f, "
+            "\"max_ms\": %.3f, \"server_cpu_ms\": %.1f, \"cpu_us_per_req\": %.2f, "
+            "\"rss_kb\": %ld, \"peak_rss_kb\": %ld, \"cache_kb\": %zu}%s\n",
+            s->name, s->path ? s->path : "*", s->algorithm, s->warm ? "warm" : "cold",
+            s->keep_alive ? "keep-alive" : "close", s->concurrency, r->completed, r->errors,
+            r->seconds, r->rps, r->mbps, r->p50_ms, r->p90_ms, r->p99_ms, r->p999_ms,
+            r->max_ms, r->server_cpu_ms, r->cpu_us_per_req, r->rss_kb, r->peak_rss_kb,
+            r->cache_kb, last ? "" : ",");
+}
+
+static double json_number(const char *line, const char *key) {
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\": ", key);
+    const char *p = strstr(line, pattern);
+    return p ? strtod(p + strlen(pattern), NULL) : -1;
+}
+
+// 在基线文件中查找同名场景的一行
+static int find_baseline(FILE *fp, const char *name, char *line, size_t size) {
+    char pattern[128];
+    snprintf(pattern, sizeof(pattern), "\"name\": \"%s\"", name);
+    rewind(fp);
+    while (fgets(line, size, fp)) {
+        if (strstr(line, pattern)) return 0;
+    }
+    return -1;
+}
+
+// 变化超过容差时标记: higher_is_better决定哪个方向算退步
+static int regressed(double base, double now, double tolerance, int higher_is_better) {
+    if (base <= 0) return 0;
+    double change = (now - base) / base * 100;
+    return higher_is_better ? change < -tolerance : change > tolerance;
+}
+
+// 与基线逐个场景比较，返回退步的场景数
+static int compare_baseline(const char *path, const result_t *results, const int *ran,
+                            double tolerance) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "无法读取基线: %s\n", path);
+        return -1;
+    }
+    
+    printf("\n与基线比较 (%s，容差%.0f%%):\n", path, tolerance);
+    printf("%-28s %21s %21s %19s %19s\n", "场景", "rps", "p99(ms)", "CPU/请求(us)", "峰值RSS(KB)");
+    
+    int regressions = 0;
+    for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+        if (!ran[i]) continue;
+        const scenario_t *s = &scenarios[i];
+        const result_t *r = &results[i];
+        char line[2048];
+        if (find_baseline(fp, s->name, line, sizeof(line)) != 0) {
+            printf("%-28s (基线中没有该场景)\n", s->name);
+            continue;
+        }
+        
+        double base_rps = json_number(line, "rps");
+        double base_p99 = json_number(line, "p99_ms");
+        double base_cpu = json_number(line, "cpu_us_per_req");
+        double base_rss = json_number(line, "peak_rss_kb");
+        double base_errors = json_number(line, "errors");
+        
+        int bad = regressed(base_rps, r->rps, tolerance, 1) ||
+                  (regressed(base_p99, r->p99_ms, tolerance, 0) &&
+                   r->p99_ms - base_p99 > BENCH_P99_FLOOR_MS) ||
+                  regressed(base_cpu, r->cpu_us_per_req, tolerance, 0) ||
+                  regressed(base_rss, r->peak_rss_kb, tolerance, 0) ||
+                  r->errors > base_errors;
+        regressions += bad;
+        
+        printf("%-28s %9.0f -> %9.0f %9.3f -> %9.3f %8.2f -> %8.2f %8.0f -> %8ld %s\n",
+               s->name, base_rps, r->rps, base_p99, r->p99_ms, base_cpu, r->cpu_us_per_req,
+               base_rss, r->peak_rss_kb, bad ? "退步" : "");
+    }
+    fclose(fp);
+    return regressions;
+}
+
+static void print_usage(const char *program) {
+    printf("Usage: %s [OPTIONS]\n", program);
+    printf("Options:\n");
+    printf("  -s, --server PATH    Server binary (default: ./bin/webserver)\n");
+    printf("  -d, --dir DIR        Document root served during the runs (default: ./www)\n");
+    printf("  -p, --port PORT      Port for the server under test (default: %d)\n", BENCH_DEFAULT_PORT);
+    printf("  -o, --output FILE    Write results as JSON to FILE (default: benchmark.json)\n");
+    printf("  -b, --baseline FILE  Compare with a previous results file, exit 1 on regression\n");
+    printf("  -t, --tolerance PCT  Allowed change against the baseline (default: 10)\n");
+    printf("  -f, --filter TEXT    Only run scenarios whose name contains TEXT\n");
+    printf("  -q, --quick          Send a tenth of the requests (smoke run)\n");
+    printf("  -l, --list           List the scenarios and exit\n");
+    printf("  -h, --help           Show this help message\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *server = "./bin/webserver";
+    const char *root = "./www";
+    const char *output = "benchmark.json";
+    const char *baseline = NULL;
+    const char *filter = NULL;
+    double tolerance = 10;
+    int port = BENCH_DEFAULT_PORT;
+    int scale = 1;
+    
+    static struct option long_options[] = {
+        {"server", required_argument, 0, 's'},
+        {"dir", required_argument, 0, 'd'},
+        {"port", required_argument, 0, 'p'},
+        {"output", required_argument, 0, 'o'},
+        {"baseline", required_argument, 0, 'b'},
+        {"tolerance", required_argument, 0, 't'},
+        {"filter", required_argument, 0, 'f'},
+        {"quick", no_argument, 0, 'q'},
+        {"list", no_argument, 0, 'l'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+    
+    int opt;
+    while ((opt = getopt_long(argc, argv, "s:d:p:o:b:t:f:qlh", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 's':
+                server = optarg;
+                break;
+            case 'd':
+                root = optarg;
+                break;
+            case 'p':
+                port = atoi(optarg);
+                if (port <= 0 || port > 65535) {
+                    fprintf(stderr, "Invalid port number: %s\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            case 'b':
+                baseline = optarg;
+                break;
+            case 't':
+                tolerance = atof(optarg);
+                if (tolerance <= 0) {
+                    fprintf(stderr, "Invalid tolerance: %s\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'f':
+                filter = optarg;
+                break;
+            case 'q':
+                scale = 10;
+                break;
+            case 'l':
+                for (size_t i = 0; i < SCENARIO_COUNT; i++) printf("%s\n", scenarios[i].name);
+                return 0;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 2;
+        }
+    }
+    
+    if (access(server, X_OK) != 0) {
+        fprintf(stderr, "Server binary not found: %s\n", server);
+        return 2;
+    }
+    
+    static char paths[BENCH_MAX_FILES][256];
+    size_t doc_bytes;
+    int path_count = collect_paths(root, paths, BENCH_MAX_FILES, &doc_bytes);
+    if (path_count <= 0) {
+        fprintf(stderr, "No files to request in %s\n", root);
+        return 2;
+    }
+    
+    // 服务器关闭连接时不因SIGPIPE退出
+    signal(SIGPIPE, SIG_IGN);
+    
+    result_t results[SCENARIO_COUNT];
+    int ran[SCENARIO_COUNT] = {0};
+    int failed = 0;
+    
+    printf("%-28s %9s %7s %9s %9s %9s %10s %11s\n",
+           "场景", "rps", "错误", "p50(ms)", "p99(ms)", "max(ms)", "CPU/请求", "峰值RSS(KB)");
+    for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+        const scenario_t *s = &scenarios[i];
+        if (filter && !strstr(s->name, filter)) continue;
+        if (run_scenario(s, server, root, port, paths, path_count, doc_bytes, scale,
+                         &results[i]) != 0) {
+            failed++;
+            continue;
+        }
+        ran[i] = 1;
+        
+        const result_t *r = &results[i];
+        printf("%-28s %9.0f %7d %9.3f %9.3f %9.3f %8.2fus %11ld\n", s->name, r->rps, r->errors,
+               r->p50_ms, r->p99_ms, r->max_ms, r->cpu_us_per_req, r->peak_rss_kb);
+        fflush(stdout);
+    }
+    
+    FILE *fp = fopen(output, "w");
+    if (!fp) {
+        perror(output);
+        return 2;
+    }
+    time_t now = time(NULL);
+    char timestamp[32];
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    fprintf(fp, "{\n  \"server\": \"%s\",\n  \"document_root\": \"%s\",\n"
+            "  \"timestamp\": \"%s\",\n  \"quick\": %s,\n  \"scenarios\": [\n",
+            server, root, timestamp, scale > 1 ? "true" : "false");
+    int remaining = 0;
+    for (size_t i = 0; i < SCENARIO_COUNT; i++) remaining += ran[i];
+    for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+        if (ran[i]) write_result(fp, &scenarios[i], &results[i], --remaining == 0);
+    }
+    fprintf(fp, "  ]\n}\n");
+    fclose(fp);
+    printf("结果已写入 %s\n", output);
+    
+    if (failed) return 2;
+    if (baseline) {
+        int regressions = compare_baseline(baseline, results, ran, tolerance);
+        if (regressions < 0) return 2;
+        if (regressions > 0) {
+            printf("%d个场景超出容差\n", regressions);
+            return 1;
+        }
+        printf("没有超出容差的退步\n");
+    }
+    return 0;
+}
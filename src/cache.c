@@ -4,36 +4,75 @@
 #include <unistd.h>
 #include <time.h>
 #include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <malloc.h>
 #include "cache.h"
+#include "shm_cache.h"
 
 // 哈希函数
-static unsigned int hash(const char *key) {
+unsigned int cache_key_hash(const char *key) {
     unsigned int hash = 0;
     while (*key) {
         hash = (hash << 5) + hash + *key++;
     }
+    return hash;
+}
+
+static unsigned int bucket(unsigned int hash) {
     return hash % HASH_TABLE_SIZE;
 }
 
-// 创建新缓存项
-static cache_item_t *create_item(const char *key, void *data, size_t size) {
+// glibc每个分配块的头部开销，malloc_usable_size不包含
+#define CHUNK_OVERHEAD sizeof(size_t)
+
+// 缓存项实际占用的内存: 映射数据按页计算(文件页同样计入cgroup)，影子缓存按数据大小模拟
+static size_t item_charge(cache_item_t *item) {
+    size_t charge = malloc_usable_size(item) + malloc_usable_size(item->key) + 2 * CHUNK_OVERHEAD;
+    if (item->mapped) {
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        charge += (item->size + page - 1) / page * page;
+    } else if (item->data) {
+        charge += malloc_usable_size(item->data) + CHUNK_OVERHEAD;
+    } else {
+        charge += item->size;
+    }
+    return charge;
+}
+
+// 创建新缓存项，data为NULL时只记录元数据(影子缓存)，mapped时直接接管映射
+static cache_item_t *create_item(const char *key, unsigned int hash, void *data, size_t size,
+                                 time_t mtime, const char *etag, int mapped) {
     cache_item_t *item = malloc(sizeof(cache_item_t));
     if (!item) return NULL;
     
     item->key = strdup(key);
-    item->data = malloc(size);
-    if (!item->data || !item->key) {
+    item->hash = hash;
+    item->mapped = mapped && data;
+    item->data = item->mapped ? data : data ? malloc(size) : NULL;
+    if ((data && !item->data) || !item->key) {
         free(item->key);
-        free(item->data);
+        if (!item->mapped) free(item->data);
         free(item);
         return NULL;
     }
     
-    memcpy(item->data, data, size);
+    if (data && !item->mapped) memcpy(item->data, data, size);
     item->size = size;
     item->timestamp = time(NULL);
     item->frequency = 1;
+    item->refcount = 0;
+    item->detached = 0;
+    item->mtime = mtime;
+    snprintf(item->etag, sizeof(item->etag), "%s", etag ? etag : "");
     item->prev = item->next = item->h_next = NULL;
+    item->priority = 0;
+    item->heap_index = -1;
+    item->epoch = 0;
+    item->shared = 0;
+    item->charge = item_charge(item);
     
     return item;
 }
@@ -42,21 +81,115 @@ static cache_item_t *create_item(const char *key, void *data, size_t size) {
 static void free_item(cache_item_t *item) {
     if (!item) return;
     free(item->key);
-    free(item->data);
+    if (item->mapped) {
+        munmap(item->data, item->size);
+    } else {
+        free(item->data);
+    }
     free(item);
 }
 
-// 从链表中移除项
+// 回收已脱离缓存的项：仍被引用时延迟到cache_release释放
+static void retire_item(cache_item_t *item) {
+    if (item->refcount > 0) {
+        item->detached = 1;
+    } else {
+        free_item(item);
+    }
+}
+
+// GDSF最小堆操作
+static void heap_swap(cache_t *cache, unsigned int a, unsigned int b) {
+    cache_item_t *tmp = cache->heap[a];
+    cache->heap[a] = cache->heap[b];
+    cache->heap[b] = tmp;
+    cache->heap[a]->heap_index = a;
+    cache->heap[b]->heap_index = b;
+}
+
+static void heap_up(cache_t *cache, unsigned int i) {
+    while (i > 0) {
+        unsigned int parent = (i - 1) / 2;
+        if (cache->heap[parent]->priority <= cache->heap[i]->priority) break;
+        heap_swap(cache, i, parent);
+        i = parent;
+    }
+}
+
+static void heap_down(cache_t *cache, unsigned int i) {
+    for (;;) {
+        unsigned int left = 2 * i + 1;
+        unsigned int right = left + 1;
+        unsigned int smallest = i;
+        if (left < cache->heap_count &&
+            cache->heap[left]->priority < cache->heap[smallest]->priority) smallest = left;
+        if (right < cache->heap_count &&
+            cache->heap[right]->priority < cache->heap[smallest]->priority) smallest = right;
+        if (smallest == i) break;
+        heap_swap(cache, i, smallest);
+        i = smallest;
+    }
+}
+
+// 插入前保证堆容量不小于项目数，之后任何项放入堆都不会失败，
+// 否则已链入缓存却不在堆中的项永远不会被GDSF淘汰
+static int heap_reserve(cache_t *cache, unsigned int count) {
+    if (count <= cache->heap_capacity) return 0;
+    
+    unsigned int capacity = cache->heap_capacity ? cache->heap_capacity : 256;
+    while (capacity < count) capacity *= 2;
+    cache_item_t **heap = realloc(cache->heap, capacity * sizeof(cache_item_t *));
+    if (!heap) return -1;
+    cache->heap = heap;
+    cache->heap_capacity = capacity;
+    return 0;
+}
+
+// 容量已由heap_reserve保证(堆中的项不会多于缓存中的项)
+static void heap_push(cache_t *cache, cache_item_t *item) {
+    item->heap_index = cache->heap_count;
+    cache->heap[cache->heap_count++] = item;
+    heap_up(cache, item->heap_index);
+}
+
+static void heap_remove(cache_t *cache, cache_item_t *item) {
+    unsigned int i = item->heap_index;
+    unsigned int last = --cache->heap_count;
+    
+    if (i != last) {
+        heap_swap(cache, i, last);
+        heap_down(cache, i);
+        heap_up(cache, i);
+    }
+    item->heap_index = -1;
+}
+
+// 从链表中移除项(可能在切换算法前的旧链表中，旧链表中的项不在当前的堆中)
 static void remove_from_list(cache_t *cache, cache_item_t *item) {
+    int stale = item->epoch != cache->epoch;
+    cache_item_t **head = stale ? &cache->old_head : &cache->head;
+    cache_item_t **tail = stale ? &cache->old_tail : &cache->tail;
+    
     if (item->prev) item->prev->next = item->next;
     if (item->next) item->next->prev = item->prev;
-    if (cache->head == item) cache->head = item->next;
-    if (cache->tail == item) cache->tail = item->prev;
+    if (*head == item) *head = item->next;
+    if (*tail == item) *tail = item->prev;
+    if (!stale && item->heap_index >= 0) heap_remove(cache, item);
+    item->prev = item->next = NULL;
 }
 
-// 添加到链表头部(LRU)或根据频率排序(LFU)
+// 添加到链表头部(LRU/GDSF)或根据频率排序(LFU)，GDSF另外按优先级放入堆
 static void add_to_list(cache_t *cache, cache_item_t *item) {
-    if (cache->algorithm == LRU) {
+    item->epoch = cache->epoch;
+    item->heap_index = -1;
+    if (cache->algorithm == GDSF) {
+        // 大对象的优先级低，先被淘汰；老化值L让长期不访问的项逐渐落后
+        item->priority = cache->inflation +
+                         (double)item->frequency * GDSF_MISS_COST / (double)item->size;
+        heap_push(cache, item);
+    }
+    
+    if (cache->algorithm == LRU || cache->algorithm == GDSF) {
         // LRU: 新项添加到头部
         item->next = cache->head;
         item->prev = NULL;
@@ -89,14 +222,25 @@ static void add_to_list(cache_t *cache, cache_item_t *item) {
     }
 }
 
+// 下一个要被淘汰的项: 先淘汰切换算法后再没有被访问过的项(按原算法的顺序)，
+// 然后GDSF取优先级最低的项，其他算法取链表尾
+static cache_item_t *next_victim(cache_t *cache) {
+    if (cache->old_tail) return cache->old_tail;
+    if (cache->algorithm == GDSF && cache->heap_count > 0) return cache->heap[0];
+    return cache->tail;
+}
+
 // 淘汰缓存项
 static void evict_item(cache_t *cache) {
-    if (!cache->tail) return;
+    cache_item_t *victim = next_victim(cache);
+    if (!victim) return;
     
-    cache_item_t *victim = cache->tail;
+    if (cache->algorithm == GDSF && victim->epoch == cache->epoch) {
+        cache->inflation = victim->priority;
+    }
     
     // 从哈希表移除
-    unsigned int idx = hash(victim->key);
+    unsigned int idx = bucket(victim->hash);
     cache_item_t *curr = cache->table[idx];
     cache_item_t *prev = NULL;
     
@@ -114,10 +258,10 @@ static void evict_item(cache_t *cache) {
     remove_from_list(cache, victim);
     
     // 更新统计
-    cache->total_size -= victim->size;
+    cache->total_size -= victim->charge;
     cache->count--;
     
-    free_item(victim);
+    retire_item(victim);
 }
 
 cache_t *cache_create(size_t max_size, cache_algorithm_t algorithm) {
@@ -126,11 +270,31 @@ cache_t *cache_create(size_t max_size, cache_algorithm_t algorithm) {
     
     memset(cache->table, 0, sizeof(cache->table));
     cache->head = cache->tail = NULL;
+    cache->old_head = cache->old_tail = NULL;
+    cache->epoch = 0;
     cache->total_size = 0;
     cache->max_size = max_size;
     cache->count = 0;
     cache->algorithm = algorithm;
+    cache->heap = NULL;
+    cache->heap_count = 0;
+    cache->heap_capacity = 0;
+    cache->inflation = 0;
     pthread_mutex_init(&cache->lock, NULL);
+    cache->ghost = 0;
+    cache->adaptive = 0;
+    memset(cache->shadows, 0, sizeof(cache->shadows));
+    cache->window_requests = 0;
+    memset(cache->window_hits, 0, sizeof(cache->window_hits));
+    cache->adapt_switches = 0;
+    cache->sketch = NULL;
+    cache->admission_rejects = 0;
+    cache->misses = 0;
+    cache->hits = 0;
+    cache->hit_bytes = 0;
+    cache->miss_bytes = 0;
+    cache->shared = NULL;
+    cache->buffer_size = 0;
     
     return cache;
 }
@@ -138,62 +302,73 @@ cache_t *cache_create(size_t max_size, cache_algorithm_t algorithm) {
 void cache_destroy(cache_t *cache) {
     if (!cache) return;
     
+    for (int a = 0; a < CACHE_ALGORITHM_COUNT; a++) {
+        cache_destroy(cache->shadows[a]);
+    }
+    
     pthread_mutex_lock(&cache->lock);
     
-    // 清理所有缓存项
-    cache_item_t *item = cache->head;
-    while (item) {
-        cache_item_t *next = item->next;
-        free_item(item);
-        item = next;
+    // 清理所有缓存项(包括旧链表)
+    cache_item_t *lists[2] = { cache->head, cache->old_head };
+    for (int l = 0; l < 2; l++) {
+        cache_item_t *item = lists[l];
+        while (item) {
+            cache_item_t *next = item->next;
+            free_item(item);
+            item = next;
+        }
     }
     
     pthread_mutex_unlock(&cache->lock);
     pthread_mutex_destroy(&cache->lock);
+    sketch_destroy(cache->sketch);
+    free(cache->heap);
     free(cache);
 }
 
-int cache_put(cache_t *cache, const char *key, void *data, size_t size) {
-    if (!cache || !key || !data || size == 0) return -1;
-    
-    pthread_mutex_lock(&cache->lock);
-    
+// 插入或替换缓存项(调用者持有锁)，未通过准入过滤时返回1
+static int insert_locked(cache_t *cache, const char *key, unsigned int hash, void *data,
+                         size_t size, time_t mtime, const char *etag, int mapped) {
     // 检查是否已存在
-    unsigned int idx = hash(key);
+    unsigned int idx = bucket(hash);
+    unsigned int frequency = 1;
     cache_item_t *curr = cache->table[idx];
+    cache_item_t *prev = NULL;
     while (curr) {
-        if (strcmp(curr->key, key) == 0) {
-            // 更新现有项
-            free(curr->data);
-            curr->data = malloc(size);
-            if (!curr->data) {
-                pthread_mutex_unlock(&cache->lock);
-                return -1;
-            }
-            memcpy(curr->data, data, size);
-            curr->size = size;
-            curr->timestamp = time(NULL);
-            curr->frequency++;
-            
-            // 更新链表位置
+        if (curr->hash == hash && strcmp(curr->key, key) == 0) {
+            // 已存在: 旧项可能仍被发送中的请求引用，整体替换而不是原地改写数据
+            if (prev) prev->h_next = curr->h_next;
+            else cache->table[idx] = curr->h_next;
             remove_from_list(cache, curr);
-            add_to_list(cache, curr);
-            
-            pthread_mutex_unlock(&cache->lock);
-            return 0;
+            cache->total_size -= curr->charge;
+            cache->count--;
+            frequency = curr->frequency + 1;
+            retire_item(curr);
+            break;
         }
+        prev = curr;
         curr = curr->h_next;
     }
     
-    // 创建新项
-    cache_item_t *item = create_item(key, data, size);
-    if (!item) {
-        pthread_mutex_unlock(&cache->lock);
-        return -1;
+    // 准入过滤: 需要淘汰时，新对象的估计频率必须高于将被淘汰的对象
+    if (cache->sketch && frequency == 1 && next_victim(cache) &&
+        cache->total_size + size > cache->max_size) {
+        unsigned int candidate = sketch_estimate(cache->sketch, hash);
+        unsigned int victim = sketch_estimate(cache->sketch, next_victim(cache)->hash);
+        if (candidate <= victim) {
+            cache->admission_rejects++;
+            return 1;
+        }
     }
     
+    // 创建新项(先保证堆容量，插入失败时不留下不在堆中的项)
+    if (heap_reserve(cache, cache->count + 1) != 0) return -1;
+    cache_item_t *item = create_item(key, hash, cache->ghost ? NULL : data, size, mtime, etag, mapped);
+    if (!item) return -1;
+    item->frequency = frequency;
+    
     // 检查空间并淘汰
-    while (cache->total_size + size > cache->max_size && cache->count > 0) {
+    while (cache->total_size + item->charge > cache->max_size && cache->count > 0) {
         evict_item(cache);
     }
     
@@ -204,52 +379,217 @@ int cache_put(cache_t *cache, const char *key, void *data, size_t size) {
     // 添加到链表
     add_to_list(cache, item);
     
-    cache->total_size += size;
+    cache->total_size += item->charge;
     cache->count++;
+    return 0;
+}
+
+// 只查找，不更新访问信息(调用者持有锁)
+static cache_item_t *find_locked(cache_t *cache, const char *key, unsigned int hash) {
+    for (cache_item_t *item = cache->table[bucket(hash)]; item; item = item->h_next) {
+        if (item->hash == hash && strcmp(item->key, key) == 0) return item;
+    }
+    return NULL;
+}
+
+// 查找并更新访问信息(调用者持有锁)
+static cache_item_t *lookup_locked(cache_t *cache, const char *key, unsigned int hash) {
+    cache_item_t *item = find_locked(cache, key, hash);
+    if (item) {
+        // 更新访问信息
+        item->timestamp = time(NULL);
+        item->frequency++;
+        
+        // 更新链表位置
+        remove_from_list(cache, item);
+        add_to_list(cache, item);
+    }
+    return item;
+}
+
+// 只有被采样的key进入影子缓存，影子缓存的容量同比缩小
+static int is_sampled(unsigned int hash) {
+    // 短key的高位分布很差，先做一次混合再取模
+    unsigned int h = hash;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h % ADAPT_SAMPLE_RATE == 0;
+}
+
+// 切换算法(调用者持有锁): 不在锁内重新排序所有项，O(1)完成
+// 当前链表整体接到旧链表前面(比其中的项更近被访问)，之后被访问的项按新算法放入新链表，
+// 淘汰时先从旧链表尾部取，旧链表随访问和淘汰逐渐清空
+static void switch_algorithm_locked(cache_t *cache, cache_algorithm_t algorithm) {
+    if (cache->algorithm == algorithm) return;
+    cache->algorithm = algorithm;
+    cache->epoch++;
+    
+    // 旧链表中的项不在堆中，重新被访问时按新算法放入
+    cache->heap_count = 0;
+    
+    if (cache->head) {
+        if (cache->old_head) {
+            cache->tail->next = cache->old_head;
+            cache->old_head->prev = cache->tail;
+        } else {
+            cache->old_tail = cache->tail;
+        }
+        cache->old_head = cache->head;
+        cache->head = cache->tail = NULL;
+    }
+}
+
+// 一个窗口结束时比较各影子缓存的命中数，明显领先的算法接管真实缓存
+static void adapt_algorithm(cache_t *cache) {
+    cache_algorithm_t current = cache->algorithm;
+    cache_algorithm_t best = current;
+    
+    for (int a = 0; a < CACHE_ALGORITHM_COUNT; a++) {
+        if (cache->window_hits[a] > cache->window_hits[best]) best = (cache_algorithm_t)a;
+    }
+    
+    unsigned long base = cache->window_hits[current];
+    unsigned long margin = base * ADAPT_MARGIN_PERCENT / 100;
+    if (margin < ADAPT_MIN_GAIN) margin = ADAPT_MIN_GAIN;
+    
+    if (best != current && cache->window_hits[best] > base + margin) {
+        printf("自适应缓存: %s命中%lu次 > %s命中%lu次，切换为%s\n",
+               cache_algorithm_name(best), cache->window_hits[best],
+               cache_algorithm_name(current), base, cache_algorithm_name(best));
+        switch_algorithm_locked(cache, best);
+        cache->adapt_switches++;
+    }
+    
+    cache->window_requests = 0;
+    memset(cache->window_hits, 0, sizeof(cache->window_hits));
+}
+
+// 在各影子缓存上重放一次访问(调用者持有锁): 每个影子缓存都记录每次访问，
+// 在自己未命中时插入，命中率不受真实缓存当前算法的影响
+// 真实缓存命中时大小已知，直接插入；真实缓存也未命中时等到put_item得知大小再插入
+static void shadow_access(cache_t *cache, const char *key, unsigned int hash,
+                          const cache_item_t *item) {
+    if (!cache->adaptive || !is_sampled(hash)) return;
+    
+    for (int a = 0; a < CACHE_ALGORITHM_COUNT; a++) {
+        cache_t *shadow = cache->shadows[a];
+        if (lookup_locked(shadow, key, hash)) {
+            cache->window_hits[a]++;
+        } else if (item) {
+            insert_locked(shadow, key, hash, NULL, item->size, item->mtime, NULL, 0);
+        }
+    }
+    if (++cache->window_requests >= ADAPT_WINDOW) adapt_algorithm(cache);
+}
+
+static int put_item(cache_t *cache, const char *key, void *data, size_t size,
+                    time_t mtime, const char *etag, int mapped) {
+    if (!cache || !key || !data || size == 0) return -1;
+    
+    // 共享缓存总是复制数据，映射仍由调用者释放
+    if (cache->shared) {
+        int ret = shm_cache_put(cache->shared, key, data, size, mtime, etag);
+        return ret == 0 && mapped ? 1 : ret;
+    }
+    
+    pthread_mutex_lock(&cache->lock);
+    
+    unsigned int hash = cache_key_hash(key);
+    int ret = insert_locked(cache, key, hash, data, size, mtime, etag, mapped);
+    // 这次访问在shadow_access中已经计过，只补上未命中的影子缓存
+    if (ret >= 0 && cache->adaptive && is_sampled(hash)) {
+        for (int a = 0; a < CACHE_ALGORITHM_COUNT; a++) {
+            if (find_locked(cache->shadows[a], key, hash)) continue;
+            insert_locked(cache->shadows[a], key, hash, NULL, size, mtime, NULL, 0);
+        }
+    }
     
     pthread_mutex_unlock(&cache->lock);
-    return 0;
+    return ret;
+}
+
+int cache_put(cache_t *cache, const char *key, void *data, size_t size,
+              time_t mtime, const char *etag) {
+    return put_item(cache, key, data, size, mtime, etag, 0);
+}
+
+int cache_put_mapped(cache_t *cache, const char *key, void *map, size_t size,
+                     time_t mtime, const char *etag) {
+    return put_item(cache, key, map, size, mtime, etag, 1);
 }
 
 cache_item_t *cache_get(cache_t *cache, const char *key) {
+    return cache_lookup(cache, key, key ? cache_key_hash(key) : 0);
+}
+
+cache_item_t *cache_lookup(cache_t *cache, const char *key, unsigned int hash) {
     if (!cache || !key) return NULL;
     
+    if (cache->shared) {
+        // 共享路径不经过进程内的锁，统计用原子累加
+        cache_item_t *view = shm_cache_get(cache->shared, key);
+        if (view) {
+            __atomic_add_fetch(&cache->hits, 1, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&cache->hit_bytes, view->size, __ATOMIC_RELAXED);
+        }
+        return view;
+    }
+    
     pthread_mutex_lock(&cache->lock);
     
-    unsigned int idx = hash(key);
-    cache_item_t *item = cache->table[idx];
+    // 命中和未命中都计入频率草图
+    if (cache->sketch) sketch_increment(cache->sketch, hash);
     
-    while (item) {
-        if (strcmp(item->key, key) == 0) {
-            // 更新访问信息
-            item->timestamp = time(NULL);
-            item->frequency++;
-            
-            // 更新链表位置
-            remove_from_list(cache, item);
-            add_to_list(cache, item);
-            
-            pthread_mutex_unlock(&cache->lock);
-            return item;
-        }
-        item = item->h_next;
+    cache_item_t *item = lookup_locked(cache, key, hash);
+    if (item) {
+        item->refcount++;
+        cache->hits++;
+        cache->hit_bytes += item->size;
+    }
+    shadow_access(cache, key, hash, item);
+    
+    pthread_mutex_unlock(&cache->lock);
+    return item;
+}
+
+void cache_release(cache_t *cache, cache_item_t *item) {
+    if (!cache || !item) return;
+    
+    if (item->shared) {
+        shm_cache_release(cache->shared, item);
+        return;
+    }
+    
+    pthread_mutex_lock(&cache->lock);
+    
+    if (item->refcount > 0) item->refcount--;
+    if (item->refcount == 0 && item->detached) {
+        free_item(item);
     }
     
     pthread_mutex_unlock(&cache->lock);
-    return NULL;
 }
 
 void cache_remove(cache_t *cache, const char *key) {
     if (!cache || !key) return;
     
+    if (cache->shared) {
+        shm_cache_remove(cache->shared, key);
+        return;
+    }
+    
     pthread_mutex_lock(&cache->lock);
     
-    unsigned int idx = hash(key);
+    unsigned int hash = cache_key_hash(key);
+    unsigned int idx = bucket(hash);
     cache_item_t *curr = cache->table[idx];
     cache_item_t *prev = NULL;
     
     while (curr) {
-        if (strcmp(curr->key, key) == 0) {
+        if (curr->hash == hash && strcmp(curr->key, key) == 0) {
             // 从哈希表移除
             if (prev) prev->h_next = curr->h_next;
             else cache->table[idx] = curr->h_next;
@@ -258,10 +598,10 @@ void cache_remove(cache_t *cache, const char *key) {
             remove_from_list(cache, curr);
             
             // 更新统计
-            cache->total_size -= curr->size;
+            cache->total_size -= curr->charge;
             cache->count--;
             
-            free_item(curr);
+            retire_item(curr);
             break;
         }
         prev = curr;
@@ -274,32 +614,45 @@ void cache_remove(cache_t *cache, const char *key) {
 void cache_clear(cache_t *cache) {
     if (!cache) return;
     
+    if (cache->shared) {
+        shm_cache_clear(cache->shared);
+        return;
+    }
+    
     pthread_mutex_lock(&cache->lock);
     
-    // 清理所有缓存项
-    cache_item_t *item = cache->head;
-    while (item) {
-        cache_item_t *next = item->next;
-        free_item(item);
-        item = next;
+    // 清理所有缓存项(包括旧链表)
+    cache_item_t *lists[2] = { cache->head, cache->old_head };
+    for (int l = 0; l < 2; l++) {
+        cache_item_t *item = lists[l];
+        while (item) {
+            cache_item_t *next = item->next;
+            retire_item(item);
+            item = next;
+        }
     }
     
     // 重置缓存状态
     memset(cache->table, 0, sizeof(cache->table));
     cache->head = cache->tail = NULL;
+    cache->old_head = cache->old_tail = NULL;
     cache->total_size = 0;
     cache->count = 0;
+    cache->heap_count = 0;
+    cache->inflation = 0;
     
     pthread_mutex_unlock(&cache->lock);
 }
 
 size_t cache_get_size(cache_t *cache) {
     if (!cache) return 0;
+    if (cache->shared) return shm_cache_size(cache->shared);
     return cache->total_size;
 }
 
 unsigned int cache_get_count(cache_t *cache) {
     if (!cache) return 0;
+    if (cache->shared) return shm_cache_count(cache->shared);
     return cache->count;
 }
 
@@ -307,23 +660,410 @@ void cache_set_algorithm(cache_t *cache, cache_algorithm_t algorithm) {
     if (!cache) return;
     
     pthread_mutex_lock(&cache->lock);
+    switch_algorithm_locked(cache, algorithm);
+    pthread_mutex_unlock(&cache->lock);
+}
+
+cache_algorithm_t cache_get_algorithm(cache_t *cache) {
+    return cache ? cache->algorithm : DEFAULT_CACHE_ALGORITHM;
+}
+
+int cache_set_adaptive(cache_t *cache, int enabled) {
+    if (!cache) return -1;
     
-    if (cache->algorithm != algorithm) {
-        cache->algorithm = algorithm;
+    pthread_mutex_lock(&cache->lock);
+    
+    if (enabled && !cache->adaptive) {
+        // 每种算法一个只含元数据的影子缓存，模拟采样后的访问流
+        for (int a = 0; a < CACHE_ALGORITHM_COUNT; a++) {
+            cache->shadows[a] = cache_create(cache->max_size / ADAPT_SAMPLE_RATE,
+                                             (cache_algorithm_t)a);
+            if (!cache->shadows[a]) {
+                for (int b = 0; b < a; b++) {
+                    cache_destroy(cache->shadows[b]);
+                    cache->shadows[b] = NULL;
+                }
+                pthread_mutex_unlock(&cache->lock);
+                return -1;
+            }
+            cache->shadows[a]->ghost = 1;
+        }
+        cache->window_requests = 0;
+        memset(cache->window_hits, 0, sizeof(cache->window_hits));
+        cache->adaptive = 1;
+    } else if (!enabled && cache->adaptive) {
+        cache->adaptive = 0;
+        for (int a = 0; a < CACHE_ALGORITHM_COUNT; a++) {
+            cache_destroy(cache->shadows[a]);
+            cache->shadows[a] = NULL;
+        }
+    }
+    
+    pthread_mutex_unlock(&cache->lock);
+    return 0;
+}
+
+int cache_set_admission(cache_t *cache, int enabled) {
+    if (!cache) return -1;
+    
+    pthread_mutex_lock(&cache->lock);
+    
+    int ret = 0;
+    if (enabled && !cache->sketch) {
+        cache->sketch = sketch_create(ADMISSION_SKETCH_WIDTH);
+        if (!cache->sketch) ret = -1;
+    } else if (!enabled && cache->sketch) {
+        sketch_destroy(cache->sketch);
+        cache->sketch = NULL;
+    }
+    
+    pthread_mutex_unlock(&cache->lock);
+    return ret;
+}
+
+void cache_attach_shared(cache_t *cache, struct shm_cache *shared) {
+    if (!cache) return;
+    cache->shared = shared;
+}
+
+int cache_set_max_size(cache_t *cache, size_t max_size) {
+    if (!cache || max_size == 0) return -1;
+    if (cache->shared) return shm_cache_set_max_size(cache->shared, max_size);
+    
+    pthread_mutex_lock(&cache->lock);
+    cache->max_size = max_size;
+    
+    // 影子缓存不保存数据，随主缓存按采样比例一次调整到位
+    for (int a = 0; a < CACHE_ALGORITHM_COUNT; a++) {
+        cache_t *shadow = cache->shadows[a];
+        if (!shadow) continue;
+        shadow->max_size = max_size / ADAPT_SAMPLE_RATE;
+        while (shadow->total_size > shadow->max_size && shadow->count > 0) {
+            evict_item(shadow);
+        }
+    }
+    
+    // 每批淘汰后释放锁，避免大量淘汰时长时间阻塞请求
+    int done = 0;
+    while (!done) {
+        for (int i = 0; i < CACHE_EVICT_BATCH && cache->total_size > cache->max_size &&
+             cache->count > 0; i++) {
+            evict_item(cache);
+        }
+        done = cache->total_size <= cache->max_size || cache->count == 0;
+        pthread_mutex_unlock(&cache->lock);
+        if (!done) {
+            sched_yield();
+            pthread_mutex_lock(&cache->lock);
+        }
+    }
+    return 0;
+}
+
+size_t cache_get_max_size(cache_t *cache) {
+    if (!cache) return 0;
+    if (cache->shared) return shm_cache_max_size(cache->shared);
+    return cache->max_size;
+}
+
+const char *cache_algorithm_name(cache_algorithm_t algorithm) {
+    switch (algorithm) {
+        case LRU: return "LRU";
+        case LFU: return "LFU";
+        case GDSF: return "GDSF";
+        default: return "UNKNOWN";
+    }
+}
+
+void cache_note_miss(cache_t *cache, size_t size) {
+    if (!cache) return;
+    
+    __atomic_add_fetch(&cache->misses, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&cache->miss_bytes, size, __ATOMIC_RELAXED);
+}
+
+int cache_reserve_buffer(cache_t *cache, size_t size) {
+    if (!cache) return 0;
+    
+    size_t used = __atomic_add_fetch(&cache->buffer_size, size, __ATOMIC_RELAXED);
+    if (used > MISS_BUFFER_BUDGET) {
+        __atomic_sub_fetch(&cache->buffer_size, size, __ATOMIC_RELAXED);
+        return -1;
+    }
+    return 0;
+}
+
+void cache_release_buffer(cache_t *cache, size_t size) {
+    if (cache) __atomic_sub_fetch(&cache->buffer_size, size, __ATOMIC_RELAXED);
+}
+
+size_t cache_get_memory(cache_t *cache) {
+    if (!cache) return 0;
+    return cache_get_size(cache) + __atomic_load_n(&cache->buffer_size, __ATOMIC_RELAXED);
+}
+
+double cache_object_hit_ratio(cache_t *cache) {
+    if (!cache) return 0;
+    unsigned long total = cache->hits + cache->misses;
+    return total > 0 ? (double)cache->hits / total : 0;
+}
+
+double cache_byte_hit_ratio(cache_t *cache) {
+    if (!cache) return 0;
+    unsigned long long total = cache->hit_bytes + cache->miss_bytes;
+    return total > 0 ? (double)cache->hit_bytes / total : 0;
+}
+
+// 缓存快照文件格式(本机字节序): 文件头 + 每项(记录 + key + 数据)，每项按8字节对齐
+#define CACHE_FILE_MAGIC "LLABCSH1"
+#define CACHE_FILE_VERSION 2              // 2: key改为相对文档根目录的路径
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t algorithm;
+    uint64_t count;
+    double inflation;
+} cache_file_header_t;
+
+typedef struct {
+    uint32_t key_len;
+    uint32_t mapped;           // 1表示数据不在快照中，加载时重新映射原文件
+    uint64_t size;
+    uint64_t frequency;
+    int64_t timestamp;
+    int64_t mtime;
+    char etag[64];
+} cache_file_record_t;
+
+static size_t align8(size_t n) {
+    return (n + 7) & ~(size_t)7;
+}
+
+static int write_padded(FILE *fp, const void *data, size_t len) {
+    static const char zeros[8] = {0};
+    if (len > 0 && fwrite(data, 1, len, fp) != len) return -1;
+    size_t pad = align8(len) - len;
+    if (pad > 0 && fwrite(zeros, 1, pad, fp) != pad) return -1;
+    return 0;
+}
+
+// 保存时在锁内取得的一项: 引用计数保证数据在写出期间不被回收，可变字段先复制到record
+typedef struct {
+    cache_item_t *item;
+    cache_file_record_t record;
+} saved_item_t;
+
+static void fill_record(cache_file_record_t *record, const cache_item_t *item) {
+    memset(record, 0, sizeof(*record));
+    record->key_len = strlen(item->key);
+    record->mapped = item->mapped;
+    record->size = item->size;
+    record->frequency = item->frequency;
+    record->timestamp = item->timestamp;
+    record->mtime = item->mtime;
+    memcpy(record->etag, item->etag, sizeof(record->etag));
+}
+
+static int write_item(FILE *fp, const saved_item_t *saved) {
+    const cache_item_t *item = saved->item;
+    if (write_padded(fp, &saved->record, sizeof(saved->record)) != 0 ||
+        write_padded(fp, item->key, saved->record.key_len) != 0 ||
+        (!item->mapped && write_padded(fp, item->data, item->size) != 0)) {
+        return -1;
+    }
+    return 0;
+}
+
+// 锁内只收集项的引用和元数据，文件写入在锁外进行，不阻塞请求路径
+static int write_snapshot(cache_t *cache, FILE *fp) {
+    cache_file_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_FILE_MAGIC, sizeof(header.magic));
+    header.version = CACHE_FILE_VERSION;
+    
+    pthread_mutex_lock(&cache->lock);
+    
+    saved_item_t *saved = malloc((cache->count ? cache->count : 1) * sizeof(saved_item_t));
+    if (!saved) {
+        pthread_mutex_unlock(&cache->lock);
+        return -1;
+    }
+    
+    // 从尾到头保存(旧链表中的项更久没有被访问，先保存)，按顺序重新插入即可恢复LRU的访问顺序
+    unsigned int count = 0;
+    cache_item_t *tails[2] = { cache->old_tail, cache->tail };
+    for (int l = 0; l < 2; l++) {
+        for (cache_item_t *item = tails[l]; item && count < cache->count; item = item->prev) {
+            item->refcount++;
+            saved[count].item = item;
+            fill_record(&saved[count].record, item);
+            count++;
+        }
+    }
+    header.algorithm = cache->algorithm;
+    header.count = count;
+    header.inflation = cache->inflation;
+    
+    pthread_mutex_unlock(&cache->lock);
+    
+    int ret = write_padded(fp, &header, sizeof(header));
+    for (unsigned int i = 0; i < count && ret == 0; i++) {
+        ret = write_item(fp, &saved[i]);
+    }
+    
+    // 写出期间被淘汰的项由最后一个引用回收
+    pthread_mutex_lock(&cache->lock);
+    for (unsigned int i = 0; i < count; i++) {
+        cache_item_t *item = saved[i].item;
+        if (item->refcount > 0) item->refcount--;
+        if (item->refcount == 0 && item->detached) free_item(item);
+    }
+    pthread_mutex_unlock(&cache->lock);
+    
+    free(saved);
+    return ret;
+}
+
+int cache_save(cache_t *cache, const char *path) {
+    if (!cache || !path || cache->shared) return -1;
+    
+    char tmp_path[512];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *fp = fopen(tmp_path, "wb");
+    if (!fp) return -1;
+    
+    int ret = write_snapshot(cache, fp);
+    if (fclose(fp) != 0) ret = -1;
+    if (ret == 0 && rename(tmp_path, path) != 0) ret = -1;
+    if (ret != 0) unlink(tmp_path);
+    return ret;
+}
+
+// 映射仍然有效的原文件
+static void *map_source(const char *path, size_t size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    
+    void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+    madvise(map, size, MADV_WILLNEED);
+    return map;
+}
+
+// 插入一项并恢复保存时的频率和访问时间(调用者持有锁)
+static int restore_locked(cache_t *cache, const char *key, void *data, size_t size,
+                          const cache_file_record_t *record, int mapped) {
+    unsigned int hash = cache_key_hash(key);
+    if (insert_locked(cache, key, hash, data, size, record->mtime, record->etag, mapped) != 0) {
+        return -1;
+    }
+    
+    // 新项位于哈希链表头部
+    cache_item_t *item = cache->table[bucket(hash)];
+    item->frequency = record->frequency > 0 ? (unsigned int)record->frequency : 1;
+    item->timestamp = (time_t)record->timestamp;
+    remove_from_list(cache, item);
+    add_to_list(cache, item);
+    return 0;
+}
+
+int cache_save_fd(cache_t *cache, int fd) {
+    if (!cache || fd < 0 || cache->shared) return -1;
+    
+    int copy = dup(fd);
+    if (copy < 0) return -1;
+    FILE *fp = fdopen(copy, "wb");
+    if (!fp) {
+        close(copy);
+        return -1;
+    }
+    
+    int ret = write_snapshot(cache, fp);
+    if (fclose(fp) != 0) ret = -1;
+    return ret;
+}
+
+int cache_load(cache_t *cache, const char *path, const char *root,
+               int (*validate)(const struct stat *st, const char *etag)) {
+    if (!cache || !path || cache->shared) return -1;
+    
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    
+    int restored = cache_load_fd(cache, fd, root, validate);
+    close(fd);
+    return restored;
+}
+
+int cache_load_fd(cache_t *cache, int fd, const char *root,
+                  int (*validate)(const struct stat *st, const char *etag)) {
+    if (!cache || fd < 0 || !root || cache->shared) return -1;
+    
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(cache_file_header_t)) {
+        return -1;
+    }
+    
+    size_t file_size = st.st_size;
+    const char *base = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED) return -1;
+    madvise((void *)base, file_size, MADV_SEQUENTIAL);
+    
+    const cache_file_header_t *header = (const cache_file_header_t *)base;
+    if (memcmp(header->magic, CACHE_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != CACHE_FILE_VERSION) {
+        munmap((void *)base, file_size);
+        return -1;
+    }
+    
+    pthread_mutex_lock(&cache->lock);
+    
+    if (cache->algorithm == GDSF) cache->inflation = header->inflation;
+    
+    int restored = 0;
+    size_t offset = align8(sizeof(cache_file_header_t));
+    for (uint64_t i = 0; i < header->count; i++) {
+        if (offset + sizeof(cache_file_record_t) > file_size) break;
+        const cache_file_record_t *record = (const cache_file_record_t *)(base + offset);
+        offset += align8(sizeof(cache_file_record_t));
         
-        // 重新排序所有项
-        if (cache->head) {
-            cache_item_t *curr = cache->head;
-            cache->head = cache->tail = NULL;
-            
-            while (curr) {
-                cache_item_t *next = curr->next;
-                curr->prev = curr->next = NULL;
-                add_to_list(cache, curr);
-                curr = next;
+        // 校验长度，截断或损坏的文件只恢复前面完整的部分
+        size_t data_len = record->mapped ? 0 : record->size;
+        if (record->key_len == 0 || record->key_len >= 512 || record->size == 0 ||
+            offset + align8(record->key_len) + align8(data_len) > file_size) break;
+        
+        char key[512];
+        memcpy(key, base + offset, record->key_len);
+        key[record->key_len] = '\0';
+        offset += align8(record->key_len);
+        const char *data = base + offset;
+        offset += align8(data_len);
+        
+        // 文件已修改或被替换的项丢弃(代理响应的key不对应文件，同样不恢复)
+        char source[1024];
+        struct stat file_stat;
+        if (snprintf(source, sizeof(source), "%s%s", root, key) >= (int)sizeof(source) ||
+            stat(source, &file_stat) < 0 || (size_t)file_stat.st_size != record->size ||
+            (validate && !validate(&file_stat, record->etag))) {
+            continue;
+        }
+        
+        if (record->mapped) {
+            void *map = map_source(source, record->size);
+            if (!map) continue;
+            if (restore_locked(cache, key, map, record->size, record, 1) != 0) {
+                munmap(map, record->size);
+                continue;
             }
+        } else if (restore_locked(cache, key, (void *)data, record->size, record, 0) != 0) {
+            continue;
         }
+        restored++;
     }
     
     pthread_mutex_unlock(&cache->lock);
+    munmap((void *)base, file_size);
+    return restored;
 }
\ No newline at end of file
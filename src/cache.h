@@ -7,7 +7,9 @@
 #include <unistd.h>
 #include <time.h>
 #include <pthread.h>
+#include <sys/stat.h>
 #include "config.h"  // 包含配置头文件
+#include "sketch.h"
 
 // 使用config.h中的定义，不再重复定义
 // #define MAX_CACHE_SIZE (100 * 1024 * 1024)  // 移动到config.h
@@ -15,11 +17,22 @@
 
 // 缓存项结构
 typedef struct cache_item {
-    char *key;                  // 资源路径
+    char *key;                  // 相对文档根目录的规范化请求路径(或代理key)
+    unsigned int hash;          // cache_key_hash(key)，查找、淘汰和准入过滤时不再重新计算
     void *data;                // 资源数据
     size_t size;               // 资源大小
+    size_t charge;             // 计入容量的内存: 数据、结构体和key，含分配器开销
     time_t timestamp;          // 最后访问时间
     unsigned int frequency;    // 访问频率(LFU使用)
+    time_t mtime;              // 文件最后修改时间(Last-Modified)
+    char etag[64];             // 强校验器ETag
+    unsigned int refcount;     // 使用中的引用数(cache_get获取，cache_release释放)
+    int detached;              // 已被淘汰但仍有引用，最后一个引用释放时回收
+    int mapped;                // data是文件的只读映射，回收时munmap
+    size_t shared;             // 共享缓存项的段内偏移(此时本结构只是视图)，0表示私有项
+    double priority;           // GDSF优先级H = L + 频率 * 代价 / 大小
+    int heap_index;            // 在GDSF堆中的位置，-1表示不在堆中
+    unsigned int epoch;        // 按哪一次算法切换后的顺序放入链表，与缓存的epoch不同时在旧链表中
     struct cache_item *prev;
     struct cache_item *next;
     struct cache_item *h_next; // 哈希表链表指针
@@ -30,22 +43,80 @@ typedef struct cache {
     cache_item_t *table[HASH_TABLE_SIZE]; // 哈希表
     cache_item_t *head;        // 链表头(LRU/LFU顺序)
     cache_item_t *tail;        // 链表尾
-    size_t total_size;         // 当前缓存总大小
+    cache_item_t *old_head;    // 切换算法前的链表: 切换后还没有被访问的项，淘汰时优先
+    cache_item_t *old_tail;
+    unsigned int epoch;        // 算法切换次数，区分项在哪个链表中
+    size_t total_size;         // 当前占用的内存(各项charge之和)
     size_t max_size;           // 最大缓存大小
     unsigned int count;        // 缓存项数量
     cache_algorithm_t algorithm; // 缓存算法
+    cache_item_t **heap;       // GDSF最小堆(按priority)
+    unsigned int heap_count;
+    unsigned int heap_capacity;
+    double inflation;          // GDSF老化值L: 最近一次淘汰项的优先级
     pthread_mutex_t lock;      // 线程安全锁
+    int ghost;                 // 影子缓存: 只保存key和大小等元数据
+    int adaptive;              // 是否根据影子缓存自动选择算法
+    struct cache *shadows[CACHE_ALGORITHM_COUNT]; // 各算法的影子缓存(自适应模式)
+    unsigned long window_requests;                // 当前窗口的采样请求数
+    unsigned long window_hits[CACHE_ALGORITHM_COUNT]; // 当前窗口各影子缓存的命中数
+    unsigned long adapt_switches; // 自动切换次数
+    frequency_sketch_t *sketch;   // 准入过滤用的访问频率草图(NULL表示不过滤)
+    unsigned long admission_rejects; // 因频率不足被拒绝的插入次数
+    unsigned long hits;        // 命中次数
+    unsigned long misses;      // 未命中次数(cache_note_miss，不含无法缓存的请求)
+    unsigned long long hit_bytes;  // 命中返回的字节数
+    unsigned long long miss_bytes; // 未命中从磁盘读取的字节数(cache_note_miss)
+    struct shm_cache *shared;  // 非NULL时数据存放在多进程共享的缓存段中(只支持LRU)
+    size_t buffer_size;        // 未命中路径中尚未放入缓存的读取缓冲区(原子访问)
 } cache_t;
 
 // 函数声明
 cache_t *cache_create(size_t max_size, cache_algorithm_t algorithm);
 void cache_destroy(cache_t *cache);
-int cache_put(cache_t *cache, const char *key, void *data, size_t size);
-cache_item_t *cache_get(cache_t *cache, const char *key);
+int cache_put(cache_t *cache, const char *key, void *data, size_t size,
+              time_t mtime, const char *etag);  // 未通过准入过滤时返回1
+// 接管一个只读文件映射作为缓存数据(不复制)，返回0表示缓存已接管，否则仍由调用者munmap
+int cache_put_mapped(cache_t *cache, const char *key, void *map, size_t size,
+                     time_t mtime, const char *etag);
+cache_item_t *cache_get(cache_t *cache, const char *key);  // 命中时持有引用，用完需cache_release
+// 同cache_get，hash为调用者预先计算的cache_key_hash(key)(请求路径规范化时算出)
+cache_item_t *cache_lookup(cache_t *cache, const char *key, unsigned int hash);
+unsigned int cache_key_hash(const char *key);
+void cache_release(cache_t *cache, cache_item_t *item);
 void cache_remove(cache_t *cache, const char *key);
 void cache_clear(cache_t *cache);
 size_t cache_get_size(cache_t *cache);
 unsigned int cache_get_count(cache_t *cache);
 void cache_set_algorithm(cache_t *cache, cache_algorithm_t algorithm);
+cache_algorithm_t cache_get_algorithm(cache_t *cache);
+int cache_set_adaptive(cache_t *cache, int enabled);
+int cache_set_admission(cache_t *cache, int enabled);
+// 把存取转到共享内存缓存，私有部分只保留统计
+void cache_attach_shared(cache_t *cache, struct shm_cache *shared);
+const char *cache_algorithm_name(cache_algorithm_t algorithm);
+// 运行中调整容量，缩小时分批淘汰(每批之间释放锁)，已缓存的内容在容量允许范围内保留
+int cache_set_max_size(cache_t *cache, size_t max_size);
+size_t cache_get_max_size(cache_t *cache);
+// 记录一次未命中的对象大小，用于计算字节命中率
+void cache_note_miss(cache_t *cache, size_t size);
+// 未命中读取缓冲区计入内存账目，总量超过MISS_BUFFER_BUDGET时返回-1(调用者不缓冲直接发送)
+int cache_reserve_buffer(cache_t *cache, size_t size);
+void cache_release_buffer(cache_t *cache, size_t size);
+// 缓存和读取缓冲区占用的内存总量
+size_t cache_get_memory(cache_t *cache);
+double cache_object_hit_ratio(cache_t *cache);
+double cache_byte_hit_ratio(cache_t *cache);
+
+// 持久化: 保存索引、频率/访问时间和小对象内容(映射项只保存元数据)，写临时文件后rename
+int cache_save(cache_t *cache, const char *path);
+// 加载快照文件，key对应的文件为root + key，validate对其当前状态和保存时的ETag判断是否仍然有效
+// 返回恢复的项目数，文件不存在或格式不符时返回-1
+int cache_load(cache_t *cache, const char *path, const char *root,
+               int (*validate)(const struct stat *st, const char *etag));
+// 同上，直接读写已打开的文件(如交接时传递的memfd)，不关闭fd
+int cache_save_fd(cache_t *cache, int fd);
+int cache_load_fd(cache_t *cache, int fd, const char *root,
+                  int (*validate)(const struct stat *st, const char *etag));
 
 #endif
\ No newline at end of file
@@ -5,17 +5,103 @@
 #define MAX_CACHE_SIZE (100 * 1024 * 1024)  // 100MB最大缓存大小
 #define HASH_TABLE_SIZE 1024                 // 哈希表大小
 #define MAX_CACHE_ITEM_SIZE (10 * 1024 * 1024) // 单个缓存项最大大小(10MB)
+#define CACHE_EVICT_BATCH 64                 // 运行中缩小容量时每次持锁淘汰的项目数
 
 // 网络配置
 #define MAX_EVENTS 1024                      // epoll最大事件数
 #define BUFFER_SIZE 8196                     // 缓冲区大小
 #define MAX_CONNECTIONS 1024                  // 最大连接数
-#define BACKLOG_SIZE 128                     // 监听队列大小
+#define BACKLOG_SIZE 1024                    // 默认监听队列大小(可用-q调整，受net.core.somaxconn限制)
+#define ACCEPT_BATCH 256                     // 每次监听socket就绪时最多接受的连接数，避免饿死其他事件
+#define MAX_PATH_LENGTH 256                  // 规范化后的请求路径(缓存key)长度上限
+
+// 连接超时配置
+#define TIMER_TICK_MS 100                    // 时间轮精度(毫秒)
+#define HEADER_TIMEOUT_MS 10000              // 请求头读取时限
+#define KEEPALIVE_TIMEOUT_MS 15000           // 长连接空闲时限
+#define SEND_STALL_TIMEOUT_MS 30000          // 发送无进展时限
+#define DRAIN_TIMEOUT_MS 10000               // 关闭或交接时等待进行中请求完成的时限
+#define HANDOFF_ACK_TIMEOUT_MS 5000          // 交接后等待新进程确认的时限
 
 // 线程池配置
 #define MAX_THREADS 16                       // 最大线程数
+#define DEFAULT_THREADS 8                    // 默认请求线程数(可用-t或管理接口调整)
 #define MAX_QUEUE 256                        // 任务队列最大长度
 
+// 过载保护配置
+#define QUEUE_TARGET_MS 10                   // 过载时允许的最长排队时间
+#define QUEUE_INTERVAL_MS 100                // 队列持续非空超过该时间视为过载
+#define OVERLOAD_RETRY_AFTER "1"             // 503响应的Retry-After(秒)
+
+// 磁盘I/O配置(缓存未命中)
+#define DISK_IO_THREADS 4                    // 磁盘I/O线程数
+#define DISK_IO_QUEUE 64                     // 磁盘I/O队列上限，满时返回503
+#define DISK_CHUNK_SIZE (256 * 1024)         // 分块读取大小
+#define DISK_READAHEAD_SIZE (1024 * 1024)    // 预读窗口大小
+#define MMAP_THRESHOLD (64 * 1024)           // 不小于该大小的文件以只读映射缓存，不复制到堆
+#define MISS_BUFFER_BUDGET (32 * 1024 * 1024) // 未命中读取缓冲区总量上限，超出时直接sendfile不缓存
+
+// 传输策略配置(按对象大小分类测量各发送方式的CPU开销，自动选择)
+#define TRANSFER_SIZE_CLASSES 8              // 大小分类数: 4KB起每级x4，最后一级不限
+#define TRANSFER_MIN_CLASS 4096              // 第一级的上界
+#define TRANSFER_WARMUP 8                    // 每类每种方式先采样的次数
+#define TRANSFER_EXPLORE_INTERVAL 32         // 每N次选择试一次非最优方式，跟踪开销变化
+#define TRANSFER_EWMA_SHIFT 3                // 开销EWMA的权重(1/8)
+#define TRANSFER_SPLICE_CHUNK (64 * 1024)    // splice每次经管道搬运的字节数(默认管道容量)
+
+// 零拷贝发送配置(MSG_ZEROCOPY，需要-z开启)
+#define ZEROCOPY_THRESHOLD (128 * 1024)      // 小于该大小的缓存项普通复制发送，固定页面的开销不划算
+#define ZEROCOPY_LINGER_MS 5000              // 关闭连接前等待内核完成通知的时限
+
+// 反向代理配置(-r PREFIX=UPSTREAM)
+#define MAX_PROXY_ROUTES 16                  // 代理路由数上限
+#define PROXY_POOL_SIZE 32                   // 每个上游保留的空闲长连接数
+#define PROXY_IDLE_TIMEOUT_MS 30000          // 空闲上游连接的保留时限
+#define PROXY_TIMEOUT_MS 30000               // 从提交到收完上游响应的时限
+#define PROXY_SWEEP_MS 1000                  // 有上游连接时检查超时的间隔
+#define PROXY_MAX_HEADER (16 * 1024)         // 上游响应头上限
+#define PROXY_MAX_BODY (1024 * 1024)         // 转发的请求体上限
+#define PROXY_MAX_RESPONSE MAX_CACHE_ITEM_SIZE // 上游响应体上限(收完整个响应后再发给客户端)
+
+// HTTP/2配置(h2c: 连接前言或Upgrade: h2c)
+#define H2_MAX_STREAMS 100                   // 每个连接的并发流上限(SETTINGS_MAX_CONCURRENT_STREAMS)
+#define H2_MAX_FRAME_SIZE 16384              // 接收帧负载上限(协议默认值)
+#define H2_MAX_HEADER_LIST (16 * 1024)       // 头部块及解码后头部的总长度上限
+#define H2_DATA_QUANTUM 16384                // 轮转调度时每个流每轮最多发送的字节数
+#define H2_OUTPUT_BUFFER (64 * 1024)         // 每个连接的发送缓冲区
+#define H2_CONTROL_RESERVE (16 * 1024)       // 发送缓冲区中DATA帧不能占用、留给控制帧和HEADERS的部分
+#define H2_CONTROL_OVERFLOW_LIMIT 8          // 控制帧放不进发送缓冲区的次数上限，超过后GOAWAY(ENHANCE_YOUR_CALM)
+#define H2_SESSION_MAX_MS 60000              // 会话不能交还事件循环时占用工作线程的时限
+
+// 内存压力配置(-m，读取所在cgroup v2的memory.max/memory.high/memory.stat/memory.pressure)
+#define MEMWATCH_INTERVAL_MS 1000            // 检查间隔
+#define MEMWATCH_HIGH_PERCENT 85             // 不可回收内存(anon+shmem)超过上限的该比例时缩小缓存
+#define MEMWATCH_LOW_PERCENT 70              // 低于该比例且没有内存停顿时逐步恢复
+#define MEMWATCH_PSI_STALL_US 200000         // PSI触发器: 窗口内some停顿超过该时间
+#define MEMWATCH_PSI_WINDOW_US 2000000       // PSI触发器窗口(非特权进程要求为2秒的整数倍)
+#define MEMWATCH_PSI_AVG10 10.0              // 无法注册触发器时按some avg10(百分比)判断
+#define MEMWATCH_SHRINK_PERCENT 25           // 每次至少缩小当前容量的比例
+#define MEMWATCH_GROW_PERCENT 5              // 每次恢复设定容量的比例
+#define MEMWATCH_HOLD_MS 10000               // 缩小后至少平稳这么久才恢复或再次因停顿缩小(avg10的窗口)
+#define MEMWATCH_MIN_CACHE (8 * 1024 * 1024) // 缩小的下限
+
+// 静态快照配置(文档根目录打包为只读快照，读端无锁)
+#define SNAPSHOT_MAX_SIZE (256 * 1024 * 1024) // 快照缓冲区上限，超出的文件走普通路径
+#define SNAPSHOT_HEADER_RESERVE 512          // 每个文件预构建响应头的最大长度
+#define SNAPSHOT_MAX_READERS 128             // 读者线程槽位数
+#define SNAPSHOT_MAX_DISPLACE (1 << 20)      // 完美哈希构建时每个桶尝试的位移上限
+
+// 共享内存缓存配置
+#define SHM_OVERHEAD_RATIO 8                 // 段大小 = 预算 + 预算/N，容纳碎片(项头和key已计入预算)
+#define SHM_RELEASE_MIN (64 * 1024)          // 释放的块中不小于该大小的整页交还内核
+#define SHM_MAX_PROCS 128                    // 引用槽位数: 预派生上限64，交接期间新旧两组进程同时使用
+
+// 文档根目录遍历配置(快照打包和缓存预热)
+#define DIRWALK_MAX_DEPTH 16                 // 目录递归深度上限
+
+// 缓存预热配置
+#define PRELOAD_BUDGET (MAX_CACHE_SIZE / 10 * 8) // 默认预热上限，给新访问留出空间
+
 // 服务器配置
 #define DEFAULT_PORT 8181                    // 默认端口
 #define DEFAULT_DOCUMENT_ROOT "./www"        // 默认文档根目录
@@ -24,9 +110,42 @@
 // 缓存算法枚举
 typedef enum {
     LRU,
-    LFU
+    LFU,
+    GDSF                                     // GreedyDual-Size-Frequency: 兼顾频率和大小
 } cache_algorithm_t;
 
+#define CACHE_ALGORITHM_COUNT 3              // 缓存算法数量
+#define GDSF_MISS_COST 1.0                   // GDSF中每次未命中的代价(1.0偏向对象命中率)
+
+// 自适应缓存策略配置(影子缓存模拟各策略，按命中数自动切换)
+#define ADAPT_SAMPLE_RATE 4                  // 影子缓存只模拟1/N的key，容量同比缩小
+#define ADAPT_WINDOW 256                     // 每个评估窗口的采样请求数
+#define ADAPT_MARGIN_PERCENT 5               // 其他策略命中数需领先的比例
+#define ADAPT_MIN_GAIN 4                     // 其他策略命中数需领先的最少次数
+
+// TinyLFU准入配置(新对象估计频率需高于被淘汰对象才能进入缓存)
+#define CACHE_ADMISSION 1                    // 启用准入过滤
+#define ADMISSION_SKETCH_WIDTH 8192          // 频率草图每行计数器数
+
+// I/O事件后端枚举
+typedef enum {
+    IO_BACKEND_EPOLL,
+    IO_BACKEND_URING
+} io_backend_t;
+
+#define DEFAULT_IO_BACKEND IO_BACKEND_EPOLL  // 默认I/O后端
+#define URING_QUEUE_DEPTH 256                // io_uring提交队列深度
+#define URING_BUFFER_COUNT 256               // recv提供缓冲区数量(2的幂)
+
+// 管理接口配置
+#define ADMIN_MAX_LINE 256                   // 管理命令最大长度
+
+// 热点路径统计配置(Space-Saving，通过管理接口top/hot-list查看)
+#define HITTERS_CAPACITY 512                 // 跟踪的路径槽位数
+#define HITTERS_DEFAULT_TOP 20               // top和hot-list默认输出的路径数
+#define HITTERS_BATCH 32                     // 每个线程攒够这么多个请求再加锁写入
+#define HITTERS_FLUSH_MS 100                 // 或者距第一个未写入的请求超过该时间
+
 // 性能监控配置
 #define STATS_UPDATE_INTERVAL 5              // 统计信息更新间隔(秒)
 
@@ -0,0 +1,35 @@
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "dirwalk.h"
+#include "config.h"
+
+static void walk(const char *dir, int depth, dirwalk_fn fn, void *arg) {
+    if (depth > DIRWALK_MAX_DEPTH) return;
+    
+    DIR *d = opendir(dir);
+    if (!d) return;
+    
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        
+        char path[512];
+        if (snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name) >= (int)sizeof(path)) continue;
+        
+        struct stat st;
+        if (stat(path, &st) < 0) continue;
+        
+        if (S_ISDIR(st.st_mode)) {
+            walk(path, depth + 1, fn, arg);
+        } else if (S_ISREG(st.st_mode) && st.st_size > 0 && st.st_size < MAX_CACHE_ITEM_SIZE) {
+            fn(path, st.st_size, arg);
+        }
+    }
+    closedir(d);
+}
+
+void dirwalk(const char *root, dirwalk_fn fn, void *arg) {
+    walk(root, 0, fn, arg);
+}
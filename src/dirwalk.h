@@ -0,0 +1,13 @@
+#ifndef DIRWALK_H
+#define DIRWALK_H
+
+#include <stddef.h>
+
+// 递归遍历文档根目录(快照打包、缓存预热共用)
+// 只报告大小在(0, MAX_CACHE_ITEM_SIZE)之间的常规文件，符号链接按目标处理，
+// 超过DIRWALK_MAX_DEPTH层或路径过长的部分跳过
+typedef void (*dirwalk_fn)(const char *path, size_t size, void *arg);
+
+void dirwalk(const char *root, dirwalk_fn fn, void *arg);
+
+#endif
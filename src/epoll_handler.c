@@ -4,10 +4,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
 
 #include "epoll_handler.h"
 #include "webserver.h"
@@ -15,10 +19,17 @@
 #include "cache.h"
 #include "logging.h"
 
-static void handle_new_connection(epoll_handler_t *handler);
+static void handle_new_connection(epoll_handler_t *handler, int listen_fd);
+static void accept_connection(epoll_handler_t *handler, int client_fd,
+                              const struct sockaddr_storage *client_addr);
 static void handle_client_data(epoll_handler_t *handler, int client_fd);
+static void handle_resumed_connections(epoll_handler_t *handler);
+static void handle_timeout(timer_node_t *node, void *arg);
+static void close_connection(epoll_handler_t *handler, int client_fd);
+static void start_linger(epoll_handler_t *handler, int client_fd);
+static void handle_zerocopy_completion(epoll_handler_t *handler, int client_fd);
 
-epoll_handler_t *epoll_handler_create(int server_fd, cache_t *cache, 
+epoll_handler_t *epoll_handler_create(int server_fd, int unix_fd, cache_t *cache, 
                                      const char *document_root, threadpool_t *pool) {
     epoll_handler_t *handler = malloc(sizeof(epoll_handler_t));
     if (!handler) return NULL;
@@ -31,29 +42,64 @@ epoll_handler_t *epoll_handler_create(int server_fd, cache_t *cache,
     }
     
     handler->server_fd = server_fd;
+    handler->unix_fd = unix_fd;
     handler->cache = cache;
     handler->document_root = strdup(document_root);
     handler->thread_pool = pool;
     handler->events = malloc(sizeof(struct epoll_event) * MAX_EVENTS);
     
-    if (!handler->events || !handler->document_root) {
-        free(handler->events);
-        free(handler->document_root);
-        close(handler->epoll_fd);
-        free(handler);
+    // 连接表按进程fd上限分配
+    struct rlimit rl;
+    handler->max_fds = MAX_CONNECTIONS * 4;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY &&
+        rl.rlim_cur > (rlim_t)handler->max_fds) {
+        handler->max_fds = (int)rl.rlim_cur;
+    }
+    handler->conns = calloc(handler->max_fds, sizeof(conn_t));
+    handler->timers = timer_wheel_create(TIMER_TICK_MS);
+    handler->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    handler->resume_fds = NULL;
+    handler->resume_count = 0;
+    handler->resume_capacity = 0;
+    handler->active_connections = 0;
+    handler->draining = 0;
+    handler->proxy = NULL;
+    handler->proxy_fd = -1;
+    pthread_mutex_init(&handler->resume_lock, NULL);
+    
+    if (!handler->events || !handler->document_root || !handler->conns ||
+        !handler->timers || handler->wake_fd < 0) {
+        epoll_handler_destroy(handler);
         return NULL;
     }
     
     // 添加服务器socket到epoll
+    // 预派生的各进程共用监听socket，EPOLLEXCLUSIVE让一个新连接只唤醒其中一个进程
     struct epoll_event ev;
-    ev.events = EPOLLIN;
+    ev.events = EPOLLIN | EPOLLEXCLUSIVE;
     ev.data.fd = server_fd;
     if (epoll_ctl(handler->epoll_fd, EPOLL_CTL_ADD, server_fd, &ev) == -1) {
         perror("epoll_ctl: server_fd");
-        free(handler->events);
-        free(handler->document_root);
-        close(handler->epoll_fd);
-        free(handler);
+        epoll_handler_destroy(handler);
+        return NULL;
+    }
+    
+    // 本机反向代理经Unix域socket连接，与TCP连接走同一套处理
+    if (unix_fd >= 0) {
+        ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+        ev.data.fd = unix_fd;
+        if (epoll_ctl(handler->epoll_fd, EPOLL_CTL_ADD, unix_fd, &ev) == -1) {
+            perror("epoll_ctl: unix_fd");
+            epoll_handler_destroy(handler);
+            return NULL;
+        }
+    }
+    
+    ev.events = EPOLLIN;
+    ev.data.fd = handler->wake_fd;
+    if (epoll_ctl(handler->epoll_fd, EPOLL_CTL_ADD, handler->wake_fd, &ev) == -1) {
+        perror("epoll_ctl: wake_fd");
+        epoll_handler_destroy(handler);
         return NULL;
     }
     
@@ -61,53 +107,132 @@ epoll_handler_t *epoll_handler_create(int server_fd, cache_t *cache,
     return handler;
 }
 
-void epoll_handler_loop(epoll_handler_t *handler) {
-    log_message(LOG_INFO, "Epoll事件循环开始");
+int epoll_handler_add_proxy(epoll_handler_t *handler, proxy_t *proxy) {
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = proxy_fd(proxy);
+    if (epoll_ctl(handler->epoll_fd, EPOLL_CTL_ADD, ev.data.fd, &ev) == -1) {
+        perror("epoll_ctl: proxy_fd");
+        return -1;
+    }
+    handler->proxy = proxy;
+    handler->proxy_fd = ev.data.fd;
+    return 0;
+}
+
+// 等待并处理一轮事件，max_timeout为等待上限(-1表示只由定时器决定)，出错时返回-1
+static int process_events(epoll_handler_t *handler, int max_timeout) {
+    // 由最近的连接超时决定等待时间
+    int timeout = timer_wheel_next_timeout(handler->timers, timer_now_ms());
+    if (max_timeout >= 0 && (timeout < 0 || timeout > max_timeout)) timeout = max_timeout;
+    
+    // 控制信号只在等待期间解除屏蔽，收到后epoll_pwait返回EINTR，回到循环开头处理
+    int nfds = epoll_pwait(handler->epoll_fd, handler->events, MAX_EVENTS, timeout,
+                           server_wait_sigmask());
+    if (nfds == -1) {
+        if (errno == EINTR) {
+            log_message(LOG_DEBUG, "epoll_pwait被信号中断，继续循环");
+            return 0;
+        }
+        perror("epoll_pwait");
+        log_message(LOG_ERROR, "epoll_pwait错误: %s", strerror(errno));
+        return -1;
+    }
+    
+    log_message(LOG_DEBUG, "epoll_pwait返回 %d 个就绪事件", nfds);
     
-    while (1) {
-        int nfds = epoll_wait(handler->epoll_fd, handler->events, MAX_EVENTS, -1);
-        if (nfds == -1) {
-            if (errno == EINTR) {
-                log_message(LOG_DEBUG, "epoll_wait被信号中断，继续循环");
+    for (int i = 0; i < nfds; i++) {
+        if (handler->events[i].data.fd == handler->server_fd ||
+            handler->events[i].data.fd == handler->unix_fd) {
+            // 处理新连接
+            handle_new_connection(handler, handler->events[i].data.fd);
+        } else if (handler->events[i].data.fd == handler->wake_fd) {
+            // 工作线程归还的长连接
+            handle_resumed_connections(handler);
+        } else if (handler->events[i].data.fd == handler->proxy_fd) {
+            // 上游连接就绪、新的转发请求或超时检查
+            proxy_process(handler->proxy);
+        } else {
+            int client_fd = handler->events[i].data.fd;
+            uint32_t events = handler->events[i].events;
+            
+            // 零拷贝完成通知经错误队列到达，表现为EPOLLERR
+            if (handler->conns[client_fd].state == CONN_LINGER) {
+                handle_zerocopy_completion(handler, client_fd);
                 continue;
             }
-            perror("epoll_wait");
-            log_message(LOG_ERROR, "epoll_wait错误: %s", strerror(errno));
-            break;
-        }
-        
-        log_message(LOG_DEBUG, "epoll_wait返回 %d 个就绪事件", nfds);
-        
-        for (int i = 0; i < nfds; i++) {
-            if (handler->events[i].data.fd == handler->server_fd) {
-                // 处理新连接
-                handle_new_connection(handler);
-            } else {
-                // 处理客户端数据
-                handle_client_data(handler, handler->events[i].data.fd);
+            if ((events & EPOLLERR) && handler->conns[client_fd].zc.head) {
+                handle_zerocopy_completion(handler, client_fd);
+                if (!(events & (EPOLLIN | EPOLLHUP))) continue;
             }
+            
+            // 处理客户端数据
+            handle_client_data(handler, client_fd);
         }
     }
     
+    // 关闭超过请求头读取或空闲时限的连接
+    timer_wheel_advance(handler->timers, timer_now_ms(), handle_timeout, handler);
+    return 0;
+}
+
+void epoll_handler_loop(epoll_handler_t *handler) {
+    log_message(LOG_INFO, "Epoll事件循环开始");
+    
+    while (!server_process_signals()) {
+        if (process_events(handler, -1) != 0) break;
+    }
+    
     log_message(LOG_INFO, "Epoll事件循环结束");
 }
 
-static void handle_new_connection(epoll_handler_t *handler) {
-    struct sockaddr_in client_addr;
-    socklen_t addr_len = sizeof(client_addr);
+void epoll_handler_drain(epoll_handler_t *handler, int timeout_ms) {
+    // 监听socket可能已交给新进程，留在队列中的连接由它接受
+    epoll_ctl(handler->epoll_fd, EPOLL_CTL_DEL, handler->server_fd, NULL);
+    if (handler->unix_fd >= 0) epoll_ctl(handler->epoll_fd, EPOLL_CTL_DEL, handler->unix_fd, NULL);
+    handler->draining = 1;
     
-    int client_fd = accept(handler->server_fd, (struct sockaddr*)&client_addr, &addr_len);
-    if (client_fd == -1) {
-        perror("accept");
-        log_message(LOG_ERROR, "接受新连接失败");
+    // 空闲的长连接没有进行中的请求，直接关闭
+    for (int fd = 0; fd < handler->max_fds; fd++) {
+        conn_t *conn = &handler->conns[fd];
+        if (conn->state != CONN_KEEPALIVE || (conn->h2 && h2_session_busy(conn->h2))) continue;
+        timer_wheel_del(handler->timers, &conn->timer);
+        epoll_ctl(handler->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+        if (conn->zc.head) start_linger(handler, fd);
+        else close_connection(handler, fd);
+    }
+    
+    uint64_t deadline = timer_now_ms() + timeout_ms;
+    while (__atomic_load_n(&handler->active_connections, __ATOMIC_RELAXED) > 0) {
+        uint64_t now = timer_now_ms();
+        if (now >= deadline) {
+            log_message(LOG_WARN, "排空超时，放弃 %d 个连接",
+                        __atomic_load_n(&handler->active_connections, __ATOMIC_RELAXED));
+            break;
+        }
+        if (process_events(handler, (int)(deadline - now)) != 0) break;
+    }
+    
+    log_message(LOG_INFO, "Epoll连接排空结束");
+}
+
+static void accept_connection(epoll_handler_t *handler, int client_fd,
+                              const struct sockaddr_storage *client_addr) {
+    if (client_fd >= handler->max_fds) {
+        log_message(LOG_WARN, "fd %d 超出连接表范围，拒绝连接", client_fd);
+        close(client_fd);
         return;
     }
     
-    // 设置非阻塞模式
-    int flags = fcntl(client_fd, F_GETFL, 0);
-    fcntl(client_fd, F_SETFL, flags | O_NONBLOCK);
+    // 连接数达到上限时直接返回503，不再占用epoll和工作线程
+    if (__atomic_load_n(&handler->active_connections, __ATOMIC_RELAXED) >= MAX_CONNECTIONS) {
+        send_overload_response(client_fd);
+        close(client_fd);
+        log_message(LOG_WARN, "连接数达到上限 %d，拒绝新连接", MAX_CONNECTIONS);
+        return;
+    }
     
-    // 添加客户端到epoll
+    // 添加客户端到epoll(accept4已设置非阻塞)，延迟accept下请求数据通常已到达，添加时即报告可读
     struct epoll_event ev;
     ev.events = EPOLLIN | EPOLLET; // 边缘触发模式
     ev.data.fd = client_fd;
@@ -117,40 +242,261 @@ static void handle_new_connection(epoll_handler_t *handler) {
         log_message(LOG_ERROR, "添加客户端到epoll失败");
         return;
     }
+    __atomic_add_fetch(&handler->active_connections, 1, __ATOMIC_RELAXED);
+    
+    // 请求头必须在时限内到达，防止空连接长期占用fd
+    conn_t *conn = &handler->conns[client_fd];
+    conn->state = CONN_READING_HEADER;
+    timer_wheel_add(handler->timers, &conn->timer, timer_now_ms() + HEADER_TIMEOUT_MS);
     
-    log_message(LOG_INFO, "新连接: %s:%d", 
-                inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
+    if (client_addr->ss_family == AF_INET) {
+        const struct sockaddr_in *addr = (const struct sockaddr_in *)client_addr;
+        char ip[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &addr->sin_addr, ip, sizeof(ip));
+        log_message(LOG_DEBUG, "新连接: %s:%d", ip, ntohs(addr->sin_port));
+    } else {
+        log_message(LOG_DEBUG, "新连接: Unix域socket, fd %d", client_fd);
+    }
 }
 
-static void handle_client_data(epoll_handler_t *handler, int client_fd) {
+// 监听socket是非阻塞的: 一次就绪取完队列中的连接(最多ACCEPT_BATCH个)，
+// 连接风暴时不必每个连接都经过一轮epoll_wait
+static void handle_new_connection(epoll_handler_t *handler, int listen_fd) {
+    for (int n = 0; n < ACCEPT_BATCH; n++) {
+        struct sockaddr_storage client_addr;
+        socklen_t addr_len = sizeof(client_addr);
+        
+        int client_fd = accept4(listen_fd, (struct sockaddr*)&client_addr, &addr_len,
+                                SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_fd == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+            // 对端在排队期间放弃了连接，继续取下一个
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            // fd耗尽时连接留在队列中，等已有连接关闭后再取
+            log_message(LOG_ERROR, "接受新连接失败: %s", strerror(errno));
+            return;
+        }
+        accept_connection(handler, client_fd, &client_addr);
+    }
+}
 
+static void handle_client_data(epoll_handler_t *handler, int client_fd) {
+    conn_t *conn = &handler->conns[client_fd];
+    uint64_t now = timer_now_ms();
+    
+    // 新连接沿用accept时的请求头期限，长连接从收到数据开始计时
+    uint64_t deadline = now + HEADER_TIMEOUT_MS;
+    if (conn->state == CONN_READING_HEADER && conn->timer.active) {
+        deadline = conn->timer.expire_tick * handler->timers->tick_ms;
+    }
+    timer_wheel_del(handler->timers, &conn->timer);
+    conn->state = CONN_IN_WORKER;
+    
     // 创建客户端上下文
     client_context_t *ctx = malloc(sizeof(client_context_t));
     if (!ctx) {
         log_message(LOG_ERROR, "分配客户端上下文内存失败");
-        close(client_fd);
+        epoll_ctl(handler->epoll_fd, EPOLL_CTL_DEL, client_fd, NULL);
+        close_connection(handler, client_fd);
         return;
     }
     
     ctx->client_fd = client_fd;
     ctx->document_root = handler->document_root;
     ctx->cache = handler->cache;
+    ctx->request = NULL;
+    ctx->request_len = 0;
+    ctx->deadline_ms = deadline;
+    ctx->keep_alive = 0;
+    ctx->release = epoll_handler_release;
+    ctx->owner = handler;
+    ctx->zc = &conn->zc;
+    ctx->h2 = &conn->h2;
+    ctx->pending = &conn->pending;
     
     // 从epoll中移除，交给线程池处理
     epoll_ctl(handler->epoll_fd, EPOLL_CTL_DEL, client_fd, NULL);
     
     // 添加到线程池
-    if (threadpool_add_task(handler->thread_pool, handle_client_request, ctx) != 0) {
-        log_message(LOG_ERROR, "添加任务到线程池失败");
-        close(client_fd);
+    // 队列已满时立即返回503；排队过久的任务由线程池调用shed_client_request丢弃
+    if (threadpool_add_task_sheddable(handler->thread_pool, handle_client_request,
+                                      shed_client_request, ctx) != 0) {
+        log_message(LOG_WARN, "线程池队列已满，拒绝请求");
+        send_overload_response(client_fd);
+        close_connection(handler, client_fd);
         free(ctx);
     } else {
         log_message(LOG_DEBUG, "客户端任务已添加到线程池");
     }
 }
+
+// 关闭连接并更新连接计数，可在任意线程调用
+static void close_connection(epoll_handler_t *handler, int client_fd) {
+    conn_t *conn = &handler->conns[client_fd];
+    
+    // 仍有零拷贝发送未完成时用RST中止，内核丢弃发送队列后才能释放缓存项
+    if (conn->zc.head && zerocopy_reap(client_fd, &conn->zc, handler->cache) > 0) {
+        struct linger abort_linger = { .l_onoff = 1, .l_linger = 0 };
+        setsockopt(client_fd, SOL_SOCKET, SO_LINGER, &abort_linger, sizeof(abort_linger));
+    }
+    zerocopy_release_all(&conn->zc, handler->cache);
+    h2_session_free(conn->h2);
+    conn->h2 = NULL;
+    free(conn->pending.data);
+    conn->pending.data = NULL;
+    conn->pending.len = 0;
+    conn->linger = 0;
+    conn->state = CONN_FREE;
+    close(client_fd);
+    
+    // 排空期间最后一个连接可能在工作线程中关闭，唤醒等待中的事件循环，不必等到排空时限
+    if (__atomic_sub_fetch(&handler->active_connections, 1, __ATOMIC_RELAXED) == 0 &&
+        __atomic_load_n(&handler->draining, __ATOMIC_RELAXED)) {
+        uint64_t one = 1;
+        write(handler->wake_fd, &one, sizeof(one));
+    }
+}
+
+void epoll_handler_release(void *owner, int client_fd, int keep_alive) {
+    epoll_handler_t *handler = (epoll_handler_t *)owner;
+    
+    // 零拷贝发送未完成的连接交给事件循环等待通知后再关闭
+    if (!keep_alive && !handler->conns[client_fd].zc.head) {
+        close_connection(handler, client_fd);
+        return;
+    }
+    handler->conns[client_fd].linger = !keep_alive;
+    
+    pthread_mutex_lock(&handler->resume_lock);
+    if (handler->resume_count == handler->resume_capacity) {
+        int capacity = handler->resume_capacity ? handler->resume_capacity * 2 : 64;
+        int *fds = realloc(handler->resume_fds, sizeof(int) * capacity);
+        if (!fds) {
+            pthread_mutex_unlock(&handler->resume_lock);
+            close_connection(handler, client_fd);
+            return;
+        }
+        handler->resume_fds = fds;
+        handler->resume_capacity = capacity;
+    }
+    handler->resume_fds[handler->resume_count++] = client_fd;
+    pthread_mutex_unlock(&handler->resume_lock);
+    
+    uint64_t one = 1;
+    write(handler->wake_fd, &one, sizeof(one));
+}
+
+static void handle_resumed_connections(epoll_handler_t *handler) {
+    uint64_t value;
+    read(handler->wake_fd, &value, sizeof(value));
+    
+    pthread_mutex_lock(&handler->resume_lock);
+    int count = handler->resume_count;
+    int fds[count > 0 ? count : 1];
+    memcpy(fds, handler->resume_fds, sizeof(int) * count);
+    handler->resume_count = 0;
+    pthread_mutex_unlock(&handler->resume_lock);
+    
+    uint64_t idle_deadline = timer_now_ms() + KEEPALIVE_TIMEOUT_MS;
+    for (int i = 0; i < count; i++) {
+        int client_fd = fds[i];
+        conn_t *conn = &handler->conns[client_fd];
+        if (conn->linger || (handler->draining && conn->zc.head)) {
+            start_linger(handler, client_fd);
+            continue;
+        }
+        // 排空期间还在发送的HTTP/2会话继续等待，发完后再关闭
+        int h2_busy = conn->h2 && h2_session_busy(conn->h2);
+        if (handler->draining && !h2_busy) {
+            close_connection(handler, client_fd);
+            continue;
+        }
+        
+        // 下一个请求已经读到了，socket上可能不会再有数据，直接分派而不是等待可读
+        if (conn->pending.len > 0) {
+            handle_client_data(handler, client_fd);
+            continue;
+        }
+        
+        // HTTP/2会话等待对端的窗口或socket可写，输出缓冲区有数据时也关心可写
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLET;
+        if (h2_busy && h2_session_wants_write(conn->h2)) ev.events |= EPOLLOUT;
+        ev.data.fd = client_fd;
+        
+        // 重新加入epoll时若已有数据(或已经可写)会立即就绪
+        if (epoll_ctl(handler->epoll_fd, EPOLL_CTL_ADD, client_fd, &ev) == -1) {
+            log_message(LOG_ERROR, "长连接重新加入epoll失败: %s", strerror(errno));
+            close_connection(handler, client_fd);
+            continue;
+        }
+        
+        conn->state = CONN_KEEPALIVE;
+        timer_wheel_add(handler->timers, &conn->timer,
+                        h2_busy ? timer_now_ms() + SEND_STALL_TIMEOUT_MS : idle_deadline);
+    }
+}
+
+// 响应已完整发出但内核仍引用缓存数据: 半关闭后等待完成通知，超时再中止
+static void start_linger(epoll_handler_t *handler, int client_fd) {
+    conn_t *conn = &handler->conns[client_fd];
+    conn->linger = 0;
+    if (zerocopy_reap(client_fd, &conn->zc, handler->cache) == 0) {
+        close_connection(handler, client_fd);
+        return;
+    }
+    
+    shutdown(client_fd, SHUT_WR);
+    
+    // 只关心错误队列，EPOLLERR/EPOLLHUP无需显式注册
+    struct epoll_event ev;
+    ev.events = EPOLLET;
+    ev.data.fd = client_fd;
+    if (epoll_ctl(handler->epoll_fd, EPOLL_CTL_ADD, client_fd, &ev) == -1) {
+        close_connection(handler, client_fd);
+        return;
+    }
+    conn->state = CONN_LINGER;
+    timer_wheel_add(handler->timers, &conn->timer, timer_now_ms() + ZEROCOPY_LINGER_MS);
+}
+
+static void handle_zerocopy_completion(epoll_handler_t *handler, int client_fd) {
+    conn_t *conn = &handler->conns[client_fd];
+    int remaining = zerocopy_reap(client_fd, &conn->zc, handler->cache);
+    
+    if (conn->state == CONN_LINGER && remaining == 0) {
+        timer_wheel_del(handler->timers, &conn->timer);
+        epoll_ctl(handler->epoll_fd, EPOLL_CTL_DEL, client_fd, NULL);
+        close_connection(handler, client_fd);
+    }
+}
+
+static void handle_timeout(timer_node_t *node, void *arg) {
+    epoll_handler_t *handler = (epoll_handler_t *)arg;
+    conn_t *conn = (conn_t *)((char *)node - offsetof(conn_t, timer));
+    int client_fd = (int)(conn - handler->conns);
+    
+    log_message(LOG_INFO, "连接 %d %s超时，关闭", client_fd,
+                conn->state == CONN_READING_HEADER ? "请求头读取" :
+                conn->state == CONN_LINGER ? "零拷贝完成通知" : "空闲");
+    
+    epoll_ctl(handler->epoll_fd, EPOLL_CTL_DEL, client_fd, NULL);
+    close_connection(handler, client_fd);
+}
+
 void epoll_handler_destroy(epoll_handler_t *handler) {
     if (!handler) return;
     
+    // 排空超时后残留的零拷贝引用
+    for (int fd = 0; handler->conns && fd < handler->max_fds; fd++) {
+        if (handler->conns[fd].state == CONN_LINGER) close_connection(handler, fd);
+    }
+    free(handler->conns);
+    timer_wheel_destroy(handler->timers);
+    free(handler->resume_fds);
+    pthread_mutex_destroy(&handler->resume_lock);
+    if (handler->wake_fd >= 0) close(handler->wake_fd);
+    
     if (handler->events) {
         free(handler->events);
         handler->events = NULL;
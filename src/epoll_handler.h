@@ -2,25 +2,69 @@
 #define EPOLL_HANDLER_H
 
 #include <sys/epoll.h>
+#include <pthread.h>
 #include "cache.h"
 #include "threadpool.h"
 #include "config.h"
+#include "timer_wheel.h"
+#include "zerocopy.h"
+#include "proxy.h"
+#include "h2.h"
+#include "webserver.h"
 
 #define MAX_EVENTS 1024
 
+// 连接状态
+typedef enum {
+    CONN_FREE = 0,
+    CONN_READING_HEADER,       // 新连接，等待请求头
+    CONN_KEEPALIVE,            // 长连接空闲，等待下一个请求
+    CONN_IN_WORKER,            // 已交给工作线程处理
+    CONN_LINGER                // 响应已发完，等待零拷贝完成通知后关闭
+} conn_state_t;
+
+// 每个连接的事件循环侧状态(按fd索引)
+typedef struct {
+    conn_state_t state;
+    timer_node_t timer;        // 请求头/空闲超时定时器
+    zc_state_t zc;             // 尚未完成的零拷贝发送
+    int linger;                // 工作线程要求关闭，但仍有零拷贝发送未完成
+    h2_session_t *h2;          // 空闲的HTTP/2会话，等待下一批帧
+    pending_input_t pending;   // 已读到的下一个请求(管线化)，归还时直接再次分派
+} conn_t;
+
 typedef struct {
     int epoll_fd;
     int server_fd;
+    int unix_fd;               // Unix域监听socket(-1表示未启用)
     cache_t *cache;
     char *document_root;
     threadpool_t *thread_pool;
     struct epoll_event *events;
+    conn_t *conns;             // 连接表，下标为fd
+    int max_fds;
+    timer_wheel_t *timers;     // 连接超时时间轮
+    int wake_fd;               // eventfd: 工作线程归还长连接时唤醒事件循环
+    pthread_mutex_t resume_lock;
+    int *resume_fds;           // 待重新加入epoll的长连接
+    int resume_count;
+    int resume_capacity;
+    int active_connections;    // 当前打开的客户端连接数(原子更新)
+    int draining;              // 排空中: 不再接受新连接，归还的长连接直接关闭
+    proxy_t *proxy;            // 反向代理，上游连接的事件经proxy_fd汇入本循环(可为NULL)
+    int proxy_fd;
 } epoll_handler_t;
 
 // 添加这些函数声明
-epoll_handler_t *epoll_handler_create(int server_fd, cache_t *cache, 
+epoll_handler_t *epoll_handler_create(int server_fd, int unix_fd, cache_t *cache, 
                                      const char *document_root, threadpool_t *pool);
 void epoll_handler_destroy(epoll_handler_t *handler);
 void epoll_handler_loop(epoll_handler_t *handler);
+// 把反向代理的事件fd加入事件循环
+int epoll_handler_add_proxy(epoll_handler_t *handler, proxy_t *proxy);
+// 停止接受新连接并处理完已接受连接上的请求，最多等待timeout_ms
+void epoll_handler_drain(epoll_handler_t *handler, int timeout_ms);
+// 工作线程处理完请求后调用(线程安全): keep_alive时把连接交还给事件循环，否则关闭
+void epoll_handler_release(void *owner, int client_fd, int keep_alive);
 
 #endif
\ No newline at end of file
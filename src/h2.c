@@ -0,0 +1,831 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/socket.h>
+#include "h2.h"
+#include "hpack.h"
+#include "config.h"
+#include "logging.h"
+#include "mapguard.h"
+
+// 帧类型
+#define FRAME_DATA 0x0
+#define FRAME_HEADERS 0x1
+#define FRAME_PRIORITY 0x2
+#define FRAME_RST_STREAM 0x3
+#define FRAME_SETTINGS 0x4
+#define FRAME_PUSH_PROMISE 0x5
+#define FRAME_PING 0x6
+#define FRAME_GOAWAY 0x7
+#define FRAME_WINDOW_UPDATE 0x8
+#define FRAME_CONTINUATION 0x9
+
+// 帧标志
+#define FLAG_END_STREAM 0x1
+#define FLAG_ACK 0x1
+#define FLAG_END_HEADERS 0x4
+#define FLAG_PADDED 0x8
+#define FLAG_PRIORITY 0x20
+
+// 错误码
+#define ERR_NO_ERROR 0x0
+#define ERR_PROTOCOL 0x1
+#define ERR_INTERNAL 0x2
+#define ERR_FLOW_CONTROL 0x3
+#define ERR_FRAME_SIZE 0x6
+#define ERR_REFUSED_STREAM 0x7
+#define ERR_COMPRESSION 0x9
+#define ERR_ENHANCE_YOUR_CALM 0xb
+
+// SETTINGS参数
+#define SETTINGS_HEADER_TABLE_SIZE 0x1
+#define SETTINGS_ENABLE_PUSH 0x2
+#define SETTINGS_MAX_CONCURRENT_STREAMS 0x3
+#define SETTINGS_INITIAL_WINDOW_SIZE 0x4
+#define SETTINGS_MAX_FRAME_SIZE 0x5
+#define SETTINGS_MAX_HEADER_LIST_SIZE 0x6
+
+#define FRAME_HEADER_LEN 9
+#define DEFAULT_WINDOW 65535
+#define MAX_WINDOW 0x7fffffff
+#define INPUT_BUFFER (2 * (FRAME_HEADER_LEN + H2_MAX_FRAME_SIZE))
+#define GOAWAY_FRAME_LEN (FRAME_HEADER_LEN + 8)  // 发送缓冲区最后这部分只留给GOAWAY
+#define WINDOW_CREDIT_THRESHOLD (DEFAULT_WINDOW / 2) // 处理过的DATA累计到这么多才归还窗口
+
+typedef struct {
+    uint32_t id;               // 0表示空闲槽位
+    int64_t window;            // 对端给这个流的发送窗口(SETTINGS调整后可能为负)
+    h2_response_t resp;
+    size_t sent;
+    uint32_t consumed;         // 已丢弃但还没有归还给对端的请求体字节数(流级窗口)
+    char *request;             // 暂缓的请求(respond把status设为0)，非NULL时还没有发送HEADERS
+} h2_stream_t;
+
+// 正在解码的请求头部
+typedef struct {
+    char method[16];
+    char path[1024];
+    char authority[256];
+    char *fields;              // 普通头部，已按"name: value\r\n"拼好
+    size_t fields_len;
+    int regular_seen;          // 伪头部必须在普通头部之前
+    int malformed;
+} h2_request_t;
+
+struct h2_session {
+    h2_respond_t respond;
+    void *arg;
+    int fd;
+    
+    uint8_t *in;
+    size_t in_len;
+    int preface_done;
+    int settings_seen;         // 前言之后第一个帧必须是SETTINGS
+    
+    uint8_t *out;
+    size_t out_len;
+    int broken;                // 发送失败，连接不可再用
+    int overflows;             // 控制帧放不进发送缓冲区的次数(对端不读取却不断触发回应)
+    int closing;               // 已发送GOAWAY(连接错误)，不再处理新的帧
+    int goaway_sent;           // 已发送GOAWAY(NO_ERROR)，进行中的流发完后关闭
+    int peer_goaway;
+    
+    hpack_table_t decoder;
+    hpack_table_t encoder;
+    
+    // 跨HEADERS/CONTINUATION帧拼接的头部块
+    uint8_t *block;
+    size_t block_len;
+    uint32_t block_stream;     // 0表示没有未完成的头部块
+    
+    uint32_t last_stream_id;
+    int64_t window;            // 连接级发送窗口
+    uint32_t peer_initial_window;
+    uint32_t peer_max_frame;
+    uint32_t consumed;         // 已丢弃但还没有归还给对端的请求体字节数(连接级窗口)
+    
+    h2_stream_t streams[H2_MAX_STREAMS];
+    int active;
+    int deferred;              // 暂缓的流数
+    int next;                  // 轮转发送的起点
+    uint64_t progress_ms;      // 最近一次发出DATA帧(或会话空闲)的时间
+    char *upgrade_request;     // Upgrade请求，首次运行时作为流1响应
+};
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// 非阻塞发送输出缓冲区，发不完的部分留到socket可写时再发，从不等待
+static int flush_output(h2_session_t *s) {
+    size_t done = 0;
+    while (done < s->out_len && !s->broken) {
+        ssize_t n = send(s->fd, s->out + done, s->out_len - done, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n > 0) {
+            done += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        s->broken = 1;
+    }
+    memmove(s->out, s->out + done, s->out_len - done);
+    s->out_len -= done;
+    return s->broken ? -1 : 0;
+}
+
+static int connection_error(h2_session_t *s, uint32_t code);
+
+// 在输出缓冲区中追加帧头，返回负载位置
+// 空间不足时只尝试非阻塞发送；仍放不下就丢弃这一帧并计数，对端不读取却不断触发回应
+// (PING、SETTINGS、打开又重置流等)超过上限时以GOAWAY(ENHANCE_YOUR_CALM)结束连接
+static uint8_t *frame_begin(h2_session_t *s, size_t len, uint8_t type, uint8_t flags, uint32_t id) {
+    if (s->broken) return NULL;
+    size_t limit = type == FRAME_GOAWAY ? H2_OUTPUT_BUFFER : H2_OUTPUT_BUFFER - GOAWAY_FRAME_LEN;
+    if (s->out_len + FRAME_HEADER_LEN + len > limit && s->fd >= 0) flush_output(s);
+    if (s->out_len + FRAME_HEADER_LEN + len > limit) {
+        if (type != FRAME_GOAWAY && ++s->overflows > H2_CONTROL_OVERFLOW_LIMIT) {
+            connection_error(s, ERR_ENHANCE_YOUR_CALM);
+        }
+        return NULL;
+    }
+    uint8_t *p = s->out + s->out_len;
+    p[0] = len >> 16;
+    p[1] = len >> 8;
+    p[2] = len;
+    p[3] = type;
+    p[4] = flags;
+    put_u32(p + 5, id & MAX_WINDOW);
+    s->out_len += FRAME_HEADER_LEN + len;
+    return p + FRAME_HEADER_LEN;
+}
+
+static void send_settings(h2_session_t *s) {
+    static const struct { uint16_t id; uint32_t value; } settings[] = {
+        { SETTINGS_MAX_CONCURRENT_STREAMS, H2_MAX_STREAMS },
+        { SETTINGS_MAX_FRAME_SIZE, H2_MAX_FRAME_SIZE },
+        { SETTINGS_MAX_HEADER_LIST_SIZE, H2_MAX_HEADER_LIST },
+    };
+    int count = sizeof(settings) / sizeof(settings[0]);
+    uint8_t *p = frame_begin(s, count * 6, FRAME_SETTINGS, 0, 0);
+    if (!p) return;
+    for (int i = 0; i < count; i++, p += 6) {
+        p[0] = settings[i].id >> 8;
+        p[1] = settings[i].id;
+        put_u32(p + 2, settings[i].value);
+    }
+}
+
+static void send_window_update(h2_session_t *s, uint32_t id, uint32_t increment) {
+    uint8_t *p = frame_begin(s, 4, FRAME_WINDOW_UPDATE, 0, id);
+    if (p) put_u32(p, increment);
+}
+
+static void send_rst_stream(h2_session_t *s, uint32_t id, uint32_t code) {
+    uint8_t *p = frame_begin(s, 4, FRAME_RST_STREAM, 0, id);
+    if (p) put_u32(p, code);
+}
+
+// 连接错误: 发送GOAWAY后不再处理新的帧
+static int connection_error(h2_session_t *s, uint32_t code) {
+    if (!s->closing) {
+        uint8_t *p = frame_begin(s, 8, FRAME_GOAWAY, 0, 0);
+        if (p) {
+            put_u32(p, s->last_stream_id);
+            put_u32(p + 4, code);
+        }
+        s->closing = 1;
+        log_message(LOG_WARN, "HTTP/2连接错误 %u，发送GOAWAY", code);
+    }
+    return -1;
+}
+
+static h2_stream_t *find_stream(h2_session_t *s, uint32_t id) {
+    for (int i = 0; i < H2_MAX_STREAMS; i++) {
+        if (s->streams[i].id == id) return &s->streams[i];
+    }
+    return NULL;
+}
+
+static void close_stream(h2_session_t *s, h2_stream_t *st) {
+    if (st->resp.release) st->resp.release(&st->resp);
+    if (st->request) {
+        free(st->request);
+        s->deferred--;
+    }
+    memset(st, 0, sizeof(*st));
+    s->active--;
+}
+
+// :status和实体头部；content-type/server/date反复出现，加入动态表
+static int encode_response_headers(h2_session_t *s, const h2_response_t *resp, uint8_t *block, size_t size) {
+    char status[8], length[24], date[64];
+    snprintf(status, sizeof(status), "%d", resp->status);
+    snprintf(length, sizeof(length), "%zu", resp->body_len);
+    time_t now = time(NULL);
+    struct tm tm;
+    strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", gmtime_r(&now, &tm));
+    
+    int n = hpack_encode_begin(&s->encoder, block, size);
+    int m;
+    if (n < 0) return -1;
+    #define ENCODE(name, value, index) \
+        if ((m = hpack_encode(&s->encoder, block + n, size - n, name, value, index)) < 0) return -1; \
+        n += m
+    ENCODE(":status", status, 0);
+    if (resp->content_type) {
+        ENCODE("content-type", resp->content_type, 1);
+    }
+    if (resp->status != 304) {
+        ENCODE("content-length", length, 0);
+    }
+    if (resp->etag[0]) {
+        ENCODE("etag", resp->etag, 0);
+    }
+    if (resp->mtime) {
+        char last_modified[64];
+        strftime(last_modified, sizeof(last_modified), "%a, %d %b %Y %H:%M:%S GMT",
+                 gmtime_r(&resp->mtime, &tm));
+        ENCODE("last-modified", last_modified, 0);
+    }
+    ENCODE("date", date, 1);
+    ENCODE("server", "MyWebServer/1.0", 1);
+    #undef ENCODE
+    return n;
+}
+
+static void respond_stream(h2_session_t *s, h2_stream_t *st, const char *request);
+
+// 生成响应并发送HEADERS，响应体由调度器按DATA帧轮转发送
+static void start_response(h2_session_t *s, uint32_t id, const char *request) {
+    h2_stream_t *st = find_stream(s, 0);
+    if (!st) {
+        send_rst_stream(s, id, ERR_REFUSED_STREAM);
+        return;
+    }
+    st->id = id;
+    st->window = s->peer_initial_window;
+    st->sent = 0;
+    s->active++;
+    respond_stream(s, st, request);
+}
+
+// 调用respond生成响应并发送HEADERS；respond暂缓时保留请求，等下一次运行再调用
+static void respond_stream(h2_session_t *s, h2_stream_t *st, const char *request) {
+    uint32_t id = st->id;
+    memset(&st->resp, 0, sizeof(st->resp));
+    s->respond(s->arg, request, &st->resp);
+    if (st->resp.status == 0) {
+        if (!st->request) {
+            st->request = strdup(request);
+            if (!st->request) {
+                send_rst_stream(s, id, ERR_INTERNAL);
+                close_stream(s, st);
+                return;
+            }
+            s->deferred++;
+        }
+        return;
+    }
+    
+    uint8_t block[1024];
+    int len = encode_response_headers(s, &st->resp, block, sizeof(block));
+    if (len < 0) {
+        send_rst_stream(s, id, ERR_INTERNAL);
+        close_stream(s, st);
+        return;
+    }
+    int done = st->resp.body_len == 0;
+    uint8_t *p = frame_begin(s, len, FRAME_HEADERS, FLAG_END_HEADERS | (done ? FLAG_END_STREAM : 0), id);
+    if (p) memcpy(p, block, len);
+    if (done || !p) close_stream(s, st);
+}
+
+static int on_header(void *arg, const char *name, size_t name_len, const char *value, size_t value_len) {
+    h2_request_t *req = arg;
+    
+    // 值中的CR/LF/NUL会破坏拼出的HTTP/1.1请求头
+    if (memchr(value, '\r', value_len) || memchr(value, '\n', value_len) ||
+        memchr(value, '\0', value_len)) {
+        req->malformed = 1;
+        return 0;
+    }
+    
+    if (name_len > 0 && name[0] == ':') {
+        char *dst = NULL;
+        size_t dst_size = 0;
+        if (name_len == 7 && memcmp(name, ":method", 7) == 0) {
+            dst = req->method;
+            dst_size = sizeof(req->method);
+        } else if (name_len == 5 && memcmp(name, ":path", 5) == 0) {
+            dst = req->path;
+            dst_size = sizeof(req->path);
+        } else if (name_len == 10 && memcmp(name, ":authority", 10) == 0) {
+            dst = req->authority;
+            dst_size = sizeof(req->authority);
+        } else if (name_len != 7 || memcmp(name, ":scheme", 7) != 0) {
+            req->malformed = 1;
+        }
+        if (req->regular_seen || memchr(value, ' ', value_len)) req->malformed = 1;
+        if (dst && value_len < dst_size) {
+            memcpy(dst, value, value_len);
+            dst[value_len] = '\0';
+        } else if (dst) {
+            req->malformed = 1;
+        }
+        return 0;
+    }
+    
+    req->regular_seen = 1;
+    for (size_t i = 0; i < name_len; i++) {
+        if ((name[i] >= 'A' && name[i] <= 'Z') || name[i] == ':' || name[i] == ' ' ||
+            name[i] == '\r' || name[i] == '\n' || name[i] == '\0') {
+            req->malformed = 1;
+            return 0;
+        }
+    }
+    // 连接级头部在HTTP/2中无效
+    if (name_len == 10 && memcmp(name, "connection", 10) == 0) {
+        req->malformed = 1;
+        return 0;
+    }
+    
+    if (req->fields_len + name_len + value_len + 4 > H2_MAX_HEADER_LIST) {
+        req->malformed = 1;
+        return 0;
+    }
+    char *p = req->fields + req->fields_len;
+    memcpy(p, name, name_len);
+    p += name_len;
+    *p++ = ':';
+    *p++ = ' ';
+    memcpy(p, value, value_len);
+    p += value_len;
+    *p++ = '\r';
+    *p++ = '\n';
+    req->fields_len = p - req->fields;
+    return 0;
+}
+
+// 头部块收齐: 解码(即使流被拒绝也要解码以保持HPACK状态)，然后开始响应
+static int finish_headers(h2_session_t *s) {
+    uint32_t id = s->block_stream;
+    s->block_stream = 0;
+    
+    h2_request_t req;
+    memset(&req, 0, sizeof(req));
+    req.fields = malloc(H2_MAX_HEADER_LIST);
+    if (!req.fields) return connection_error(s, ERR_INTERNAL);
+    if (hpack_decode(&s->decoder, s->block, s->block_len, on_header, &req) != 0) {
+        free(req.fields);
+        return connection_error(s, ERR_COMPRESSION);
+    }
+    s->block_len = 0;
+    
+    // 已有流上的头部(trailer)不产生新的请求
+    if (id <= s->last_stream_id) {
+        free(req.fields);
+        return 0;
+    }
+    s->last_stream_id = id;
+    
+    if (req.malformed || !req.method[0] || !req.path[0]) {
+        send_rst_stream(s, id, ERR_PROTOCOL);
+    } else if (s->active >= H2_MAX_STREAMS || s->closing || s->goaway_sent || s->peer_goaway) {
+        send_rst_stream(s, id, ERR_REFUSED_STREAM);
+    } else {
+        size_t size = req.fields_len + strlen(req.path) + sizeof(req.authority) + 64;
+        char *request = malloc(size);
+        if (!request) {
+            free(req.fields);
+            return connection_error(s, ERR_INTERNAL);
+        }
+        int len = snprintf(request, size, "%s %s HTTP/2\r\n", req.method, req.path);
+        if (req.authority[0]) len += snprintf(request + len, size - len, "host: %s\r\n", req.authority);
+        memcpy(request + len, req.fields, req.fields_len);
+        memcpy(request + len + req.fields_len, "\r\n", 3);
+        start_response(s, id, request);
+        free(request);
+    }
+    free(req.fields);
+    return 0;
+}
+
+static int apply_settings(h2_session_t *s, const uint8_t *p, size_t len) {
+    for (size_t i = 0; i + 6 <= len; i += 6) {
+        uint16_t id = (p[i] << 8) | p[i + 1];
+        uint32_t value = get_u32(p + i + 2);
+        switch (id) {
+            case SETTINGS_HEADER_TABLE_SIZE:
+                hpack_encoder_set_limit(&s->encoder, value);
+                break;
+            case SETTINGS_ENABLE_PUSH:
+                if (value > 1) return connection_error(s, ERR_PROTOCOL);
+                break;
+            case SETTINGS_INITIAL_WINDOW_SIZE:
+                if (value > MAX_WINDOW) return connection_error(s, ERR_FLOW_CONTROL);
+                // 初始窗口的变化作用于所有已打开的流
+                for (int j = 0; j < H2_MAX_STREAMS; j++) {
+                    if (!s->streams[j].id) continue;
+                    s->streams[j].window += (int64_t)value - s->peer_initial_window;
+                    if (s->streams[j].window > MAX_WINDOW) return connection_error(s, ERR_FLOW_CONTROL);
+                }
+                s->peer_initial_window = value;
+                break;
+            case SETTINGS_MAX_FRAME_SIZE:
+                if (value < 16384 || value > 16777215) return connection_error(s, ERR_PROTOCOL);
+                s->peer_max_frame = value;
+                break;
+            default:
+                // 未知参数和只作提示的参数忽略
+                break;
+        }
+    }
+    return 0;
+}
+
+// 处理一个完整的帧，连接错误时返回-1
+static int process_frame(h2_session_t *s, uint8_t type, uint8_t flags, uint32_t id,
+                         const uint8_t *payload, size_t len) {
+    // 头部块未收齐时只能是同一个流的CONTINUATION
+    if (s->block_stream && (type != FRAME_CONTINUATION || id != s->block_stream)) {
+        return connection_error(s, ERR_PROTOCOL);
+    }
+    if (!s->settings_seen && type != FRAME_SETTINGS) return connection_error(s, ERR_PROTOCOL);
+    
+    switch (type) {
+        case FRAME_DATA: {
+            if (id == 0) return connection_error(s, ERR_PROTOCOL);
+            // 只提供静态文件，请求体直接丢弃，处理完这批输入后累计归还窗口
+            s->consumed += len;
+            h2_stream_t *st = find_stream(s, id);
+            if (st && !(flags & FLAG_END_STREAM)) st->consumed += len;
+            return 0;
+        }
+        case FRAME_HEADERS: {
+            if (id == 0 || id % 2 == 0) return connection_error(s, ERR_PROTOCOL);
+            size_t pad = 0;
+            if (flags & FLAG_PADDED) {
+                if (len < 1) return connection_error(s, ERR_FRAME_SIZE);
+                pad = payload[0];
+                payload++;
+                len--;
+            }
+            if (flags & FLAG_PRIORITY) {
+                if (len < 5) return connection_error(s, ERR_FRAME_SIZE);
+                payload += 5;
+                len -= 5;
+            }
+            if (pad > len) return connection_error(s, ERR_PROTOCOL);
+            len -= pad;
+            s->block_stream = id;
+            s->block_len = 0;
+        }
+        /* fall through */
+        case FRAME_CONTINUATION:
+            if (!s->block_stream) return connection_error(s, ERR_PROTOCOL);
+            if (s->block_len + len > H2_MAX_HEADER_LIST) return connection_error(s, ERR_ENHANCE_YOUR_CALM);
+            memcpy(s->block + s->block_len, payload, len);
+            s->block_len += len;
+            return flags & FLAG_END_HEADERS ? finish_headers(s) : 0;
+        case FRAME_PRIORITY:
+            if (id == 0) return connection_error(s, ERR_PROTOCOL);
+            if (len != 5) return connection_error(s, ERR_FRAME_SIZE);
+            return 0;
+        case FRAME_RST_STREAM: {
+            if (id == 0) return connection_error(s, ERR_PROTOCOL);
+            if (len != 4) return connection_error(s, ERR_FRAME_SIZE);
+            h2_stream_t *st = find_stream(s, id);
+            if (st) close_stream(s, st);
+            return 0;
+        }
+        case FRAME_SETTINGS:
+            if (id != 0) return connection_error(s, ERR_PROTOCOL);
+            if (flags & FLAG_ACK) {
+                return len == 0 ? 0 : connection_error(s, ERR_FRAME_SIZE);
+            }
+            if (len % 6 != 0) return connection_error(s, ERR_FRAME_SIZE);
+            s->settings_seen = 1;
+            if (apply_settings(s, payload, len) != 0) return -1;
+            frame_begin(s, 0, FRAME_SETTINGS, FLAG_ACK, 0);
+            return 0;
+        case FRAME_PUSH_PROMISE:
+            // 客户端不能推送
+            return connection_error(s, ERR_PROTOCOL);
+        case FRAME_PING: {
+            if (id != 0) return connection_error(s, ERR_PROTOCOL);
+            if (len != 8) return connection_error(s, ERR_FRAME_SIZE);
+            if (flags & FLAG_ACK) return 0;
+            uint8_t *p = frame_begin(s, 8, FRAME_PING, FLAG_ACK, 0);
+            if (p) memcpy(p, payload, 8);
+            return 0;
+        }
+        case FRAME_GOAWAY:
+            if (id != 0) return connection_error(s, ERR_PROTOCOL);
+            if (len < 8) return connection_error(s, ERR_FRAME_SIZE);
+            // 已开始的流继续发完，之后关闭连接
+            s->peer_goaway = 1;
+            return 0;
+        case FRAME_WINDOW_UPDATE: {
+            if (len != 4) return connection_error(s, ERR_FRAME_SIZE);
+            uint32_t increment = get_u32(payload) & MAX_WINDOW;
+            if (id == 0) {
+                if (increment == 0) return connection_error(s, ERR_PROTOCOL);
+                s->window += increment;
+                if (s->window > MAX_WINDOW) return connection_error(s, ERR_FLOW_CONTROL);
+                return 0;
+            }
+            h2_stream_t *st = find_stream(s, id);
+            if (!st) return 0;
+            if (increment == 0 || st->window + increment > MAX_WINDOW) {
+                send_rst_stream(s, id, increment == 0 ? ERR_PROTOCOL : ERR_FLOW_CONTROL);
+                close_stream(s, st);
+                return 0;
+            }
+            st->window += increment;
+            return 0;
+        }
+        default:
+            // 未知类型的帧必须忽略
+            return 0;
+    }
+}
+
+// 已处理的请求体累计到阈值后才发WINDOW_UPDATE: 对端发来大量小DATA帧时
+// 回应的帧数与实际读取的数据量成比例，而不是每个DATA帧都回应
+static void return_window_credit(h2_session_t *s) {
+    if (s->consumed >= WINDOW_CREDIT_THRESHOLD) {
+        send_window_update(s, 0, s->consumed);
+        s->consumed = 0;
+    }
+    for (int i = 0; i < H2_MAX_STREAMS; i++) {
+        h2_stream_t *st = &s->streams[i];
+        if (st->id && st->consumed >= WINDOW_CREDIT_THRESHOLD) {
+            send_window_update(s, st->id, st->consumed);
+            st->consumed = 0;
+        }
+    }
+}
+
+// 解析输入缓冲区中所有完整的帧
+static int process_input(h2_session_t *s) {
+    size_t pos = 0;
+    int ret = 0;
+    
+    if (!s->preface_done) {
+        size_t n = s->in_len < H2_PREFACE_LEN ? s->in_len : H2_PREFACE_LEN;
+        if (memcmp(s->in, H2_PREFACE, n) != 0) return connection_error(s, ERR_PROTOCOL);
+        if (n < H2_PREFACE_LEN) return 0;
+        s->preface_done = 1;
+        pos = H2_PREFACE_LEN;
+    }
+    
+    while (!s->closing && s->in_len - pos >= FRAME_HEADER_LEN) {
+        const uint8_t *p = s->in + pos;
+        size_t len = ((size_t)p[0] << 16) | (p[1] << 8) | p[2];
+        if (len > H2_MAX_FRAME_SIZE) {
+            ret = connection_error(s, ERR_FRAME_SIZE);
+            break;
+        }
+        if (s->in_len - pos < FRAME_HEADER_LEN + len) break;
+        
+        ret = process_frame(s, p[3], p[4], get_u32(p + 5) & MAX_WINDOW, p + FRAME_HEADER_LEN, len);
+        pos += FRAME_HEADER_LEN + len;
+        if (ret != 0) break;
+    }
+    
+    memmove(s->in, s->in + pos, s->in_len - pos);
+    s->in_len -= pos;
+    if (!s->closing) return_window_credit(s);
+    return ret;
+}
+
+// 轮转调度: 每个有数据且有窗口的流每轮最多发送一个分片，小响应不会被大文件阻塞
+static void schedule_data(h2_session_t *s) {
+    int progress = 1;
+    while (progress && s->window > 0 && s->active > 0 && !s->broken) {
+        progress = 0;
+        for (int k = 0; k < H2_MAX_STREAMS && s->window > 0; k++) {
+            int i = (s->next + k) % H2_MAX_STREAMS;
+            h2_stream_t *st = &s->streams[i];
+            if (!st->id || st->request || st->window <= 0) continue;
+            
+            size_t chunk = st->resp.body_len - st->sent;
+            if (chunk > H2_DATA_QUANTUM) chunk = H2_DATA_QUANTUM;
+            if (chunk > s->peer_max_frame) chunk = s->peer_max_frame;
+            if ((int64_t)chunk > st->window) chunk = st->window;
+            if ((int64_t)chunk > s->window) chunk = s->window;
+            // 输出缓冲区满时留给下一轮，调度本身从不阻塞；预留的部分留给控制帧
+            if (s->out_len + FRAME_HEADER_LEN + chunk > H2_OUTPUT_BUFFER - H2_CONTROL_RESERVE) {
+                s->next = i;
+                return;
+            }
+            
+            int last = st->sent + chunk == st->resp.body_len;
+            uint8_t *p = frame_begin(s, chunk, FRAME_DATA, last ? FLAG_END_STREAM : 0, st->id);
+            if (!p) return;
+            // 响应体可能是文件映射，文件被截断时撤回这一帧并重置流，不影响其他流
+            if (mapguard_copy(p, st->resp.body + st->sent, chunk) != 0) {
+                s->out_len -= FRAME_HEADER_LEN + chunk;
+                log_message(LOG_WARN, "HTTP/2流 %u 的响应体读取失败(文件被截断?)，重置流", st->id);
+                send_rst_stream(s, st->id, ERR_INTERNAL);
+                st->resp.failed = 1;
+                close_stream(s, st);
+                progress = 1;
+                continue;
+            }
+            st->sent += chunk;
+            st->window -= chunk;
+            s->window -= chunk;
+            s->progress_ms = now_ms();
+            progress = 1;
+            if (last) close_stream(s, st);
+        }
+        s->next = (s->next + 1) % H2_MAX_STREAMS;
+    }
+}
+
+h2_session_t *h2_session_create(h2_respond_t respond) {
+    h2_session_t *s = calloc(1, sizeof(h2_session_t));
+    if (!s) return NULL;
+    s->in = malloc(INPUT_BUFFER);
+    s->out = malloc(H2_OUTPUT_BUFFER);
+    s->block = malloc(H2_MAX_HEADER_LIST);
+    if (!s->in || !s->out || !s->block) {
+        h2_session_free(s);
+        return NULL;
+    }
+    s->respond = respond;
+    s->fd = -1;
+    s->window = DEFAULT_WINDOW;
+    s->peer_initial_window = DEFAULT_WINDOW;
+    s->peer_max_frame = 16384;
+    s->progress_ms = now_ms();
+    hpack_table_init(&s->decoder, HPACK_DEFAULT_TABLE_SIZE);
+    hpack_table_init(&s->encoder, HPACK_DEFAULT_TABLE_SIZE);
+    
+    // 服务器的连接前言是一个SETTINGS帧，随第一次发送一起发出
+    send_settings(s);
+    return s;
+}
+
+void h2_session_free(h2_session_t *s) {
+    if (!s) return;
+    for (int i = 0; i < H2_MAX_STREAMS; i++) {
+        if (s->streams[i].id) close_stream(s, &s->streams[i]);
+    }
+    hpack_table_free(&s->decoder);
+    hpack_table_free(&s->encoder);
+    free(s->upgrade_request);
+    free(s->in);
+    free(s->out);
+    free(s->block);
+    free(s);
+}
+
+int h2_session_feed(h2_session_t *s, const char *data, size_t len) {
+    if (len > INPUT_BUFFER - s->in_len) return -1;
+    memcpy(s->in + s->in_len, data, len);
+    s->in_len += len;
+    return 0;
+}
+
+int h2_session_upgrade(h2_session_t *s, const char *settings, const char *request) {
+    // HTTP2-Settings是SETTINGS帧负载的base64url编码，101响应即是对它的确认
+    uint8_t payload[256];
+    size_t len = 0;
+    uint32_t acc = 0;
+    int bits = 0;
+    for (const char *p = settings; *p && *p != '='; p++) {
+        int v;
+        if (*p >= 'A' && *p <= 'Z') v = *p - 'A';
+        else if (*p >= 'a' && *p <= 'z') v = *p - 'a' + 26;
+        else if (*p >= '0' && *p <= '9') v = *p - '0' + 52;
+        else if (*p == '-' || *p == '+') v = 62;
+        else if (*p == '_' || *p == '/') v = 63;
+        else return -1;
+        acc = (acc << 6) | v;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            if (len == sizeof(payload)) return -1;
+            payload[len++] = (uint8_t)(acc >> bits);
+        }
+    }
+    if (len % 6 != 0 || apply_settings(s, payload, len) != 0) return -1;
+    
+    s->upgrade_request = strdup(request);
+    if (!s->upgrade_request) return -1;
+    s->last_stream_id = 1;
+    return 0;
+}
+
+// 重新调用暂缓的流，respond可能再次暂缓
+static void resume_deferred(h2_session_t *s) {
+    for (int i = 0; i < H2_MAX_STREAMS && s->deferred > 0; i++) {
+        h2_stream_t *st = &s->streams[i];
+        if (!st->id || !st->request) continue;
+        char *request = st->request;
+        st->request = NULL;
+        s->deferred--;
+        respond_stream(s, st, request);
+        free(request);
+    }
+}
+
+h2_result_t h2_session_run(h2_session_t *s, int fd, void *arg) {
+    s->fd = fd;
+    s->arg = arg;
+    
+    // 停滞时限从会话开始有工作时算起，之前空闲的时间不计
+    if (!h2_session_busy(s)) s->progress_ms = now_ms();
+    
+    process_input(s);
+    if (!s->closing) resume_deferred(s);
+    
+    for (;;) {
+        int progress = 0;
+        if (!s->closing) {
+            ssize_t n = recv(fd, s->in + s->in_len, INPUT_BUFFER - s->in_len, MSG_DONTWAIT);
+            if (n == 0) return H2_CLOSE;
+            if (n > 0) {
+                s->in_len += n;
+                progress = 1;
+                process_input(s);
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                return H2_CLOSE;
+            }
+        }
+        
+        // 流1的响应等收到客户端的前言和SETTINGS后再发: 对端设置可能改变窗口，
+        // 有的客户端也无法在101之后立即接收大量帧
+        if (s->upgrade_request && s->settings_seen && !s->closing) {
+            start_response(s, 1, s->upgrade_request);
+            free(s->upgrade_request);
+            s->upgrade_request = NULL;
+            progress = 1;
+        }
+        
+        schedule_data(s);
+        size_t pending = s->out_len;
+        if (flush_output(s) != 0) return H2_CLOSE;
+        if (s->out_len < pending) progress = 1;
+        
+        // 发出GOAWAY后只等输出发完；因对端不读取而发出的GOAWAY不再等待
+        if (s->closing && (s->out_len == 0 || s->overflows > H2_CONTROL_OVERFLOW_LIMIT)) {
+            return H2_CLOSE;
+        }
+        if (progress && !s->closing) continue;
+        
+        // 暂缓的请求要换到其他线程处理，先把已生成的帧发出去
+        if (s->deferred > 0 && !s->closing) return H2_DEFER;
+        if (!h2_session_busy(s)) return s->peer_goaway || s->goaway_sent ? H2_CLOSE : H2_IDLE;
+        
+        // 等待对端的帧(WINDOW_UPDATE等)或socket可写: 交还调用方，不在会话里阻塞。
+        // 对端只回PING而不开窗口时也不算进展，超过时限没有发出DATA就关闭
+        if (now_ms() - s->progress_ms >= SEND_STALL_TIMEOUT_MS) {
+            log_message(LOG_WARN, "HTTP/2连接 %d 发送停滞，关闭", fd);
+            return H2_CLOSE;
+        }
+        return H2_BLOCKED;
+    }
+}
+
+int h2_session_busy(const h2_session_t *s) {
+    return s->active > 0 || s->out_len > 0 || s->upgrade_request != NULL;
+}
+
+int h2_session_wants_write(const h2_session_t *s) {
+    return s->out_len > 0;
+}
+
+void h2_session_goaway(h2_session_t *s, int fd) {
+    if (!s->closing && !s->goaway_sent) {
+        uint8_t *p = frame_begin(s, 8, FRAME_GOAWAY, 0, 0);
+        if (p) {
+            put_u32(p, s->last_stream_id);
+            put_u32(p + 4, ERR_NO_ERROR);
+        }
+    }
+    s->goaway_sent = 1;
+    if (fd >= 0) {
+        s->fd = fd;
+        flush_output(s);
+    }
+}
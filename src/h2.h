@@ -0,0 +1,57 @@
+#ifndef H2_H
+#define H2_H
+
+#include <stddef.h>
+#include <time.h>
+
+// 明文HTTP/2(h2c): 帧解析、HPACK、按流和连接的流量控制，多个流的DATA帧轮转发送
+// 会话只处理已连接的socket，请求由respond回调生成响应；会话从不阻塞等待对端，
+// 需要等待时返回，由调用方在socket就绪后再次运行
+#define H2_PREFACE "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+#define H2_PREFACE_LEN 24
+
+typedef struct h2_response h2_response_t;
+
+struct h2_response {
+    int status;
+    const char *content_type;  // NULL表示不发送
+    char etag[64];             // 空串表示不发送
+    time_t mtime;              // 0表示不发送Last-Modified
+    const char *body;          // 流发送完(或被取消)之前保持有效
+    size_t body_len;
+    int failed;                // 读取响应体时出错(映射的文件被截断)，流已被重置
+    void (*release)(h2_response_t *resp); // 流结束时调用(可为NULL)
+    void *owner;
+    void *data;
+};
+
+// request为按HTTP/1.1格式拼出的请求头("GET /path HTTP/2\r\nhost: ...\r\n\r\n")
+// resp->status保持0表示暂缓: 会话保留请求并返回H2_DEFER，下一次运行时再次调用
+typedef void (*h2_respond_t)(void *arg, const char *request, h2_response_t *resp);
+
+typedef enum {
+    H2_IDLE,                   // 没有进行中的流，可以把连接交还事件循环
+    H2_BLOCKED,                // 流在等待对端的窗口或socket可写，等连接就绪后再运行
+    H2_DEFER,                  // 有暂缓的请求，应换到可以阻塞的线程再运行
+    H2_CLOSE                   // 对端关闭、协议错误或发送停滞，应关闭连接
+} h2_result_t;
+
+typedef struct h2_session h2_session_t;
+
+h2_session_t *h2_session_create(h2_respond_t respond);
+void h2_session_free(h2_session_t *session);
+// 交给会话已经读到的字节(连接前言及之后的帧)
+int h2_session_feed(h2_session_t *session, const char *data, size_t len);
+// HTTP/1.1 Upgrade: 应用HTTP2-Settings(base64url)，原请求作为流1处理
+int h2_session_upgrade(h2_session_t *session, const char *settings, const char *request);
+// 处理到没有可读数据且无法继续发送为止，arg传给respond
+// 有进行中的流却超过SEND_STALL_TIMEOUT_MS没有发出DATA帧时返回H2_CLOSE
+h2_result_t h2_session_run(h2_session_t *session, int fd, void *arg);
+// 还有进行中的流或未发出的数据
+int h2_session_busy(const h2_session_t *session);
+// 输出缓冲区有数据，需要等待socket可写
+int h2_session_wants_write(const h2_session_t *session);
+// 发送GOAWAY(NO_ERROR)，不再接受新的流，进行中的流发完后关闭；fd非负时立即尝试发送(不阻塞)
+void h2_session_goaway(h2_session_t *session, int fd);
+
+#endif
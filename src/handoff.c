@@ -0,0 +1,262 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "handoff.h"
+#include "config.h"
+#include "logging.h"
+
+#define HANDOFF_REQUEST "LLABUPG1"
+#define HANDOFF_REPLY   "LLABFDS1"
+#define HANDOFF_ACK     "LLABACK1"
+#define HANDOFF_MSG_LEN 8
+#define HANDOFF_MAX_FDS 3          // TCP监听socket、Unix域监听socket、缓存快照
+
+// 旧进程侧的等待状态
+static struct {
+    int sock_fd;
+    int listen_fd;
+    int unix_fd;
+    cache_t *cache;
+    char path[108];
+    pthread_t thread;
+    int running;
+    int completed;
+} handoff = { .sock_fd = -1 };
+
+static int make_address(const char *path, struct sockaddr_un *addr) {
+    if (strlen(path) >= sizeof(addr->sun_path)) return -1;
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    strcpy(addr->sun_path, path);
+    return 0;
+}
+
+// 发送消息并附带fds[0..count)
+static int send_fds(int sock, const char *msg, const int *fds, int count) {
+    char control[CMSG_SPACE(sizeof(int) * HANDOFF_MAX_FDS)];
+    struct iovec iov = { .iov_base = (void *)msg, .iov_len = HANDOFF_MSG_LEN };
+    struct msghdr mh;
+    memset(&mh, 0, sizeof(mh));
+    memset(control, 0, sizeof(control));
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = control;
+    mh.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+    
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&mh);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * count);
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * count);
+    
+    return sendmsg(sock, &mh, MSG_NOSIGNAL) == HANDOFF_MSG_LEN ? 0 : -1;
+}
+
+// 接收消息及附带的fd，返回收到的fd数量
+static int recv_fds(int sock, char *msg, int *fds, int max) {
+    char control[CMSG_SPACE(sizeof(int) * HANDOFF_MAX_FDS)];
+    struct iovec iov = { .iov_base = msg, .iov_len = HANDOFF_MSG_LEN };
+    struct msghdr mh;
+    memset(&mh, 0, sizeof(mh));
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = control;
+    mh.msg_controllen = sizeof(control);
+    
+    if (recvmsg(sock, &mh, MSG_CMSG_CLOEXEC) != HANDOFF_MSG_LEN) return -1;
+    
+    int count = 0;
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&mh); cmsg; cmsg = CMSG_NXTHDR(&mh, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+        int n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        if (n > HANDOFF_MAX_FDS) n = HANDOFF_MAX_FDS;
+        int received[HANDOFF_MAX_FDS];
+        memcpy(received, CMSG_DATA(cmsg), sizeof(int) * n);
+        for (int i = 0; i < n; i++) {
+            if (count < max) fds[count++] = received[i];
+            else close(received[i]);
+        }
+    }
+    return count;
+}
+
+// 按类型区分收到的fd: 缓存快照不是socket，监听socket按地址族区分
+static void classify_fd(int fd, int *listen_fd, int *unix_fd, int *cache_fd) {
+    struct stat st;
+    struct sockaddr_storage addr;
+    socklen_t len = sizeof(addr);
+    int **slot;
+    
+    if (fstat(fd, &st) == 0 && !S_ISSOCK(st.st_mode)) {
+        slot = &cache_fd;
+    } else if (getsockname(fd, (struct sockaddr *)&addr, &len) == 0 && addr.ss_family == AF_UNIX) {
+        slot = &unix_fd;
+    } else {
+        slot = &listen_fd;
+    }
+    
+    if (**slot >= 0) close(**slot);
+    **slot = fd;
+}
+
+int handoff_receive(const char *path, int *listen_fd, int *unix_fd, int *cache_fd) {
+    *listen_fd = -1;
+    *unix_fd = -1;
+    *cache_fd = -1;
+    
+    struct sockaddr_un addr;
+    if (make_address(path, &addr) != 0) return -1;
+    
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0) return -1;
+    
+    // 连接失败说明没有旧进程在运行(或socket文件已过期)，正常冷启动
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        send(sock, HANDOFF_REQUEST, HANDOFF_MSG_LEN, MSG_NOSIGNAL) != HANDOFF_MSG_LEN) {
+        close(sock);
+        return -1;
+    }
+    
+    char msg[HANDOFF_MSG_LEN];
+    int fds[HANDOFF_MAX_FDS];
+    int count = recv_fds(sock, msg, fds, HANDOFF_MAX_FDS);
+    if (count < 1 || memcmp(msg, HANDOFF_REPLY, HANDOFF_MSG_LEN) != 0) {
+        for (int i = 0; i < count; i++) close(fds[i]);
+        close(sock);
+        log_message(LOG_WARN, "交接失败: 旧进程没有返回监听socket");
+        return -1;
+    }
+    
+    for (int i = 0; i < count; i++) classify_fd(fds[i], listen_fd, unix_fd, cache_fd);
+    if (*listen_fd < 0) {
+        if (*unix_fd >= 0) close(*unix_fd);
+        if (*cache_fd >= 0) close(*cache_fd);
+        *unix_fd = *cache_fd = -1;
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+void handoff_confirm(int conn_fd) {
+    if (conn_fd < 0) return;
+    send(conn_fd, HANDOFF_ACK, HANDOFF_MSG_LEN, MSG_NOSIGNAL);
+    close(conn_fd);
+}
+
+// 把监听socket和缓存快照交给一个新进程，对方确认后返回0
+static int serve_request(int conn) {
+    // 只和同一用户的进程交接
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0 || cred.uid != geteuid()) {
+        return -1;
+    }
+    
+    char msg[HANDOFF_MSG_LEN];
+    if (recv(conn, msg, sizeof(msg), MSG_WAITALL) != HANDOFF_MSG_LEN ||
+        memcmp(msg, HANDOFF_REQUEST, HANDOFF_MSG_LEN) != 0) {
+        return -1;
+    }
+    
+    // 快照写入匿名内存文件，失败时新进程冷启动
+    int fds[HANDOFF_MAX_FDS] = { handoff.listen_fd, -1, -1 };
+    int count = 1;
+    if (handoff.unix_fd >= 0) fds[count++] = handoff.unix_fd;
+    int cache_fd = memfd_create("llab-handoff-cache", MFD_CLOEXEC);
+    if (cache_fd >= 0 && cache_save_fd(handoff.cache, cache_fd) == 0) {
+        fds[count++] = cache_fd;
+    }
+    
+    int ret = send_fds(conn, HANDOFF_REPLY, fds, count);
+    if (cache_fd >= 0) close(cache_fd);
+    if (ret != 0) return -1;
+    
+    // 新进程启动失败时不会确认，继续提供服务
+    struct pollfd pfd = { .fd = conn, .events = POLLIN };
+    if (poll(&pfd, 1, HANDOFF_ACK_TIMEOUT_MS) <= 0 ||
+        recv(conn, msg, sizeof(msg), MSG_WAITALL) != HANDOFF_MSG_LEN ||
+        memcmp(msg, HANDOFF_ACK, HANDOFF_MSG_LEN) != 0) {
+        log_message(LOG_WARN, "新进程未确认交接，继续提供服务");
+        return -1;
+    }
+    return 0;
+}
+
+static void *handoff_thread(void *arg) {
+    (void)arg;
+    while (1) {
+        int conn = accept4(handoff.sock_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (conn < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;  // handoff_stop关闭了socket
+        }
+        
+        int ret = serve_request(conn);
+        close(conn);
+        if (ret == 0) {
+            __atomic_store_n(&handoff.completed, 1, __ATOMIC_RELEASE);
+            printf("监听socket已交给新进程，开始排空连接\n");
+            kill(getpid(), SIGTERM);
+            break;
+        }
+    }
+    return NULL;
+}
+
+int handoff_start(const char *path, int listen_fd, int unix_fd, cache_t *cache) {
+    struct sockaddr_un addr;
+    if (make_address(path, &addr) != 0) return -1;
+    
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0) return -1;
+    
+    // 旧进程交接后不再需要socket文件，由新进程重新创建
+    unlink(path);
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(sock, 4) != 0) {
+        close(sock);
+        return -1;
+    }
+    
+    handoff.sock_fd = sock;
+    handoff.listen_fd = listen_fd;
+    handoff.unix_fd = unix_fd;
+    handoff.cache = cache;
+    handoff.completed = 0;
+    snprintf(handoff.path, sizeof(handoff.path), "%s", path);
+    
+    if (pthread_create(&handoff.thread, NULL, handoff_thread, NULL) != 0) {
+        close(sock);
+        unlink(path);
+        handoff.sock_fd = -1;
+        return -1;
+    }
+    handoff.running = 1;
+    return 0;
+}
+
+void handoff_stop(void) {
+    if (!handoff.running) return;
+    
+    // shutdown唤醒阻塞在accept中的线程
+    shutdown(handoff.sock_fd, SHUT_RDWR);
+    pthread_join(handoff.thread, NULL);
+    close(handoff.sock_fd);
+    handoff.sock_fd = -1;
+    handoff.running = 0;
+    
+    if (!handoff_completed()) unlink(handoff.path);
+}
+
+int handoff_completed(void) {
+    return __atomic_load_n(&handoff.completed, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,21 @@
+#ifndef HANDOFF_H
+#define HANDOFF_H
+
+#include "cache.h"
+
+// 平滑升级: 旧进程在Unix socket上等待新进程，通过SCM_RIGHTS把监听socket
+// 和缓存快照(memfd)交给新进程，收到确认后停止accept、排空连接并退出
+
+// 向path上运行中的旧进程请求交接，成功时返回交接连接(用handoff_confirm确认)，
+// 并得到TCP监听socket、Unix域监听socket和缓存快照fd(后两者没有时为-1)；没有旧进程时返回-1
+int handoff_receive(const char *path, int *listen_fd, int *unix_fd, int *cache_fd);
+// 新进程准备好接受连接后确认交接，旧进程收到后开始排空
+void handoff_confirm(int conn_fd);
+// 在path上等待下一个新进程，交接成功后向本进程发送SIGTERM
+int handoff_start(const char *path, int listen_fd, int unix_fd, cache_t *cache);
+// 停止等待并删除socket文件(已交接时文件属于新进程，不删除)
+void handoff_stop(void);
+// 是否已把监听socket交给新进程
+int handoff_completed(void);
+
+#endif
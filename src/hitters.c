@@ -0,0 +1,289 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "hitters.h"
+#include "config.h"
+
+// 线程本地尚未写入的记录，同一路径合并为一项
+typedef struct {
+    char path[HITTERS_KEY_LEN];
+    unsigned int hash;
+    uint64_t count;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t bytes;
+    uint64_t service_us;
+} pending_t;
+
+typedef struct {
+    hitters_t *owner;
+    int size;                  // entries中的项数
+    int records;               // 合并前的请求数
+    uint64_t since_ms;         // 第一个未写入请求的时间
+    pending_t entries[HITTERS_BATCH];
+} batch_t;
+
+static __thread batch_t batch;
+
+static unsigned int hash_path(const char *path) {
+    unsigned int h = 5381;
+    while (*path) h = (h << 5) + h + (unsigned char)*path++;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    return h;
+}
+
+static void heap_swap(hitters_t *hitters, int a, int b) {
+    int slot_a = hitters->heap[a];
+    int slot_b = hitters->heap[b];
+    hitters->heap[a] = slot_b;
+    hitters->heap[b] = slot_a;
+    hitters->slots[slot_a].heap_index = b;
+    hitters->slots[slot_b].heap_index = a;
+}
+
+static uint64_t heap_count(const hitters_t *hitters, int pos) {
+    return hitters->slots[hitters->heap[pos]].count;
+}
+
+static void sift_up(hitters_t *hitters, int pos) {
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (heap_count(hitters, parent) <= heap_count(hitters, pos)) break;
+        heap_swap(hitters, pos, parent);
+        pos = parent;
+    }
+}
+
+// 计数只会增加，更新后向下调整即可
+static void sift_down(hitters_t *hitters, int pos) {
+    while (1) {
+        int smallest = pos;
+        int left = pos * 2 + 1;
+        int right = left + 1;
+        if (left < hitters->size && heap_count(hitters, left) < heap_count(hitters, smallest)) smallest = left;
+        if (right < hitters->size && heap_count(hitters, right) < heap_count(hitters, smallest)) smallest = right;
+        if (smallest == pos) break;
+        heap_swap(hitters, pos, smallest);
+        pos = smallest;
+    }
+}
+
+static void bucket_unlink(hitters_t *hitters, int index) {
+    int *link = &hitters->buckets[hash_path(hitters->slots[index].path) & hitters->bucket_mask];
+    while (*link >= 0) {
+        if (*link == index) {
+            *link = hitters->slots[index].next;
+            return;
+        }
+        link = &hitters->slots[*link].next;
+    }
+}
+
+hitters_t *hitters_create(int capacity) {
+    hitters_t *hitters = calloc(1, sizeof(hitters_t));
+    if (!hitters) return NULL;
+    
+    unsigned int buckets = 64;
+    while (buckets < (unsigned int)capacity * 2) buckets <<= 1;
+    
+    hitters->slots = calloc(capacity, sizeof(hitter_t));
+    hitters->heap = calloc(capacity, sizeof(int));
+    hitters->buckets = malloc(buckets * sizeof(int));
+    if (!hitters->slots || !hitters->heap || !hitters->buckets) {
+        hitters_destroy(hitters);
+        return NULL;
+    }
+    for (unsigned int i = 0; i < buckets; i++) hitters->buckets[i] = -1;
+    hitters->bucket_mask = buckets - 1;
+    hitters->capacity = capacity;
+    pthread_mutex_init(&hitters->lock, NULL);
+    return hitters;
+}
+
+void hitters_destroy(hitters_t *hitters) {
+    if (!hitters) return;
+    if (hitters->slots) pthread_mutex_destroy(&hitters->lock);
+    free(hitters->slots);
+    free(hitters->heap);
+    free(hitters->buckets);
+    free(hitters);
+}
+
+// 把一项合并后的记录计入槽位(调用者持有锁)
+static void apply_locked(hitters_t *hitters, const pending_t *pending) {
+    unsigned int bucket = pending->hash & hitters->bucket_mask;
+    int index = hitters->buckets[bucket];
+    while (index >= 0 && strcmp(hitters->slots[index].path, pending->path) != 0) {
+        index = hitters->slots[index].next;
+    }
+    
+    if (index < 0) {
+        hitter_t *slot;
+        if (hitters->size < hitters->capacity) {
+            // 还有空槽位: 计数从0开始，放到堆尾后上浮
+            index = hitters->size++;
+            slot = &hitters->slots[index];
+            slot->count = 0;
+            slot->error = 0;
+            slot->heap_index = index;
+            hitters->heap[index] = index;
+            sift_up(hitters, index);
+        } else {
+            // 接管计数最小的槽位，其计数成为新路径的误差上界
+            index = hitters->heap[0];
+            slot = &hitters->slots[index];
+            bucket_unlink(hitters, index);
+            slot->error = slot->count;
+        }
+        memcpy(slot->path, pending->path, sizeof(slot->path));
+        slot->hits = slot->misses = slot->bytes = slot->service_us = 0;
+        slot->next = hitters->buckets[bucket];
+        hitters->buckets[bucket] = index;
+    }
+    
+    hitter_t *slot = &hitters->slots[index];
+    slot->count += pending->count;
+    slot->hits += pending->hits;
+    slot->misses += pending->misses;
+    slot->bytes += pending->bytes;
+    slot->service_us += pending->service_us;
+    sift_down(hitters, slot->heap_index);
+}
+
+static void flush_batch(hitters_t *hitters) {
+    pthread_mutex_lock(&hitters->lock);
+    hitters->total += batch.records;
+    for (int i = 0; i < batch.size; i++) apply_locked(hitters, &batch.entries[i]);
+    pthread_mutex_unlock(&hitters->lock);
+    batch.size = 0;
+    batch.records = 0;
+}
+
+static uint64_t coarse_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void hitters_record(hitters_t *hitters, const char *path, int hit, size_t bytes, uint64_t service_us) {
+    if (!hitters || !path) return;
+    
+    // 线程上一批属于另一个(已销毁的)统计实例时丢弃
+    if (batch.owner != hitters) {
+        batch.owner = hitters;
+        batch.size = 0;
+        batch.records = 0;
+    }
+    
+    // 过长的路径截断后统计，哈希也按截断后的key计算
+    char key[HITTERS_KEY_LEN];
+    snprintf(key, sizeof(key), "%s", path);
+    unsigned int hash = hash_path(key);
+    
+    pending_t *pending = NULL;
+    for (int i = 0; i < batch.size; i++) {
+        if (batch.entries[i].hash == hash && strcmp(batch.entries[i].path, key) == 0) {
+            pending = &batch.entries[i];
+            break;
+        }
+    }
+    if (!pending) {
+        pending = &batch.entries[batch.size++];
+        memcpy(pending->path, key, sizeof(key));
+        pending->hash = hash;
+        pending->count = pending->hits = pending->misses = 0;
+        pending->bytes = pending->service_us = 0;
+    }
+    
+    uint64_t now = coarse_now_ms();
+    if (batch.records++ == 0) batch.since_ms = now;
+    pending->count++;
+    if (hit) pending->hits++;
+    else pending->misses++;
+    pending->bytes += bytes;
+    pending->service_us += service_us;
+    
+    if (batch.records >= HITTERS_BATCH || now - batch.since_ms >= HITTERS_FLUSH_MS) {
+        flush_batch(hitters);
+    }
+}
+
+static uint64_t order_value(const hitter_t *h, hitters_order_t order) {
+    switch (order) {
+        case HITTERS_BY_MISSES: return h->misses;
+        case HITTERS_BY_BYTES: return h->bytes;
+        case HITTERS_BY_TIME: return h->service_us;
+        default: return h->count;
+    }
+}
+
+static int compare_hitters(const void *a, const void *b, void *arg) {
+    hitters_order_t order = *(const hitters_order_t *)arg;
+    uint64_t va = order_value(a, order);
+    uint64_t vb = order_value(b, order);
+    if (va != vb) return va < vb ? 1 : -1;
+    
+    uint64_t ca = ((const hitter_t *)a)->count;
+    uint64_t cb = ((const hitter_t *)b)->count;
+    return ca < cb ? 1 : ca > cb ? -1 : 0;
+}
+
+int hitters_top(hitters_t *hitters, hitters_order_t order, hitter_t *out, int max, uint64_t *total) {
+    if (!hitters || max <= 0) return 0;
+    
+    // 复制后在锁外排序，不阻塞请求线程
+    hitter_t *copy = malloc(sizeof(hitter_t) * hitters->capacity);
+    if (!copy) return 0;
+    
+    pthread_mutex_lock(&hitters->lock);
+    int size = hitters->size;
+    memcpy(copy, hitters->slots, sizeof(hitter_t) * size);
+    if (total) *total = hitters->total;
+    pthread_mutex_unlock(&hitters->lock);
+    
+    qsort_r(copy, size, sizeof(hitter_t), compare_hitters, &order);
+    int count = size < max ? size : max;
+    memcpy(out, copy, sizeof(hitter_t) * count);
+    free(copy);
+    return count;
+}
+
+int hitters_dump(hitters_t *hitters, const char *file, int max) {
+    if (!hitters || max <= 0) return -1;
+    
+    hitter_t *top = malloc(sizeof(hitter_t) * max);
+    if (!top) return -1;
+    uint64_t total;
+    int count = hitters_top(hitters, HITTERS_BY_REQUESTS, top, max, &total);
+    
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s.tmp.%d", file, (int)getpid());
+    FILE *fp = fopen(tmp, "w");
+    if (!fp) {
+        free(top);
+        return -1;
+    }
+    
+    // 预热按列表顺序加载，最热的路径在前；带查询串或被截断的路径不是文件路径
+    fprintf(fp, "# hot-list: top %d of %llu requests\n", count, (unsigned long long)total);
+    int written = 0;
+    for (int i = 0; i < count; i++) {
+        if (top[i].path[0] != '/' || strchr(top[i].path, '?') ||
+            strlen(top[i].path) == HITTERS_KEY_LEN - 1) {
+            continue;
+        }
+        fprintf(fp, "%s\n", top[i].path);
+        written++;
+    }
+    free(top);
+    
+    if (fclose(fp) != 0 || rename(tmp, file) != 0) {
+        unlink(tmp);
+        return -1;
+    }
+    return written;
+}
@@ -0,0 +1,53 @@
+#ifndef HITTERS_H
+#define HITTERS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+// Space-Saving热点统计: 固定数量的槽位跟踪请求最多的路径
+// 新路径在槽位用满时接管计数最小的槽位，并继承其计数作为误差上界
+#define HITTERS_KEY_LEN 256
+
+typedef struct {
+    char path[HITTERS_KEY_LEN];
+    uint64_t count;            // 估计请求数(不低于真实值)
+    uint64_t error;            // 接管槽位时继承的计数，真实请求数不少于count - error
+    uint64_t hits;             // 以下统计从路径占据槽位时开始累计
+    uint64_t misses;
+    uint64_t bytes;
+    uint64_t service_us;       // 服务时间总和(微秒)
+    int heap_index;            // 在最小堆中的位置
+    int next;                  // 哈希链中的下一个槽位，-1表示结尾
+} hitter_t;
+
+// 排序依据
+typedef enum {
+    HITTERS_BY_REQUESTS,
+    HITTERS_BY_MISSES,
+    HITTERS_BY_BYTES,
+    HITTERS_BY_TIME
+} hitters_order_t;
+
+typedef struct {
+    hitter_t *slots;
+    int capacity;
+    int size;
+    int *heap;                 // 按count排列的最小堆(槽位下标)，堆顶是下一个被替换的槽位
+    int *buckets;              // 哈希桶，指向槽位下标，-1为空
+    unsigned int bucket_mask;
+    uint64_t total;            // 记录过的请求总数
+    pthread_mutex_t lock;
+} hitters_t;
+
+hitters_t *hitters_create(int capacity);
+void hitters_destroy(hitters_t *hitters);
+// 每个请求调用一次(线程安全)。记录先在线程本地合并，攒够HITTERS_BATCH个请求或超过
+// HITTERS_FLUSH_MS后才加锁写入，因此每个线程最多有一批请求暂未出现在top中
+void hitters_record(hitters_t *hitters, const char *path, int hit, size_t bytes, uint64_t service_us);
+// 复制排名前max个的槽位到out，返回实际个数；total可为NULL
+int hitters_top(hitters_t *hitters, hitters_order_t order, hitter_t *out, int max, uint64_t *total);
+// 把请求数最多的max个路径写成预热热点列表(每行一个路径)，先写临时文件再rename
+int hitters_dump(hitters_t *hitters, const char *file, int max);
+
+#endif
@@ -0,0 +1,485 @@
+#include <stdlib.h>
+#include <string.h>
+#include "hpack.h"
+
+#define STATIC_COUNT 61
+
+static const struct {
+    const char *name;
+    const char *value;
+} static_table[STATIC_COUNT] = {
+    { ":authority", "" },
+    { ":method", "GET" },
+    { ":method", "POST" },
+    { ":path", "/" },
+    { ":path", "/index.html" },
+    { ":scheme", "http" },
+    { ":scheme", "https" },
+    { ":status", "200" },
+    { ":status", "204" },
+    { ":status", "206" },
+    { ":status", "304" },
+    { ":status", "400" },
+    { ":status", "404" },
+    { ":status", "500" },
+    { "accept-charset", "" },
+    { "accept-encoding", "gzip, deflate" },
+    { "accept-language", "" },
+    { "accept-ranges", "" },
+    { "accept", "" },
+    { "access-control-allow-origin", "" },
+    { "age", "" },
+    { "allow", "" },
+    { "authorization", "" },
+    { "cache-control", "" },
+    { "content-disposition", "" },
+    { "content-encoding", "" },
+    { "content-language", "" },
+    { "content-length", "" },
+    { "content-location", "" },
+    { "content-range", "" },
+    { "content-type", "" },
+    { "cookie", "" },
+    { "date", "" },
+    { "etag", "" },
+    { "expect", "" },
+    { "expires", "" },
+    { "from", "" },
+    { "host", "" },
+    { "if-match", "" },
+    { "if-modified-since", "" },
+    { "if-none-match", "" },
+    { "if-range", "" },
+    { "if-unmodified-since", "" },
+    { "last-modified", "" },
+    { "link", "" },
+    { "location", "" },
+    { "max-forwards", "" },
+    { "proxy-authenticate", "" },
+    { "proxy-authorization", "" },
+    { "range", "" },
+    { "referer", "" },
+    { "refresh", "" },
+    { "retry-after", "" },
+    { "server", "" },
+    { "set-cookie", "" },
+    { "strict-transport-security", "" },
+    { "transfer-encoding", "" },
+    { "user-agent", "" },
+    { "vary", "" },
+    { "via", "" },
+    { "www-authenticate", "" },
+};
+
+// Huffman码表(RFC 7541附录B)，下标为符号，256是EOS
+static const struct {
+    uint32_t code;
+    uint8_t bits;
+} huffman_codes[257] = {
+    { 0x1ff8, 13 }, { 0x7fffd8, 23 }, { 0xfffffe2, 28 }, { 0xfffffe3, 28 },
+    { 0xfffffe4, 28 }, { 0xfffffe5, 28 }, { 0xfffffe6, 28 }, { 0xfffffe7, 28 },
+    { 0xfffffe8, 28 }, { 0xffffea, 24 }, { 0x3ffffffc, 30 }, { 0xfffffe9, 28 },
+    { 0xfffffea, 28 }, { 0x3ffffffd, 30 }, { 0xfffffeb, 28 }, { 0xfffffec, 28 },
+    { 0xfffffed, 28 }, { 0xfffffee, 28 }, { 0xfffffef, 28 }, { 0xffffff0, 28 },
+    { 0xffffff1, 28 }, { 0xffffff2, 28 }, { 0x3ffffffe, 30 }, { 0xffffff3, 28 },
+    { 0xffffff4, 28 }, { 0xffffff5, 28 }, { 0xffffff6, 28 }, { 0xffffff7, 28 },
+    { 0xffffff8, 28 }, { 0xffffff9, 28 }, { 0xffffffa, 28 }, { 0xffffffb, 28 },
+    { 0x14, 6 }, { 0x3f8, 10 }, { 0x3f9, 10 }, { 0xffa, 12 },
+    { 0x1ff9, 13 }, { 0x15, 6 }, { 0xf8, 8 }, { 0x7fa, 11 },
+    { 0x3fa, 10 }, { 0x3fb, 10 }, { 0xf9, 8 }, { 0x7fb, 11 },
+    { 0xfa, 8 }, { 0x16, 6 }, { 0x17, 6 }, { 0x18, 6 },
+    { 0x0, 5 }, { 0x1, 5 }, { 0x2, 5 }, { 0x19, 6 },
+    { 0x1a, 6 }, { 0x1b, 6 }, { 0x1c, 6 }, { 0x1d, 6 },
+    { 0x1e, 6 }, { 0x1f, 6 }, { 0x5c, 7 }, { 0xfb, 8 },
+    { 0x7ffc, 15 }, { 0x20, 6 }, { 0xffb, 12 }, { 0x3fc, 10 },
+    { 0x1ffa, 13 }, { 0x21, 6 }, { 0x5d, 7 }, { 0x5e, 7 },
+    { 0x5f, 7 }, { 0x60, 7 }, { 0x61, 7 }, { 0x62, 7 },
+    { 0x63, 7 }, { 0x64, 7 }, { 0x65, 7 }, { 0x66, 7 },
+    { 0x67, 7 }, { 0x68, 7 }, { 0x69, 7 }, { 0x6a, 7 },
+    { 0x6b, 7 }, { 0x6c, 7 }, { 0x6d, 7 }, { 0x6e, 7 },
+    { 0x6f, 7 }, { 0x70, 7 }, { 0x71, 7 }, { 0x72, 7 },
+    { 0xfc, 8 }, { 0x73, 7 }, { 0xfd, 8 }, { 0x1ffb, 13 },
+    { 0x7fff0, 19 }, { 0x1ffc, 13 }, { 0x3ffc, 14 }, { 0x22, 6 },
+    { 0x7ffd, 15 }, { 0x3, 5 }, { 0x23, 6 }, { 0x4, 5 },
+    { 0x24, 6 }, { 0x5, 5 }, { 0x25, 6 }, { 0x26, 6 },
+    { 0x27, 6 }, { 0x6, 5 }, { 0x74, 7 }, { 0x75, 7 },
+    { 0x28, 6 }, { 0x29, 6 }, { 0x2a, 6 }, { 0x7, 5 },
+    { 0x2b, 6 }, { 0x76, 7 }, { 0x2c, 6 }, { 0x8, 5 },
+    { 0x9, 5 }, { 0x2d, 6 }, { 0x77, 7 }, { 0x78, 7 },
+    { 0x79, 7 }, { 0x7a, 7 }, { 0x7b, 7 }, { 0x7ffe, 15 },
+    { 0x7fc, 11 }, { 0x3ffd, 14 }, { 0x1ffd, 13 }, { 0xffffffc, 28 },
+    { 0xfffe6, 20 }, { 0x3fffd2, 22 }, { 0xfffe7, 20 }, { 0xfffe8, 20 },
+    { 0x3fffd3, 22 }, { 0x3fffd4, 22 }, { 0x3fffd5, 22 }, { 0x7fffd9, 23 },
+    { 0x3fffd6, 22 }, { 0x7fffda, 23 }, { 0x7fffdb, 23 }, { 0x7fffdc, 23 },
+    { 0x7fffdd, 23 }, { 0x7fffde, 23 }, { 0xffffeb, 24 }, { 0x7fffdf, 23 },
+    { 0xffffec, 24 }, { 0xffffed, 24 }, { 0x3fffd7, 22 }, { 0x7fffe0, 23 },
+    { 0xffffee, 24 }, { 0x7fffe1, 23 }, { 0x7fffe2, 23 }, { 0x7fffe3, 23 },
+    { 0x7fffe4, 23 }, { 0x1fffdc, 21 }, { 0x3fffd8, 22 }, { 0x7fffe5, 23 },
+    { 0x3fffd9, 22 }, { 0x7fffe6, 23 }, { 0x7fffe7, 23 }, { 0xffffef, 24 },
+    { 0x3fffda, 22 }, { 0x1fffdd, 21 }, { 0xfffe9, 20 }, { 0x3fffdb, 22 },
+    { 0x3fffdc, 22 }, { 0x7fffe8, 23 }, { 0x7fffe9, 23 }, { 0x1fffde, 21 },
+    { 0x7fffea, 23 }, { 0x3fffdd, 22 }, { 0x3fffde, 22 }, { 0xfffff0, 24 },
+    { 0x1fffdf, 21 }, { 0x3fffdf, 22 }, { 0x7fffeb, 23 }, { 0x7fffec, 23 },
+    { 0x1fffe0, 21 }, { 0x1fffe1, 21 }, { 0x3fffe0, 22 }, { 0x1fffe2, 21 },
+    { 0x7fffed, 23 }, { 0x3fffe1, 22 }, { 0x7fffee, 23 }, { 0x7fffef, 23 },
+    { 0xfffea, 20 }, { 0x3fffe2, 22 }, { 0x3fffe3, 22 }, { 0x3fffe4, 22 },
+    { 0x7ffff0, 23 }, { 0x3fffe5, 22 }, { 0x3fffe6, 22 }, { 0x7ffff1, 23 },
+    { 0x3ffffe0, 26 }, { 0x3ffffe1, 26 }, { 0xfffeb, 20 }, { 0x7fff1, 19 },
+    { 0x3fffe7, 22 }, { 0x7ffff2, 23 }, { 0x3fffe8, 22 }, { 0x1ffffec, 25 },
+    { 0x3ffffe2, 26 }, { 0x3ffffe3, 26 }, { 0x3ffffe4, 26 }, { 0x7ffffde, 27 },
+    { 0x7ffffdf, 27 }, { 0x3ffffe5, 26 }, { 0xfffff1, 24 }, { 0x1ffffed, 25 },
+    { 0x7fff2, 19 }, { 0x1fffe3, 21 }, { 0x3ffffe6, 26 }, { 0x7ffffe0, 27 },
+    { 0x7ffffe1, 27 }, { 0x3ffffe7, 26 }, { 0x7ffffe2, 27 }, { 0xfffff2, 24 },
+    { 0x1fffe4, 21 }, { 0x1fffe5, 21 }, { 0x3ffffe8, 26 }, { 0x3ffffe9, 26 },
+    { 0xffffffd, 28 }, { 0x7ffffe3, 27 }, { 0x7ffffe4, 27 }, { 0x7ffffe5, 27 },
+    { 0xfffec, 20 }, { 0xfffff3, 24 }, { 0xfffed, 20 }, { 0x1fffe6, 21 },
+    { 0x3fffe9, 22 }, { 0x1fffe7, 21 }, { 0x1fffe8, 21 }, { 0x7ffff3, 23 },
+    { 0x3fffea, 22 }, { 0x3fffeb, 22 }, { 0x1ffffee, 25 }, { 0x1ffffef, 25 },
+    { 0xfffff4, 24 }, { 0xfffff5, 24 }, { 0x3ffffea, 26 }, { 0x7ffff4, 23 },
+    { 0x3ffffeb, 26 }, { 0x7ffffe6, 27 }, { 0x3ffffec, 26 }, { 0x3ffffed, 26 },
+    { 0x7ffffe7, 27 }, { 0x7ffffe8, 27 }, { 0x7ffffe9, 27 }, { 0x7ffffea, 27 },
+    { 0x7ffffeb, 27 }, { 0xffffffe, 28 }, { 0x7ffffec, 27 }, { 0x7ffffed, 27 },
+    { 0x7ffffee, 27 }, { 0x7ffffef, 27 }, { 0x7fffff0, 27 }, { 0x3ffffee, 26 },
+    { 0x3fffffff, 30 },
+};
+
+// 解码树: 节点的两个子节点，>0为内部节点下标，<0为叶子(-(符号+1))，0表示不存在
+static int16_t huffman_tree[512][2];
+
+void hpack_init(void) {
+    int nodes = 1;
+    for (int sym = 0; sym < 257; sym++) {
+        int node = 0;
+        for (int bit = huffman_codes[sym].bits - 1; bit > 0; bit--) {
+            int b = (huffman_codes[sym].code >> bit) & 1;
+            if (!huffman_tree[node][b]) huffman_tree[node][b] = (int16_t)nodes++;
+            node = huffman_tree[node][b];
+        }
+        huffman_tree[node][huffman_codes[sym].code & 1] = (int16_t)-(sym + 1);
+    }
+}
+
+static int huffman_decode(const uint8_t *in, size_t len, char *out, size_t *out_len) {
+    int node = 0, depth = 0, ones = 1;
+    size_t n = 0;
+    
+    for (size_t i = 0; i < len; i++) {
+        for (int bit = 7; bit >= 0; bit--) {
+            int b = (in[i] >> bit) & 1;
+            int next = huffman_tree[node][b];
+            if (next == 0) return -1;
+            if (next < 0) {
+                // 解码出EOS是错误
+                if (next == -257) return -1;
+                out[n++] = (char)(-next - 1);
+                node = depth = 0;
+                ones = 1;
+            } else {
+                node = next;
+                depth++;
+                ones &= b;
+            }
+        }
+    }
+    // 结尾的填充必须是EOS的前缀(全1)且不超过7位
+    if (depth > 7 || !ones) return -1;
+    *out_len = n;
+    return 0;
+}
+
+static size_t huffman_length(const char *s, size_t len) {
+    size_t bits = 0;
+    for (size_t i = 0; i < len; i++) bits += huffman_codes[(uint8_t)s[i]].bits;
+    return (bits + 7) / 8;
+}
+
+static void huffman_encode(const char *s, size_t len, uint8_t *out) {
+    uint64_t acc = 0;
+    int nbits = 0;
+    for (size_t i = 0; i < len; i++) {
+        acc = (acc << huffman_codes[(uint8_t)s[i]].bits) | huffman_codes[(uint8_t)s[i]].code;
+        nbits += huffman_codes[(uint8_t)s[i]].bits;
+        while (nbits >= 8) {
+            nbits -= 8;
+            *out++ = (uint8_t)(acc >> nbits);
+        }
+        acc &= (1u << nbits) - 1;
+    }
+    if (nbits > 0) *out = (uint8_t)((acc << (8 - nbits)) | (0xff >> nbits));
+}
+
+// 前缀整数(RFC 7541 5.1)，值超过2^30视为格式错误
+static int decode_int(const uint8_t **p, const uint8_t *end, int prefix, uint32_t *value) {
+    uint32_t max = (1u << prefix) - 1;
+    if (*p >= end) return -1;
+    uint64_t v = *(*p)++ & max;
+    if (v < max) {
+        *value = (uint32_t)v;
+        return 0;
+    }
+    
+    for (int shift = 0; *p < end && shift <= 28; shift += 7) {
+        uint8_t b = *(*p)++;
+        v += (uint64_t)(b & 0x7f) << shift;
+        if (v > (1u << 30)) return -1;
+        if (!(b & 0x80)) {
+            *value = (uint32_t)v;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int encode_int(uint8_t *out, size_t size, uint32_t value, int prefix, uint8_t flags) {
+    uint32_t max = (1u << prefix) - 1;
+    size_t n = 0;
+    if (size == 0) return -1;
+    if (value < max) {
+        out[n++] = flags | (uint8_t)value;
+        return (int)n;
+    }
+    out[n++] = flags | (uint8_t)max;
+    value -= max;
+    while (value >= 0x80) {
+        if (n >= size) return -1;
+        out[n++] = (uint8_t)(value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+    if (n >= size) return -1;
+    out[n++] = (uint8_t)value;
+    return (int)n;
+}
+
+// 字符串解码到out(调用者保证容量为输入长度的2倍，Huffman最短码5位)
+static int decode_string(const uint8_t **p, const uint8_t *end, char *out, size_t *out_len) {
+    if (*p >= end) return -1;
+    int huffman = **p & 0x80;
+    uint32_t len;
+    if (decode_int(p, end, 7, &len) != 0 || len > (size_t)(end - *p)) return -1;
+    
+    if (huffman) {
+        if (huffman_decode(*p, len, out, out_len) != 0) return -1;
+    } else {
+        memcpy(out, *p, len);
+        *out_len = len;
+    }
+    *p += len;
+    return 0;
+}
+
+// 只有Huffman更短时才使用
+static int encode_string(uint8_t *out, size_t size, const char *s, size_t len) {
+    size_t hlen = huffman_length(s, len);
+    int huffman = hlen < len;
+    int n = encode_int(out, size, (uint32_t)(huffman ? hlen : len), 7, huffman ? 0x80 : 0);
+    if (n < 0 || (size_t)n + (huffman ? hlen : len) > size) return -1;
+    
+    if (huffman) huffman_encode(s, len, out + n);
+    else memcpy(out + n, s, len);
+    return n + (int)(huffman ? hlen : len);
+}
+
+static size_t entry_size(const hpack_entry_t *e) {
+    return e->name_len + e->value_len + HPACK_ENTRY_OVERHEAD;
+}
+
+// 淘汰最旧的项直到能再容纳need字节
+static void table_evict(hpack_table_t *table, size_t need) {
+    unsigned int drop = 0;
+    while (drop < table->count && table->size + need > table->max_size) {
+        table->size -= entry_size(&table->entries[drop]);
+        free(table->entries[drop].name);
+        drop++;
+    }
+    if (drop == 0) return;
+    memmove(table->entries, table->entries + drop, (table->count - drop) * sizeof(hpack_entry_t));
+    table->count -= drop;
+}
+
+static int table_add(hpack_table_t *table, const char *name, size_t name_len,
+                     const char *value, size_t value_len) {
+    size_t need = name_len + value_len + HPACK_ENTRY_OVERHEAD;
+    // 比整个表还大的项会清空动态表，本身不加入(RFC 7541 4.4)
+    if (need > table->max_size) {
+        table_evict(table, table->max_size + 1);
+        return 0;
+    }
+    table_evict(table, need);
+    
+    if (table->count == table->capacity) {
+        unsigned int capacity = table->capacity ? table->capacity * 2 : 16;
+        hpack_entry_t *entries = realloc(table->entries, capacity * sizeof(hpack_entry_t));
+        if (!entries) return -1;
+        table->entries = entries;
+        table->capacity = capacity;
+    }
+    
+    char *buf = malloc(name_len + value_len + 2);
+    if (!buf) return -1;
+    hpack_entry_t *e = &table->entries[table->count++];
+    e->name = buf;
+    memcpy(e->name, name, name_len);
+    e->name[name_len] = '\0';
+    e->value = buf + name_len + 1;
+    memcpy(e->value, value, value_len);
+    e->value[value_len] = '\0';
+    e->name_len = name_len;
+    e->value_len = value_len;
+    table->size += need;
+    return 0;
+}
+
+// 索引从1开始: 1..61为静态表，之后是动态表(最新的项在前)
+static int table_get(const hpack_table_t *table, uint32_t index, const char **name, size_t *name_len,
+                     const char **value, size_t *value_len) {
+    if (index == 0) return -1;
+    if (index <= STATIC_COUNT) {
+        *name = static_table[index - 1].name;
+        *name_len = strlen(*name);
+        *value = static_table[index - 1].value;
+        *value_len = strlen(*value);
+        return 0;
+    }
+    index -= STATIC_COUNT;
+    if (index > table->count) return -1;
+    const hpack_entry_t *e = &table->entries[table->count - index];
+    *name = e->name;
+    *name_len = e->name_len;
+    *value = e->value;
+    *value_len = e->value_len;
+    return 0;
+}
+
+void hpack_table_init(hpack_table_t *table, size_t limit) {
+    memset(table, 0, sizeof(*table));
+    table->limit = limit;
+    table->max_size = limit < HPACK_DEFAULT_TABLE_SIZE ? limit : HPACK_DEFAULT_TABLE_SIZE;
+}
+
+void hpack_table_free(hpack_table_t *table) {
+    for (unsigned int i = 0; i < table->count; i++) free(table->entries[i].name);
+    free(table->entries);
+    memset(table, 0, sizeof(*table));
+}
+
+int hpack_decode(hpack_table_t *table, const uint8_t *block, size_t len,
+                 hpack_header_cb cb, void *arg) {
+    const uint8_t *p = block, *end = block + len;
+    // 名字和值都解码到这里，总长度不超过输入的8/5
+    char *scratch = malloc(len * 2 + 2);
+    if (!scratch) return -1;
+    int fields = 0, ret = 0;
+    
+    while (p < end && ret == 0) {
+        uint8_t b = *p;
+        uint32_t index;
+        const char *name, *value;
+        size_t name_len, value_len;
+        
+        if (b & 0x80) {
+            // 索引头部
+            if (decode_int(&p, end, 7, &index) != 0 ||
+                table_get(table, index, &name, &name_len, &value, &value_len) != 0) {
+                ret = -1;
+                break;
+            }
+            fields++;
+            ret = cb(arg, name, name_len, value, value_len);
+            continue;
+        }
+        
+        if ((b & 0xe0) == 0x20) {
+            // 表大小更新只能出现在头部块开头，且不能超过我们通告的上限
+            if (fields > 0 || decode_int(&p, end, 5, &index) != 0 || index > table->limit) {
+                ret = -1;
+                break;
+            }
+            table->max_size = index;
+            table_evict(table, 0);
+            continue;
+        }
+        
+        // 字面量: 01为加入动态表，0000不索引，0001永不索引
+        int incremental = (b & 0x40) != 0;
+        if (decode_int(&p, end, incremental ? 6 : 4, &index) != 0) {
+            ret = -1;
+            break;
+        }
+        // 名字可能引用动态表中即将被淘汰的项，先复制出来
+        char *name_buf = scratch;
+        if (index) {
+            if (table_get(table, index, &name, &name_len, &value, &value_len) != 0) {
+                ret = -1;
+                break;
+            }
+            memcpy(name_buf, name, name_len);
+        } else if (decode_string(&p, end, name_buf, &name_len) != 0) {
+            ret = -1;
+            break;
+        }
+        char *value_buf = name_buf + name_len;
+        if (decode_string(&p, end, value_buf, &value_len) != 0) {
+            ret = -1;
+            break;
+        }
+        
+        fields++;
+        ret = cb(arg, name_buf, name_len, value_buf, value_len);
+        if (ret == 0 && incremental && table_add(table, name_buf, name_len, value_buf, value_len) != 0) {
+            ret = -1;
+        }
+    }
+    
+    free(scratch);
+    return ret;
+}
+
+void hpack_encoder_set_limit(hpack_table_t *table, size_t limit) {
+    table->limit = limit;
+    // 只会缩小；对端放大时仍使用默认大小
+    if (limit < table->max_size) {
+        table->max_size = limit;
+        table_evict(table, 0);
+        table->pending_update = 1;
+    }
+}
+
+int hpack_encode_begin(hpack_table_t *table, uint8_t *out, size_t size) {
+    if (!table->pending_update) return 0;
+    int n = encode_int(out, size, (uint32_t)table->max_size, 5, 0x20);
+    if (n > 0) table->pending_update = 0;
+    return n;
+}
+
+int hpack_encode(hpack_table_t *table, uint8_t *out, size_t size,
+                 const char *name, const char *value, int index) {
+    size_t name_len = strlen(name), value_len = strlen(value);
+    uint32_t name_index = 0;
+    
+    for (uint32_t i = 0; i < STATIC_COUNT; i++) {
+        if (strcmp(static_table[i].name, name) != 0) continue;
+        if (strcmp(static_table[i].value, value) == 0) return encode_int(out, size, i + 1, 7, 0x80);
+        if (!name_index) name_index = i + 1;
+    }
+    for (unsigned int i = 0; i < table->count; i++) {
+        const hpack_entry_t *e = &table->entries[i];
+        if (e->name_len == name_len && e->value_len == value_len &&
+            memcmp(e->name, name, name_len) == 0 && memcmp(e->value, value, value_len) == 0) {
+            return encode_int(out, size, STATIC_COUNT + table->count - i, 7, 0x80);
+        }
+    }
+    
+    int n = encode_int(out, size, name_index, index ? 6 : 4, index ? 0x40 : 0);
+    if (n < 0) return -1;
+    if (!name_index) {
+        int m = encode_string(out + n, size - n, name, name_len);
+        if (m < 0) return -1;
+        n += m;
+    }
+    int m = encode_string(out + n, size - n, value, value_len);
+    if (m < 0) return -1;
+    n += m;
+    
+    if (index && table_add(table, name, name_len, value, value_len) != 0) return -1;
+    return n;
+}
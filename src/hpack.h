@@ -0,0 +1,51 @@
+#ifndef HPACK_H
+#define HPACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// HPACK(RFC 7541)头部压缩: 静态表、动态表、整数和字符串(含Huffman)编解码
+#define HPACK_DEFAULT_TABLE_SIZE 4096
+#define HPACK_ENTRY_OVERHEAD 32
+
+typedef struct {
+    char *name;                // name和value在同一块内存中
+    char *value;
+    size_t name_len;
+    size_t value_len;
+} hpack_entry_t;
+
+// 动态表: entries[0]是最旧的项，新项追加在末尾(表很小，淘汰时直接移动数组)
+typedef struct {
+    hpack_entry_t *entries;
+    unsigned int count;
+    unsigned int capacity;
+    size_t size;               // 按RFC计算的占用(name + value + 32)
+    size_t max_size;           // 当前上限
+    size_t limit;              // 协商的上限(SETTINGS_HEADER_TABLE_SIZE)
+    int pending_update;        // 编码端: 下一个头部块开头要发送表大小更新
+} hpack_table_t;
+
+typedef int (*hpack_header_cb)(void *arg, const char *name, size_t name_len,
+                               const char *value, size_t value_len);
+
+// 构建Huffman解码树，启动时(创建任何会话之前)调用一次
+void hpack_init(void);
+void hpack_table_init(hpack_table_t *table, size_t limit);
+void hpack_table_free(hpack_table_t *table);
+
+// 解码一个完整的头部块，每个头部调用一次cb(cb返回非0时停止)
+// 格式错误返回-1(连接错误COMPRESSION_ERROR)，cb中止时返回cb的返回值
+int hpack_decode(hpack_table_t *table, const uint8_t *block, size_t len,
+                 hpack_header_cb cb, void *arg);
+
+// 编码端: 对端通过SETTINGS调整了表大小上限
+void hpack_encoder_set_limit(hpack_table_t *table, size_t limit);
+// 头部块开头调用，必要时写入表大小更新；返回写入字节数，空间不足返回-1
+int hpack_encode_begin(hpack_table_t *table, uint8_t *out, size_t size);
+// 编码一个头部: index为1时加入动态表(反复出现的值)，0时不索引(每次不同的值)
+// 返回写入字节数，空间不足返回-1
+int hpack_encode(hpack_table_t *table, uint8_t *out, size_t size,
+                 const char *name, const char *value, int index);
+
+#endif
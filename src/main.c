@@ -12,8 +12,32 @@ void print_usage(const char *program_name) {
     printf("Options:\n");
     printf("  -p, --port PORT      Server port (default: %d)\n", 8181);  // 修改为8181
     printf("  -d, --dir DIR        Document root directory (default: %s)\n", DEFAULT_DOCUMENT_ROOT);
-    printf("  -a, --algorithm ALG  Cache algorithm: lru or lfu (default: %s)\n", 
-           DEFAULT_CACHE_ALGORITHM == LRU ? "lru" : "lfu");
+    printf("  -a, --algorithm ALG  Cache algorithm: lru, lfu, gdsf or auto (default: %s)\n", 
+           DEFAULT_CACHE_ALGORITHM == LRU ? "lru" : DEFAULT_CACHE_ALGORITHM == LFU ? "lfu" : "gdsf");
+    printf("  -b, --backend IO     I/O backend: epoll or uring (default: %s)\n",
+           DEFAULT_IO_BACKEND == IO_BACKEND_URING ? "uring" : "epoll");
+    printf("  -s, --snapshot       Pack the document root into an immutable snapshot (SIGHUP reloads, epoll only)\n");
+    printf("  -w, --preload        Warm the cache at startup from the document root\n");
+    printf("  -W, --preload-list FILE  Warm the cache from a hot-list instead (implies -w)\n");
+    printf("      --preload-budget MB  Preload at most MB megabytes (default: %d)\n",
+           (int)(PRELOAD_BUDGET / (1024 * 1024)));
+    printf("  -C, --cache-size SIZE Cache capacity in MB, or in KB with a K suffix (default: %d)\n",
+           MAX_CACHE_SIZE / (1024 * 1024));
+    printf("  -c, --cache-file FILE Restore the cache from FILE at startup and save it on shutdown\n");
+    printf("  -S, --shared-cache NAME Keep the cache in shared memory segment NAME\n");
+    printf("  -P, --prefork N      Run N worker processes sharing one cache\n");
+    printf("  -u, --upgrade-socket PATH Hand the listening socket and cache over to a new server\n");
+    printf("                       started with the same PATH (zero-downtime restart)\n");
+    printf("  -t, --threads N      Request worker threads (default: %d, max: %d)\n",
+           DEFAULT_THREADS, MAX_THREADS);
+    printf("  -A, --admin-socket PATH Accept runtime tuning commands on a local socket\n");
+    printf("  -z, --zerocopy       Send large cached bodies with MSG_ZEROCOPY (epoll backend)\n");
+    printf("  -l, --listen ADDR    Also listen on ADDR: unix:/path, or tcp:PORT to change the TCP port\n");
+    printf("  -r, --proxy PREFIX=UPSTREAM  Forward paths under PREFIX to UPSTREAM (host:port or\n");
+    printf("                       unix:/path); repeatable, cacheable responses are cached\n");
+    printf("  -m, --memory-watch   Shrink the cache under cgroup memory pressure and regrow it later\n");
+    printf("  -q, --backlog N      Listen queue length (default: %d, capped by net.core.somaxconn)\n",
+           BACKLOG_SIZE);
     printf("  -h, --help           Show this help message\n");
 }
 
@@ -21,18 +45,54 @@ int main(int argc, char *argv[]) {
     int port = 8181;  // 修改默认端口为8181
     char *document_root = DEFAULT_DOCUMENT_ROOT;
     cache_algorithm_t algorithm = DEFAULT_CACHE_ALGORITHM;
+    int adaptive_cache = 0;
+    int snapshot = 0;
+    int preload = 0;
+    const char *preload_list = NULL;
+    size_t preload_budget = PRELOAD_BUDGET;
+    size_t cache_size = MAX_CACHE_SIZE;
+    const char *cache_file = NULL;
+    const char *shared_cache = NULL;
+    int prefork = 1;
+    const char *upgrade_socket = NULL;
+    const char *admin_socket = NULL;
+    int threads = DEFAULT_THREADS;
+    int zerocopy = 0;
+    const char *unix_socket = NULL;
+    const char *proxy_routes[MAX_PROXY_ROUTES];
+    int proxy_route_count = 0;
+    int memory_watch = 0;
+    int backlog = BACKLOG_SIZE;
+    io_backend_t backend = DEFAULT_IO_BACKEND;
     
     // 解析命令行参数
     static struct option long_options[] = {
         {"port", required_argument, 0, 'p'},
         {"dir", required_argument, 0, 'd'},
         {"algorithm", required_argument, 0, 'a'},
+        {"backend", required_argument, 0, 'b'},
+        {"snapshot", no_argument, 0, 's'},
+        {"preload", no_argument, 0, 'w'},
+        {"preload-list", required_argument, 0, 'W'},
+        {"preload-budget", required_argument, 0, 'B'},
+        {"cache-size", required_argument, 0, 'C'},
+        {"cache-file", required_argument, 0, 'c'},
+        {"shared-cache", required_argument, 0, 'S'},
+        {"prefork", required_argument, 0, 'P'},
+        {"upgrade-socket", required_argument, 0, 'u'},
+        {"threads", required_argument, 0, 't'},
+        {"admin-socket", required_argument, 0, 'A'},
+        {"zerocopy", no_argument, 0, 'z'},
+        {"listen", required_argument, 0, 'l'},
+        {"proxy", required_argument, 0, 'r'},
+        {"memory-watch", no_argument, 0, 'm'},
+        {"backlog", required_argument, 0, 'q'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
     
     int opt;
-    while ((opt = getopt_long(argc, argv, "p:d:a:h", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "p:d:a:b:swW:C:c:S:P:u:t:A:zl:r:mq:h", long_options, NULL)) != -1) {
         switch (opt) {
             case 'p':
                 port = atoi(optarg);
@@ -49,8 +109,117 @@ int main(int argc, char *argv[]) {
                     algorithm = LRU;
                 } else if (strcasecmp(optarg, "lfu") == 0) {
                     algorithm = LFU;
+                } else if (strcasecmp(optarg, "gdsf") == 0) {
+                    algorithm = GDSF;
+                } else if (strcasecmp(optarg, "auto") == 0) {
+                    adaptive_cache = 1;
                 } else {
-                    fprintf(stderr, "Invalid algorithm: %s (use lru or lfu)\n", optarg);
+                    fprintf(stderr, "Invalid algorithm: %s (use lru, lfu, gdsf or auto)\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'b':
+                if (strcasecmp(optarg, "epoll") == 0) {
+                    backend = IO_BACKEND_EPOLL;
+                } else if (strcasecmp(optarg, "uring") == 0) {
+                    backend = IO_BACKEND_URING;
+                } else {
+                    fprintf(stderr, "Invalid backend: %s (use epoll or uring)\n", optarg);
+                    return 1;
+                }
+                break;
+            case 's':
+                snapshot = 1;
+                break;
+            case 'w':
+                preload = 1;
+                break;
+            case 'W':
+                preload = 1;
+                preload_list = optarg;
+                break;
+            case 'B':
+                if (atoi(optarg) <= 0) {
+                    fprintf(stderr, "Invalid preload budget: %s\n", optarg);
+                    return 1;
+                }
+                preload_budget = (size_t)atoi(optarg) * 1024 * 1024;
+                break;
+            case 'C': {
+                // 默认单位MB；K后缀用于比测试文档集还小的缓存
+                char *end;
+                unsigned long long value = strtoull(optarg, &end, 10);
+                size_t unit = 1024 * 1024;
+                if (*end == 'K' || *end == 'k') {
+                    unit = 1024;
+                    end++;
+                } else if (*end == 'M' || *end == 'm') {
+                    end++;
+                }
+                if (end == optarg || *end != '\0' || value == 0 || value > (1ull << 40) / unit) {
+                    fprintf(stderr, "Invalid cache size: %s\n", optarg);
+                    return 1;
+                }
+                cache_size = (size_t)value * unit;
+                break;
+            }
+            case 'c':
+                cache_file = optarg;
+                break;
+            case 'S':
+                shared_cache = optarg;
+                break;
+            case 'P':
+                prefork = atoi(optarg);
+                if (prefork <= 0 || prefork > 64) {
+                    fprintf(stderr, "Invalid worker process count: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'u':
+                upgrade_socket = optarg;
+                break;
+            case 't':
+                threads = atoi(optarg);
+                if (threads <= 0 || threads > MAX_THREADS) {
+                    fprintf(stderr, "Invalid thread count: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'A':
+                admin_socket = optarg;
+                break;
+            case 'z':
+                zerocopy = 1;
+                break;
+            case 'l':
+                if (strncmp(optarg, "unix:", 5) == 0 && optarg[5] != '\0') {
+                    unix_socket = optarg + 5;
+                } else if (strncmp(optarg, "tcp:", 4) == 0 && atoi(optarg + 4) > 0) {
+                    port = atoi(optarg + 4);
+                } else {
+                    fprintf(stderr, "Invalid listen address: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'r':
+                if (optarg[0] != '/' || !strchr(optarg, '=') || strchr(optarg, '=')[1] == '\0') {
+                    fprintf(stderr, "Invalid proxy route: %s (use PREFIX=UPSTREAM)\n", optarg);
+                    return 1;
+                }
+                if (proxy_route_count == MAX_PROXY_ROUTES) {
+                    fprintf(stderr, "Too many proxy routes (max %d)\n", MAX_PROXY_ROUTES);
+                    return 1;
+                }
+                proxy_routes[proxy_route_count++] = optarg;
+                break;
+            case 'm':
+                memory_watch = 1;
+                break;
+            case 'q':
+                backlog = atoi(optarg);
+                if (backlog <= 0) {
+                    fprintf(stderr, "Invalid backlog: %s\n", optarg);
                     return 1;
                 }
                 break;
@@ -63,6 +232,12 @@ int main(int argc, char *argv[]) {
         }
     }
     
+    // io_uring的缓存快速路径在事件循环内直接发送，不经过快照读者区间
+    if (snapshot && backend == IO_BACKEND_URING) {
+        fprintf(stderr, "--snapshot is only supported with the epoll backend\n");
+        return 1;
+    }
+    
     // 检查文档根目录是否存在
     if (access(document_root, F_OK) != 0) {
         fprintf(stderr, "Document root directory does not exist: %s\n", document_root);
@@ -72,10 +247,34 @@ int main(int argc, char *argv[]) {
     printf("Starting web server...\n");
     printf("Port: %d\n", port);
     printf("Document root: %s\n", document_root);
-    printf("Cache algorithm: %s\n", algorithm == LRU ? "LRU" : "LFU");
-    printf("Cache size: %d MB\n", MAX_CACHE_SIZE / (1024 * 1024));
+    printf("Cache algorithm: %s\n", adaptive_cache ? "auto" : cache_algorithm_name(algorithm));
+    if (cache_size % (1024 * 1024)) printf("Cache size: %zu KB\n", cache_size / 1024);
+    else printf("Cache size: %zu MB\n", cache_size / (1024 * 1024));
     
-    start_server(port, document_root, algorithm);
+    server_options_t options;
+    options.port = port;
+    options.document_root = document_root;
+    options.algorithm = algorithm;
+    options.adaptive_cache = adaptive_cache;
+    options.backend = backend;
+    options.snapshot = snapshot;
+    options.preload = preload;
+    options.preload_list = preload_list;
+    options.preload_budget = preload_budget;
+    options.cache_size = cache_size;
+    options.cache_file = cache_file;
+    options.shared_cache = shared_cache;
+    options.prefork = prefork;
+    options.upgrade_socket = upgrade_socket;
+    options.admin_socket = admin_socket;
+    options.threads = threads;
+    options.zerocopy = zerocopy;
+    options.unix_socket = unix_socket;
+    for (int i = 0; i < proxy_route_count; i++) options.proxy_routes[i] = proxy_routes[i];
+    options.proxy_route_count = proxy_route_count;
+    options.memory_watch = memory_watch;
+    options.backlog = backlog;
+    start_server(&options);
     
     return 0;
 }
\ No newline at end of file
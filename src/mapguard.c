@@ -0,0 +1,47 @@
+#include <setjmp.h>
+#include <signal.h>
+#include <string.h>
+#include "mapguard.h"
+
+// 正在受保护复制的线程: 跳回点和被读取的地址范围
+static __thread sigjmp_buf *guard_jump = NULL;
+static __thread const char *guard_start = NULL;
+static __thread const char *guard_end = NULL;
+
+static struct sigaction previous_action;
+
+static void sigbus_handler(int sig, siginfo_t *info, void *context) {
+    (void)context;
+    const char *addr = info->si_addr;
+    if (guard_jump && addr >= guard_start && addr < guard_end) {
+        siglongjmp(*guard_jump, 1);
+    }
+    
+    // 不是受保护的读取: 恢复原来的处理方式，返回后重新执行出错的指令
+    sigaction(sig, &previous_action, NULL);
+}
+
+int mapguard_init(void) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = sigbus_handler;
+    // SA_NODEFER: 跳出处理函数时SIGBUS没有被屏蔽，sigsetjmp不必保存信号掩码(省去系统调用)
+    action.sa_flags = SA_SIGINFO | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+    return sigaction(SIGBUS, &action, &previous_action);
+}
+
+int mapguard_copy(void *dst, const void *src, size_t len) {
+    sigjmp_buf jump;
+    if (sigsetjmp(jump, 0)) {
+        guard_jump = NULL;
+        return -1;
+    }
+    
+    guard_start = src;
+    guard_end = (const char *)src + len;
+    guard_jump = &jump;
+    memcpy(dst, src, len);
+    guard_jump = NULL;
+    return 0;
+}
@@ -0,0 +1,15 @@
+#ifndef MAPGUARD_H
+#define MAPGUARD_H
+
+#include <stddef.h>
+
+// 文件映射的受保护读取: 映射期间文件被原地截断时，访问越过文件末尾的页会收到SIGBUS
+// 在用户态读取缓存映射的地方(HTTP/2分帧、复制到共享缓存)改用mapguard_copy，
+// 出错时返回-1而不是让整个进程终止；writev/sendmsg等由内核读取时得到EFAULT，无需保护
+
+// 安装SIGBUS处理函数(进程范围)，启动时调用一次
+int mapguard_init(void);
+// 复制len字节，读取src时遇到SIGBUS返回-1(dst中的内容不确定)
+int mapguard_copy(void *dst, const void *src, size_t len);
+
+#endif
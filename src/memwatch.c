@@ -0,0 +1,257 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include "memwatch.h"
+#include "config.h"
+#include "logging.h"
+#include "timer_wheel.h"
+
+static struct {
+    cache_t *cache;
+    char dir[256];             // cgroup目录，空串表示只有系统级PSI
+    char psi_path[300];
+    int psi_fd;                // 已注册的PSI触发器(POLLPRI)，-1表示按avg10轮询
+    int stop_fd;
+    pthread_t thread;
+    int running;
+    size_t last_set;           // 上次由本模块设置的容量，不同则说明被管理接口修改
+    uint64_t last_shrink_ms;
+    pthread_mutex_t lock;      // 保护stats
+    memwatch_stats_t stats;
+} watch = { .psi_fd = -1, .stop_fd = -1, .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static int read_file(const char *path, char *buf, size_t size) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    ssize_t n = read(fd, buf, size - 1);
+    close(fd);
+    if (n < 0) return -1;
+    buf[n] = '\0';
+    return (int)n;
+}
+
+// memory.max/memory.high，"max"表示不限，返回0
+static size_t read_limit(const char *name) {
+    char path[300], buf[64];
+    snprintf(path, sizeof(path), "%s/%s", watch.dir, name);
+    if (read_file(path, buf, sizeof(buf)) <= 0 || strncmp(buf, "max", 3) == 0) return 0;
+    return strtoull(buf, NULL, 10);
+}
+
+// 页缓存可以由内核回收，真正决定OOM的是匿名内存和tmpfs/共享内存
+static size_t read_unreclaimable(void) {
+    char path[300], buf[8192];
+    snprintf(path, sizeof(path), "%s/memory.stat", watch.dir);
+    if (read_file(path, buf, sizeof(buf)) <= 0) return 0;
+    
+    size_t total = 0;
+    for (char *line = buf; line && *line; line = strchr(line, '\n') ? strchr(line, '\n') + 1 : NULL) {
+        if (strncmp(line, "anon ", 5) == 0) total += strtoull(line + 5, NULL, 10);
+        else if (strncmp(line, "shmem ", 6) == 0) total += strtoull(line + 6, NULL, 10);
+    }
+    return total;
+}
+
+static double read_pressure(void) {
+    char buf[256];
+    if (read_file(watch.psi_path, buf, sizeof(buf)) <= 0) return 0;
+    const char *avg = strstr(buf, "some avg10=");
+    return avg ? strtod(avg + 11, NULL) : 0;
+}
+
+// 从/proc/self/cgroup找到cgroup v2("0::路径")的目录
+static int find_cgroup(void) {
+    char buf[1024];
+    if (read_file("/proc/self/cgroup", buf, sizeof(buf)) <= 0) return -1;
+    
+    char *line = strstr(buf, "0::");
+    if (!line || (line != buf && line[-1] != '\n')) return -1;
+    char *end = strchr(line, '\n');
+    if (end) *end = '\0';
+    snprintf(watch.dir, sizeof(watch.dir), "/sys/fs/cgroup%s", strcmp(line + 3, "/") == 0 ? "" : line + 3);
+    
+    char path[300];
+    snprintf(path, sizeof(path), "%s/memory.current", watch.dir);
+    if (access(path, R_OK) != 0) {
+        watch.dir[0] = '\0';
+        return -1;
+    }
+    return 0;
+}
+
+// 注册PSI触发器，停顿超过阈值时poll返回POLLPRI；不支持时退回轮询avg10
+static int open_trigger(void) {
+    int fd = open(watch.psi_path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) return -1;
+    
+    char trigger[64];
+    int len = snprintf(trigger, sizeof(trigger), "some %d %d",
+                       MEMWATCH_PSI_STALL_US, MEMWATCH_PSI_WINDOW_US);
+    if (write(fd, trigger, len + 1) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void evaluate(int stalled) {
+    cache_t *cache = watch.cache;
+    size_t limit = 0, used = 0;
+    if (watch.dir[0]) {
+        size_t max = read_limit("memory.max");
+        size_t high = read_limit("memory.high");
+        limit = max && (!high || max < high) ? max : high;
+        used = read_unreclaimable();
+    }
+    double pressure = read_pressure();
+    uint64_t now = timer_now_ms();
+    int settled = now - watch.last_shrink_ms >= MEMWATCH_HOLD_MS;
+    
+    // avg10在停顿结束后要约10秒才回落，缩小后的保持期内不再据此重复缩小
+    if (watch.psi_fd < 0 && pressure >= MEMWATCH_PSI_AVG10 && settled) stalled = 1;
+    
+    size_t budget = cache_get_max_size(cache);
+    pthread_mutex_lock(&watch.lock);
+    if (budget != watch.last_set) watch.stats.ceiling = budget;
+    size_t ceiling = watch.stats.ceiling;
+    pthread_mutex_unlock(&watch.lock);
+    
+    int over = limit > 0 && used > limit / 100 * MEMWATCH_HIGH_PERCENT;
+    int shrunk = 0, grown = 0;
+    size_t target = budget;
+    
+    if (over || stalled) {
+        // 至少缩小一个固定比例；超出上限时一次降到低水位以下
+        size_t cut = budget / 100 * MEMWATCH_SHRINK_PERCENT;
+        size_t low = limit / 100 * MEMWATCH_LOW_PERCENT;
+        if (over && used - low > cut) cut = used - low;
+        target = budget > cut + MEMWATCH_MIN_CACHE ? budget - cut : MEMWATCH_MIN_CACHE;
+        if (target < budget && cache_set_max_size(cache, target) == 0) {
+            // 释放的堆内存交还内核，否则cgroup中的占用不会下降
+            malloc_trim(0);
+            shrunk = 1;
+            log_message(LOG_WARN, "内存压力: 不可回收 %zu MB / 上限 %zu MB, avg10 %.2f, 缓存容量 %zu -> %zu MB",
+                        used >> 20, limit >> 20, pressure, budget >> 20, target >> 20);
+            printf("内存压力: 缓存容量 %zu -> %zu MB\n", budget >> 20, target >> 20);
+        } else {
+            target = budget;
+        }
+        watch.last_shrink_ms = now;
+    } else if (budget < ceiling && settled && pressure < MEMWATCH_PSI_AVG10 / 2 &&
+               (limit == 0 || used < limit / 100 * MEMWATCH_LOW_PERCENT)) {
+        target = budget + ceiling / 100 * MEMWATCH_GROW_PERCENT;
+        if (target > ceiling) target = ceiling;
+        if (cache_set_max_size(cache, target) == 0) {
+            grown = 1;
+            log_message(LOG_INFO, "内存压力缓解，缓存容量 %zu -> %zu MB", budget >> 20, target >> 20);
+        } else {
+            target = budget;
+        }
+    }
+    watch.last_set = target;
+    
+    pthread_mutex_lock(&watch.lock);
+    watch.stats.limit = limit;
+    watch.stats.unreclaimable = used;
+    watch.stats.pressure = pressure;
+    watch.stats.budget = target;
+    watch.stats.shrinks += shrunk;
+    watch.stats.grows += grown;
+    pthread_mutex_unlock(&watch.lock);
+}
+
+static void *watch_thread(void *arg) {
+    (void)arg;
+    
+    for (;;) {
+        struct pollfd fds[2] = {
+            { .fd = watch.stop_fd, .events = POLLIN },
+            { .fd = watch.psi_fd, .events = POLLPRI },
+        };
+        int n = poll(fds, watch.psi_fd >= 0 ? 2 : 1, MEMWATCH_INTERVAL_MS);
+        if (n < 0 && errno != EINTR) break;
+        if (fds[0].revents) break;
+        
+        int stalled = 0;
+        if (watch.psi_fd >= 0 && fds[1].revents) {
+            if (fds[1].revents & POLLERR) {
+                // cgroup已被删除，退回轮询
+                close(watch.psi_fd);
+                watch.psi_fd = -1;
+            } else {
+                stalled = (fds[1].revents & POLLPRI) != 0;
+            }
+        }
+        evaluate(stalled);
+    }
+    return NULL;
+}
+
+int memwatch_start(cache_t *cache) {
+    if (!cache || watch.running) return -1;
+    
+    // cgroup自身的PSI优先，没有时使用系统级PSI
+    int has_cgroup = find_cgroup() == 0;
+    if (has_cgroup) snprintf(watch.psi_path, sizeof(watch.psi_path), "%s/memory.pressure", watch.dir);
+    if (!has_cgroup || access(watch.psi_path, R_OK) != 0) {
+        snprintf(watch.psi_path, sizeof(watch.psi_path), "/proc/pressure/memory");
+        if (access(watch.psi_path, R_OK) != 0) {
+            watch.psi_path[0] = '\0';
+            if (!has_cgroup) return -1;
+        }
+    }
+    
+    watch.stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (watch.stop_fd < 0) return -1;
+    watch.psi_fd = watch.psi_path[0] ? open_trigger() : -1;
+    watch.cache = cache;
+    watch.last_set = cache_get_max_size(cache);
+    watch.last_shrink_ms = 0;
+    memset(&watch.stats, 0, sizeof(watch.stats));
+    watch.stats.ceiling = watch.stats.budget = watch.last_set;
+    
+    if (pthread_create(&watch.thread, NULL, watch_thread, NULL) != 0) {
+        if (watch.psi_fd >= 0) close(watch.psi_fd);
+        close(watch.stop_fd);
+        watch.psi_fd = watch.stop_fd = -1;
+        return -1;
+    }
+    watch.running = 1;
+    
+    char limit[32] = "无";
+    if (has_cgroup && read_limit("memory.max") > 0) {
+        snprintf(limit, sizeof(limit), "%zu MB", read_limit("memory.max") >> 20);
+    }
+    printf("内存压力监控: cgroup %s, 上限 %s, PSI %s\n", has_cgroup ? watch.dir : "无", limit,
+           watch.psi_fd >= 0 ? "触发器" : watch.psi_path[0] ? "轮询avg10" : "不可用");
+    return 0;
+}
+
+void memwatch_stop(void) {
+    if (!watch.running) return;
+    
+    uint64_t one = 1;
+    if (write(watch.stop_fd, &one, sizeof(one)) < 0) {
+        log_message(LOG_WARN, "无法唤醒内存压力监控线程");
+    }
+    pthread_join(watch.thread, NULL);
+    if (watch.psi_fd >= 0) close(watch.psi_fd);
+    close(watch.stop_fd);
+    watch.psi_fd = watch.stop_fd = -1;
+    watch.running = 0;
+}
+
+int memwatch_get_stats(memwatch_stats_t *stats) {
+    if (!watch.running) return -1;
+    pthread_mutex_lock(&watch.lock);
+    *stats = watch.stats;
+    pthread_mutex_unlock(&watch.lock);
+    return 0;
+}
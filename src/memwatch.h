@@ -0,0 +1,25 @@
+#ifndef MEMWATCH_H
+#define MEMWATCH_H
+
+#include <stddef.h>
+#include "cache.h"
+
+// 内存压力监控: 跟踪所在cgroup v2的内存上限、不可回收内存(anon+shmem)和PSI停顿
+// 有压力时主动缩小缓存容量，压力消失后逐步恢复；运行中由管理接口设定的容量作为新的恢复上限
+typedef struct {
+    size_t limit;              // min(memory.high, memory.max)，0表示没有上限
+    size_t unreclaimable;      // 最近一次读取的anon+shmem
+    double pressure;           // some avg10(百分比)
+    size_t budget;             // 当前缓存容量
+    size_t ceiling;            // 设定的缓存容量
+    unsigned long shrinks;
+    unsigned long grows;
+} memwatch_stats_t;
+
+// 既没有cgroup v2内存控制器也没有PSI时返回-1
+int memwatch_start(cache_t *cache);
+void memwatch_stop(void);
+// 未运行时返回-1
+int memwatch_get_stats(memwatch_stats_t *stats);
+
+#endif
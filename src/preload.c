@@ -0,0 +1,216 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include "preload.h"
+#include "webserver.h"
+#include "logging.h"
+#include "urlpath.h"
+#include "dirwalk.h"
+
+typedef struct {
+    char *path;
+    size_t size;
+} preload_file_t;
+
+// 所有预热任务共享的状态，最后一个结束的任务负责释放
+typedef struct {
+    cache_t *cache;
+    preload_file_t *files;
+    size_t count;
+    size_t capacity;
+    size_t next;               // 下一个待加载文件(原子递增)
+    size_t budget;
+    size_t root_len;           // 文件路径去掉该长度的前缀即为缓存key
+    size_t loaded_bytes;       // 已加载字节数(原子累加)
+    unsigned int loaded_files;
+    unsigned int skipped_files;  // 共享缓存模式下跳过的大文件
+    unsigned int workers;      // 尚未结束的任务数
+    struct timeval start;
+} preload_job_t;
+
+static int add_file(preload_job_t *job, const char *path, size_t size) {
+    if (job->count == job->capacity) {
+        size_t capacity = job->capacity ? job->capacity * 2 : 64;
+        preload_file_t *files = realloc(job->files, capacity * sizeof(preload_file_t));
+        if (!files) return -1;
+        job->files = files;
+        job->capacity = capacity;
+    }
+    
+    job->files[job->count].path = strdup(path);
+    if (!job->files[job->count].path) return -1;
+    job->files[job->count].size = size;
+    job->count++;
+    return 0;
+}
+
+static void collect_file(const char *path, size_t size, void *arg) {
+    add_file(arg, path, size);
+}
+
+// 读取热点列表，路径与请求一样规范化(..不能越过根目录)
+static int read_hot_list(preload_job_t *job, const char *document_root, const char *hot_list) {
+    FILE *fp = fopen(hot_list, "r");
+    if (!fp) return -1;
+    
+    char line[512];
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        
+        char key[MAX_PATH_LENGTH];
+        if (line[0] != '/' || urlpath_normalize(line, key, sizeof(key)) != 0) continue;
+        
+        char path[512];
+        if (snprintf(path, sizeof(path), "%s%s", document_root, key) >= (int)sizeof(path)) {
+            continue;
+        }
+        
+        struct stat st;
+        if (stat(path, &st) < 0 || !S_ISREG(st.st_mode)) continue;
+        if (st.st_size <= 0 || st.st_size >= MAX_CACHE_ITEM_SIZE) continue;
+        add_file(job, path, st.st_size);
+    }
+    fclose(fp);
+    return 0;
+}
+
+static int compare_size(const void *a, const void *b) {
+    const preload_file_t *fa = a;
+    const preload_file_t *fb = b;
+    return fa->size < fb->size ? -1 : fa->size > fb->size ? 1 : 0;
+}
+
+// 与未命中路径相同的方式把文件放入缓存: 大文件映射，小文件读入堆，key为相对文档根目录的路径
+// 返回0表示已缓存，1表示按模式跳过，-1表示失败
+static int load_file(cache_t *cache, const char *path, const char *key) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size <= 0) {
+        close(fd);
+        return -1;
+    }
+    
+    char etag[64];
+    build_etag(&st, etag, sizeof(etag));
+    size_t size = st.st_size;
+    int ret = -1;
+    
+    // 共享缓存模式不支持接管映射，大文件留给未命中路径按需加载
+    if (size >= MMAP_THRESHOLD && cache->shared) {
+        close(fd);
+        return 1;
+    }
+    
+    if (size >= MMAP_THRESHOLD) {
+        void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map != MAP_FAILED) {
+            madvise(map, size, MADV_WILLNEED);
+            ret = cache_put_mapped(cache, key, map, size, st.st_mtime, etag);
+            if (ret != 0) munmap(map, size);
+        }
+    } else {
+        void *data = malloc(size);
+        size_t done = 0;
+        while (data && done < size) {
+            ssize_t n = pread(fd, (char *)data + done, size - done, done);
+            if (n <= 0) break;
+            done += n;
+        }
+        if (data && done == size) ret = cache_put(cache, key, data, size, st.st_mtime, etag);
+        free(data);
+    }
+    
+    close(fd);
+    return ret;
+}
+
+static void preload_worker(void *arg) {
+    preload_job_t *job = arg;
+    
+    for (;;) {
+        size_t index = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+        if (index >= job->count) break;
+        
+        preload_file_t *file = &job->files[index];
+        size_t used = __atomic_add_fetch(&job->loaded_bytes, file->size, __ATOMIC_RELAXED);
+        if (used > job->budget) {
+            // 超出预算的文件跳过，热点列表中后面更小的文件仍可能装得下
+            __atomic_sub_fetch(&job->loaded_bytes, file->size, __ATOMIC_RELAXED);
+            continue;
+        }
+        
+        int ret = load_file(job->cache, file->path, file->path + job->root_len);
+        if (ret == 0) {
+            __atomic_add_fetch(&job->loaded_files, 1, __ATOMIC_RELAXED);
+        } else {
+            if (ret == 1) __atomic_add_fetch(&job->skipped_files, 1, __ATOMIC_RELAXED);
+            __atomic_sub_fetch(&job->loaded_bytes, file->size, __ATOMIC_RELAXED);
+        }
+    }
+    
+    if (__atomic_sub_fetch(&job->workers, 1, __ATOMIC_ACQ_REL) > 0) return;
+    
+    // 最后一个任务: 汇报并释放
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    double elapsed = (now.tv_sec - job->start.tv_sec) + (now.tv_usec - job->start.tv_usec) / 1000000.0;
+    printf("缓存预热完成: %u个文件, %zuKB, 用时%.2f秒\n",
+           job->loaded_files, job->loaded_bytes / 1024, elapsed);
+    log_message(LOG_INFO, "缓存预热完成: %u个文件, %zu字节", job->loaded_files, job->loaded_bytes);
+    if (job->skipped_files > 0) {
+        printf("缓存预热跳过%u个大文件(共享缓存模式不支持)\n", job->skipped_files);
+    }
+    
+    for (size_t i = 0; i < job->count; i++) free(job->files[i].path);
+    free(job->files);
+    free(job);
+}
+
+int cache_preload(cache_t *cache, threadpool_t *pool, const char *document_root,
+                  const char *hot_list, size_t budget) {
+    preload_job_t *job = calloc(1, sizeof(preload_job_t));
+    if (!job) return -1;
+    
+    job->cache = cache;
+    job->budget = budget;
+    job->root_len = strlen(document_root);
+    gettimeofday(&job->start, NULL);
+    
+    if (hot_list) {
+        if (read_hot_list(job, document_root, hot_list) != 0) {
+            fprintf(stderr, "Cannot read preload list: %s\n", hot_list);
+            free(job);
+            return -1;
+        }
+    } else {
+        // 没有访问统计时优先加载小文件，同样的预算能覆盖更多对象
+        dirwalk(document_root, collect_file, job);
+        qsort(job->files, job->count, sizeof(preload_file_t), compare_size);
+    }
+    
+    // 每个任务循环领取文件，只占用部分线程，其余线程照常处理请求
+    unsigned int workers = pool->thread_count / 2 > 0 ? pool->thread_count / 2 : 1;
+    job->workers = workers;
+    printf("开始缓存预热: %zu个候选文件, 预算%zuMB, %u个线程\n",
+           job->count, budget / (1024 * 1024), workers);
+    
+    for (unsigned int i = 0; i < workers; i++) {
+        if (threadpool_add_task(pool, preload_worker, job) != 0) {
+            // 提交失败的份额视为已结束
+            if (__atomic_sub_fetch(&job->workers, workers - i, __ATOMIC_ACQ_REL) == 0) {
+                for (size_t j = 0; j < job->count; j++) free(job->files[j].path);
+                free(job->files);
+                free(job);
+            }
+            return i > 0 ? 0 : -1;
+        }
+    }
+    return 0;
+}
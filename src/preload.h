@@ -0,0 +1,14 @@
+#ifndef PRELOAD_H
+#define PRELOAD_H
+
+#include <stddef.h>
+#include "cache.h"
+#include "threadpool.h"
+
+// 启动时预热缓存: hot_list为NULL时遍历document_root(小文件优先)，
+// 否则按热点列表的顺序加载(每行一个请求路径，如/index.html，#开头为注释)
+// 加载在线程池中并行进行，不阻塞调用者；总量不超过budget字节
+int cache_preload(cache_t *cache, threadpool_t *pool, const char *document_root,
+                  const char *hot_list, size_t budget);
+
+#endif
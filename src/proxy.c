@@ -0,0 +1,1087 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "proxy.h"
+#include "config.h"
+#include "logging.h"
+#include "timer_wheel.h"
+
+#define PROXY_MAX_EVENTS 64
+#define PROXY_READ_CHUNK 16384
+
+// 响应体的结束方式
+typedef enum {
+    BODY_NONE,                 // 没有响应体
+    BODY_LENGTH,               // Content-Length
+    BODY_CHUNKED,              // 分块编码，接收时就地解码
+    BODY_CLOSE                 // 读到连接关闭为止，连接不可复用
+} body_framing_t;
+
+// 一条上游连接，同一时刻最多承载一个请求
+typedef struct upstream_conn {
+    int fd;
+    upstream_t *upstream;
+    proxy_request_t *req;      // 正在转发的请求，NULL表示空闲
+    int connecting;            // 非阻塞connect尚未完成
+    int reused;                // 取自空闲连接池
+    int pooled;                // 在空闲连接栈中
+    int keep_alive;            // 上游允许在响应后复用
+    uint64_t idle_since;
+    size_t sent;               // 请求已发送的字节数
+    char *buf;                 // 接收缓冲区: 响应头 + 已解码的响应体 + 未处理的原始数据
+    size_t len;
+    size_t cap;
+    size_t header_end;         // 响应头长度(含结尾空行)，0表示尚未收完
+    int status;
+    body_framing_t framing;
+    size_t content_length;
+    size_t body_len;           // 已得到的响应体长度
+    size_t chunk_pos;          // 下一段未解码原始数据的位置
+    size_t chunk_left;         // 当前分块剩余的数据字节
+    int chunk_crlf;            // 分块数据之后还需跳过CRLF
+    int chunk_trailer;         // 已读到最后一个分块，正在跳过trailer
+    struct upstream_conn *prev;
+    struct upstream_conn *next;
+} upstream_conn_t;
+
+struct upstream {
+    char name[128];            // 配置中的地址，用作缓存key和缺省Host
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    upstream_conn_t *idle[PROXY_POOL_SIZE]; // 空闲连接栈，栈顶是最近放回的(最可能仍然有效)
+    int idle_count;
+};
+
+typedef struct {
+    char prefix[128];
+    size_t prefix_len;
+    upstream_t *upstream;
+} proxy_route_t;
+
+struct proxy {
+    int epoll_fd;              // 上游连接、唤醒和超时都注册在这里，它本身挂在事件循环上
+    int wake_fd;               // eventfd: 工作线程提交了请求
+    int timer_fd;              // timerfd: 有上游连接或正在读取请求体时周期检查超时
+    int body_fd;               // epoll: 正在读取请求体的客户端连接(事件指针为请求)
+    int timer_armed;
+    threadpool_t *pool;        // complete回调在这里执行
+    proxy_route_t routes[MAX_PROXY_ROUTES];
+    int route_count;
+    upstream_t *upstreams[MAX_PROXY_ROUTES];
+    int upstream_count;
+    upstream_conn_t *conns;    // 全部上游连接，超时检查时遍历
+    int conn_count;
+    pthread_mutex_t lock;      // 保护提交队列
+    proxy_request_t *queue_head;
+    proxy_request_t *queue_tail;
+    proxy_request_t *reading;  // 正在读取请求体的请求(用next串起来)
+    proxy_stats_t stats;
+};
+
+// 逐跳头部只对单条连接有意义，不转发也不缓存
+static const char *const hop_headers[] = {
+    "Connection", "Keep-Alive", "Proxy-Connection", "Transfer-Encoding",
+    "TE", "Trailer", "Upgrade", NULL
+};
+
+static const char *line_end(const char *line, const char *end) {
+    const char *eol = memmem(line, end - line, "\r\n", 2);
+    return eol ? eol : end;
+}
+
+static int header_is(const char *line, size_t len, const char *name) {
+    size_t name_len = strlen(name);
+    return len > name_len && line[name_len] == ':' && strncasecmp(line, name, name_len) == 0;
+}
+
+// Connection头部列出的字段名(可能有多个Connection头部，每个是逗号分隔的列表)
+static int connection_lists(const char *headers, const char *end, const char *name,
+                            size_t name_len) {
+    for (const char *line = line_end(headers, end) + 2; line < end; line = line_end(line, end) + 2) {
+        const char *eol = line_end(line, end);
+        if (eol == line) break;
+        if (!header_is(line, eol - line, "Connection")) continue;
+        
+        const char *p = line + 11;
+        while (p < eol) {
+            while (p < eol && (*p == ' ' || *p == '\t' || *p == ',')) p++;
+            const char *token = p;
+            while (p < eol && *p != ',' && *p != ' ' && *p != '\t') p++;
+            if ((size_t)(p - token) == name_len && strncasecmp(token, name, name_len) == 0) return 1;
+        }
+    }
+    return 0;
+}
+
+// 固定的逐跳头部，以及Connection中列出的头部(RFC 9110 7.6.1)
+static int is_hop_header(const char *headers, const char *end, const char *line, size_t len) {
+    for (int i = 0; hop_headers[i]; i++) {
+        if (header_is(line, len, hop_headers[i])) return 1;
+    }
+    const char *colon = memchr(line, ':', len);
+    return colon && connection_lists(headers, end, line, colon - line);
+}
+
+// 在头部块(首行为请求行或状态行)中查找头部，值去掉首尾空白后复制到out
+static int find_header(const char *headers, size_t len, const char *name, char *out, size_t out_len) {
+    const char *end = headers + len;
+    size_t name_len = strlen(name);
+    
+    for (const char *line = line_end(headers, end) + 2; line < end; line = line_end(line, end) + 2) {
+        const char *eol = line_end(line, end);
+        if (eol == line) break;
+        if (!header_is(line, eol - line, name)) continue;
+        
+        const char *value = line + name_len + 1;
+        while (value < eol && (*value == ' ' || *value == '\t')) value++;
+        const char *value_end = eol;
+        while (value_end > value && (value_end[-1] == ' ' || value_end[-1] == '\t')) value_end--;
+        
+        size_t n = value_end - value;
+        if (n >= out_len) n = out_len - 1;
+        memcpy(out, value, n);
+        out[n] = '\0';
+        return 1;
+    }
+    return 0;
+}
+
+// 头部块中名为name的字段出现的次数
+static int count_headers(const char *headers, size_t len, const char *name) {
+    const char *end = headers + len;
+    int count = 0;
+    for (const char *line = line_end(headers, end) + 2; line < end; line = line_end(line, end) + 2) {
+        const char *eol = line_end(line, end);
+        if (eol == line) break;
+        if (header_is(line, eol - line, name)) count++;
+    }
+    return count;
+}
+
+int proxy_parse_content_length(const char *value, size_t *length) {
+    size_t n = 0;
+    if (*value == '\0') return -1;
+    // strtoul会接受空白、符号和尾随的垃圾
+    for (const char *p = value; *p; p++) {
+        if (*p < '0' || *p > '9') return -1;
+        n = n > (SIZE_MAX - 9) / 10 ? SIZE_MAX : n * 10 + (*p - '0');
+    }
+    *length = n;
+    return 0;
+}
+
+int proxy_check_framing(const char *header, size_t header_len) {
+    const char *end = header + header_len;
+    for (const char *line = line_end(header, end) + 2; line < end; line = line_end(line, end) + 2) {
+        const char *eol = line_end(line, end);
+        if (eol == line) break;
+        // 续行(obs-fold)和字段名与冒号之间的空白都不允许(RFC 9112 5.1/5.2)，
+        // 上游可能把这样的行当作另一个字段
+        const char *colon = memchr(line, ':', eol - line);
+        if (!colon || colon == line || line[0] == ' ' || line[0] == '\t' ||
+            colon[-1] == ' ' || colon[-1] == '\t') {
+            return -1;
+        }
+    }
+    
+    int lengths = count_headers(header, header_len, "Content-Length");
+    if (lengths > 1) return -1;
+    if (lengths == 1 && count_headers(header, header_len, "Transfer-Encoding") > 0) return -1;
+    return 0;
+}
+
+// 共享缓存中的新鲜期(秒): s-maxage优先于max-age
+// no-store/private/no-cache、没有显式期限、带Set-Cookie或Vary时不缓存
+static long freshness_lifetime(const char *headers, size_t len) {
+    char value[256], ignored[8];
+    if (find_header(headers, len, "Set-Cookie", ignored, sizeof(ignored)) ||
+        find_header(headers, len, "Vary", ignored, sizeof(ignored)) ||
+        !find_header(headers, len, "Cache-Control", value, sizeof(value))) {
+        return 0;
+    }
+    
+    long max_age = -1, s_maxage = -1;
+    char *save;
+    for (char *token = strtok_r(value, ",", &save); token; token = strtok_r(NULL, ",", &save)) {
+        while (*token == ' ' || *token == '\t') token++;
+        if (strncasecmp(token, "no-store", 8) == 0 || strncasecmp(token, "private", 7) == 0 ||
+            strncasecmp(token, "no-cache", 8) == 0) {
+            return 0;
+        }
+        if (strncasecmp(token, "s-maxage=", 9) == 0) s_maxage = atol(token + 9);
+        else if (strncasecmp(token, "max-age=", 8) == 0) max_age = atol(token + 8);
+    }
+    
+    long lifetime = s_maxage >= 0 ? s_maxage : max_age;
+    return lifetime > 0 ? lifetime : 0;
+}
+
+// 带显式新鲜期时允许缓存的状态码
+static int cacheable_status(int status) {
+    return status == 200 || status == 203 || status == 301 || status == 404 || status == 410;
+}
+
+int proxy_build_request(proxy_request_t *req, const char *header, size_t header_len,
+                        const char *target, const char *body, size_t body_have, size_t body_len) {
+    const char *end = header + header_len;
+    const char *eol = line_end(header, end);
+    const char *method_end = memchr(header, ' ', eol - header);
+    if (!method_end) return -1;
+    
+    size_t target_len = strlen(target);
+    size_t capacity = header_len + target_len + body_len + strlen(req->upstream->name) + 64;
+    char *out = malloc(capacity);
+    if (!out) return -1;
+    
+    // 请求行统一为HTTP/1.1，上游才会保持连接
+    size_t n = method_end + 1 - header;
+    memcpy(out, header, n);
+    memcpy(out + n, target, target_len);
+    n += target_len;
+    memcpy(out + n, " HTTP/1.1\r\n", 11);
+    n += 11;
+    
+    int has_host = 0;
+    for (const char *line = eol + 2; line < end; line = line_end(line, end) + 2) {
+        const char *line_stop = line_end(line, end);
+        size_t len = line_stop - line;
+        if (len == 0) break;
+        // 请求体已完整读取，上游无需再发100 Continue
+        if (is_hop_header(header, end, line, len) || header_is(line, len, "Expect")) continue;
+        if (header_is(line, len, "Host")) has_host = 1;
+        memcpy(out + n, line, len);
+        memcpy(out + n + len, "\r\n", 2);
+        n += len + 2;
+    }
+    
+    if (!has_host) {
+        const char *host = req->upstream->addr.ss_family == AF_UNIX ? "localhost" : req->upstream->name;
+        n += snprintf(out + n, capacity - n, "Host: %s\r\n", host);
+    }
+    n += snprintf(out + n, capacity - n, "Connection: keep-alive\r\n\r\n");
+    if (body_have > 0) memcpy(out + n, body, body_have);
+    
+    req->request = out;
+    req->request_len = n + body_len;
+    req->body_missing = body_len - body_have;
+    return 0;
+}
+
+// 就地解码已收到的分块: 数据移到已解码响应体之后，返回1表示消息结束，0需要更多数据，-1格式错误
+static int decode_chunks(upstream_conn_t *conn) {
+    char *buf = conn->buf;
+    int done = 0;
+    
+    while (!done && conn->chunk_pos < conn->len) {
+        char *p = buf + conn->chunk_pos;
+        size_t avail = conn->len - conn->chunk_pos;
+        
+        if (conn->chunk_left > 0) {
+            size_t n = avail < conn->chunk_left ? avail : conn->chunk_left;
+            memmove(buf + conn->header_end + conn->body_len, p, n);
+            conn->body_len += n;
+            conn->chunk_pos += n;
+            conn->chunk_left -= n;
+            continue;
+        }
+        if (conn->chunk_crlf) {
+            if (avail < 2) break;
+            if (p[0] != '\r' || p[1] != '\n') return -1;
+            conn->chunk_pos += 2;
+            conn->chunk_crlf = 0;
+            continue;
+        }
+        
+        char *eol = memmem(p, avail, "\r\n", 2);
+        if (!eol) {
+            if (avail > 256) return -1;
+            break;
+        }
+        conn->chunk_pos += eol - p + 2;
+        
+        // 最后一个分块之后跳过trailer，直到空行
+        if (conn->chunk_trailer) {
+            if (eol == p) done = 1;
+            continue;
+        }
+        
+        char *size_end;
+        unsigned long size = strtoul(p, &size_end, 16);
+        if (size_end == p) return -1;
+        if (size == 0) {
+            conn->chunk_trailer = 1;
+        } else if (conn->body_len + size > PROXY_MAX_RESPONSE) {
+            return -1;
+        } else {
+            conn->chunk_left = size;
+            conn->chunk_crlf = 1;
+        }
+    }
+    
+    // 消息之后还有数据说明上游在流水线上多发了内容，不再复用
+    if (done && conn->chunk_pos < conn->len) conn->keep_alive = 0;
+    
+    // 丢弃已解码的原始数据，缓冲区只保留未处理部分
+    size_t decoded_end = conn->header_end + conn->body_len;
+    if (conn->chunk_pos > decoded_end) {
+        memmove(buf + decoded_end, buf + conn->chunk_pos, conn->len - conn->chunk_pos);
+        conn->len -= conn->chunk_pos - decoded_end;
+        conn->chunk_pos = decoded_end;
+    }
+    return done;
+}
+
+// 解析已收到的响应，返回1表示响应完整，0需要更多数据，-1格式错误
+static int parse_response(upstream_conn_t *conn, const proxy_request_t *req) {
+    while (!conn->header_end) {
+        char *end = memmem(conn->buf, conn->len, "\r\n\r\n", 4);
+        if (!end) return conn->len > PROXY_MAX_HEADER ? -1 : 0;
+        size_t header_end = end - conn->buf + 4;
+        
+        int minor, status;
+        if (sscanf(conn->buf, "HTTP/1.%d %d", &minor, &status) != 2 || status < 100) return -1;
+        
+        // 跳过100 Continue等中间响应
+        if (status < 200) {
+            if (status == 101) return -1;
+            memmove(conn->buf, conn->buf + header_end, conn->len - header_end);
+            conn->len -= header_end;
+            continue;
+        }
+        
+        char value[64];
+        conn->header_end = header_end;
+        conn->status = status;
+        conn->keep_alive = minor >= 1;
+        if (find_header(conn->buf, header_end, "Connection", value, sizeof(value))) {
+            if (strcasestr(value, "close")) conn->keep_alive = 0;
+            else if (strcasestr(value, "keep-alive")) conn->keep_alive = 1;
+        }
+        
+        if (req->head || status == 204 || status == 304) {
+            conn->framing = BODY_NONE;
+        } else if (find_header(conn->buf, header_end, "Transfer-Encoding", value, sizeof(value)) &&
+                   strcasestr(value, "chunked")) {
+            conn->framing = BODY_CHUNKED;
+        } else if (find_header(conn->buf, header_end, "Content-Length", value, sizeof(value))) {
+            // 重复或格式错误的Content-Length无法确定响应边界，按上游错误返回502
+            size_t length;
+            if (count_headers(conn->buf, header_end, "Content-Length") > 1 ||
+                proxy_parse_content_length(value, &length) != 0 || length > PROXY_MAX_RESPONSE) {
+                return -1;
+            }
+            conn->framing = BODY_LENGTH;
+            conn->content_length = length;
+        } else {
+            conn->framing = BODY_CLOSE;
+            conn->keep_alive = 0;
+        }
+        conn->chunk_pos = header_end;
+        conn->body_len = 0;
+    }
+    
+    size_t received = conn->len - conn->header_end;
+    switch (conn->framing) {
+        case BODY_NONE:
+            if (received > 0) conn->keep_alive = 0;
+            return 1;
+        case BODY_LENGTH:
+            if (received < conn->content_length) return 0;
+            if (received > conn->content_length) conn->keep_alive = 0;
+            conn->body_len = conn->content_length;
+            return 1;
+        case BODY_CHUNKED:
+            return decode_chunks(conn);
+        case BODY_CLOSE:
+            conn->body_len = received;
+            return received > PROXY_MAX_RESPONSE ? -1 : 0;
+    }
+    return -1;
+}
+
+// 把收到的响应整理为proxy_entry_t布局，分块编码已在接收时解码
+static int build_entry(upstream_conn_t *conn, proxy_request_t *req) {
+    const char *headers = conn->buf;
+    const char *end = conn->buf + conn->header_end;
+    int bodyless = conn->framing == BODY_NONE;
+    size_t body_len = bodyless ? 0 : conn->body_len;
+    
+    // 整理后的头部不会比原始头部长
+    char *data = malloc(sizeof(proxy_entry_t) + conn->header_end + body_len);
+    if (!data) return -1;
+    char *out = data + sizeof(proxy_entry_t);
+    
+    // 状态行统一为HTTP/1.1，保留上游的原因短语
+    const char *eol = line_end(headers, end);
+    const char *code = memchr(headers, ' ', eol - headers);
+    if (!code) {
+        free(data);
+        return -1;
+    }
+    size_t n = 8;
+    memcpy(out, "HTTP/1.1", 8);
+    memcpy(out + n, code, eol - code);
+    n += eol - code;
+    memcpy(out + n, "\r\n", 2);
+    n += 2;
+    
+    // 长度、连接和Age在发给客户端时重新生成
+    for (const char *line = eol + 2; line < end; line = line_end(line, end) + 2) {
+        const char *line_stop = line_end(line, end);
+        size_t len = line_stop - line;
+        if (len == 0) break;
+        if (is_hop_header(headers, end, line, len) || header_is(line, len, "Age") ||
+            (!bodyless && header_is(line, len, "Content-Length"))) {
+            continue;
+        }
+        memcpy(out + n, line, len);
+        memcpy(out + n + len, "\r\n", 2);
+        n += len + 2;
+    }
+    
+    proxy_entry_t entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.stored = time(NULL);
+    entry.header_len = n;
+    entry.bodyless = bodyless;
+    
+    char age[32];
+    if (find_header(headers, conn->header_end, "Age", age, sizeof(age))) entry.age = atol(age);
+    if (entry.age < 0) entry.age = 0;
+    if (req->cacheable && cacheable_status(conn->status)) {
+        long lifetime = freshness_lifetime(headers, conn->header_end);
+        if (lifetime > entry.age) entry.expires = entry.stored + lifetime - entry.age;
+    }
+    
+    memcpy(data, &entry, sizeof(entry));
+    if (body_len > 0) memcpy(out + n, conn->buf + conn->header_end, body_len);
+    
+    req->status = conn->status;
+    req->response = data;
+    req->response_len = sizeof(proxy_entry_t) + n + body_len;
+    return 0;
+}
+
+static void set_events(proxy_t *proxy, upstream_conn_t *conn, uint32_t events) {
+    struct epoll_event ev;
+    ev.events = events;
+    ev.data.ptr = conn;
+    epoll_ctl(proxy->epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev);
+}
+
+// 只在有上游连接或正在读取请求体时周期唤醒，空闲的服务器不产生额外事件
+static void update_timer(proxy_t *proxy) {
+    int want = proxy->conn_count > 0 || proxy->reading;
+    if (want == proxy->timer_armed) return;
+    
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (want) {
+        spec.it_value.tv_sec = PROXY_SWEEP_MS / 1000;
+        spec.it_value.tv_nsec = (PROXY_SWEEP_MS % 1000) * 1000000L;
+        spec.it_interval = spec.it_value;
+    }
+    timerfd_settime(proxy->timer_fd, 0, &spec, NULL);
+    proxy->timer_armed = want;
+}
+
+static upstream_conn_t *open_conn(proxy_t *proxy, upstream_t *upstream) {
+    int fd = socket(upstream->addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return NULL;
+    
+    if (upstream->addr.ss_family != AF_UNIX) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    
+    int ret = connect(fd, (struct sockaddr *)&upstream->addr, upstream->addr_len);
+    if (ret < 0 && errno != EINPROGRESS) {
+        log_message(LOG_WARN, "连接上游 %s 失败: %s", upstream->name, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+    
+    upstream_conn_t *conn = calloc(1, sizeof(upstream_conn_t));
+    if (!conn) {
+        close(fd);
+        return NULL;
+    }
+    conn->fd = fd;
+    conn->upstream = upstream;
+    conn->connecting = ret < 0;
+    
+    struct epoll_event ev;
+    ev.events = EPOLLOUT;
+    ev.data.ptr = conn;
+    if (epoll_ctl(proxy->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        close(fd);
+        free(conn);
+        return NULL;
+    }
+    
+    conn->next = proxy->conns;
+    if (proxy->conns) proxy->conns->prev = conn;
+    proxy->conns = conn;
+    proxy->conn_count++;
+    proxy->stats.connects++;
+    return conn;
+}
+
+static void close_conn(proxy_t *proxy, upstream_conn_t *conn) {
+    if (conn->pooled) {
+        upstream_t *upstream = conn->upstream;
+        for (int i = 0; i < upstream->idle_count; i++) {
+            if (upstream->idle[i] != conn) continue;
+            memmove(&upstream->idle[i], &upstream->idle[i + 1],
+                    sizeof(upstream_conn_t *) * (upstream->idle_count - i - 1));
+            upstream->idle_count--;
+            break;
+        }
+    }
+    
+    epoll_ctl(proxy->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    if (conn->prev) conn->prev->next = conn->next;
+    else proxy->conns = conn->next;
+    if (conn->next) conn->next->prev = conn->prev;
+    proxy->conn_count--;
+    free(conn->buf);
+    free(conn);
+}
+
+// 响应完整后把连接放回空闲栈，上游不允许复用或栈已满时关闭
+static void release_conn(proxy_t *proxy, upstream_conn_t *conn) {
+    upstream_t *upstream = conn->upstream;
+    conn->req = NULL;
+    if (!conn->keep_alive || upstream->idle_count == PROXY_POOL_SIZE) {
+        close_conn(proxy, conn);
+        return;
+    }
+    
+    // 大响应的缓冲区不随空闲连接保留
+    if (conn->cap > PROXY_READ_CHUNK * 4) {
+        free(conn->buf);
+        conn->buf = NULL;
+        conn->cap = 0;
+    }
+    conn->len = 0;
+    conn->idle_since = timer_now_ms();
+    conn->pooled = 1;
+    upstream->idle[upstream->idle_count++] = conn;
+    
+    // 空闲时任何可读事件都意味着上游关闭了连接
+    set_events(proxy, conn, EPOLLIN | EPOLLRDHUP);
+}
+
+// 结束请求: 写给客户端可能阻塞，complete交给线程池执行
+static void complete_request(proxy_t *proxy, proxy_request_t *req, int status) {
+    if (status) {
+        req->status = status;
+        free(req->response);
+        req->response = NULL;
+    }
+    if (threadpool_add_task(proxy->pool, req->complete, req) != 0) {
+        // 线程池已满，在事件循环中以503结束(只做非阻塞发送)
+        req->status = 503;
+        free(req->response);
+        req->response = NULL;
+        req->complete(req);
+    }
+}
+
+static void send_request(proxy_t *proxy, upstream_conn_t *conn);
+
+static void start_request(proxy_t *proxy, proxy_request_t *req) {
+    upstream_t *upstream = req->upstream;
+    upstream_conn_t *conn;
+    
+    // 重试时不再使用可能同样失效的空闲连接
+    if (upstream->idle_count > 0 && !req->retried) {
+        conn = upstream->idle[--upstream->idle_count];
+        conn->pooled = 0;
+        conn->reused = 1;
+        proxy->stats.reused++;
+    } else {
+        conn = open_conn(proxy, upstream);
+        if (!conn) {
+            proxy->stats.errors++;
+            complete_request(proxy, req, 502);
+            return;
+        }
+    }
+    
+    conn->req = req;
+    conn->sent = 0;
+    conn->len = 0;
+    conn->header_end = 0;
+    conn->status = 0;
+    conn->body_len = 0;
+    conn->chunk_left = 0;
+    conn->chunk_crlf = 0;
+    conn->chunk_trailer = 0;
+    send_request(proxy, conn);
+}
+
+// 上游连接出错: 复用的连接在收到任何响应数据之前失效时换新连接重试一次，否则返回502
+static void conn_failed(proxy_t *proxy, upstream_conn_t *conn) {
+    proxy_request_t *req = conn->req;
+    int retry = conn->reused && conn->len == 0 && req->idempotent && !req->retried;
+    
+    conn->req = NULL;
+    close_conn(proxy, conn);
+    if (retry) {
+        req->retried = 1;
+        proxy->stats.retries++;
+        start_request(proxy, req);
+    } else {
+        proxy->stats.errors++;
+        log_message(LOG_WARN, "上游 %s 请求失败", req->upstream->name);
+        complete_request(proxy, req, 502);
+    }
+}
+
+static void send_request(proxy_t *proxy, upstream_conn_t *conn) {
+    proxy_request_t *req = conn->req;
+    if (conn->connecting) return;
+    
+    while (conn->sent < req->request_len) {
+        ssize_t n = send(conn->fd, req->request + conn->sent, req->request_len - conn->sent,
+                         MSG_NOSIGNAL);
+        if (n > 0) {
+            conn->sent += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            set_events(proxy, conn, EPOLLOUT);
+            return;
+        } else {
+            conn_failed(proxy, conn);
+            return;
+        }
+    }
+    set_events(proxy, conn, EPOLLIN | EPOLLRDHUP);
+}
+
+static void finish_response(proxy_t *proxy, upstream_conn_t *conn) {
+    proxy_request_t *req = conn->req;
+    int ret = build_entry(conn, req);
+    release_conn(proxy, conn);
+    if (ret != 0) proxy->stats.errors++;
+    complete_request(proxy, req, ret == 0 ? 0 : 502);
+}
+
+static void receive_response(proxy_t *proxy, upstream_conn_t *conn) {
+    while (1) {
+        if (conn->cap - conn->len < PROXY_READ_CHUNK / 4) {
+            size_t cap = conn->cap ? conn->cap * 2 : PROXY_READ_CHUNK;
+            char *buf = realloc(conn->buf, cap);
+            if (!buf) {
+                conn_failed(proxy, conn);
+                return;
+            }
+            conn->buf = buf;
+            conn->cap = cap;
+        }
+        
+        ssize_t n = recv(conn->fd, conn->buf + conn->len, conn->cap - conn->len, 0);
+        if (n > 0) {
+            conn->len += n;
+            int ret = parse_response(conn, conn->req);
+            if (ret > 0) {
+                finish_response(proxy, conn);
+                return;
+            }
+            if (ret < 0) {
+                log_message(LOG_WARN, "上游 %s 响应格式错误或过大", conn->upstream->name);
+                conn_failed(proxy, conn);
+                return;
+            }
+            continue;
+        }
+        if (n == 0) {
+            // 没有长度信息的响应以连接关闭结束
+            if (conn->header_end && conn->framing == BODY_CLOSE) {
+                finish_response(proxy, conn);
+            } else {
+                conn_failed(proxy, conn);
+            }
+            return;
+        }
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) conn_failed(proxy, conn);
+        return;
+    }
+}
+
+static void handle_conn_event(proxy_t *proxy, upstream_conn_t *conn) {
+    // 空闲连接上的任何事件都说明上游已关闭连接
+    if (!conn->req) {
+        close_conn(proxy, conn);
+        return;
+    }
+    
+    if (conn->connecting) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if (getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0) {
+            log_message(LOG_WARN, "连接上游 %s 失败: %s", conn->upstream->name, strerror(err));
+            conn_failed(proxy, conn);
+            return;
+        }
+        conn->connecting = 0;
+    }
+    
+    if (conn->sent < conn->req->request_len) {
+        send_request(proxy, conn);
+    } else {
+        receive_response(proxy, conn);
+    }
+}
+
+// ---- 请求体: 工作线程只转交已读到的部分，剩余部分在这里非阻塞读取，读完后才占用上游连接 ----
+
+static void stop_body(proxy_t *proxy, proxy_request_t *req) {
+    epoll_ctl(proxy->body_fd, EPOLL_CTL_DEL, req->client_fd, NULL);
+    proxy_request_t **link = &proxy->reading;
+    while (*link != req) link = &(*link)->next;
+    *link = req->next;
+    req->next = NULL;
+}
+
+// 读到可用的数据为止；读完时开始转发，客户端关闭或出错时以400结束
+static void read_body(proxy_t *proxy, proxy_request_t *req) {
+    while (req->body_missing > 0) {
+        char *dst = req->request + req->request_len - req->body_missing;
+        ssize_t n = recv(req->client_fd, dst, req->body_missing, MSG_DONTWAIT);
+        if (n > 0) {
+            req->body_missing -= n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        stop_body(proxy, req);
+        complete_request(proxy, req, 400);
+        return;
+    }
+    
+    stop_body(proxy, req);
+    req->deadline_ms = timer_now_ms() + PROXY_TIMEOUT_MS;
+    start_request(proxy, req);
+}
+
+static void start_body(proxy_t *proxy, proxy_request_t *req) {
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.ptr = req;
+    if (epoll_ctl(proxy->body_fd, EPOLL_CTL_ADD, req->client_fd, &ev) < 0) {
+        complete_request(proxy, req, 500);
+        return;
+    }
+    // 和请求头一样限时，慢速上传不能无限期占住请求
+    req->deadline_ms = timer_now_ms() + HEADER_TIMEOUT_MS;
+    req->next = proxy->reading;
+    proxy->reading = req;
+    read_body(proxy, req);
+}
+
+static void handle_body_events(proxy_t *proxy) {
+    struct epoll_event events[PROXY_MAX_EVENTS];
+    int nfds = epoll_wait(proxy->body_fd, events, PROXY_MAX_EVENTS, 0);
+    for (int i = 0; i < nfds; i++) {
+        read_body(proxy, (proxy_request_t *)events[i].data.ptr);
+    }
+}
+
+static void start_queued(proxy_t *proxy) {
+    uint64_t value;
+    read(proxy->wake_fd, &value, sizeof(value));
+    
+    pthread_mutex_lock(&proxy->lock);
+    proxy_request_t *req = proxy->queue_head;
+    proxy->queue_head = proxy->queue_tail = NULL;
+    pthread_mutex_unlock(&proxy->lock);
+    
+    while (req) {
+        proxy_request_t *next = req->next;
+        req->next = NULL;
+        if (req->body_missing > 0) start_body(proxy, req);
+        else start_request(proxy, req);
+        req = next;
+    }
+}
+
+// 结束超时的转发，关闭空闲过久的连接
+static void sweep(proxy_t *proxy) {
+    uint64_t value;
+    read(proxy->timer_fd, &value, sizeof(value));
+    
+    uint64_t now = timer_now_ms();
+    upstream_conn_t *conn = proxy->conns;
+    while (conn) {
+        upstream_conn_t *next = conn->next;
+        proxy_request_t *req = conn->req;
+        if (req && now >= req->deadline_ms) {
+            log_message(LOG_WARN, "上游 %s 响应超时", conn->upstream->name);
+            conn->req = NULL;
+            close_conn(proxy, conn);
+            proxy->stats.timeouts++;
+            complete_request(proxy, req, 504);
+        } else if (!req && now - conn->idle_since >= PROXY_IDLE_TIMEOUT_MS) {
+            close_conn(proxy, conn);
+        }
+        conn = next;
+    }
+    
+    proxy_request_t *req = proxy->reading;
+    while (req) {
+        proxy_request_t *next = req->next;
+        if (now >= req->deadline_ms) {
+            stop_body(proxy, req);
+            complete_request(proxy, req, 408);
+        }
+        req = next;
+    }
+}
+
+void proxy_process(proxy_t *proxy) {
+    struct epoll_event events[PROXY_MAX_EVENTS];
+    int nfds = epoll_wait(proxy->epoll_fd, events, PROXY_MAX_EVENTS, 0);
+    int wake = 0, tick = 0, body = 0;
+    
+    // 新请求、请求体和超时检查放在最后: 它们会关闭或复用连接，使本批中后面的事件失效
+    for (int i = 0; i < nfds; i++) {
+        void *ptr = events[i].data.ptr;
+        if (ptr == &proxy->wake_fd) wake = 1;
+        else if (ptr == &proxy->timer_fd) tick = 1;
+        else if (ptr == &proxy->body_fd) body = 1;
+        else handle_conn_event(proxy, (upstream_conn_t *)ptr);
+    }
+    if (body) handle_body_events(proxy);
+    if (tick) sweep(proxy);
+    if (wake) start_queued(proxy);
+    update_timer(proxy);
+}
+
+int proxy_fd(proxy_t *proxy) {
+    return proxy->epoll_fd;
+}
+
+int proxy_submit(proxy_t *proxy, proxy_request_t *req) {
+    req->deadline_ms = timer_now_ms() + PROXY_TIMEOUT_MS;
+    req->retried = 0;
+    req->status = 0;
+    req->response = NULL;
+    req->response_len = 0;
+    req->next = NULL;
+    
+    pthread_mutex_lock(&proxy->lock);
+    if (proxy->queue_tail) proxy->queue_tail->next = req;
+    else proxy->queue_head = req;
+    proxy->queue_tail = req;
+    pthread_mutex_unlock(&proxy->lock);
+    
+    __atomic_add_fetch(&proxy->stats.requests, 1, __ATOMIC_RELAXED);
+    uint64_t one = 1;
+    write(proxy->wake_fd, &one, sizeof(one));
+    return 0;
+}
+
+upstream_t *proxy_route(proxy_t *proxy, const char *path) {
+    const proxy_route_t *best = NULL;
+    
+    for (int i = 0; i < proxy->route_count; i++) {
+        const proxy_route_t *route = &proxy->routes[i];
+        if (strncmp(path, route->prefix, route->prefix_len) != 0) continue;
+        
+        // 前缀必须在路径段边界结束: /api匹配/api/x和/api?q，不匹配/apix
+        char next = path[route->prefix_len];
+        if (route->prefix[route->prefix_len - 1] != '/' && next != '\0' && next != '/' && next != '?') {
+            continue;
+        }
+        if (!best || route->prefix_len > best->prefix_len) best = route;
+    }
+    return best ? best->upstream : NULL;
+}
+
+const char *proxy_upstream_name(const upstream_t *upstream) {
+    return upstream->name;
+}
+
+// 解析上游地址: unix:/path或host:port(可带http://前缀)
+static upstream_t *resolve_upstream(const char *target) {
+    upstream_t *upstream = calloc(1, sizeof(upstream_t));
+    if (!upstream) return NULL;
+    
+    if (strncmp(target, "unix:", 5) == 0) {
+        struct sockaddr_un *addr = (struct sockaddr_un *)&upstream->addr;
+        if (target[5] == '\0' || strlen(target + 5) >= sizeof(addr->sun_path)) {
+            free(upstream);
+            return NULL;
+        }
+        snprintf(upstream->name, sizeof(upstream->name), "%s", target);
+        addr->sun_family = AF_UNIX;
+        strcpy(addr->sun_path, target + 5);
+        upstream->addr_len = sizeof(struct sockaddr_un);
+        return upstream;
+    }
+    
+    if (strncmp(target, "http://", 7) == 0) target += 7;
+    size_t len = strcspn(target, "/");
+    if (len == 0 || len >= sizeof(upstream->name)) {
+        free(upstream);
+        return NULL;
+    }
+    memcpy(upstream->name, target, len);
+    upstream->name[len] = '\0';
+    
+    char host[128];
+    const char *port = strrchr(upstream->name, ':');
+    if (!port || port == upstream->name || port[1] == '\0') {
+        free(upstream);
+        return NULL;
+    }
+    size_t host_len = port - upstream->name;
+    const char *host_start = upstream->name;
+    if (host_start[0] == '[' && host_len > 2 && host_start[host_len - 1] == ']') {
+        host_start++;
+        host_len -= 2;
+    }
+    memcpy(host, host_start, host_len);
+    host[host_len] = '\0';
+    
+    struct addrinfo hints, *result;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_socktype = SOCK_STREAM;
+    int ret = getaddrinfo(host, port + 1, &hints, &result);
+    if (ret != 0) {
+        fprintf(stderr, "Cannot resolve upstream %s: %s\n", upstream->name, gai_strerror(ret));
+        free(upstream);
+        return NULL;
+    }
+    memcpy(&upstream->addr, result->ai_addr, result->ai_addrlen);
+    upstream->addr_len = result->ai_addrlen;
+    freeaddrinfo(result);
+    return upstream;
+}
+
+static int add_route(proxy_t *proxy, const char *spec) {
+    const char *eq = strchr(spec, '=');
+    if (!eq || spec[0] != '/' || (size_t)(eq - spec) >= sizeof(proxy->routes[0].prefix) ||
+        proxy->route_count == MAX_PROXY_ROUTES) {
+        return -1;
+    }
+    
+    upstream_t *resolved = resolve_upstream(eq + 1);
+    if (!resolved) return -1;
+    
+    // 指向同一上游的路由共用连接池
+    upstream_t *upstream = NULL;
+    for (int i = 0; i < proxy->upstream_count; i++) {
+        if (strcmp(proxy->upstreams[i]->name, resolved->name) == 0) upstream = proxy->upstreams[i];
+    }
+    if (upstream) {
+        free(resolved);
+    } else {
+        upstream = resolved;
+        proxy->upstreams[proxy->upstream_count++] = upstream;
+    }
+    
+    proxy_route_t *route = &proxy->routes[proxy->route_count++];
+    route->prefix_len = eq - spec;
+    memcpy(route->prefix, spec, route->prefix_len);
+    route->prefix[route->prefix_len] = '\0';
+    route->upstream = upstream;
+    return 0;
+}
+
+proxy_t *proxy_create(threadpool_t *pool, const char *const *routes, int route_count) {
+    proxy_t *proxy = calloc(1, sizeof(proxy_t));
+    if (!proxy) return NULL;
+    
+    proxy->pool = pool;
+    proxy->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    proxy->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    proxy->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    proxy->body_fd = epoll_create1(EPOLL_CLOEXEC);
+    pthread_mutex_init(&proxy->lock, NULL);
+    if (proxy->epoll_fd < 0 || proxy->wake_fd < 0 || proxy->timer_fd < 0 || proxy->body_fd < 0) {
+        proxy_destroy(proxy);
+        return NULL;
+    }
+    
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = &proxy->wake_fd;
+    epoll_ctl(proxy->epoll_fd, EPOLL_CTL_ADD, proxy->wake_fd, &ev);
+    ev.data.ptr = &proxy->timer_fd;
+    epoll_ctl(proxy->epoll_fd, EPOLL_CTL_ADD, proxy->timer_fd, &ev);
+    ev.data.ptr = &proxy->body_fd;
+    epoll_ctl(proxy->epoll_fd, EPOLL_CTL_ADD, proxy->body_fd, &ev);
+    
+    for (int i = 0; i < route_count; i++) {
+        if (add_route(proxy, routes[i]) != 0) {
+            fprintf(stderr, "Invalid proxy route: %s\n", routes[i]);
+            proxy_destroy(proxy);
+            return NULL;
+        }
+        log_message(LOG_INFO, "代理路由: %s -> %s", proxy->routes[i].prefix,
+                    proxy->routes[i].upstream->name);
+    }
+    return proxy;
+}
+
+// 以502结束，在调用线程中回调
+static void abort_request(proxy_request_t *req) {
+    req->status = 502;
+    free(req->response);
+    req->response = NULL;
+    req->complete(req);
+}
+
+void proxy_destroy(proxy_t *proxy) {
+    if (!proxy) return;
+    
+    proxy_request_t *req = proxy->queue_head;
+    while (req) {
+        proxy_request_t *next = req->next;
+        abort_request(req);
+        req = next;
+    }
+    while (proxy->reading) {
+        req = proxy->reading;
+        stop_body(proxy, req);
+        abort_request(req);
+    }
+    while (proxy->conns) {
+        upstream_conn_t *conn = proxy->conns;
+        req = conn->req;
+        conn->req = NULL;
+        close_conn(proxy, conn);
+        if (req) abort_request(req);
+    }
+    
+    for (int i = 0; i < proxy->upstream_count; i++) free(proxy->upstreams[i]);
+    if (proxy->epoll_fd >= 0) close(proxy->epoll_fd);
+    if (proxy->wake_fd >= 0) close(proxy->wake_fd);
+    if (proxy->timer_fd >= 0) close(proxy->timer_fd);
+    if (proxy->body_fd >= 0) close(proxy->body_fd);
+    pthread_mutex_destroy(&proxy->lock);
+    free(proxy);
+}
+
+void proxy_get_stats(proxy_t *proxy, proxy_stats_t *stats) {
+    *stats = proxy->stats;
+    stats->requests = __atomic_load_n(&proxy->stats.requests, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,75 @@
+#ifndef PROXY_H
+#define PROXY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include "threadpool.h"
+
+// 缓存中代理响应的布局: proxy_entry_t + 响应头(状态行和端到端头部，不含结尾空行) + 响应体
+typedef struct {
+    time_t stored;             // 收到响应的时间
+    time_t expires;            // 新鲜期截止时间，0表示不可缓存
+    long age;                  // 收到时上游给出的Age(秒)
+    unsigned int header_len;
+    int bodyless;              // 按定义没有响应体(HEAD/204/304)，保留上游的Content-Length
+} proxy_entry_t;
+
+typedef struct proxy proxy_t;
+typedef struct upstream upstream_t;
+
+// 一次转发: 工作线程填写后提交，事件循环完成上游I/O后把complete作为线程池任务调用
+typedef struct proxy_request {
+    upstream_t *upstream;
+    char *request;             // 发给上游的完整请求(已改写逐跳头部)
+    size_t request_len;
+    int client_fd;             // body_missing>0时从这里读取请求体的剩余部分
+    size_t body_missing;       // 请求体中尚未从客户端收到的字节数(位于request末尾)
+    int head;                  // HEAD请求，响应没有响应体
+    int idempotent;            // 复用的连接已被上游关闭时可以在新连接上重试
+    int cacheable;             // 请求本身允许缓存响应(GET且不带凭据)
+    int status;                // 上游状态码；失败时为502/503/504且response为NULL
+    char *response;            // proxy_entry_t布局的响应，由complete负责释放
+    size_t response_len;
+    void (*complete)(void *arg); // 参数为本结构
+    // 以下由代理内部使用
+    uint64_t deadline_ms;
+    int retried;
+    struct proxy_request *next;
+} proxy_request_t;
+
+typedef struct {
+    unsigned long requests;    // 转发的请求数
+    unsigned long connects;    // 新建的上游连接数
+    unsigned long reused;      // 复用空闲连接的次数
+    unsigned long retries;     // 复用的连接失效后重试的次数
+    unsigned long errors;      // 502
+    unsigned long timeouts;    // 504
+} proxy_stats_t;
+
+// routes为"前缀=上游"，上游为host:port或unix:/path；地址无法解析时返回NULL
+proxy_t *proxy_create(threadpool_t *pool, const char *const *routes, int route_count);
+// 未完成的请求以502结束(在调用线程中回调complete)
+void proxy_destroy(proxy_t *proxy);
+// 最长前缀匹配，不转发的路径返回NULL
+upstream_t *proxy_route(proxy_t *proxy, const char *path);
+const char *proxy_upstream_name(const upstream_t *upstream);
+// Content-Length只能是十进制数字(RFC 9110 8.6)，超出size_t的值饱和为SIZE_MAX
+int proxy_parse_content_length(const char *value, size_t *length);
+// 客户端请求头(含结尾空行)的消息长度无歧义时返回0: 没有重复的Content-Length，
+// Content-Length不与Transfer-Encoding同时出现，字段行格式合法
+int proxy_check_framing(const char *header, size_t header_len);
+// 按客户端请求头(含结尾空行)和请求体生成req->request: 请求目标换成target，
+// 改为HTTP/1.1长连接并去掉逐跳头部
+// 请求体共body_len字节，已读到的前body_have字节在body中，其余部分提交后由事件循环从
+// req->client_fd读取，不占用工作线程
+int proxy_build_request(proxy_request_t *req, const char *header, size_t header_len,
+                        const char *target, const char *body, size_t body_have, size_t body_len);
+// 工作线程调用(线程安全)，成功后req归代理所有直到complete被调用
+int proxy_submit(proxy_t *proxy, proxy_request_t *req);
+// 可读时事件循环应调用proxy_process驱动上游连接
+int proxy_fd(proxy_t *proxy);
+void proxy_process(proxy_t *proxy);
+void proxy_get_stats(proxy_t *proxy, proxy_stats_t *stats);
+
+#endif
@@ -0,0 +1,668 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "shm_cache.h"
+#include "logging.h"
+#include "mapguard.h"
+
+#define SHM_MAGIC "LLABSHM4"     // 4: 按进程槽位记录引用
+#define SHM_ALIGN 16
+#define SHM_NULL 0             // 偏移0是段头，不会是任何块
+#define SHM_VIEW_CACHE 16      // 每个线程保留的空闲视图数
+
+// 段头
+typedef struct shm_header {
+    char magic[8];
+    uint32_t ready;            // 初始化完成后置1
+    uint32_t generation;       // 段被重置的次数，之前取得的视图和预留块随之失效
+    pthread_mutex_t lock;      // 进程间共享的健壮锁
+    uint64_t segment_size;
+    uint64_t max_size;         // 内存预算(与私有缓存的max_size含义相同)
+    uint64_t total_size;       // 已分配块的总大小(含块头、项头和key)
+    uint32_t count;
+    uint64_t lru_head;         // 最近使用
+    uint64_t lru_tail;         // 最久未使用
+    uint64_t free_head;        // 空闲块链表(按偏移排序，便于合并)
+    uint64_t detached_head;    // 不在索引中但仍占用块的项: 仍有引用的已摘除项和正在复制的预留项
+    int32_t procs[SHM_MAX_PROCS]; // 各引用槽位所属的进程，0表示空闲
+    uint64_t table[HASH_TABLE_SIZE];
+} shm_header_t;
+
+// 每个块的头部，空闲块用next_free串起来
+typedef struct {
+    uint64_t size;             // 含块头的总大小
+    uint64_t next_free;
+} shm_block_t;
+
+// 缓存项，紧跟在块头之后，后面依次是key和数据
+typedef struct {
+    uint64_t h_next;
+    uint64_t prev;
+    uint64_t next;
+    uint64_t size;
+    int64_t mtime;
+    uint32_t key_len;
+    uint32_t refcount;
+    uint32_t detached;
+    uint32_t reserver;         // 正在复制数据的进程槽位+1，0表示已发布
+    char etag[64];
+    uint16_t refs[SHM_MAX_PROCS]; // 各槽位持有的引用数，进程退出后据此归还
+} shm_entry_t;
+
+#define AT(shm, off) ((void *)((char *)(shm)->header + (off)))
+#define ENTRY(shm, off) ((shm_entry_t *)AT(shm, off))
+#define ENTRY_KEY(e) ((char *)((e) + 1))
+#define ENTRY_DATA(e) (ENTRY_KEY(e) + (e)->key_len + 1)
+
+static unsigned int hash(const char *key) {
+    unsigned int hash = 0;
+    while (*key) {
+        hash = (hash << 5) + hash + *key++;
+    }
+    return hash % HASH_TABLE_SIZE;
+}
+
+static void reset_segment(shm_cache_t *shm);
+
+static void shm_lock(shm_cache_t *shm) {
+    // 持锁进程崩溃后链表、空闲链表和计数可能停在中间状态，无法校验，清空整个段后再标记为一致
+    if (pthread_mutex_lock(&shm->header->lock) == EOWNERDEAD) {
+        log_message(LOG_WARN, "共享缓存锁的持有进程已退出，清空共享缓存");
+        reset_segment(shm);
+        pthread_mutex_consistent(&shm->header->lock);
+    }
+}
+
+static void shm_unlock(shm_cache_t *shm) {
+    pthread_mutex_unlock(&shm->header->lock);
+}
+
+// ---- 段内分配器: 首次适配，从空闲块尾部切割，释放时与相邻空闲块合并 ----
+
+static uint64_t block_alloc(shm_cache_t *shm, size_t payload) {
+    uint64_t need = (sizeof(shm_block_t) + payload + SHM_ALIGN - 1) & ~(uint64_t)(SHM_ALIGN - 1);
+    uint64_t prev = SHM_NULL;
+    uint64_t off = shm->header->free_head;
+    
+    while (off != SHM_NULL) {
+        shm_block_t *block = AT(shm, off);
+        if (block->size >= need) {
+            if (block->size - need >= sizeof(shm_block_t) + SHM_ALIGN) {
+                // 从尾部切出，空闲块留在原位
+                block->size -= need;
+                uint64_t result = off + block->size;
+                shm_block_t *allocated = AT(shm, result);
+                allocated->size = need;
+                allocated->next_free = SHM_NULL;
+                return result;
+            }
+            // 整块使用
+            if (prev == SHM_NULL) shm->header->free_head = block->next_free;
+            else ((shm_block_t *)AT(shm, prev))->next_free = block->next_free;
+            block->next_free = SHM_NULL;
+            return off;
+        }
+        prev = off;
+        off = block->next_free;
+    }
+    return SHM_NULL;
+}
+
+// 释放块中的整页交还内核: 段在tmpfs/memfd上，MADV_REMOVE释放后备页面，再次使用时按需分配零页
+// 缓存因内存压力缩小后，被淘汰的数据不再占用内存
+static void block_release_pages(shm_cache_t *shm, uint64_t off, uint64_t size) {
+    uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t start = (off + sizeof(shm_block_t) + page - 1) & ~(page - 1);
+    uint64_t end = (off + size) & ~(page - 1);
+    if (end > start && end - start >= SHM_RELEASE_MIN) {
+        madvise(AT(shm, start), end - start, MADV_REMOVE);
+    }
+}
+
+static void block_free(shm_cache_t *shm, uint64_t off) {
+    shm_block_t *block = AT(shm, off);
+    block_release_pages(shm, off, block->size);
+    uint64_t prev = SHM_NULL;
+    uint64_t next = shm->header->free_head;
+    while (next != SHM_NULL && next < off) {
+        prev = next;
+        next = ((shm_block_t *)AT(shm, next))->next_free;
+    }
+    
+    // 与后一个空闲块合并
+    if (next != SHM_NULL && off + block->size == next) {
+        shm_block_t *next_block = AT(shm, next);
+        block->size += next_block->size;
+        block->next_free = next_block->next_free;
+    } else {
+        block->next_free = next;
+    }
+    
+    // 与前一个空闲块合并
+    if (prev != SHM_NULL) {
+        shm_block_t *prev_block = AT(shm, prev);
+        if (prev + prev_block->size == off) {
+            prev_block->size += block->size;
+            prev_block->next_free = block->next_free;
+        } else {
+            prev_block->next_free = off;
+        }
+    } else {
+        shm->header->free_head = off;
+    }
+}
+
+// ---- 链表和哈希表(调用者持有锁) ----
+
+static uint64_t entry_offset(uint64_t block) {
+    return block + sizeof(shm_block_t);
+}
+
+static uint64_t entry_block(uint64_t entry) {
+    return entry - sizeof(shm_block_t);
+}
+
+static void lru_unlink(shm_cache_t *shm, uint64_t off) {
+    shm_entry_t *entry = ENTRY(shm, off);
+    if (entry->prev != SHM_NULL) ENTRY(shm, entry->prev)->next = entry->next;
+    else shm->header->lru_head = entry->next;
+    if (entry->next != SHM_NULL) ENTRY(shm, entry->next)->prev = entry->prev;
+    else shm->header->lru_tail = entry->prev;
+    entry->prev = entry->next = SHM_NULL;
+}
+
+static void lru_push_front(shm_cache_t *shm, uint64_t off) {
+    shm_entry_t *entry = ENTRY(shm, off);
+    entry->prev = SHM_NULL;
+    entry->next = shm->header->lru_head;
+    if (entry->next != SHM_NULL) ENTRY(shm, entry->next)->prev = off;
+    shm->header->lru_head = off;
+    if (shm->header->lru_tail == SHM_NULL) shm->header->lru_tail = off;
+}
+
+static uint64_t table_find(shm_cache_t *shm, const char *key, uint64_t **link) {
+    uint64_t *slot = &shm->header->table[hash(key)];
+    while (*slot != SHM_NULL) {
+        shm_entry_t *entry = ENTRY(shm, *slot);
+        if (strcmp(ENTRY_KEY(entry), key) == 0) {
+            if (link) *link = slot;
+            return *slot;
+        }
+        slot = &entry->h_next;
+    }
+    return SHM_NULL;
+}
+
+// 索引之外的项用prev/next串在detached链表中，进程退出时从这里找到它留下的块
+static void detached_push(shm_cache_t *shm, uint64_t off) {
+    shm_entry_t *entry = ENTRY(shm, off);
+    entry->prev = SHM_NULL;
+    entry->next = shm->header->detached_head;
+    if (entry->next != SHM_NULL) ENTRY(shm, entry->next)->prev = off;
+    shm->header->detached_head = off;
+}
+
+static void detached_unlink(shm_cache_t *shm, uint64_t off) {
+    shm_entry_t *entry = ENTRY(shm, off);
+    if (entry->prev != SHM_NULL) ENTRY(shm, entry->prev)->next = entry->next;
+    else shm->header->detached_head = entry->next;
+    if (entry->next != SHM_NULL) ENTRY(shm, entry->next)->prev = entry->prev;
+    entry->prev = entry->next = SHM_NULL;
+}
+
+// 从索引中摘除，仍有其他进程在发送时延迟释放
+static void detach_entry(shm_cache_t *shm, uint64_t *link, uint64_t off) {
+    shm_entry_t *entry = ENTRY(shm, off);
+    *link = entry->h_next;
+    lru_unlink(shm, off);
+    shm->header->total_size -= ((shm_block_t *)AT(shm, entry_block(off)))->size;
+    shm->header->count--;
+    
+    if (entry->refcount > 0) {
+        entry->detached = 1;
+        detached_push(shm, off);
+    } else {
+        block_free(shm, entry_block(off));
+    }
+}
+
+static void drop_slot_refs(shm_entry_t *entry, int slot) {
+    entry->refcount -= entry->refs[slot];
+    entry->refs[slot] = 0;
+}
+
+// 归还一个槽位的全部引用(调用者持有锁): 索引中的项只扣引用，
+// 已摘除的项引用归零后释放，该槽位未完成的预留块直接释放
+static void reclaim_slot(shm_cache_t *shm, int slot) {
+    for (uint64_t off = shm->header->lru_head; off != SHM_NULL; off = ENTRY(shm, off)->next) {
+        drop_slot_refs(ENTRY(shm, off), slot);
+    }
+    
+    uint64_t off = shm->header->detached_head;
+    while (off != SHM_NULL) {
+        shm_entry_t *entry = ENTRY(shm, off);
+        uint64_t next = entry->next;
+        drop_slot_refs(entry, slot);
+        if (entry->reserver == (uint32_t)slot + 1) {
+            detached_unlink(shm, off);
+            shm->header->total_size -= ((shm_block_t *)AT(shm, entry_block(off)))->size;
+            block_free(shm, entry_block(off));
+        } else if (entry->detached && entry->refcount == 0) {
+            detached_unlink(shm, off);
+            block_free(shm, entry_block(off));
+        }
+        off = next;
+    }
+    shm->header->procs[slot] = 0;
+}
+
+static void evict_tail(shm_cache_t *shm) {
+    uint64_t off = shm->header->lru_tail;
+    if (off == SHM_NULL) return;
+    
+    uint64_t *link = NULL;
+    table_find(shm, ENTRY_KEY(ENTRY(shm, off)), &link);
+    detach_entry(shm, link, off);
+}
+
+// 丢弃所有项，段头之后的全部空间重新成为一个空闲块(调用者持有锁或段尚未发布)
+// 其他进程仍持有的视图属于旧的generation，释放时不再访问段内数据
+static void reset_segment(shm_cache_t *shm) {
+    shm_header_t *header = shm->header;
+    memset(header->table, 0, sizeof(header->table));
+    header->lru_head = header->lru_tail = SHM_NULL;
+    header->detached_head = SHM_NULL;
+    header->total_size = 0;
+    header->count = 0;
+    header->generation++;
+    
+    uint64_t first = (sizeof(shm_header_t) + SHM_ALIGN - 1) & ~(uint64_t)(SHM_ALIGN - 1);
+    shm_block_t *block = AT(shm, first);
+    block->size = (shm->segment_size - first) & ~(uint64_t)(SHM_ALIGN - 1);
+    block->next_free = SHM_NULL;
+    header->free_head = first;
+}
+
+// ---- 视图: 每个线程缓存少量空闲视图，命中路径不必每次分配 ----
+
+typedef struct {
+    cache_item_t *head;        // 用视图的next字段串起来
+    unsigned int count;
+} view_cache_t;
+
+static __thread view_cache_t view_cache;
+static pthread_key_t view_key;
+static pthread_once_t view_once = PTHREAD_ONCE_INIT;
+
+// 线程退出时释放缓存的视图
+static void free_view_cache(void *arg) {
+    view_cache_t *cache = arg;
+    while (cache->head) {
+        cache_item_t *view = cache->head;
+        cache->head = view->next;
+        free(view);
+    }
+    cache->count = 0;
+}
+
+static void create_view_key(void) {
+    pthread_key_create(&view_key, free_view_cache);
+}
+
+static cache_item_t *view_alloc(void) {
+    cache_item_t *view = view_cache.head;
+    if (!view) return calloc(1, sizeof(cache_item_t));
+    view_cache.head = view->next;
+    view_cache.count--;
+    memset(view, 0, sizeof(*view));
+    return view;
+}
+
+static void view_free(cache_item_t *view) {
+    if (view_cache.count >= SHM_VIEW_CACHE) {
+        free(view);
+        return;
+    }
+    if (!view_cache.head) {
+        pthread_once(&view_once, create_view_key);
+        pthread_setspecific(view_key, &view_cache);
+    }
+    view->next = view_cache.head;
+    view_cache.head = view;
+    view_cache.count++;
+}
+
+// ---- 对外接口 ----
+
+static int init_segment(shm_cache_t *shm, size_t max_size) {
+    shm_header_t *header = shm->header;
+    memset(header, 0, sizeof(shm_header_t));
+    
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    int ret = pthread_mutex_init(&header->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+    if (ret != 0) return -1;
+    
+    header->segment_size = shm->segment_size;
+    header->max_size = max_size;
+    reset_segment(shm);
+    
+    memcpy(header->magic, SHM_MAGIC, sizeof(header->magic));
+    __atomic_store_n(&header->ready, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+shm_cache_t *shm_cache_open(const char *name, size_t max_size) {
+    shm_cache_t *shm = calloc(1, sizeof(shm_cache_t));
+    if (!shm) return NULL;
+    
+    // key、项头和碎片需要额外空间
+    shm->segment_size = max_size + max_size / SHM_OVERHEAD_RATIO + sizeof(shm_header_t);
+    int creator = 1;
+    
+    if (name) {
+        char shm_name[256];
+        snprintf(shm_name, sizeof(shm_name), "/%s", name);
+        shm->fd = shm_open(shm_name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (shm->fd < 0 && errno == EEXIST) {
+            creator = 0;
+            shm->fd = shm_open(shm_name, O_RDWR, 0600);
+        }
+    } else {
+        shm->fd = memfd_create("llab-cache", MFD_CLOEXEC);
+    }
+    if (shm->fd < 0) {
+        free(shm);
+        return NULL;
+    }
+    
+    if (creator) {
+        if (ftruncate(shm->fd, shm->segment_size) != 0) {
+            close(shm->fd);
+            free(shm);
+            return NULL;
+        }
+    } else {
+        // 使用已存在段的实际大小
+        struct stat st;
+        if (fstat(shm->fd, &st) != 0 || (size_t)st.st_size < sizeof(shm_header_t)) {
+            close(shm->fd);
+            free(shm);
+            return NULL;
+        }
+        shm->segment_size = st.st_size;
+    }
+    
+    shm->header = mmap(NULL, shm->segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm->fd, 0);
+    if (shm->header == MAP_FAILED) {
+        close(shm->fd);
+        free(shm);
+        return NULL;
+    }
+    shm->slot = -1;
+    
+    if (creator) {
+        if (init_segment(shm, max_size) != 0) {
+            shm_cache_close(shm);
+            return NULL;
+        }
+    } else {
+        // 等待创建者完成初始化
+        for (int i = 0; i < 1000 && !__atomic_load_n(&shm->header->ready, __ATOMIC_ACQUIRE); i++) {
+            usleep(1000);
+        }
+        if (!shm->header->ready || memcmp(shm->header->magic, SHM_MAGIC, 8) != 0) {
+            shm_cache_close(shm);
+            return NULL;
+        }
+    }
+    shm_cache_attach(shm);
+    return shm;
+}
+
+int shm_cache_attach(shm_cache_t *shm) {
+    pid_t pid = getpid();
+    int slot = -1;
+    
+    shm_lock(shm);
+    for (int i = 0; i < SHM_MAX_PROCS; i++) {
+        pid_t owner = shm->header->procs[i];
+        // 同一pid残留的槽位属于已退出的进程(pid被复用)，所属进程不存在的槽位同样回收
+        if (owner != 0 && (owner == pid || (kill(owner, 0) != 0 && errno == ESRCH))) {
+            reclaim_slot(shm, i);
+        }
+        if (shm->header->procs[i] == 0 && slot < 0) slot = i;
+    }
+    if (slot >= 0) shm->header->procs[slot] = pid;
+    shm_unlock(shm);
+    
+    shm->slot = slot;
+    if (slot < 0) {
+        log_message(LOG_WARN, "共享缓存的进程槽位已用完，进程 %d 不使用共享缓存", pid);
+        return -1;
+    }
+    return 0;
+}
+
+void shm_cache_reclaim(shm_cache_t *shm, pid_t pid) {
+    if (!shm || pid <= 0) return;
+    
+    shm_lock(shm);
+    for (int i = 0; i < SHM_MAX_PROCS; i++) {
+        if (shm->header->procs[i] == pid) reclaim_slot(shm, i);
+    }
+    shm_unlock(shm);
+}
+
+void shm_cache_close(shm_cache_t *shm) {
+    if (!shm) return;
+    if (shm->slot >= 0 && shm->header->procs[shm->slot] == getpid()) {
+        shm_cache_reclaim(shm, getpid());
+    }
+    munmap(shm->header, shm->segment_size);
+    close(shm->fd);
+    free(shm);
+}
+
+cache_item_t *shm_cache_get(shm_cache_t *shm, const char *key) {
+    if (shm->slot < 0) return NULL;
+    
+    cache_item_t *view = view_alloc();
+    if (!view) return NULL;
+    
+    shm_lock(shm);
+    
+    // 单个进程对同一项的引用数到上限时按未命中处理
+    uint64_t off = table_find(shm, key, NULL);
+    if (off == SHM_NULL || ENTRY(shm, off)->refs[shm->slot] == UINT16_MAX) {
+        shm_unlock(shm);
+        view_free(view);
+        return NULL;
+    }
+    
+    shm_entry_t *entry = ENTRY(shm, off);
+    entry->refs[shm->slot]++;
+    entry->refcount++;
+    lru_unlink(shm, off);
+    lru_push_front(shm, off);
+    
+    view->data = ENTRY_DATA(entry);
+    view->size = entry->size;
+    view->mtime = entry->mtime;
+    memcpy(view->etag, entry->etag, sizeof(view->etag));
+    view->shared = off;
+    view->epoch = shm->header->generation;  // 视图的epoch记录取得时段的generation
+    
+    shm_unlock(shm);
+    return view;
+}
+
+void shm_cache_release(shm_cache_t *shm, cache_item_t *view) {
+    shm_lock(shm);
+    
+    // 段在此期间被重置过，原来的项已不存在
+    if (view->epoch == shm->header->generation) {
+        shm_entry_t *entry = ENTRY(shm, view->shared);
+        if (entry->refs[shm->slot] > 0) {
+            entry->refs[shm->slot]--;
+            entry->refcount--;
+        }
+        if (entry->refcount == 0 && entry->detached) {
+            detached_unlink(shm, view->shared);
+            block_free(shm, entry_block(view->shared));
+        }
+    }
+    
+    shm_unlock(shm);
+    view_free(view);
+}
+
+// 锁内只预留块(计入total_size但不在索引中，淘汰不到)，数据在锁外复制，完成后再发布
+int shm_cache_put(shm_cache_t *shm, const char *key, const void *data, size_t size,
+                  time_t mtime, const char *etag) {
+    size_t key_len = strlen(key);
+    size_t payload = sizeof(shm_entry_t) + key_len + 1 + size;
+    if (shm->slot < 0 || sizeof(shm_block_t) + payload > shm->header->max_size) return -1;
+    
+    shm_lock(shm);
+    
+    // 替换旧项
+    uint64_t *link = NULL;
+    uint64_t old = table_find(shm, key, &link);
+    if (old != SHM_NULL) detach_entry(shm, link, old);
+    
+    while (shm->header->total_size + sizeof(shm_block_t) + payload > shm->header->max_size &&
+           shm->header->count > 0) {
+        evict_tail(shm);
+    }
+    
+    // 碎片导致分配失败时继续淘汰
+    uint64_t block = block_alloc(shm, payload);
+    while (block == SHM_NULL && shm->header->count > 0) {
+        evict_tail(shm);
+        block = block_alloc(shm, payload);
+    }
+    if (block == SHM_NULL) {
+        shm_unlock(shm);
+        return -1;
+    }
+    
+    uint64_t block_size = ((shm_block_t *)AT(shm, block))->size;
+    uint32_t generation = shm->header->generation;
+    shm->header->total_size += block_size;
+    
+    uint64_t off = entry_offset(block);
+    shm_entry_t *entry = ENTRY(shm, off);
+    memset(entry, 0, sizeof(shm_entry_t));
+    entry->size = size;
+    entry->mtime = mtime;
+    entry->key_len = key_len;
+    entry->reserver = shm->slot + 1;
+    snprintf(entry->etag, sizeof(entry->etag), "%s", etag ? etag : "");
+    memcpy(ENTRY_KEY(entry), key, key_len + 1);
+    detached_push(shm, off);
+    
+    shm_unlock(shm);
+    
+    // 数据可能来自文件映射，文件被截断时放弃这一项
+    int copied = mapguard_copy(ENTRY_DATA(entry), data, size);
+    
+    shm_lock(shm);
+    
+    // 复制期间段被重置，预留的块已经回到空闲空间
+    if (shm->header->generation != generation) {
+        shm_unlock(shm);
+        return -1;
+    }
+    detached_unlink(shm, off);
+    entry->reserver = 0;
+    if (copied != 0) {
+        shm->header->total_size -= block_size;
+        block_free(shm, block);
+        shm_unlock(shm);
+        return -1;
+    }
+    
+    // 复制期间其他进程可能放入了同一个key
+    old = table_find(shm, key, &link);
+    if (old != SHM_NULL) detach_entry(shm, link, old);
+    
+    uint64_t *slot = &shm->header->table[hash(key)];
+    entry->h_next = *slot;
+    *slot = off;
+    lru_push_front(shm, off);
+    shm->header->count++;
+    
+    shm_unlock(shm);
+    return 0;
+}
+
+void shm_cache_remove(shm_cache_t *shm, const char *key) {
+    shm_lock(shm);
+    
+    uint64_t *link = NULL;
+    uint64_t off = table_find(shm, key, &link);
+    if (off != SHM_NULL) detach_entry(shm, link, off);
+    
+    shm_unlock(shm);
+}
+
+void shm_cache_clear(shm_cache_t *shm) {
+    shm_lock(shm);
+    while (shm->header->count > 0) {
+        evict_tail(shm);
+    }
+    shm_unlock(shm);
+}
+
+void shm_cache_reset(shm_cache_t *shm) {
+    shm_lock(shm);
+    reset_segment(shm);
+    shm_unlock(shm);
+}
+
+int shm_cache_set_max_size(shm_cache_t *shm, size_t max_size) {
+    uint64_t capacity = (shm->segment_size - sizeof(shm_header_t)) / (SHM_OVERHEAD_RATIO + 1) *
+                        SHM_OVERHEAD_RATIO;
+    if (max_size == 0 || max_size > capacity) return -1;
+    
+    int done = 0;
+    shm_lock(shm);
+    shm->header->max_size = max_size;
+    while (!done) {
+        for (int i = 0; i < CACHE_EVICT_BATCH && shm->header->total_size > max_size &&
+             shm->header->count > 0; i++) {
+            evict_tail(shm);
+        }
+        done = shm->header->total_size <= max_size || shm->header->count == 0;
+        shm_unlock(shm);
+        if (!done) {
+            sched_yield();
+            shm_lock(shm);
+        }
+    }
+    return 0;
+}
+
+size_t shm_cache_max_size(shm_cache_t *shm) {
+    return shm->header->max_size;
+}
+
+size_t shm_cache_size(shm_cache_t *shm) {
+    return shm->header->total_size;
+}
+
+unsigned int shm_cache_count(shm_cache_t *shm) {
+    return shm->header->count;
+}
@@ -0,0 +1,44 @@
+#ifndef SHM_CACHE_H
+#define SHM_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+#include "cache.h"
+
+// 放在共享内存段中的LRU缓存，多个进程共用一份热点数据和一份内存预算
+// 段内只保存相对段起始位置的偏移，不保存指针，各进程可以映射到不同地址
+typedef struct shm_cache {
+    struct shm_header *header; // 段起始地址
+    size_t segment_size;
+    int fd;
+    int slot;                  // 本进程的引用槽位，-1表示槽位已用完(不使用共享缓存)
+} shm_cache_t;
+
+// name为NULL时使用memfd(只能在fork之前创建，由子进程继承)；
+// 否则使用shm_open("/name")，第一个打开的进程负责初始化
+shm_cache_t *shm_cache_open(const char *name, size_t max_size);
+void shm_cache_close(shm_cache_t *shm);
+// 为当前进程分配引用槽位(打开时自动分配，fork出的子进程需要重新调用)
+int shm_cache_attach(shm_cache_t *shm);
+// 回收已退出进程持有的引用和未完成的预留块，由父进程回收子进程后调用
+void shm_cache_reclaim(shm_cache_t *shm, pid_t pid);
+
+// 命中时返回一个指向共享数据的只读视图并持有引用，用完需shm_cache_release
+cache_item_t *shm_cache_get(shm_cache_t *shm, const char *key);
+void shm_cache_release(shm_cache_t *shm, cache_item_t *view);
+// 数据复制进共享段，空间不足时按LRU淘汰
+int shm_cache_put(shm_cache_t *shm, const char *key, const void *data, size_t size,
+                  time_t mtime, const char *etag);
+void shm_cache_remove(shm_cache_t *shm, const char *key);
+void shm_cache_clear(shm_cache_t *shm);
+// 丢弃段中全部内容，其他进程仍持有的视图随之失效
+void shm_cache_reset(shm_cache_t *shm);
+size_t shm_cache_size(shm_cache_t *shm);
+// 调整数据预算，不能超过创建时映射的共享段容量
+int shm_cache_set_max_size(shm_cache_t *shm, size_t max_size);
+size_t shm_cache_max_size(shm_cache_t *shm);
+unsigned int shm_cache_count(shm_cache_t *shm);
+
+#endif
@@ -0,0 +1,83 @@
+#include <stdlib.h>
+#include <string.h>
+#include "sketch.h"
+
+// 把原始哈希打散，避免短key高位分布不均
+static uint32_t mix(uint32_t h) {
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+// 第row行的计数器下标(双重哈希)
+static size_t slot(const frequency_sketch_t *sketch, uint32_t h, int row) {
+    uint32_t h2 = (h >> 17) | (h << 15);
+    return (size_t)row * sketch->width + ((h + (uint32_t)row * (h2 | 1)) & (sketch->width - 1));
+}
+
+frequency_sketch_t *sketch_create(size_t width) {
+    frequency_sketch_t *sketch = malloc(sizeof(frequency_sketch_t));
+    if (!sketch) return NULL;
+    
+    // 向上取整到2的幂
+    size_t w = 64;
+    while (w < width) w <<= 1;
+    
+    sketch->table = calloc(SKETCH_DEPTH * w, sizeof(uint8_t));
+    if (!sketch->table) {
+        free(sketch);
+        return NULL;
+    }
+    sketch->width = w;
+    sketch->additions = 0;
+    sketch->sample_size = w * 10;
+    sketch->resets = 0;
+    return sketch;
+}
+
+void sketch_destroy(frequency_sketch_t *sketch) {
+    if (!sketch) return;
+    free(sketch->table);
+    free(sketch);
+}
+
+// 所有计数器减半，让过去的热度逐渐失效
+static void sketch_reset(frequency_sketch_t *sketch) {
+    size_t total = SKETCH_DEPTH * sketch->width;
+    for (size_t i = 0; i < total; i++) {
+        sketch->table[i] >>= 1;
+    }
+    sketch->additions /= 2;
+    sketch->resets++;
+}
+
+void sketch_increment(frequency_sketch_t *sketch, unsigned int hash) {
+    uint32_t h = mix(hash);
+    int added = 0;
+    
+    for (int row = 0; row < SKETCH_DEPTH; row++) {
+        uint8_t *counter = &sketch->table[slot(sketch, h, row)];
+        if (*counter < SKETCH_COUNTER_MAX) {
+            (*counter)++;
+            added = 1;
+        }
+    }
+    
+    if (added && ++sketch->additions >= sketch->sample_size) {
+        sketch_reset(sketch);
+    }
+}
+
+unsigned int sketch_estimate(const frequency_sketch_t *sketch, unsigned int hash) {
+    uint32_t h = mix(hash);
+    unsigned int min = SKETCH_COUNTER_MAX;
+    
+    for (int row = 0; row < SKETCH_DEPTH; row++) {
+        unsigned int value = sketch->table[slot(sketch, h, row)];
+        if (value < min) min = value;
+    }
+    return min;
+}
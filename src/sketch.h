@@ -0,0 +1,25 @@
+#ifndef SKETCH_H
+#define SKETCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Count-Min频率草图: 每行一组饱和计数器，估计值取各行最小值
+#define SKETCH_DEPTH 4
+#define SKETCH_COUNTER_MAX 15      // 4位计数器的上限，足以区分冷热
+
+typedef struct {
+    uint8_t *table;            // SKETCH_DEPTH行，每行width个计数器
+    size_t width;              // 每行计数器数(2的幂)
+    size_t additions;          // 自上次衰减以来的增量次数
+    size_t sample_size;        // 达到该次数后所有计数器减半
+    unsigned long resets;      // 衰减次数
+} frequency_sketch_t;
+
+frequency_sketch_t *sketch_create(size_t width);
+void sketch_destroy(frequency_sketch_t *sketch);
+// hash为key的原始哈希值，内部再做混合
+void sketch_increment(frequency_sketch_t *sketch, unsigned int hash);
+unsigned int sketch_estimate(const frequency_sketch_t *sketch, unsigned int hash);
+
+#endif
@@ -0,0 +1,385 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sys/stat.h>
+#include "snapshot.h"
+#include "webserver.h"
+#include "logging.h"
+#include "dirwalk.h"
+
+#define EMPTY_SLOT UINT_MAX
+
+// 每个读者独占一个缓存行，读端只写自己的槽位
+typedef struct {
+    unsigned long epoch;       // 进入读端时的全局纪元，0表示不在读端
+    char pad[64 - sizeof(unsigned long)];
+} reader_slot_t;
+
+static reader_slot_t reader_slots[SNAPSHOT_MAX_READERS] __attribute__((aligned(64)));
+static unsigned int reader_count = 0;
+static __thread int reader_index = -1;  // -2表示槽位已用完
+static unsigned long global_epoch = 1;
+static snapshot_t *current_snapshot = NULL;
+static int snapshot_enabled = 0;
+
+static char *snapshot_root = NULL;
+static sem_t reload_sem;
+
+// 打包时收集的文件
+typedef struct {
+    char *path;
+    size_t size;
+} pending_file_t;
+
+typedef struct {
+    pending_file_t *files;
+    size_t count;
+    size_t capacity;
+    size_t total;              // 预计占用的缓冲区大小
+} file_list_t;
+
+// 带种子的FNV-1a，末尾再混合一次
+static unsigned int seeded_hash(const char *key, unsigned int seed) {
+    unsigned int h = 2166136261u ^ (seed * 0x9e3779b9u);
+    while (*key) {
+        h ^= (unsigned char)*key++;
+        h *= 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    return h;
+}
+
+static int add_file(file_list_t *list, const char *path, size_t size) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 64;
+        pending_file_t *files = realloc(list->files, capacity * sizeof(pending_file_t));
+        if (!files) return -1;
+        list->files = files;
+        list->capacity = capacity;
+    }
+    
+    list->files[list->count].path = strdup(path);
+    if (!list->files[list->count].path) return -1;
+    list->files[list->count].size = size;
+    list->count++;
+    list->total += strlen(path) + 1 + SNAPSHOT_HEADER_RESERVE + size;
+    return 0;
+}
+
+// 收集常规文件，超出快照上限的部分留给普通路径处理
+static void collect_file(const char *path, size_t size, void *arg) {
+    file_list_t *list = arg;
+    size_t need = strlen(path) + 1 + SNAPSHOT_HEADER_RESERVE + size;
+    if (list->total + need > SNAPSHOT_MAX_SIZE) return;
+    add_file(list, path, size);
+}
+
+static int read_full(int fd, char *buf, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = read(fd, buf + done, len - done);
+        if (n <= 0) return -1;
+        done += n;
+    }
+    return 0;
+}
+
+// 把文件内容和预构建的响应头追加到缓冲区，成功返回1
+static int pack_file(snapshot_t *snapshot, size_t *used, const pending_file_t *file,
+                     size_t root_len) {
+    int fd = open(file->path, O_RDONLY);
+    if (fd < 0) return 0;
+    
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size != file->size) {
+        close(fd);
+        return 0;
+    }
+    
+    snapshot_entry_t *entry = &snapshot->entries[snapshot->count];
+    char *base = snapshot->buffer;
+    size_t offset = *used;
+    
+    // key: 去掉文档根目录前缀，与请求路径规范化后的形式相同
+    const char *key = file->path + root_len;
+    entry->key_len = strlen(key);
+    memcpy(base + offset, key, entry->key_len + 1);
+    entry->key = base + offset;
+    offset += entry->key_len + 1;
+    
+    // 响应头前缀: Connection和Date在发送时补上
+    build_etag(&st, entry->etag, sizeof(entry->etag));
+    entry->mtime = st.st_mtime;
+    char last_modified[64];
+    format_http_date(st.st_mtime, last_modified, sizeof(last_modified));
+    int header_len = snprintf(base + offset, SNAPSHOT_HEADER_RESERVE,
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: %s\r\n"
+        "Content-Length: %zu\r\n"
+        "ETag: %s\r\n"
+        "Last-Modified: %s\r\n"
+        "Server: MyWebServer/1.0\r\n",
+        get_content_type(file->path), file->size, entry->etag, last_modified);
+    if (header_len < 0 || header_len >= SNAPSHOT_HEADER_RESERVE) {
+        close(fd);
+        return 0;
+    }
+    entry->header_offset = offset;
+    entry->header_len = header_len;
+    offset += header_len;
+    
+    // 文件内容
+    if (read_full(fd, base + offset, file->size) < 0) {
+        close(fd);
+        return 0;
+    }
+    close(fd);
+    entry->body_offset = offset;
+    entry->body_len = file->size;
+    offset += file->size;
+    
+    *used = offset;
+    snapshot->count++;
+    return 1;
+}
+
+static int compare_bucket_size(const void *a, const void *b, void *arg) {
+    const unsigned int *start = arg;
+    unsigned int ia = *(const unsigned int *)a;
+    unsigned int ib = *(const unsigned int *)b;
+    unsigned int sa = start[ia + 1] - start[ia];
+    unsigned int sb = start[ib + 1] - start[ib];
+    return sa < sb ? 1 : sa > sb ? -1 : 0;
+}
+
+// hash-and-displace: 先按第一个哈希分桶，从大桶开始为每个桶找一个让所有key落入空槽的位移
+static int build_perfect_hash(snapshot_t *snapshot) {
+    unsigned int n = snapshot->count;
+    unsigned int buckets = n / 4 + 1;
+    snapshot->bucket_count = buckets;
+    snapshot->slot_count = n + n / 4 + 1;
+    snapshot->displace = calloc(buckets, sizeof(unsigned int));
+    snapshot->slots = malloc(snapshot->slot_count * sizeof(unsigned int));
+    unsigned int *start = calloc(buckets + 1, sizeof(unsigned int));  // 每个桶在members中的起点
+    unsigned int *members = malloc((n + 1) * sizeof(unsigned int));
+    unsigned int *fill = malloc((buckets + 1) * sizeof(unsigned int));
+    unsigned int *order = malloc(buckets * sizeof(unsigned int));
+    unsigned int *trial = malloc((n + 1) * sizeof(unsigned int));
+    int ret = -1;
+    
+    if (!snapshot->displace || !snapshot->slots || !start || !members || !fill ||
+        !order || !trial) goto out;
+    
+    // 按桶分组
+    for (unsigned int i = 0; i < n; i++) {
+        start[seeded_hash(snapshot->entries[i].key, 0) % buckets + 1]++;
+    }
+    for (unsigned int b = 0; b < buckets; b++) start[b + 1] += start[b];
+    memcpy(fill, start, (buckets + 1) * sizeof(unsigned int));
+    for (unsigned int i = 0; i < n; i++) {
+        members[fill[seeded_hash(snapshot->entries[i].key, 0) % buckets]++] = i;
+    }
+    
+    for (unsigned int i = 0; i < snapshot->slot_count; i++) snapshot->slots[i] = EMPTY_SLOT;
+    for (unsigned int b = 0; b < buckets; b++) order[b] = b;
+    qsort_r(order, buckets, sizeof(unsigned int), compare_bucket_size, start);
+    
+    for (unsigned int o = 0; o < buckets; o++) {
+        unsigned int b = order[o];
+        unsigned int size = start[b + 1] - start[b];
+        if (size == 0) break;
+        
+        unsigned int d;
+        for (d = 1; d < SNAPSHOT_MAX_DISPLACE; d++) {
+            int ok = 1;
+            for (unsigned int k = 0; k < size && ok; k++) {
+                const char *key = snapshot->entries[members[start[b] + k]].key;
+                trial[k] = seeded_hash(key, d) % snapshot->slot_count;
+                if (snapshot->slots[trial[k]] != EMPTY_SLOT) ok = 0;
+                for (unsigned int j = 0; j < k && ok; j++) {
+                    if (trial[j] == trial[k]) ok = 0;
+                }
+            }
+            if (ok) break;
+        }
+        if (d == SNAPSHOT_MAX_DISPLACE) goto out;
+        
+        snapshot->displace[b] = d;
+        for (unsigned int k = 0; k < size; k++) {
+            snapshot->slots[trial[k]] = members[start[b] + k];
+        }
+    }
+    ret = 0;
+
+out:
+    free(start);
+    free(members);
+    free(fill);
+    free(order);
+    free(trial);
+    return ret;
+}
+
+static void snapshot_free(snapshot_t *snapshot) {
+    if (!snapshot) return;
+    free(snapshot->buffer);
+    free(snapshot->entries);
+    free(snapshot->displace);
+    free(snapshot->slots);
+    free(snapshot);
+}
+
+static snapshot_t *snapshot_build(const char *document_root) {
+    file_list_t list;
+    memset(&list, 0, sizeof(list));
+    dirwalk(document_root, collect_file, &list);
+    
+    snapshot_t *snapshot = calloc(1, sizeof(snapshot_t));
+    if (snapshot) {
+        snapshot->buffer = malloc(list.total ? list.total : 1);
+        snapshot->entries = malloc((list.count ? list.count : 1) * sizeof(snapshot_entry_t));
+    }
+    
+    if (snapshot && snapshot->buffer && snapshot->entries) {
+        size_t used = 0;
+        for (size_t i = 0; i < list.count; i++) {
+            pack_file(snapshot, &used, &list.files[i], strlen(document_root));
+        }
+        snapshot->buffer_size = used;
+        
+        // key指针指向缓冲区内部，缓冲区不再realloc
+        snapshot->refs = 1;
+        if (build_perfect_hash(snapshot) != 0) {
+            snapshot_free(snapshot);
+            snapshot = NULL;
+        }
+    } else {
+        snapshot_free(snapshot);
+        snapshot = NULL;
+    }
+    
+    for (size_t i = 0; i < list.count; i++) free(list.files[i].path);
+    free(list.files);
+    return snapshot;
+}
+
+const snapshot_entry_t *snapshot_lookup(const snapshot_t *snapshot, const char *key) {
+    if (!snapshot || snapshot->count == 0) return NULL;
+    
+    unsigned int b = seeded_hash(key, 0) % snapshot->bucket_count;
+    unsigned int slot = seeded_hash(key, snapshot->displace[b]) % snapshot->slot_count;
+    unsigned int index = snapshot->slots[slot];
+    if (index == EMPTY_SLOT) return NULL;
+    
+    // 完美哈希只对已知key无冲突，未知key需要确认
+    const snapshot_entry_t *entry = &snapshot->entries[index];
+    return strcmp(entry->key, key) == 0 ? entry : NULL;
+}
+
+const snapshot_t *snapshot_reader_enter(void) {
+    if (!__atomic_load_n(&snapshot_enabled, __ATOMIC_ACQUIRE)) return NULL;
+    
+    if (reader_index == -1) {
+        unsigned int index = __atomic_fetch_add(&reader_count, 1, __ATOMIC_RELAXED);
+        reader_index = index < SNAPSHOT_MAX_READERS ? (int)index : -2;
+    }
+    if (reader_index < 0) return NULL;
+    
+    // 先公布所处纪元，再读取指针(顺序一致)，保证写端在回收前能看到本读者
+    unsigned long epoch = __atomic_load_n(&global_epoch, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&reader_slots[reader_index].epoch, epoch, __ATOMIC_SEQ_CST);
+    return __atomic_load_n(&current_snapshot, __ATOMIC_SEQ_CST);
+}
+
+void snapshot_reader_exit(void) {
+    if (reader_index < 0) return;
+    __atomic_store_n(&reader_slots[reader_index].epoch, 0, __ATOMIC_RELEASE);
+}
+
+void snapshot_retain(const snapshot_t *snapshot) {
+    __atomic_add_fetch(&((snapshot_t *)snapshot)->refs, 1, __ATOMIC_RELAXED);
+}
+
+void snapshot_release(const snapshot_t *snapshot) {
+    if (__atomic_sub_fetch(&((snapshot_t *)snapshot)->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        snapshot_free((snapshot_t *)snapshot);
+    }
+}
+
+// 发布新快照，等待所有在旧纪元进入的读者离开后释放旧快照(仍有响应体引用时由最后一个引用回收)
+static void snapshot_publish(snapshot_t *snapshot) {
+    snapshot_t *old = __atomic_exchange_n(&current_snapshot, snapshot, __ATOMIC_SEQ_CST);
+    unsigned long epoch = __atomic_add_fetch(&global_epoch, 1, __ATOMIC_SEQ_CST);
+    if (!old) return;
+    
+    unsigned int readers = __atomic_load_n(&reader_count, __ATOMIC_RELAXED);
+    if (readers > SNAPSHOT_MAX_READERS) readers = SNAPSHOT_MAX_READERS;
+    for (unsigned int i = 0; i < readers; i++) {
+        for (;;) {
+            unsigned long seen = __atomic_load_n(&reader_slots[i].epoch, __ATOMIC_SEQ_CST);
+            if (seen == 0 || seen >= epoch) break;
+            usleep(1000);
+        }
+    }
+    snapshot_release(old);
+}
+
+static void *reload_thread(void *arg) {
+    (void)arg;
+    
+    for (;;) {
+        if (sem_wait(&reload_sem) != 0) continue;
+        // 合并连续的重载请求
+        while (sem_trywait(&reload_sem) == 0) {
+        }
+        
+        snapshot_t *snapshot = snapshot_build(snapshot_root);
+        if (!snapshot) {
+            log_message(LOG_ERROR, "快照重建失败，继续使用旧快照");
+            continue;
+        }
+        
+        unsigned int count = snapshot->count;
+        size_t size = snapshot->buffer_size;
+        snapshot_publish(snapshot);
+        log_message(LOG_INFO, "快照已重建: %u个文件, %zu字节", count, size);
+        printf("快照已重建: %u个文件, %zuKB\n", count, size / 1024);
+    }
+    return NULL;
+}
+
+int snapshot_enable(const char *document_root) {
+    snapshot_root = strdup(document_root);
+    if (!snapshot_root) return -1;
+    
+    snapshot_t *snapshot = snapshot_build(document_root);
+    if (!snapshot) return -1;
+    
+    if (sem_init(&reload_sem, 0, 0) != 0) {
+        snapshot_free(snapshot);
+        return -1;
+    }
+    
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, reload_thread, NULL) != 0) {
+        snapshot_free(snapshot);
+        return -1;
+    }
+    pthread_detach(thread);
+    
+    printf("快照已加载: %u个文件, %zuKB\n", snapshot->count, snapshot->buffer_size / 1024);
+    snapshot_publish(snapshot);
+    __atomic_store_n(&snapshot_enabled, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void snapshot_request_reload(void) {
+    if (__atomic_load_n(&snapshot_enabled, __ATOMIC_ACQUIRE)) sem_post(&reload_sem);
+}
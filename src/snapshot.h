@@ -0,0 +1,48 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include <time.h>
+#include "config.h"
+
+// 只读快照中的一个文件: 响应头前缀和内容都在同一块连续缓冲区中
+typedef struct {
+    const char *key;           // 与缓存相同的key(相对文档根目录的路径)
+    size_t key_len;
+    size_t header_offset;      // 预构建的响应头(不含Connection/Date和结束空行)
+    size_t header_len;
+    size_t body_offset;
+    size_t body_len;
+    time_t mtime;
+    char etag[64];
+} snapshot_entry_t;
+
+// 文档根目录的不可变快照，用hash-and-displace完美哈希索引
+typedef struct snapshot {
+    char *buffer;              // 所有key、响应头和文件内容
+    size_t buffer_size;
+    snapshot_entry_t *entries;
+    unsigned int count;
+    unsigned int *displace;    // 每个桶的位移种子
+    unsigned int bucket_count;
+    unsigned int *slots;       // 槽位 -> entries下标
+    unsigned int slot_count;
+    int refs;                  // 作为当前快照占一个引用，带出读者区间的响应体各占一个
+} snapshot_t;
+
+// 打包document_root并发布为当前快照，同时启动SIGHUP重载线程
+int snapshot_enable(const char *document_root);
+// 请求重新打包(只调用sem_post，可在信号处理函数中使用)
+void snapshot_request_reload(void);
+
+// 读端: enter与exit之间可以使用返回的快照，不加锁也不写共享数据
+// 未启用快照或读者槽位用完时返回NULL，此时无需调用exit
+const snapshot_t *snapshot_reader_enter(void);
+void snapshot_reader_exit(void);
+const snapshot_entry_t *snapshot_lookup(const snapshot_t *snapshot, const char *key);
+// 响应体要在读者区间之外继续使用时(HTTP/2流分多次发送)，在区间内取得引用
+// 快照被替换后由最后一个release回收
+void snapshot_retain(const snapshot_t *snapshot);
+void snapshot_release(const snapshot_t *snapshot);
+
+#endif
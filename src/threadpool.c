@@ -2,8 +2,30 @@
 #include <stdlib.h>
 #include <pthread.h>
 #include "threadpool.h"
+#include "timer_wheel.h"
 #include "config.h"
 
+// CoDel式排队时间控制: 队列在interval内始终未清空说明处于过载，
+// 此时排队超过target的任务直接丢弃；正常情况下允许排队到interval
+static int should_shed(threadpool_t *pool, task_t *task, uint64_t now) {
+    if (pool->target_ms == 0 || !task->reject) return 0;
+    
+    uint64_t sojourn = now - task->enqueue_ms;
+    int overloaded = now - pool->last_empty_ms > pool->interval_ms;
+    return sojourn > (overloaded ? pool->target_ms : pool->interval_ms);
+}
+
+// 缩容时当前线程是否应退出(调用者持有锁)
+static int should_retire(threadpool_t *pool) {
+    if (pool->thread_target >= pool->thread_count) return 0;
+    
+    pthread_t self = pthread_self();
+    for (int i = pool->thread_target; i < pool->thread_count; i++) {
+        if (pthread_equal(pool->threads[i], self)) return 1;
+    }
+    return 0;
+}
+
 static void *worker_thread(void *arg) {
     threadpool_t *pool = (threadpool_t *)arg;
     
@@ -11,30 +33,42 @@ static void *worker_thread(void *arg) {
         pthread_mutex_lock(&pool->lock);
         
         // 等待任务或关闭信号
-        while (pool->queue_size == 0 && !pool->shutdown) {
+        while (pool->queue_size == 0 && !pool->shutdown && !should_retire(pool)) {
             pthread_cond_wait(&pool->cond, &pool->lock);
         }
         
-        if (pool->shutdown) {
+        if (pool->shutdown || should_retire(pool)) {
+            // 退出的线程可能消耗了入队时的唤醒，转交给其他线程
+            if (pool->queue_size > 0) pthread_cond_signal(&pool->cond);
             pthread_mutex_unlock(&pool->lock);
             pthread_exit(NULL);
         }
         
         // 获取任务
         task_t *task = pool->queue_head;
+        int shed = 0;
         if (task) {
             pool->queue_head = task->next;
             if (!pool->queue_head) {
                 pool->queue_tail = NULL;
             }
             pool->queue_size--;
+            
+            uint64_t now = pool->target_ms ? timer_now_ms() : 0;
+            shed = should_shed(pool, task, now);
+            if (shed) pool->shed_count++;
+            if (pool->queue_size == 0) pool->last_empty_ms = now;
         }
         
         pthread_mutex_unlock(&pool->lock);
         
         if (task) {
-            // 执行任务
-            task->function(task->arg);
+            // 执行任务，排队过久的任务走拒绝路径
+            if (shed) {
+                task->reject(task->arg);
+            } else {
+                task->function(task->arg);
+            }
             free(task);
         }
     }
@@ -43,6 +77,10 @@ static void *worker_thread(void *arg) {
 }
 
 threadpool_t *threadpool_create(int thread_count) {
+    return threadpool_create_bounded(thread_count, 0);
+}
+
+threadpool_t *threadpool_create_bounded(int thread_count, int max_queue) {
     if (thread_count <= 0 || thread_count > MAX_THREADS) {
         thread_count = 4;
     }
@@ -60,6 +98,12 @@ threadpool_t *threadpool_create(int thread_count) {
     pool->queue_size = 0;
     pool->shutdown = 0;
     pool->thread_count = thread_count;
+    pool->thread_target = thread_count;
+    pool->max_queue = max_queue;
+    pool->target_ms = 0;
+    pool->interval_ms = 0;
+    pool->last_empty_ms = timer_now_ms();
+    pool->shed_count = 0;
     
     pthread_mutex_init(&pool->lock, NULL);
     pthread_cond_init(&pool->cond, NULL);
@@ -78,23 +122,35 @@ threadpool_t *threadpool_create(int thread_count) {
 }
 
 int threadpool_add_task(threadpool_t *pool, void (*function)(void *), void *arg) {
+    return threadpool_add_task_sheddable(pool, function, NULL, arg);
+}
+
+int threadpool_add_task_sheddable(threadpool_t *pool, void (*function)(void *),
+                                  void (*reject)(void *), void *arg) {
     if (!pool || !function) return -1;
     
     task_t *task = malloc(sizeof(task_t));
     if (!task) return -1;
     
     task->function = function;
+    task->reject = reject;
     task->arg = arg;
+    task->enqueue_ms = reject ? timer_now_ms() : 0;
     task->next = NULL;
     
     pthread_mutex_lock(&pool->lock);
     
-    if (pool->shutdown) {
+    if (pool->shutdown || (pool->max_queue > 0 && pool->queue_size >= pool->max_queue)) {
         pthread_mutex_unlock(&pool->lock);
         free(task);
         return -1;
     }
     
+    // 队列此前为空，过载判断从此刻重新计时
+    if (pool->queue_size == 0 && task->enqueue_ms) {
+        pool->last_empty_ms = task->enqueue_ms;
+    }
+    
     // 添加到队列尾部
     if (pool->queue_tail) {
         pool->queue_tail->next = task;
@@ -111,6 +167,60 @@ int threadpool_add_task(threadpool_t *pool, void (*function)(void *), void *arg)
     return 0;
 }
 
+void threadpool_set_shedding(threadpool_t *pool, unsigned int target_ms, unsigned int interval_ms) {
+    if (!pool) return;
+    
+    pthread_mutex_lock(&pool->lock);
+    pool->target_ms = target_ms;
+    pool->interval_ms = interval_ms > target_ms ? interval_ms : target_ms;
+    pool->last_empty_ms = timer_now_ms();
+    pthread_mutex_unlock(&pool->lock);
+}
+
+int threadpool_resize(threadpool_t *pool, int thread_count) {
+    if (!pool || thread_count <= 0 || thread_count > MAX_THREADS) return -1;
+    
+    pthread_mutex_lock(&pool->lock);
+    if (pool->shutdown) {
+        pthread_mutex_unlock(&pool->lock);
+        return -1;
+    }
+    
+    int old_count = pool->thread_count;
+    if (thread_count > old_count) {
+        pthread_t *threads = realloc(pool->threads, sizeof(pthread_t) * thread_count);
+        if (!threads) {
+            pthread_mutex_unlock(&pool->lock);
+            return -1;
+        }
+        pool->threads = threads;
+        
+        // 持有锁创建，新线程查询自己的下标时数组已写好
+        int created = old_count;
+        while (created < thread_count &&
+               pthread_create(&pool->threads[created], NULL, worker_thread, pool) == 0) {
+            created++;
+        }
+        pool->thread_count = pool->thread_target = created;
+        pthread_mutex_unlock(&pool->lock);
+        return created == thread_count ? 0 : -1;
+    }
+    
+    // 缩容: 多余线程在队列空闲或完成当前任务后自行退出
+    pool->thread_target = thread_count;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->lock);
+    
+    for (int i = thread_count; i < old_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    
+    pthread_mutex_lock(&pool->lock);
+    pool->thread_count = thread_count;
+    pthread_mutex_unlock(&pool->lock);
+    return 0;
+}
+
 void threadpool_destroy(threadpool_t *pool) {
     if (!pool) return;
     
@@ -5,6 +5,7 @@
 #include <semaphore.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 #include "config.h"  // 包含配置头文件
 
 // 使用config.h中的定义，不再重复定义
@@ -14,7 +15,9 @@
 // 任务结构
 typedef struct task {
     void (*function)(void *arg);
+    void (*reject)(void *arg);  // 过载丢弃时代替function调用(为NULL则不可丢弃)
     void *arg;
+    uint64_t enqueue_ms;        // 入队时间(单调时钟)
     struct task *next;
 } task_t;
 
@@ -27,12 +30,24 @@ typedef struct threadpool {
     pthread_cond_t cond;        // 条件变量
     int shutdown;               // 关闭标志
     int thread_count;           // 线程数量
+    int thread_target;          // 缩容目标，下标不小于它的线程处理完当前任务后退出
     int queue_size;             // 队列大小
+    int max_queue;              // 队列上限(0表示不限制)
+    unsigned int target_ms;     // 过载时允许的排队时间(0表示不丢弃)
+    unsigned int interval_ms;   // 队列持续非空超过该时间即视为过载
+    uint64_t last_empty_ms;     // 队列最近一次为空的时间
+    unsigned long shed_count;   // 因排队超时被丢弃的任务数
 } threadpool_t;
 
 // 函数声明
 threadpool_t *threadpool_create(int thread_count);
+threadpool_t *threadpool_create_bounded(int thread_count, int max_queue);
 int threadpool_add_task(threadpool_t *pool, void (*function)(void *), void *arg);
+int threadpool_add_task_sheddable(threadpool_t *pool, void (*function)(void *),
+                                  void (*reject)(void *), void *arg);
+void threadpool_set_shedding(threadpool_t *pool, unsigned int target_ms, unsigned int interval_ms);
+// 运行中调整线程数(1..MAX_THREADS)，缩容时等待多余线程完成手上的任务；调用者需串行调用
+int threadpool_resize(threadpool_t *pool, int thread_count);
 void threadpool_destroy(threadpool_t *pool);
 
 #endif
\ No newline at end of file
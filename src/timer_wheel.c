@@ -0,0 +1,147 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "timer_wheel.h"
+
+uint64_t timer_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void list_init(timer_node_t *head) {
+    head->prev = head->next = head;
+}
+
+static void list_append(timer_node_t *head, timer_node_t *node) {
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+static void list_unlink(timer_node_t *node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->prev = node->next = NULL;
+}
+
+// 根据到期tick放入对应层级的格子
+static void place(timer_wheel_t *wheel, timer_node_t *node) {
+    uint64_t expire = node->expire_tick;
+    if (expire <= wheel->current_tick) expire = wheel->current_tick + 1;
+    uint64_t delta = expire - wheel->current_tick;
+    
+    if (delta < TW_L0_SIZE) {
+        list_append(&wheel->l0[expire & (TW_L0_SIZE - 1)], node);
+    } else {
+        // 超出第二级范围的定时器放在最远的格子，级联时重新计算位置
+        uint64_t max_delta = (uint64_t)TW_L0_SIZE * (TW_L1_SIZE - 1);
+        if (delta > max_delta) expire = wheel->current_tick + max_delta;
+        list_append(&wheel->l1[(expire >> TW_L0_BITS) & (TW_L1_SIZE - 1)], node);
+    }
+}
+
+timer_wheel_t *timer_wheel_create(unsigned int tick_ms) {
+    timer_wheel_t *wheel = malloc(sizeof(timer_wheel_t));
+    if (!wheel) return NULL;
+    
+    for (int i = 0; i < TW_L0_SIZE; i++) list_init(&wheel->l0[i]);
+    for (int i = 0; i < TW_L1_SIZE; i++) list_init(&wheel->l1[i]);
+    wheel->tick_ms = tick_ms > 0 ? tick_ms : 1;
+    wheel->current_tick = timer_now_ms() / wheel->tick_ms;
+    wheel->count = 0;
+    return wheel;
+}
+
+void timer_wheel_destroy(timer_wheel_t *wheel) {
+    free(wheel);
+}
+
+void timer_wheel_add(timer_wheel_t *wheel, timer_node_t *node, uint64_t expire_ms) {
+    if (node->active) timer_wheel_del(wheel, node);
+    
+    // 向上取整，保证不会提前到期
+    node->expire_tick = (expire_ms + wheel->tick_ms - 1) / wheel->tick_ms;
+    node->active = 1;
+    place(wheel, node);
+    wheel->count++;
+}
+
+void timer_wheel_del(timer_wheel_t *wheel, timer_node_t *node) {
+    if (!node->active) return;
+    list_unlink(node);
+    node->active = 0;
+    wheel->count--;
+}
+
+// 把第二级一个格子的定时器重新分配到第一级
+static void cascade(timer_wheel_t *wheel, uint64_t tick) {
+    timer_node_t *head = &wheel->l1[(tick >> TW_L0_BITS) & (TW_L1_SIZE - 1)];
+    timer_node_t pending;
+    list_init(&pending);
+    
+    // 先整体摘下，避免重新放回同一格时死循环
+    if (head->next != head) {
+        pending.next = head->next;
+        pending.prev = head->prev;
+        pending.next->prev = &pending;
+        pending.prev->next = &pending;
+        list_init(head);
+    }
+    
+    while (pending.next != &pending) {
+        timer_node_t *node = pending.next;
+        list_unlink(node);
+        place(wheel, node);
+    }
+}
+
+void timer_wheel_advance(timer_wheel_t *wheel, uint64_t now_ms, timer_callback_t callback, void *arg) {
+    uint64_t now_tick = now_ms / wheel->tick_ms;
+    
+    if (wheel->count == 0) {
+        if (now_tick > wheel->current_tick) wheel->current_tick = now_tick;
+        return;
+    }
+    
+    while (wheel->current_tick < now_tick) {
+        uint64_t tick = ++wheel->current_tick;
+        if ((tick & (TW_L0_SIZE - 1)) == 0) cascade(wheel, tick);
+        
+        timer_node_t *head = &wheel->l0[tick & (TW_L0_SIZE - 1)];
+        while (head->next != head) {
+            timer_node_t *node = head->next;
+            list_unlink(node);
+            node->active = 0;
+            wheel->count--;
+            callback(node, arg);
+        }
+        
+        if (wheel->count == 0) {
+            wheel->current_tick = now_tick;
+            break;
+        }
+    }
+}
+
+int timer_wheel_next_timeout(timer_wheel_t *wheel, uint64_t now_ms) {
+    if (wheel->count == 0) return -1;
+    
+    uint64_t next_tick = 0;
+    for (uint64_t tick = wheel->current_tick + 1; tick <= wheel->current_tick + TW_L0_SIZE; tick++) {
+        // 跨过第一级边界时需要先级联
+        if ((tick & (TW_L0_SIZE - 1)) == 0) {
+            next_tick = tick;
+            break;
+        }
+        timer_node_t *head = &wheel->l0[tick & (TW_L0_SIZE - 1)];
+        if (head->next != head) {
+            next_tick = tick;
+            break;
+        }
+    }
+    
+    uint64_t next_ms = next_tick * wheel->tick_ms;
+    return next_ms > now_ms ? (int)(next_ms - now_ms) : 0;
+}
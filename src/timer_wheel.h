@@ -0,0 +1,43 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+
+// 两级分层时间轮: 第一级每格一个tick，第二级每格覆盖整个第一级
+#define TW_L0_BITS 8
+#define TW_L1_BITS 6
+#define TW_L0_SIZE (1 << TW_L0_BITS)
+#define TW_L1_SIZE (1 << TW_L1_BITS)
+
+// 定时器节点，嵌入到连接等结构中使用
+typedef struct timer_node {
+    struct timer_node *prev;
+    struct timer_node *next;
+    uint64_t expire_tick;      // 到期tick(绝对值)
+    int active;                // 是否在时间轮中
+    void *data;                // 回调使用的私有数据
+} timer_node_t;
+
+typedef struct {
+    timer_node_t l0[TW_L0_SIZE]; // 各格链表哨兵
+    timer_node_t l1[TW_L1_SIZE];
+    uint64_t current_tick;     // 已处理到的tick
+    unsigned int tick_ms;      // 每个tick的毫秒数
+    unsigned int count;        // 活动定时器数量
+} timer_wheel_t;
+
+typedef void (*timer_callback_t)(timer_node_t *node, void *arg);
+
+// 单调时钟毫秒数
+uint64_t timer_now_ms(void);
+
+timer_wheel_t *timer_wheel_create(unsigned int tick_ms);
+void timer_wheel_destroy(timer_wheel_t *wheel);
+void timer_wheel_add(timer_wheel_t *wheel, timer_node_t *node, uint64_t expire_ms);
+void timer_wheel_del(timer_wheel_t *wheel, timer_node_t *node);
+// 推进到now_ms并对到期的定时器调用callback(节点已从时间轮移除)
+void timer_wheel_advance(timer_wheel_t *wheel, uint64_t now_ms, timer_callback_t callback, void *arg);
+// 距离下一个可能到期的tick的毫秒数，无定时器时返回-1，可直接用作epoll_wait超时
+int timer_wheel_next_timeout(timer_wheel_t *wheel, uint64_t now_ms);
+
+#endif
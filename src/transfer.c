@@ -0,0 +1,98 @@
+#include <string.h>
+#include "transfer.h"
+
+// 所有线程共享，字段各自原子更新；EWMA并发更新偶尔丢失一次采样不影响选择
+static struct {
+    uint64_t count[TRANSFER_STRATEGY_COUNT];
+    uint64_t bytes[TRANSFER_STRATEGY_COUNT];
+    uint64_t cost[TRANSFER_SIZE_CLASSES][TRANSFER_STRATEGY_COUNT];
+    uint64_t samples[TRANSFER_SIZE_CLASSES][TRANSFER_STRATEGY_COUNT];
+    uint64_t decisions[TRANSFER_SIZE_CLASSES];
+} transfer;
+
+static const char *strategy_names[TRANSFER_STRATEGY_COUNT] = {
+    "writev", "sendfile", "splice", "mmap"
+};
+
+const char *transfer_strategy_name(transfer_strategy_t strategy) {
+    return strategy < TRANSFER_STRATEGY_COUNT ? strategy_names[strategy] : "unknown";
+}
+
+// 从TRANSFER_MIN_CLASS开始每级乘4
+static int size_class(size_t size) {
+    size_t limit = TRANSFER_MIN_CLASS;
+    int size_class = 0;
+    while (size_class < TRANSFER_SIZE_CLASSES - 1 && size >= limit) {
+        limit *= 4;
+        size_class++;
+    }
+    return size_class;
+}
+
+size_t transfer_class_limit(int size_class) {
+    if (size_class >= TRANSFER_SIZE_CLASSES - 1) return 0;
+    return (size_t)TRANSFER_MIN_CLASS << (2 * size_class);
+}
+
+transfer_strategy_t transfer_choose(unsigned int candidates, size_t size) {
+    int c = size_class(size);
+    transfer_strategy_t best = TRANSFER_STRATEGY_COUNT;
+    uint64_t best_cost = UINT64_MAX;
+    int count = 0;
+    
+    for (int s = 0; s < TRANSFER_STRATEGY_COUNT; s++) {
+        if (!(candidates & TRANSFER_CAN(s))) continue;
+        count++;
+        // 每种方式先采样几次，再按开销比较
+        if (__atomic_load_n(&transfer.samples[c][s], __ATOMIC_RELAXED) < TRANSFER_WARMUP) {
+            return (transfer_strategy_t)s;
+        }
+        uint64_t cost = __atomic_load_n(&transfer.cost[c][s], __ATOMIC_RELAXED);
+        if (cost < best_cost) {
+            best_cost = cost;
+            best = (transfer_strategy_t)s;
+        }
+    }
+    
+    // 定期轮流试一次其他方式，页缓存状态或负载变化后开销排序可能改变
+    uint64_t n = __atomic_add_fetch(&transfer.decisions[c], 1, __ATOMIC_RELAXED);
+    if (count > 1 && n % TRANSFER_EXPLORE_INTERVAL == 0) {
+        int pick = (int)(n / TRANSFER_EXPLORE_INTERVAL % (count - 1));
+        for (int s = 0; s < TRANSFER_STRATEGY_COUNT; s++) {
+            if (!(candidates & TRANSFER_CAN(s)) || (transfer_strategy_t)s == best) continue;
+            if (pick-- == 0) return (transfer_strategy_t)s;
+        }
+    }
+    return best;
+}
+
+void transfer_record(transfer_strategy_t strategy, size_t size, uint64_t cpu_ns) {
+    if (strategy >= TRANSFER_STRATEGY_COUNT || size == 0) return;
+    int c = size_class(size);
+    uint64_t sample = cpu_ns * 1000 / size;
+    
+    __atomic_add_fetch(&transfer.count[strategy], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&transfer.bytes[strategy], size, __ATOMIC_RELAXED);
+    uint64_t samples = __atomic_add_fetch(&transfer.samples[c][strategy], 1, __ATOMIC_RELAXED);
+    
+    // 前几次采样取算术平均(首次访问的缺页等一次性开销不会长期压低某种方式)，之后按EWMA
+    uint64_t cost = __atomic_load_n(&transfer.cost[c][strategy], __ATOMIC_RELAXED);
+    uint64_t weight = samples < (1u << TRANSFER_EWMA_SHIFT) ? samples : (1u << TRANSFER_EWMA_SHIFT);
+    if (sample >= cost) {
+        cost += (sample - cost) / weight;
+    } else {
+        cost -= (cost - sample) / weight;
+    }
+    __atomic_store_n(&transfer.cost[c][strategy], cost, __ATOMIC_RELAXED);
+}
+
+void transfer_get_stats(transfer_stats_t *stats) {
+    for (int s = 0; s < TRANSFER_STRATEGY_COUNT; s++) {
+        stats->count[s] = __atomic_load_n(&transfer.count[s], __ATOMIC_RELAXED);
+        stats->bytes[s] = __atomic_load_n(&transfer.bytes[s], __ATOMIC_RELAXED);
+        for (int c = 0; c < TRANSFER_SIZE_CLASSES; c++) {
+            stats->cost[c][s] = __atomic_load_n(&transfer.cost[c][s], __ATOMIC_RELAXED);
+            stats->samples[c][s] = __atomic_load_n(&transfer.samples[c][s], __ATOMIC_RELAXED);
+        }
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef TRANSFER_H
+#define TRANSFER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+
+// 传输策略: 按对象大小分类，测量各发送方式每字节的CPU开销(EWMA)，自动选用最便宜的
+// 调用者按数据所在位置给出可用的方式，发送成功后把耗时记回来
+typedef enum {
+    TRANSFER_WRITEV,           // 堆缓冲区中的数据，响应头和响应体一次writev
+    TRANSFER_SENDFILE,         // 从文件fd sendfile
+    TRANSFER_SPLICE,           // 文件 -> 管道 -> socket
+    TRANSFER_MMAP,             // 从文件映射writev(已有映射或临时映射)
+    TRANSFER_STRATEGY_COUNT
+} transfer_strategy_t;
+
+#define TRANSFER_CAN(strategy) (1u << (strategy))
+
+typedef struct {
+    uint64_t count[TRANSFER_STRATEGY_COUNT];
+    uint64_t bytes[TRANSFER_STRATEGY_COUNT];
+    // 每个大小分类中各方式的开销(皮秒/字节)和采样次数，采样为0表示没有测过
+    uint64_t cost[TRANSFER_SIZE_CLASSES][TRANSFER_STRATEGY_COUNT];
+    uint64_t samples[TRANSFER_SIZE_CLASSES][TRANSFER_STRATEGY_COUNT];
+} transfer_stats_t;
+
+const char *transfer_strategy_name(transfer_strategy_t strategy);
+// 大小分类的上界(字节)，最后一类返回0表示不限
+size_t transfer_class_limit(int size_class);
+// 从candidates(TRANSFER_CAN位掩码，不能为0)中选择发送方式(线程安全)
+transfer_strategy_t transfer_choose(unsigned int candidates, size_t size);
+// 记录一次成功发送的CPU耗时(纳秒)
+void transfer_record(transfer_strategy_t strategy, size_t size, uint64_t cpu_ns);
+void transfer_get_stats(transfer_stats_t *stats);
+
+#endif
@@ -0,0 +1,805 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+#include "uring_handler.h"
+#include "webserver.h"
+#include "threadpool.h"
+#include "cache.h"
+#include "logging.h"
+#include "timer_wheel.h"
+
+// user_data低2位作为类型标记，发送操作直接存放(至少8字节对齐的)上下文指针
+#define UD_TAG_MASK   3ULL
+#define UD_SEND       0ULL
+#define UD_ACCEPT     1ULL
+#define UD_CLOSE      2ULL
+#define UD_RECV       3ULL
+#define UD_FD(ud)     ((int)((ud) >> 2))
+#define UD_MAKE(fd, tag) (((unsigned long long)(fd) << 2) | (tag))
+#define UD_PROXY      UD_MAKE(-2, UD_CLOSE) // 代理事件fd上的poll(借用不会出现的负fd)
+#define UD_WAKE       UD_MAKE(-3, UD_CLOSE) // 唤醒eventfd上的poll
+
+#define URING_BUFFER_GROUP 0       // 提供缓冲区组ID
+#define URING_SERVER_FILE_INDEX 0  // 监听socket在注册文件表中的下标
+#define URING_UNIX_FILE_INDEX 1    // Unix域监听socket的下标
+#define REARM_PROXY (1u << 2)      // rearm中代理poll的位(低位按监听socket下标)
+#define REARM_WAKE  (1u << 3)      // rearm中唤醒poll的位
+
+// 缓存命中时的发送上下文：响应头和缓存数据通过一次sendmsg发出
+typedef struct {
+    int client_fd;
+    int keep_alive;            // 发送完成后重新提交recv(否则已链接close)
+    size_t total;              // 响应的总字节数，保持连接时必须完整发出
+    cache_item_t *item;        // 发送完成前持有的缓存引用
+    struct msghdr msg;
+    struct iovec iov[2];
+    char header[1024];
+} uring_send_t;
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+// sig非NULL时等待期间临时换成该屏蔽字(内核sigset大小为_NSIG/8)
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags,
+                              const sigset_t *sig) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, sig,
+                        sig ? _NSIG / 8 : 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+// 映射提交队列、完成队列和SQE数组
+static int queue_map(uring_handler_t *handler, struct io_uring_params *p) {
+    uring_queue_t *q = &handler->queue;
+    
+    q->sq_ring_size = p->sq_off.array + p->sq_entries * sizeof(unsigned);
+    q->cq_ring_size = p->cq_off.cqes + p->cq_entries * sizeof(struct io_uring_cqe);
+    if (p->features & IORING_FEAT_SINGLE_MMAP) {
+        if (q->cq_ring_size > q->sq_ring_size) q->sq_ring_size = q->cq_ring_size;
+        q->cq_ring_size = q->sq_ring_size;
+    }
+    
+    q->sq_ring_ptr = mmap(NULL, q->sq_ring_size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, handler->ring_fd, IORING_OFF_SQ_RING);
+    if (q->sq_ring_ptr == MAP_FAILED) return -1;
+    
+    if (p->features & IORING_FEAT_SINGLE_MMAP) {
+        q->cq_ring_ptr = q->sq_ring_ptr;
+    } else {
+        q->cq_ring_ptr = mmap(NULL, q->cq_ring_size, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_POPULATE, handler->ring_fd, IORING_OFF_CQ_RING);
+        if (q->cq_ring_ptr == MAP_FAILED) {
+            munmap(q->sq_ring_ptr, q->sq_ring_size);
+            return -1;
+        }
+    }
+    
+    q->sqes_size = p->sq_entries * sizeof(struct io_uring_sqe);
+    q->sqes = mmap(NULL, q->sqes_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, handler->ring_fd, IORING_OFF_SQES);
+    if (q->sqes == MAP_FAILED) {
+        if (q->cq_ring_ptr != q->sq_ring_ptr) munmap(q->cq_ring_ptr, q->cq_ring_size);
+        munmap(q->sq_ring_ptr, q->sq_ring_size);
+        return -1;
+    }
+    
+    char *sq = q->sq_ring_ptr;
+    char *cq = q->cq_ring_ptr;
+    q->sq_head = (unsigned *)(sq + p->sq_off.head);
+    q->sq_tail = (unsigned *)(sq + p->sq_off.tail);
+    q->sq_mask = (unsigned *)(sq + p->sq_off.ring_mask);
+    q->sq_array = (unsigned *)(sq + p->sq_off.array);
+    q->cq_head = (unsigned *)(cq + p->cq_off.head);
+    q->cq_tail = (unsigned *)(cq + p->cq_off.tail);
+    q->cq_mask = (unsigned *)(cq + p->cq_off.ring_mask);
+    q->cqes = (struct io_uring_cqe *)(cq + p->cq_off.cqes);
+    q->sq_pending = 0;
+    return 0;
+}
+
+static void queue_unmap(uring_queue_t *q) {
+    if (q->sqes && q->sqes != MAP_FAILED) munmap(q->sqes, q->sqes_size);
+    if (q->cq_ring_ptr && q->cq_ring_ptr != q->sq_ring_ptr) munmap(q->cq_ring_ptr, q->cq_ring_size);
+    if (q->sq_ring_ptr) munmap(q->sq_ring_ptr, q->sq_ring_size);
+}
+
+// 提交所有待处理SQE，wait_nr>0时同时等待完成事件
+static int queue_submit(uring_handler_t *handler, unsigned wait_nr) {
+    uring_queue_t *q = &handler->queue;
+    unsigned to_submit = q->sq_pending;
+    int ret;
+    
+    q->sq_pending = 0;
+    ret = sys_io_uring_enter(handler->ring_fd, to_submit, wait_nr,
+                             wait_nr ? IORING_ENTER_GETEVENTS : 0,
+                             wait_nr ? server_wait_sigmask() : NULL);
+    // 等待被控制信号打断时SQE可能还没有提交: 只补交不再等待，让调用方先处理信号
+    while (ret < 0 && errno == EINTR && to_submit > 0) {
+        ret = sys_io_uring_enter(handler->ring_fd, to_submit, 0, 0, NULL);
+    }
+    return ret;
+}
+
+// 确保提交队列至少有n个空位，不足时先提交已有SQE
+static int reserve_sqes(uring_handler_t *handler, unsigned n) {
+    uring_queue_t *q = &handler->queue;
+    unsigned tail = *q->sq_tail;
+    unsigned head = __atomic_load_n(q->sq_head, __ATOMIC_ACQUIRE);
+    
+    if (tail - head + n > *q->sq_mask + 1) {
+        queue_submit(handler, 0);
+        head = __atomic_load_n(q->sq_head, __ATOMIC_ACQUIRE);
+        if (tail - head + n > *q->sq_mask + 1) return -1;
+    }
+    return 0;
+}
+
+// 获取一个空闲SQE(未使用SQPOLL，内核只在io_uring_enter时读取，提前推进tail是安全的)
+static struct io_uring_sqe *get_sqe(uring_handler_t *handler) {
+    uring_queue_t *q = &handler->queue;
+    if (reserve_sqes(handler, 1) < 0) return NULL;
+    
+    unsigned tail = *q->sq_tail;
+    
+    unsigned idx = tail & *q->sq_mask;
+    struct io_uring_sqe *sqe = &q->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    q->sq_array[idx] = idx;
+    __atomic_store_n(q->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    q->sq_pending++;
+    return sqe;
+}
+
+// 把缓冲区归还给提供缓冲区环
+static void recycle_buffer(uring_handler_t *handler, unsigned short bid) {
+    unsigned mask = URING_BUFFER_COUNT - 1;
+    struct io_uring_buf *buf = &handler->buf_ring->bufs[handler->buf_tail & mask];
+    
+    buf->addr = (unsigned long)(handler->buffers + (size_t)bid * BUFFER_SIZE);
+    buf->len = BUFFER_SIZE - 1;  // 保留一个字节存放字符串结束符
+    buf->bid = bid;
+    handler->buf_tail++;
+    __atomic_store_n(&handler->buf_ring->tail, handler->buf_tail, __ATOMIC_RELEASE);
+}
+
+static int setup_buffer_ring(uring_handler_t *handler) {
+    size_t ring_size = sizeof(struct io_uring_buf) * URING_BUFFER_COUNT;
+    
+    handler->buf_ring = mmap(NULL, ring_size, PROT_READ | PROT_WRITE,
+                             MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (handler->buf_ring == MAP_FAILED) {
+        handler->buf_ring = NULL;
+        return -1;
+    }
+    
+    handler->buffers = malloc((size_t)URING_BUFFER_COUNT * BUFFER_SIZE);
+    if (!handler->buffers) return -1;
+    
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (unsigned long)handler->buf_ring;
+    reg.ring_entries = URING_BUFFER_COUNT;
+    reg.bgid = URING_BUFFER_GROUP;
+    if (sys_io_uring_register(handler->ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        return -1;
+    }
+    
+    handler->buf_tail = 0;
+    for (unsigned short i = 0; i < URING_BUFFER_COUNT; i++) {
+        recycle_buffer(handler, i);
+    }
+    return 0;
+}
+
+uring_handler_t *uring_handler_create(int server_fd, int unix_fd, cache_t *cache,
+                                      const char *document_root, threadpool_t *pool) {
+    uring_handler_t *handler = calloc(1, sizeof(uring_handler_t));
+    if (!handler) return NULL;
+    
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    handler->ring_fd = sys_io_uring_setup(URING_QUEUE_DEPTH, &params);
+    if (handler->ring_fd < 0) {
+        log_message(LOG_WARN, "io_uring_setup失败: %s", strerror(errno));
+        free(handler);
+        return NULL;
+    }
+    
+    handler->server_fd = server_fd;
+    handler->unix_fd = unix_fd;
+    handler->cache = cache;
+    handler->thread_pool = pool;
+    handler->document_root = strdup(document_root);
+    
+    // 连接表按进程fd上限分配
+    struct rlimit rl;
+    handler->max_fds = MAX_CONNECTIONS * 4;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY &&
+        rl.rlim_cur > (rlim_t)handler->max_fds) {
+        handler->max_fds = (int)rl.rlim_cur;
+    }
+    handler->conns = calloc(handler->max_fds, sizeof(uring_conn_t));
+    handler->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    pthread_mutex_init(&handler->resume_lock, NULL);
+    
+    if (!handler->document_root || !handler->conns || handler->wake_fd < 0 ||
+        queue_map(handler, &params) < 0) {
+        log_message(LOG_WARN, "io_uring队列映射失败: %s", strerror(errno));
+        uring_handler_destroy(handler);
+        return NULL;
+    }
+    
+    // 提供缓冲区环与多次accept同时在5.19引入，注册成功即可认为两者都可用
+    if (setup_buffer_ring(handler) < 0) {
+        log_message(LOG_WARN, "注册提供缓冲区环失败: %s", strerror(errno));
+        uring_handler_destroy(handler);
+        return NULL;
+    }
+    
+    // 注册监听socket，accept时免去每次fd查找
+    int listen_fds[2] = { server_fd, unix_fd };
+    if (sys_io_uring_register(handler->ring_fd, IORING_REGISTER_FILES, listen_fds,
+                              unix_fd >= 0 ? 2 : 1) < 0) {
+        log_message(LOG_WARN, "注册监听socket失败: %s", strerror(errno));
+        uring_handler_destroy(handler);
+        return NULL;
+    }
+    
+    log_message(LOG_INFO, "io_uring处理器创建成功，队列深度: %u", params.sq_entries);
+    return handler;
+}
+
+// 在注册文件表中下标为index的监听socket上提交多次accept
+static void arm_accept(uring_handler_t *handler, int index) {
+    struct io_uring_sqe *sqe = get_sqe(handler);
+    if (!sqe) {
+        // 提交队列已满: 多次accept不能丢，留给下一轮事件循环重新提交
+        handler->rearm |= 1u << index;
+        return;
+    }
+    
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = index;
+    sqe->flags = IOSQE_FIXED_FILE;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    // 工作线程按非阻塞socket读写(poll等待并检查期限)，与epoll后端的accept4一致
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = UD_MAKE(index, UD_ACCEPT);
+}
+
+// 单次poll，处理完代理事件后重新提交
+static void arm_proxy_poll(uring_handler_t *handler) {
+    struct io_uring_sqe *sqe = get_sqe(handler);
+    if (!sqe) {
+        handler->rearm |= REARM_PROXY;
+        return;
+    }
+    
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = proxy_fd(handler->proxy);
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = UD_PROXY;
+}
+
+// 单次poll，工作线程归还长连接后重新提交
+static void arm_wake_poll(uring_handler_t *handler) {
+    struct io_uring_sqe *sqe = get_sqe(handler);
+    if (!sqe) {
+        handler->rearm |= REARM_WAKE;
+        return;
+    }
+    
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = handler->wake_fd;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = UD_WAKE;
+}
+
+int uring_handler_add_proxy(uring_handler_t *handler, proxy_t *proxy) {
+    handler->proxy = proxy;
+    return 0;
+}
+
+// 关闭客户端连接并更新连接计数，工作线程也会调用
+static void close_client(uring_handler_t *handler, int client_fd) {
+    uring_conn_t *conn = &handler->conns[client_fd];
+    free(conn->header);
+    conn->header = NULL;
+    conn->header_len = 0;
+    free(conn->pending.data);
+    conn->pending.data = NULL;
+    conn->pending.len = 0;
+    conn->state = URING_CONN_FREE;
+    close(client_fd);
+    __atomic_sub_fetch(&handler->active_connections, 1, __ATOMIC_RELAXED);
+}
+
+// 工作线程结束请求: 保持的连接交给事件循环重新提交recv(提交队列只在事件循环线程操作)
+static void uring_handler_release(void *owner, int client_fd, int keep_alive) {
+    uring_handler_t *handler = (uring_handler_t *)owner;
+    if (!keep_alive) {
+        close_client(handler, client_fd);
+        return;
+    }
+    
+    pthread_mutex_lock(&handler->resume_lock);
+    if (handler->resume_count == handler->resume_capacity) {
+        int capacity = handler->resume_capacity ? handler->resume_capacity * 2 : 64;
+        int *fds = realloc(handler->resume_fds, sizeof(int) * capacity);
+        if (!fds) {
+            pthread_mutex_unlock(&handler->resume_lock);
+            close_client(handler, client_fd);
+            return;
+        }
+        handler->resume_fds = fds;
+        handler->resume_capacity = capacity;
+    }
+    handler->resume_fds[handler->resume_count++] = client_fd;
+    pthread_mutex_unlock(&handler->resume_lock);
+    
+    uint64_t one = 1;
+    write(handler->wake_fd, &one, sizeof(one));
+}
+
+// recv链接一个超时提交: 请求头或空闲期限到达时内核取消recv，完成事件为-ECANCELED
+static void arm_recv(uring_handler_t *handler, int client_fd) {
+    uring_conn_t *conn = &handler->conns[client_fd];
+    uint64_t now = timer_now_ms();
+    // 链接的两个SQE必须在同一批提交
+    if (now >= conn->deadline_ms || reserve_sqes(handler, 2) < 0) {
+        close_client(handler, client_fd);
+        return;
+    }
+    
+    struct io_uring_sqe *sqe = get_sqe(handler);
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = client_fd;
+    sqe->flags = IOSQE_BUFFER_SELECT | IOSQE_IO_LINK;
+    sqe->buf_group = URING_BUFFER_GROUP;
+    sqe->len = BUFFER_SIZE - 1;
+    sqe->user_data = UD_MAKE(client_fd, UD_RECV);
+    
+    uint64_t remaining = conn->deadline_ms - now;
+    conn->timeout.tv_sec = remaining / 1000;
+    conn->timeout.tv_nsec = (remaining % 1000) * 1000000;
+    struct io_uring_sqe *timeout_sqe = get_sqe(handler);
+    timeout_sqe->opcode = IORING_OP_LINK_TIMEOUT;
+    timeout_sqe->addr = (unsigned long)&conn->timeout;
+    timeout_sqe->len = 1;
+    timeout_sqe->user_data = UD_MAKE(-1, UD_CLOSE);  // 超时本身的完成事件无需处理
+}
+
+// 缓存未命中等慢路径交给线程池，已读取的请求数据随上下文一起传递
+static void dispatch_to_pool(uring_handler_t *handler, int client_fd,
+                             const char *request, size_t request_len) {
+    uring_conn_t *conn = &handler->conns[client_fd];
+    client_context_t *ctx = malloc(sizeof(client_context_t));
+    char *copy = malloc(request_len + 1);
+    if (!ctx || !copy) {
+        log_message(LOG_ERROR, "分配客户端上下文内存失败");
+        free(ctx);
+        free(copy);
+        close_client(handler, client_fd);
+        return;
+    }
+    memcpy(copy, request, request_len);
+    copy[request_len] = '\0';
+    
+    ctx->client_fd = client_fd;
+    ctx->document_root = handler->document_root;
+    ctx->cache = handler->cache;
+    ctx->request = copy;
+    ctx->request_len = request_len;
+    ctx->deadline_ms = conn->deadline_ms;
+    ctx->keep_alive = 0;
+    ctx->release = uring_handler_release;
+    ctx->owner = handler;
+    ctx->zc = NULL;
+    ctx->h2 = NULL;
+    ctx->pending = &conn->pending;
+    
+    // 队列已满时立即返回503；排队过久的任务由线程池调用shed_client_request丢弃
+    if (threadpool_add_task_sheddable(handler->thread_pool, handle_client_request,
+                                      shed_client_request, ctx) != 0) {
+        log_message(LOG_WARN, "线程池队列已满，拒绝请求");
+        send_overload_response(client_fd);
+        close_client(handler, client_fd);
+        free(ctx->request);
+        free(ctx);
+    }
+}
+
+// 缓存命中: sendmsg(响应头+缓存数据)在事件循环内提交
+// 不保持连接时链接close，整个请求无需额外系统调用；保持连接时发送完成后重新提交recv
+static int submit_cached_response(uring_handler_t *handler, int client_fd, const char *request) {
+    // 链接的两个SQE必须在同一批提交
+    if (reserve_sqes(handler, 2) < 0) return -1;
+    
+    uring_send_t *op = malloc(sizeof(uring_send_t));
+    if (!op) return -1;
+    
+    // 排空期间响应后关闭连接
+    int header_len, send_body, keep_alive = !handler->draining;
+    op->item = prepare_cached_response(handler->cache, handler->document_root, request,
+                                       op->header, sizeof(op->header), &header_len, &send_body,
+                                       &keep_alive);
+    if (!op->item) {
+        free(op);
+        return -1;
+    }
+    
+    op->client_fd = client_fd;
+    op->keep_alive = keep_alive;
+    op->total = header_len + (send_body ? op->item->size : 0);
+    op->iov[0].iov_base = op->header;
+    op->iov[0].iov_len = header_len;
+    op->iov[1].iov_base = op->item->data;
+    op->iov[1].iov_len = op->item->size;
+    memset(&op->msg, 0, sizeof(op->msg));
+    op->msg.msg_iov = op->iov;
+    op->msg.msg_iovlen = send_body ? 2 : 1;
+    
+    struct io_uring_sqe *send_sqe = get_sqe(handler);
+    send_sqe->opcode = IORING_OP_SENDMSG;
+    send_sqe->fd = client_fd;
+    send_sqe->flags = keep_alive ? 0 : IOSQE_IO_LINK;
+    send_sqe->addr = (unsigned long)&op->msg;
+    send_sqe->len = 1;
+    send_sqe->msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+    send_sqe->user_data = (unsigned long long)(unsigned long)op;
+    if (keep_alive) return 0;
+    
+    struct io_uring_sqe *close_sqe = get_sqe(handler);
+    close_sqe->opcode = IORING_OP_CLOSE;
+    close_sqe->fd = client_fd;
+    close_sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+    close_sqe->user_data = UD_MAKE(client_fd, UD_CLOSE);
+    return 0;
+}
+
+// 请求头已完整: 单个不带后续数据的缓存命中在事件循环内发送，
+// 其余(未命中、管线化、代理、HTTP/2等)交给线程池
+static void handle_request(uring_handler_t *handler, int client_fd, const char *request,
+                           size_t len) {
+    handler->conns[client_fd].state = URING_CONN_BUSY;
+    const char *end = strstr(request, "\r\n\r\n");
+    if (end && (size_t)(end + 4 - request) == len &&
+        submit_cached_response(handler, client_fd, request) == 0) {
+        return;
+    }
+    dispatch_to_pool(handler, client_fd, request, len);
+}
+
+// 把收到的数据追加到连接的请求头缓冲区
+// 请求头完整或达到长度上限时返回1，还需继续读取返回0，分配失败返回-1
+static int append_header(uring_conn_t *conn, const char *data, size_t len) {
+    if (!conn->header) {
+        conn->header = malloc(BUFFER_SIZE);
+        if (!conn->header) return -1;
+        conn->header_len = 0;
+    }
+    
+    // 结束标记可能跨越两次recv，从上次末尾往前3个字节开始查找
+    size_t from = conn->header_len > 3 ? conn->header_len - 3 : 0;
+    size_t room = BUFFER_SIZE - 1 - conn->header_len;
+    if (len > room) len = room;
+    memcpy(conn->header + conn->header_len, data, len);
+    conn->header_len += len;
+    conn->header[conn->header_len] = '\0';
+    return strstr(conn->header + from, "\r\n\r\n") != NULL || conn->header_len == BUFFER_SIZE - 1;
+}
+
+// 处理连接上累积完整的请求头
+static void handle_header(uring_handler_t *handler, int client_fd) {
+    uring_conn_t *conn = &handler->conns[client_fd];
+    char *header = conn->header;
+    size_t len = conn->header_len;
+    conn->header = NULL;
+    conn->header_len = 0;
+    handle_request(handler, client_fd, header, len);
+    free(header);
+}
+
+// 追加数据后按请求头是否完整决定处理还是继续读取
+static void consume_input(uring_handler_t *handler, int client_fd, const char *data, size_t len) {
+    int ret = append_header(&handler->conns[client_fd], data, len);
+    if (ret < 0) close_client(handler, client_fd);
+    else if (ret > 0) handle_header(handler, client_fd);
+    else arm_recv(handler, client_fd);
+}
+
+// 响应完成后保持连接: 已读到下一个请求时直接处理，否则等待新的请求
+static void resume_connection(uring_handler_t *handler, int client_fd) {
+    uring_conn_t *conn = &handler->conns[client_fd];
+    if (handler->draining) {
+        close_client(handler, client_fd);
+        return;
+    }
+    
+    if (conn->pending.len > 0) {
+        char *data = conn->pending.data;
+        size_t len = conn->pending.len;
+        conn->pending.data = NULL;
+        conn->pending.len = 0;
+        conn->state = URING_CONN_READING;
+        conn->deadline_ms = timer_now_ms() + HEADER_TIMEOUT_MS;
+        consume_input(handler, client_fd, data, len);
+        free(data);
+        return;
+    }
+    
+    conn->state = URING_CONN_IDLE;
+    conn->deadline_ms = timer_now_ms() + KEEPALIVE_TIMEOUT_MS;
+    arm_recv(handler, client_fd);
+}
+
+static void handle_resumed_connections(uring_handler_t *handler) {
+    uint64_t value;
+    read(handler->wake_fd, &value, sizeof(value));
+    
+    pthread_mutex_lock(&handler->resume_lock);
+    int count = handler->resume_count;
+    int fds[count > 0 ? count : 1];
+    memcpy(fds, handler->resume_fds, sizeof(int) * count);
+    handler->resume_count = 0;
+    pthread_mutex_unlock(&handler->resume_lock);
+    
+    for (int i = 0; i < count; i++) {
+        resume_connection(handler, fds[i]);
+    }
+}
+
+static void handle_recv(uring_handler_t *handler, int client_fd, struct io_uring_cqe *cqe) {
+    if (cqe->res == -ENOBUFS) {
+        // 缓冲区暂时耗尽: 本轮完成事件处理完后即归还，重新提交recv
+        arm_recv(handler, client_fd);
+        return;
+    }
+    
+    uring_conn_t *conn = &handler->conns[client_fd];
+    if (!(cqe->flags & IORING_CQE_F_BUFFER)) {
+        // 链接的超时到期取消了recv(排空时的取消不算超时)
+        if (cqe->res == -ECANCELED && !handler->draining) {
+            log_message(LOG_INFO, "连接 %d %s超时，关闭", client_fd,
+                        conn->state == URING_CONN_READING ? "请求头读取" : "空闲");
+        }
+        close_client(handler, client_fd);
+        return;
+    }
+    
+    unsigned short bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+    char *buffer = handler->buffers + (size_t)bid * BUFFER_SIZE;
+    
+    if (cqe->res <= 0) {
+        close_client(handler, client_fd);
+    } else {
+        buffer[cqe->res] = '\0';
+        // 长连接收到新请求，从现在开始计算请求头期限
+        if (conn->state == URING_CONN_IDLE) {
+            conn->state = URING_CONN_READING;
+            conn->deadline_ms = timer_now_ms() + HEADER_TIMEOUT_MS;
+        }
+        // 常见情况是请求头一次到达，直接使用提供的缓冲区；否则累积到请求头完整
+        if (!conn->header && strstr(buffer, "\r\n\r\n")) {
+            handle_request(handler, client_fd, buffer, cqe->res);
+        } else {
+            consume_input(handler, client_fd, buffer, cqe->res);
+        }
+    }
+    recycle_buffer(handler, bid);
+}
+
+static void handle_send(uring_handler_t *handler, uring_send_t *op, struct io_uring_cqe *cqe) {
+    int client_fd = op->client_fd;
+    int complete = cqe->res >= 0 && (size_t)cqe->res == op->total;
+    
+    if (cqe->res < 0) {
+        log_message(LOG_DEBUG, "io_uring发送失败: %s", strerror(-cqe->res));
+        // 映射的文件被截断，丢弃失效的缓存项
+        if (cqe->res == -EFAULT && op->item->mapped) cache_remove(handler->cache, op->item->key);
+    }
+    cache_release(handler->cache, op->item);
+    
+    if (!op->keep_alive) {
+        // 链接的close随后执行(发送失败时由UD_CLOSE完成事件关闭)，连接在此计为结束
+        handler->conns[client_fd].state = URING_CONN_FREE;
+        __atomic_sub_fetch(&handler->active_connections, 1, __ATOMIC_RELAXED);
+    } else if (complete) {
+        resume_connection(handler, client_fd);
+    } else {
+        close_client(handler, client_fd);
+    }
+    free(op);
+}
+
+static void accept_client(uring_handler_t *handler, int client_fd) {
+    if (client_fd >= handler->max_fds) {
+        log_message(LOG_WARN, "fd %d 超出连接表范围，拒绝连接", client_fd);
+        close(client_fd);
+        return;
+    }
+    
+    // 连接数达到上限时直接返回503，不再占用连接表和工作线程
+    if (__atomic_load_n(&handler->active_connections, __ATOMIC_RELAXED) >= MAX_CONNECTIONS) {
+        send_overload_response(client_fd);
+        close(client_fd);
+        log_message(LOG_WARN, "连接数达到上限 %d，拒绝新连接", MAX_CONNECTIONS);
+        return;
+    }
+    
+    __atomic_add_fetch(&handler->active_connections, 1, __ATOMIC_RELAXED);
+    uring_conn_t *conn = &handler->conns[client_fd];
+    conn->state = URING_CONN_READING;
+    conn->deadline_ms = timer_now_ms() + HEADER_TIMEOUT_MS;
+    arm_recv(handler, client_fd);
+}
+
+static void handle_completion(uring_handler_t *handler, struct io_uring_cqe *cqe) {
+    unsigned long long ud = cqe->user_data;
+    
+    if (ud == UD_PROXY) {
+        proxy_process(handler->proxy);
+        arm_proxy_poll(handler);
+        return;
+    }
+    if (ud == UD_WAKE) {
+        handle_resumed_connections(handler);
+        arm_wake_poll(handler);
+        return;
+    }
+    
+    switch (ud & UD_TAG_MASK) {
+        case UD_ACCEPT:
+            if (cqe->res >= 0) {
+                accept_client(handler, cqe->res);
+            } else if (cqe->res != -ECANCELED) {
+                log_message(LOG_ERROR, "io_uring accept失败: %s", strerror(-cqe->res));
+            }
+            // 多次accept被内核终止时重新提交
+            if (!(cqe->flags & IORING_CQE_F_MORE) && !handler->draining) {
+                arm_accept(handler, UD_FD(ud));
+            }
+            break;
+        case UD_RECV:
+            handle_recv(handler, UD_FD(ud), cqe);
+            break;
+        case UD_CLOSE:
+            // 前面的发送失败导致链接取消，需要手动关闭
+            if (cqe->res < 0 && UD_FD(ud) >= 0) close(UD_FD(ud));
+            break;
+        case UD_SEND:
+            handle_send(handler, (uring_send_t *)(unsigned long)ud, cqe);
+            break;
+    }
+}
+
+// 处理完成队列中所有已到达的事件
+static void reap_completions(uring_handler_t *handler) {
+    uring_queue_t *q = &handler->queue;
+    unsigned head = *q->cq_head;
+    unsigned tail = __atomic_load_n(q->cq_tail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+        handle_completion(handler, &q->cqes[head & *q->cq_mask]);
+        head++;
+        // 处理过程中可能提交新请求，逐个推进head以尽早释放CQ空间
+        __atomic_store_n(q->cq_head, head, __ATOMIC_RELEASE);
+        if (head == tail) tail = __atomic_load_n(q->cq_tail, __ATOMIC_ACQUIRE);
+    }
+}
+
+// 重新提交上一轮因提交队列满而没有提交的accept和代理poll
+static void rearm_pending(uring_handler_t *handler) {
+    unsigned pending = handler->rearm;
+    handler->rearm = 0;
+    
+    if (!handler->draining) {
+        if (pending & (1u << URING_SERVER_FILE_INDEX)) arm_accept(handler, URING_SERVER_FILE_INDEX);
+        if (pending & (1u << URING_UNIX_FILE_INDEX)) arm_accept(handler, URING_UNIX_FILE_INDEX);
+    }
+    if (pending & REARM_PROXY) arm_proxy_poll(handler);
+    if (pending & REARM_WAKE) arm_wake_poll(handler);
+}
+
+void uring_handler_loop(uring_handler_t *handler) {
+    log_message(LOG_INFO, "io_uring事件循环开始");
+    
+    arm_accept(handler, URING_SERVER_FILE_INDEX);
+    if (handler->unix_fd >= 0) arm_accept(handler, URING_UNIX_FILE_INDEX);
+    if (handler->proxy) arm_proxy_poll(handler);
+    arm_wake_poll(handler);
+    
+    while (!server_process_signals()) {
+        if (handler->rearm) rearm_pending(handler);
+        if (queue_submit(handler, 1) < 0) {
+            if (errno == EINTR) continue;
+            perror("io_uring_enter");
+            log_message(LOG_ERROR, "io_uring_enter错误: %s", strerror(errno));
+            break;
+        }
+        reap_completions(handler);
+    }
+    
+    log_message(LOG_INFO, "io_uring事件循环结束");
+}
+
+void uring_handler_drain(uring_handler_t *handler, int timeout_ms) {
+    handler->draining = 1;
+    
+    // 取消多次accept，监听队列中剩余的连接留给接管监听socket的进程
+    int listeners = handler->unix_fd >= 0 ? 2 : 1;
+    for (int index = 0; index < listeners; index++) {
+        struct io_uring_sqe *sqe = get_sqe(handler);
+        if (!sqe) break;
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = UD_MAKE(index, UD_ACCEPT);
+        sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+        sqe->user_data = UD_MAKE(-1, UD_CLOSE);  // 取消失败时的完成事件无需处理
+    }
+    
+    // 空闲的长连接没有进行中的请求，取消等待中的recv，完成事件中关闭
+    for (int fd = 0; fd < handler->max_fds; fd++) {
+        if (handler->conns[fd].state != URING_CONN_IDLE) continue;
+        struct io_uring_sqe *sqe = get_sqe(handler);
+        if (!sqe) break;
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = UD_MAKE(fd, UD_RECV);
+        sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+        sqe->user_data = UD_MAKE(-1, UD_CLOSE);
+    }
+    
+    // 工作线程关闭连接时不经过完成队列，用poll限时等待ring上的完成事件
+    uint64_t deadline = timer_now_ms() + timeout_ms;
+    while (1) {
+        queue_submit(handler, 0);
+        reap_completions(handler);
+        if (__atomic_load_n(&handler->active_connections, __ATOMIC_RELAXED) <= 0) break;
+        
+        uint64_t now = timer_now_ms();
+        if (now >= deadline) {
+            log_message(LOG_WARN, "排空超时，放弃 %d 个连接",
+                        __atomic_load_n(&handler->active_connections, __ATOMIC_RELAXED));
+            break;
+        }
+        struct pollfd pfd = { .fd = handler->ring_fd, .events = POLLIN };
+        int wait_ms = (int)(deadline - now);
+        poll(&pfd, 1, wait_ms < 50 ? wait_ms : 50);
+    }
+    
+    log_message(LOG_INFO, "io_uring连接排空结束");
+}
+
+void uring_handler_destroy(uring_handler_t *handler) {
+    if (!handler) return;
+    
+    queue_unmap(&handler->queue);
+    if (handler->ring_fd >= 0) close(handler->ring_fd);
+    if (handler->buf_ring) {
+        munmap(handler->buf_ring, sizeof(struct io_uring_buf) * URING_BUFFER_COUNT);
+    }
+    free(handler->buffers);
+    for (int fd = 0; handler->conns && fd < handler->max_fds; fd++) {
+        free(handler->conns[fd].header);
+        free(handler->conns[fd].pending.data);
+    }
+    free(handler->conns);
+    free(handler->resume_fds);
+    pthread_mutex_destroy(&handler->resume_lock);
+    if (handler->wake_fd >= 0) close(handler->wake_fd);
+    free(handler->document_root);
+    free(handler);
+    
+    log_message(LOG_INFO, "io_uring处理器已销毁");
+}
@@ -0,0 +1,84 @@
+#ifndef URING_HANDLER_H
+#define URING_HANDLER_H
+
+#include <linux/io_uring.h>
+#include <pthread.h>
+#include <stdint.h>
+#include "cache.h"
+#include "threadpool.h"
+#include "config.h"
+#include "proxy.h"
+#include "webserver.h"
+
+// 用户态视角的提交/完成队列
+typedef struct {
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+    unsigned sq_pending;       // 已填写但尚未提交的SQE数量
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+    void *sq_ring_ptr;
+    size_t sq_ring_size;
+    void *cq_ring_ptr;
+    size_t cq_ring_size;
+    size_t sqes_size;
+} uring_queue_t;
+
+// 连接状态
+typedef enum {
+    URING_CONN_FREE = 0,
+    URING_CONN_READING,        // 已提交recv，等待(剩余的)请求头
+    URING_CONN_IDLE,           // 长连接空闲，等待下一个请求
+    URING_CONN_BUSY            // 正在发送缓存响应或已交给工作线程
+} uring_conn_state_t;
+
+// 每个连接的事件循环侧状态(按fd索引)
+typedef struct {
+    uring_conn_state_t state;
+    char *header;              // 分多次到达的请求头(BUFFER_SIZE字节，收完后释放)
+    size_t header_len;
+    uint64_t deadline_ms;      // 请求头必须读完(空闲时为等待下一个请求)的时间点
+    struct __kernel_timespec timeout; // 链接到recv的超时，提交时由内核读取
+    pending_input_t pending;   // 工作线程已读到的下一个请求(管线化)，归还时直接处理
+} uring_conn_t;
+
+typedef struct {
+    int ring_fd;
+    int server_fd;
+    int unix_fd;               // Unix域监听socket(-1表示未启用)
+    uring_queue_t queue;
+    struct io_uring_buf_ring *buf_ring; // recv提供缓冲区环
+    char *buffers;             // 缓冲区内存(URING_BUFFER_COUNT * BUFFER_SIZE)
+    unsigned short buf_tail;   // 缓冲区环的本地tail
+    cache_t *cache;
+    char *document_root;
+    threadpool_t *thread_pool;
+    int active_connections;    // 已接受但未关闭的连接数(原子更新)
+    int draining;              // 排空中: 不再重新提交accept
+    unsigned rearm;            // 提交队列满时未能提交的accept/代理poll(位掩码)，下一轮事件循环重试
+    proxy_t *proxy;            // 反向代理，在proxy_fd上保持一个poll请求(可为NULL)
+    uring_conn_t *conns;       // 连接表，下标为fd
+    int max_fds;
+    int wake_fd;               // eventfd: 工作线程归还长连接时唤醒事件循环(保持一个poll请求)
+    pthread_mutex_t resume_lock;
+    int *resume_fds;           // 待重新提交recv的长连接
+    int resume_count;
+    int resume_capacity;
+} uring_handler_t;
+
+// 内核不支持io_uring(或缺少多次accept/提供缓冲区环)时返回NULL，调用者应回退到epoll
+uring_handler_t *uring_handler_create(int server_fd, int unix_fd, cache_t *cache,
+                                      const char *document_root, threadpool_t *pool);
+void uring_handler_destroy(uring_handler_t *handler);
+void uring_handler_loop(uring_handler_t *handler);
+// 由事件循环驱动反向代理的上游连接
+int uring_handler_add_proxy(uring_handler_t *handler, proxy_t *proxy);
+// 取消accept并等待已接受的连接处理完成，最多等待timeout_ms
+void uring_handler_drain(uring_handler_t *handler, int timeout_ms);
+
+#endif
@@ -0,0 +1,134 @@
+#include <string.h>
+#include "urlpath.h"
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// 解码到查询串或片段为止，解码出的'/'同样作为分隔符，%2e%2e与..一样处理
+static int percent_decode(const char *target, char *out, size_t size) {
+    size_t len = 0;
+    for (const char *p = target; *p && *p != '?' && *p != '#'; p++) {
+        char c = *p;
+        if (c == '%') {
+            int hi = hex_value(p[1]);
+            int lo = hi < 0 ? -1 : hex_value(p[2]);
+            if (lo < 0) return 400;
+            c = (char)(hi << 4 | lo);
+            p += 2;
+        }
+        // 控制字符(包括解码出的%00、%0a)会进入文件路径和日志，直接拒绝
+        if ((unsigned char)c < 0x20 || c == 0x7f) return 400;
+        if (len + 1 >= size) return 414;
+        out[len++] = c;
+    }
+    out[len] = '\0';
+    return 0;
+}
+
+// 处理decoded中的.和..段并合并重复斜杠，out以'/'开头和结尾，directory表示请求的是目录
+static int resolve_segments(const char *decoded, char *out, size_t size, size_t *out_len,
+                            int *directory) {
+    size_t len = 1;
+    out[0] = '/';
+    *directory = 1;
+    
+    const char *p = decoded;
+    while (*p) {
+        while (*p == '/') p++;
+        const char *end = strchr(p, '/');
+        size_t seg = end ? (size_t)(end - p) : strlen(p);
+        
+        if (seg == 0 || (seg == 1 && p[0] == '.')) {
+            *directory = 1;
+        } else if (seg == 2 && p[0] == '.' && p[1] == '.') {
+            // 不允许越过文档根目录
+            if (len == 1) return 403;
+            len--;
+            while (out[len - 1] != '/') len--;
+            *directory = 1;
+        } else {
+            if (len + seg + 1 >= size) return 414;
+            memcpy(out + len, p, seg);
+            len += seg;
+            out[len++] = '/';
+            *directory = end != NULL;
+        }
+        p += seg;
+    }
+    *out_len = len;
+    return 0;
+}
+
+int urlpath_normalize(const char *target, char *out, size_t size) {
+    if (target[0] != '/' || size < 2) return 400;
+    
+    char decoded[1024];
+    int status = percent_decode(target, decoded, sizeof(decoded));
+    if (status != 0) return status;
+    
+    // out始终以'/'结尾，最后决定是去掉它还是补上index.html
+    size_t len;
+    int directory;
+    status = resolve_segments(decoded, out, size, &len, &directory);
+    if (status != 0) return status;
+    
+    if (directory) {
+        static const char index[] = "index.html";
+        if (len + sizeof(index) > size) return 414;
+        memcpy(out + len, index, sizeof(index));
+    } else {
+        out[len - 1] = '\0';
+    }
+    return 0;
+}
+
+// 路径段中可以不编码的字符(RFC 3986 pchar中的unreserved、sub-delims、':'、'@')
+static int is_pchar(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+           (c != '\0' && strchr("-._~!$&'()*+,;=:@", c) != NULL);
+}
+
+int urlpath_forward_target(const char *target, char *out, size_t size) {
+    static const char hex[] = "0123456789ABCDEF";
+    if (target[0] != '/' || size < 2) return 400;
+    
+    char decoded[1024], path[1024];
+    int status = percent_decode(target, decoded, sizeof(decoded));
+    if (status != 0) return status;
+    size_t path_len;
+    int directory;
+    status = resolve_segments(decoded, path, sizeof(path), &path_len, &directory);
+    if (status != 0) return status;
+    // 目录保留结尾的'/'
+    if (!directory && path_len > 1) path_len--;
+    
+    size_t len = 0;
+    for (size_t i = 0; i < path_len; i++) {
+        unsigned char c = (unsigned char)path[i];
+        if (len + 4 > size) return 414;
+        if (c == '/' || is_pchar(c)) {
+            out[len++] = (char)c;
+        } else {
+            out[len++] = '%';
+            out[len++] = hex[c >> 4];
+            out[len++] = hex[c & 15];
+        }
+    }
+    
+    // 查询串原样转发(片段不属于请求目标)，同样不允许控制字符
+    const char *query = strchr(target, '?');
+    const char *fragment = strchr(target, '#');
+    if (query && (!fragment || query < fragment)) {
+        for (const char *p = query; *p && *p != '#'; p++) {
+            if ((unsigned char)*p < 0x20 || *p == 0x7f) return 400;
+            if (len + 2 > size) return 414;
+            out[len++] = *p;
+        }
+    }
+    out[len] = '\0';
+    return 0;
+}
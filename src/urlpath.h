@@ -0,0 +1,18 @@
+#ifndef URLPATH_H
+#define URLPATH_H
+
+#include <stddef.h>
+
+// 请求目标规范化为缓存key: 查询串不参与，百分号解码后合并重复斜杠、处理.和..段
+// 结果以'/'开头、相对文档根目录，目录(以'/'结尾)补上index.html
+// 这样/index.html?v=1、//index.html、/a/../index.html和/得到同一个key
+//
+// 成功返回0，否则返回HTTP错误码: 400(格式错误或含控制字符，包括解码出的)、403(..越过根目录)、414(过长)
+int urlpath_normalize(const char *target, char *out, size_t size);
+
+// 转发给上游的请求目标: 与urlpath_normalize一样解码、合并斜杠并处理.和..段，
+// 目录保留结尾的'/'(不补index.html)，路径重新按百分号编码，查询串原样附在后面
+// 上游收到的路径与代理路由匹配的路径一致，/api/../admin、/api/%2e%2e/admin不会原样转发
+int urlpath_forward_target(const char *target, char *out, size_t size);
+
+#endif
@@ -4,6 +4,7 @@
 #include <unistd.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -11,19 +12,52 @@
 #include <dirent.h>
 #include <signal.h>
 #include <sys/sendfile.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
 #include <sys/time.h>
+#include <poll.h>
+#include <errno.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>
+#include <sys/un.h>
 
 #include "webserver.h"
 #include "cache.h"
 #include "epoll_handler.h"
+#include "uring_handler.h"
 #include "threadpool.h"
 #include "config.h"
 #include "logging.h" 
+#include "timer_wheel.h"
+#include "snapshot.h"
+#include "preload.h"
+#include "shm_cache.h"
+#include "handoff.h"
+#include "admin.h"
+#include "proxy.h"
+#include "hitters.h"
+#include "memwatch.h"
+#include "transfer.h"
+#include "urlpath.h"
+#include "mapguard.h"
+#include "hpack.h"
 #include <stdarg.h>
-// 全局统计变量
+// 全局统计变量，工作线程并发累加，一律用STAT_INC/STAT_GET访问
+#define STAT_INC(counter) __atomic_add_fetch(&(counter), 1, __ATOMIC_RELAXED)
+#define STAT_GET(counter) __atomic_load_n(&(counter), __ATOMIC_RELAXED)
 static unsigned long cache_hits = 0;
 static unsigned long total_requests = 0;
 static unsigned long sendfile_used = 0;
+static unsigned long not_modified_sent = 0;
+static unsigned long disk_io_offloaded = 0;
+static unsigned long disk_io_shed = 0;
+static unsigned long header_timeouts = 0;
+static unsigned long send_stalls = 0;
+static unsigned long overload_rejected = 0;
+static unsigned long mmap_served = 0;
+static unsigned long snapshot_hits = 0;
+static unsigned long h2_connections = 0;
+static unsigned long h2_streams = 0;
 static struct timeval start_time;
 
 // 全局服务器状态变量
@@ -31,240 +65,1740 @@ static cache_t *global_cache = NULL;
 static cache_algorithm_t current_algorithm = LRU;
 static char *global_document_root = NULL;
 static int global_server_port = 0;
+static threadpool_t *disk_io_pool = NULL;  // 缓存未命中专用的磁盘I/O线程池
+static pid_t *worker_pids = NULL;          // 预派生的工作进程(只在父进程中)
+static int worker_pid_count = 0;
+static int zerocopy_mode = 0;              // 大的缓存命中使用MSG_ZEROCOPY发送
+static proxy_t *reverse_proxy = NULL;      // 反向代理(未配置路由时为NULL)
+static unsigned long proxy_cache_hits = 0;
+static unsigned long proxy_cache_stores = 0;
+static proxy_stats_t proxy_final_stats;     // 关闭代理时的统计，退出时打印
+static hitters_t *hot_paths = NULL;        // 热点路径统计(管理接口top/hot-list)
 
 // 函数声明
-int create_server_socket(int port);
+int create_server_socket(int port, int backlog);
 void send_error_response(int client_fd, int code, const char *message);
-void send_file_response(int client_fd, const char *filename, void *data, size_t size);
+int send_file_response(int client_fd, const char *filename, void *data, size_t size,
+                       const char *etag, time_t mtime, int keep_alive);
 void handle_client_request(void *arg);
-void start_server(int port, const char *document_root, cache_algorithm_t algorithm);
+void start_server(const server_options_t *options);
+static int wants_keep_alive(const char *request);
+static void reap_workers(void);
 
 
 // 日志函数
 
+// 信号只在处理函数中记录，由事件循环线程在正常上下文中处理
+static volatile sig_atomic_t stop_requested = 0;
+static volatile sig_atomic_t switch_requested = 0;
+static volatile sig_atomic_t status_requested = 0;
+static volatile sig_atomic_t reload_requested = 0;
+static volatile sig_atomic_t child_exited = 0;
+static sigset_t wait_sigmask;              // 事件循环等待期间的屏蔽字(不屏蔽控制信号)
+
 // 信号处理函数
 void signal_handler(int sig) {
+    if (sig == SIGINT || sig == SIGTERM) stop_requested = 1;
+    else if (sig == SIGUSR1) switch_requested = 1;
+    else if (sig == SIGUSR2) status_requested = 1;
+    else if (sig == SIGHUP) reload_requested = 1;
+    else if (sig == SIGCHLD) child_exited = 1;
+}
+
+// 打印最终统计信息
+static void print_final_stats(void) {
+    struct timeval current_time;
+    gettimeofday(&current_time, NULL);
+    
+    double uptime = (current_time.tv_sec - start_time.tv_sec) + 
+                   (current_time.tv_usec - start_time.tv_usec) / 1000000.0;
+    
+    printf("运行时间: %.2f 秒\n", uptime);
+    printf("总请求数: %lu\n", total_requests);
+    printf("缓存命中数: %lu\n", cache_hits);
+    printf("缓存命中率: %.2f%%\n", total_requests > 0 ? 
+           (double)cache_hits / total_requests * 100 : 0);
+    printf("sendfile使用次数: %lu\n", sendfile_used);
+    printf("304响应数: %lu\n", not_modified_sent);
+    printf("磁盘I/O线程池处理: %lu, 队列满拒绝(503): %lu\n", disk_io_offloaded, disk_io_shed);
+    printf("请求头超时: %lu, 发送停滞: %lu\n", header_timeouts, send_stalls);
+    printf("过载拒绝(503): %lu\n", overload_rejected);
+    printf("映射发送次数: %lu\n", mmap_served);
+    transfer_stats_t transfer;
+    transfer_get_stats(&transfer);
+    printf("传输策略: writev %llu, sendfile %llu, splice %llu, mmap %llu\n",
+           (unsigned long long)transfer.count[TRANSFER_WRITEV],
+           (unsigned long long)transfer.count[TRANSFER_SENDFILE],
+           (unsigned long long)transfer.count[TRANSFER_SPLICE],
+           (unsigned long long)transfer.count[TRANSFER_MMAP]);
+    printf("快照命中数: %lu\n", snapshot_hits);
+    if (h2_connections > 0) {
+        printf("HTTP/2连接: %lu, 流: %lu\n", h2_connections, h2_streams);
+    }
+    if (proxy_final_stats.requests > 0) {
+        proxy_stats_t stats = proxy_final_stats;
+        printf("代理转发: %lu, 缓存命中: %lu, 存入缓存: %lu\n",
+               stats.requests, proxy_cache_hits, proxy_cache_stores);
+        printf("上游连接: 新建 %lu, 复用 %lu, 重试 %lu, 502: %lu, 504: %lu\n",
+               stats.connects, stats.reused, stats.retries, stats.errors, stats.timeouts);
+    }
+    if (zerocopy_mode) {
+        unsigned long zc_sent, zc_copied;
+        zerocopy_get_stats(&zc_sent, &zc_copied);
+        printf("零拷贝发送: %lu, 内核回退复制: %lu\n", zc_sent, zc_copied);
+    }
+    printf("QPS: %.2f\n", uptime > 0 ? (double)total_requests / uptime : 0);
+    
+    if (global_cache) {
+        printf("缓存统计: 大小=%zuMB, 项目数=%u\n", 
+               cache_get_size(global_cache) / (1024 * 1024), 
+               cache_get_count(global_cache));
+        printf("准入过滤拒绝: %lu\n", global_cache->admission_rejects);
+        printf("对象命中率: %.2f%%, 字节命中率: %.2f%%\n",
+               cache_object_hit_ratio(global_cache) * 100,
+               cache_byte_hit_ratio(global_cache) * 100);
+    }
+}
+
+static void handle_signal(int sig) {
     printf("\n=== 服务器状态报告 ===\n");
     printf("接收信号: %d\n", sig);
     
-    if (sig == SIGINT || sig == SIGTERM) {
-        printf("正在关闭服务器...\n");
-        
-        // 打印最终统计信息
-        struct timeval current_time;
-        gettimeofday(&current_time, NULL);
-        
-        double uptime = (current_time.tv_sec - start_time.tv_sec) + 
-                       (current_time.tv_usec - start_time.tv_usec) / 1000000.0;
-        
-        printf("运行时间: %.2f 秒\n", uptime);
-        printf("总请求数: %lu\n", total_requests);
-        printf("缓存命中数: %lu\n", cache_hits);
-        printf("缓存命中率: %.2f%%\n", total_requests > 0 ? 
-               (double)cache_hits / total_requests * 100 : 0);
-        printf("sendfile使用次数: %lu\n", sendfile_used);
-        printf("QPS: %.2f\n", uptime > 0 ? (double)total_requests / uptime : 0);
-        
-        // 清理资源
-        if (global_cache) {
-            printf("缓存统计: 大小=%zuMB, 项目数=%u\n", 
-                   cache_get_size(global_cache) / (1024 * 1024), 
-                   cache_get_count(global_cache));
-            cache_destroy(global_cache);
+    if (sig == SIGUSR1 && global_cache && global_cache->shared) {
+        printf("共享缓存模式只支持LRU，不切换算法\n");
+    }
+    else if (sig == SIGUSR1) {
+        // 切换缓存算法，手动切换后关闭自适应选择
+        if (global_cache) {
+            if (global_cache->adaptive) {
+                cache_set_adaptive(global_cache, 0);
+                printf("已关闭自适应缓存算法选择\n");
+            }
+            current_algorithm = cache_get_algorithm(global_cache);
+        }
+        current_algorithm = (cache_algorithm_t)((current_algorithm + 1) % CACHE_ALGORITHM_COUNT);
+        printf("切换缓存算法为: %s\n", cache_algorithm_name(current_algorithm));
+        
+        if (global_cache) {
+            cache_set_algorithm(global_cache, current_algorithm);
+        }
+    }
+    else if (sig == SIGHUP) {
+        // 文档根目录已更新，由重载线程重新打包快照
+        snapshot_request_reload();
+    }
+    else if (sig == SIGUSR2) {
+        // 显示当前状态
+        if (global_cache) current_algorithm = cache_get_algorithm(global_cache);
+        printf("当前缓存算法: %s%s\n", cache_algorithm_name(current_algorithm),
+               global_cache && global_cache->adaptive ? " (自适应)" : "");
+        if (global_cache && global_cache->adaptive) {
+            printf("自适应切换次数: %lu\n", global_cache->adapt_switches);
+        }
+        printf("文档根目录: %s\n", global_document_root);
+        printf("服务器端口: %d\n", global_server_port);
+        
+        if (global_cache) {
+            printf("缓存状态: 大小=%zuMB/%zuMB, 项目数=%u\n", 
+                cache_get_size(global_cache) / (1024 * 1024),
+                cache_get_max_size(global_cache) / (1024 * 1024),
+                cache_get_count(global_cache));
+            printf("对象命中率: %.2f%%, 字节命中率: %.2f%%\n",
+                   cache_object_hit_ratio(global_cache) * 100,
+                   cache_byte_hit_ratio(global_cache) * 100);
+        }
+    }
+}
+
+int server_process_signals(void) {
+    if (child_exited) {
+        child_exited = 0;
+        reap_workers();
+    }
+    if (switch_requested) {
+        switch_requested = 0;
+        handle_signal(SIGUSR1);
+    }
+    if (status_requested) {
+        status_requested = 0;
+        handle_signal(SIGUSR2);
+    }
+    if (reload_requested) {
+        reload_requested = 0;
+        handle_signal(SIGHUP);
+    }
+    return stop_requested;
+}
+
+const sigset_t *server_wait_sigmask(void) {
+    return &wait_sigmask;
+}
+
+void send_error_response(int client_fd, int code, const char *message) {
+    char response[1024];
+    int len = snprintf(response, sizeof(response),
+        "HTTP/1.1 %d %s\r\n"
+        "Content-Type: text/html\r\n"
+        "Connection: close\r\n"
+        "\r\n"
+        "<html><body><h1>%d %s</h1></body></html>",
+        code, message, code, message);
+    write(client_fd, response, len);
+}
+
+// 格式化HTTP日期(RFC 7231 IMF-fixdate)
+void format_http_date(time_t t, char *buf, size_t len) {
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    strftime(buf, len, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+}
+
+// 根据inode/大小/修改时间生成强ETag
+void build_etag(const struct stat *st, char *buf, size_t len) {
+    snprintf(buf, len, "\"%lx-%lx-%lx\"",
+             (unsigned long)st->st_ino, (unsigned long)st->st_size,
+             (unsigned long)st->st_mtime);
+}
+
+// 在请求头中查找指定字段(不区分大小写)，找到返回1并拷贝字段值
+static int get_header_value(const char *request, const char *name, char *out, size_t out_len) {
+    size_t name_len = strlen(name);
+    const char *line = strstr(request, "\r\n");
+    
+    while (line && line[2] != '\r' && line[2] != '\0') {
+        line += 2;
+        if (strncasecmp(line, name, name_len) == 0 && line[name_len] == ':') {
+            const char *value = line + name_len + 1;
+            while (*value == ' ' || *value == '\t') value++;
+            
+            const char *end = strstr(value, "\r\n");
+            size_t value_len = end ? (size_t)(end - value) : strlen(value);
+            while (value_len > 0 && (value[value_len - 1] == ' ' || value[value_len - 1] == '\t')) {
+                value_len--;
+            }
+            if (value_len >= out_len) value_len = out_len - 1;
+            memcpy(out, value, value_len);
+            out[value_len] = '\0';
+            return 1;
+        }
+        line = strstr(line, "\r\n");
+    }
+    return 0;
+}
+
+// If-None-Match使用弱比较: 忽略W/前缀，支持逗号分隔列表和"*"
+static int etag_list_matches(const char *list, const char *etag) {
+    size_t etag_len = strlen(etag);
+    const char *p = list;
+    
+    while (*p) {
+        while (*p == ' ' || *p == '\t' || *p == ',') p++;
+        if (*p == '\0') break;
+        if (*p == '*') return 1;
+        if (strncmp(p, "W/", 2) == 0) p += 2;
+        
+        const char *end = p;
+        if (*p == '"') {
+            end = strchr(p + 1, '"');
+            end = end ? end + 1 : p + strlen(p);
+        } else {
+            while (*end && *end != ',') end++;
+        }
+        if ((size_t)(end - p) == etag_len && strncmp(p, etag, etag_len) == 0) return 1;
+        p = end;
+    }
+    return 0;
+}
+
+// 判断条件请求是否可以直接返回304
+static int is_not_modified(const char *request, const char *etag, time_t mtime) {
+    char value[256];
+    
+    // If-None-Match优先于If-Modified-Since(RFC 7232 6)
+    if (get_header_value(request, "If-None-Match", value, sizeof(value))) {
+        return etag[0] != '\0' && etag_list_matches(value, etag);
+    }
+    
+    if (get_header_value(request, "If-Modified-Since", value, sizeof(value))) {
+        struct tm tm;
+        memset(&tm, 0, sizeof(tm));
+        if (strptime(value, "%a, %d %b %Y %H:%M:%S GMT", &tm) == NULL) return 0;
+        return mtime <= timegm(&tm);
+    }
+    
+    return 0;
+}
+
+// 等待socket可写，超过发送停滞时限仍无进展则放弃该连接
+static int wait_writable(int fd) {
+    struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+    int ret;
+    
+    do {
+        ret = poll(&pfd, 1, SEND_STALL_TIMEOUT_MS);
+    } while (ret < 0 && errno == EINTR);
+    
+    if (ret == 0) {
+        STAT_INC(send_stalls);
+        log_message(LOG_INFO, "连接 %d 发送停滞超时", fd);
+        return -1;
+    }
+    return ret < 0 ? -1 : 0;
+}
+
+// 完整写出缓冲区，非阻塞socket发送缓冲区满时等待可写
+static int write_all(int fd, const void *data, size_t len) {
+    const char *p = data;
+    
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n > 0) {
+            p += n;
+            len -= n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (wait_writable(fd) < 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// 与write_all相同但带MSG_MORE: 响应头不单独成段，与随后sendfile/splice发出的响应体合并，
+// 避免小的响应头段遇上Nagle和对端延迟确认而多等一个确认周期
+static int send_more(int fd, const void *data, size_t len) {
+    const char *p = data;
+    
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_MORE | MSG_NOSIGNAL);
+        if (n > 0) {
+            p += n;
+            len -= n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (wait_writable(fd) < 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// 使用sendfile完整发送文件区间
+static int sendfile_all(int client_fd, int file_fd, off_t offset, size_t len) {
+    while (len > 0) {
+        ssize_t n = sendfile(client_fd, file_fd, &offset, len);
+        if (n > 0) {
+            len -= n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (wait_writable(client_fd) < 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// 每个线程一个splice用的管道，线程退出时关闭
+static pthread_key_t splice_pipe_key;
+static pthread_once_t splice_pipe_once = PTHREAD_ONCE_INIT;
+
+static void close_splice_pipe(void *arg) {
+    int *fds = arg;
+    close(fds[0]);
+    close(fds[1]);
+    free(fds);
+}
+
+static void create_splice_pipe_key(void) {
+    pthread_key_create(&splice_pipe_key, close_splice_pipe);
+}
+
+// 经管道把文件区间splice到socket: 数据留在页缓存中，不经过用户态
+// 出错时管道中可能残留数据，丢弃该管道，下次重新创建
+static int splice_all(int client_fd, int file_fd, off_t offset, size_t len) {
+    pthread_once(&splice_pipe_once, create_splice_pipe_key);
+    int *fds = pthread_getspecific(splice_pipe_key);
+    if (!fds) {
+        fds = malloc(2 * sizeof(int));
+        if (!fds || pipe2(fds, O_CLOEXEC) != 0) {
+            free(fds);
+            return -1;
+        }
+        pthread_setspecific(splice_pipe_key, fds);
+    }
+    
+    while (len > 0) {
+        size_t chunk = len < TRANSFER_SPLICE_CHUNK ? len : TRANSFER_SPLICE_CHUNK;
+        ssize_t in = splice(file_fd, &offset, fds[1], NULL, chunk, SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (in < 0 && errno == EINTR) continue;
+        if (in <= 0) goto fail;
+        len -= in;
+        
+        while (in > 0) {
+            ssize_t out = splice(fds[0], NULL, client_fd, NULL, in,
+                                 SPLICE_F_MOVE | (len > 0 ? SPLICE_F_MORE : 0));
+            if (out > 0) {
+                in -= out;
+            } else if (out < 0 && errno == EINTR) {
+                continue;
+            } else if (out < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                if (wait_writable(client_fd) < 0) goto fail;
+            } else {
+                goto fail;
+            }
+        }
+    }
+    return 0;
+
+fail:
+    pthread_setspecific(splice_pipe_key, NULL);
+    close_splice_pipe(fds);
+    return -1;
+}
+
+// 用一次writev发送多段内存数据，处理部分写(会修改iov)
+static int writev_all(int fd, struct iovec *iov, int iovcnt) {
+    int first = 0;
+    
+    while (first < iovcnt) {
+        ssize_t n = writev(fd, &iov[first], iovcnt - first);
+        if (n > 0) {
+            while (first < iovcnt && (size_t)n >= iov[first].iov_len) {
+                n -= iov[first].iov_len;
+                first++;
+            }
+            if (first < iovcnt) {
+                iov[first].iov_base = (char *)iov[first].iov_base + n;
+                iov[first].iov_len -= n;
+            }
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (wait_writable(fd) < 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// 构建304 Not Modified响应头，只包含校验器
+static int build_not_modified_header(char *header, size_t header_size,
+                                     const char *etag, time_t mtime, int keep_alive) {
+    char date[64], last_modified[64];
+    format_http_date(time(NULL), date, sizeof(date));
+    format_http_date(mtime, last_modified, sizeof(last_modified));
+    
+    return snprintf(header, header_size,
+        "HTTP/1.1 304 Not Modified\r\n"
+        "ETag: %s\r\n"
+        "Last-Modified: %s\r\n"
+        "Connection: %s\r\n"
+        "Date: %s\r\n"
+        "Server: MyWebServer/1.0\r\n"
+        "\r\n",
+        etag, last_modified, keep_alive ? "keep-alive" : "close", date);
+}
+
+// 发送304 Not Modified，不发送响应体
+static int send_not_modified(int client_fd, const char *etag, time_t mtime, int keep_alive) {
+    char header[512];
+    int header_len = build_not_modified_header(header, sizeof(header), etag, mtime, keep_alive);
+    return write_all(client_fd, header, header_len);
+}
+
+// 根据文件扩展名确定Content-Type
+const char *get_content_type(const char *filename) {
+    if (strstr(filename, ".html")) return "text/html";
+    else if (strstr(filename, ".css")) return "text/css";
+    else if (strstr(filename, ".js")) return "application/javascript";
+    else if (strstr(filename, ".png")) return "image/png";
+    else if (strstr(filename, ".jpg") || strstr(filename, ".jpeg")) return "image/jpeg";
+    else if (strstr(filename, ".gif")) return "image/gif";
+    else if (strstr(filename, ".ico")) return "image/x-icon";
+    return "text/plain";
+}
+
+// 构建200响应头
+static int build_file_header(char *header, size_t header_size, const char *filename,
+                             size_t size, const char *etag, time_t mtime, int keep_alive) {
+    const char *content_type = get_content_type(filename);
+    
+    char date[64], last_modified[64];
+    format_http_date(time(NULL), date, sizeof(date));
+    format_http_date(mtime, last_modified, sizeof(last_modified));
+    
+    return snprintf(header, header_size,
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: %s\r\n"
+        "Content-Length: %zu\r\n"
+        "ETag: %s\r\n"
+        "Last-Modified: %s\r\n"
+        "Connection: %s\r\n"
+        "Date: %s\r\n"
+        "Server: MyWebServer/1.0\r\n"
+        "\r\n",
+        content_type, size, etag, last_modified, keep_alive ? "keep-alive" : "close", date);
+}
+
+static uint64_t thread_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// 发送响应头和响应体: 按数据所在位置列出可用的方式，由传输策略按对象大小和测得的CPU开销选择
+// data为内存中的响应体(mapped表示是文件映射)，file_fd为已打开的文件(-1表示没有)
+static int send_body(int client_fd, const char *header, int header_len,
+                     const void *data, int mapped, int file_fd, size_t size) {
+    if (size == 0) return write_all(client_fd, header, header_len);
+    
+    // 只有调用者打开的文件才能sendfile/splice: 按文件名重新打开得到的可能已是被替换的新文件，
+    // 内存中的数据(缓存命中)只能writev，没有内存数据时可临时映射
+    unsigned int candidates = TRANSFER_CAN(data && !mapped ? TRANSFER_WRITEV : TRANSFER_MMAP);
+    if (file_fd >= 0) candidates |= TRANSFER_CAN(TRANSFER_SENDFILE) | TRANSFER_CAN(TRANSFER_SPLICE);
+    else if (!data) return -1;
+    transfer_strategy_t strategy = transfer_choose(candidates, size);
+    uint64_t start = thread_cpu_ns();
+    
+    int ret = -1;
+    if (strategy == TRANSFER_WRITEV || strategy == TRANSFER_MMAP) {
+        void *map = NULL;
+        if (!data) {
+            map = mmap(NULL, size, PROT_READ, MAP_SHARED, file_fd, 0);
+            if (map == MAP_FAILED) map = NULL;
+        }
+        if (data || map) {
+            struct iovec iov[2] = {
+                { .iov_base = (void *)header, .iov_len = header_len },
+                { .iov_base = data ? (void *)data : map, .iov_len = size }
+            };
+            ret = writev_all(client_fd, iov, 2);
+        }
+        if (map) munmap(map, size);
+        if (strategy == TRANSFER_MMAP) STAT_INC(mmap_served);
+    } else if (send_more(client_fd, header, header_len) == 0) {
+        // sendfile/splice发出最后一段时不带MORE标志，内核随即推送
+        if (strategy == TRANSFER_SENDFILE) {
+            ret = sendfile_all(client_fd, file_fd, 0, size);
+            STAT_INC(sendfile_used);
+        } else {
+            ret = splice_all(client_fd, file_fd, 0, size);
+        }
+    }
+    
+    if (ret == 0) transfer_record(strategy, size, thread_cpu_ns() - start);
+    return ret;
+}
+
+int send_file_response(int client_fd, const char *filename, void *data, size_t size,
+                       const char *etag, time_t mtime, int keep_alive) {
+    char header[1024];
+    int header_len = build_file_header(header, sizeof(header), filename, size, etag, mtime,
+                                       keep_alive);
+    return send_body(client_fd, header, header_len, data, 0, -1, size);
+}
+
+// 从文件映射或已打开的文件发送(file_fd为-1时只能发送映射)
+static int send_mapped_response(int client_fd, const char *filename, const void *map, int file_fd,
+                                size_t size, const char *etag, time_t mtime, int keep_alive) {
+    char header[1024];
+    int header_len = build_file_header(header, sizeof(header), filename, size, etag, mtime,
+                                       keep_alive);
+    return send_body(client_fd, header, header_len, map, map != NULL, file_fd, size);
+}
+
+// 零拷贝发送缓存项: 响应头普通发送，响应体由内核直接引用缓存内存
+// *tracked为1时缓存项引用已转交给连接，由事件循环在完成通知到达后释放
+static int send_zerocopy_response(client_context_t *ctx, const char *filename,
+                                  cache_item_t *item, int *tracked) {
+    int fd = ctx->client_fd;
+    char header[1024];
+    int header_len = build_file_header(header, sizeof(header), filename, item->size,
+                                       item->etag, item->mtime, ctx->keep_alive);
+    
+    // 先回收之前响应的完成通知，限制固定页面数
+    zerocopy_reap(fd, ctx->zc, ctx->cache);
+    
+    int ret = write_all(fd, header, header_len);
+    const char *p = item->data;
+    size_t left = item->size;
+    while (ret == 0 && left > 0) {
+        ssize_t n = zerocopy_send(fd, ctx->zc, p, left);
+        if (n > 0) {
+            p += n;
+            left -= n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (wait_writable(fd) < 0) ret = -1;
+        } else if (n < 0 && errno == ENOBUFS) {
+            // 固定页面超出optmem限制，其余部分改为复制发送
+            ret = write_all(fd, p, left);
+            left = 0;
+        } else {
+            ret = -1;
+        }
+    }
+    
+    *tracked = zerocopy_track(ctx->zc, item);
+    return ret;
+}
+
+// 派生count-1个工作进程，返回本进程的编号(父进程为0)
+static int fork_workers(int count) {
+    worker_pids = calloc(count, sizeof(pid_t));
+    if (!worker_pids) return 0;
+    
+    pid_t parent = getpid();
+    for (int i = 1; i < count; i++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            // 父进程退出时子进程随之退出
+            prctl(PR_SET_PDEATHSIG, SIGTERM);
+            if (getppid() != parent) exit(EXIT_FAILURE);
+            free(worker_pids);
+            worker_pids = NULL;
+            worker_pid_count = 0;
+            return i;
+        }
+        if (pid < 0) {
+            perror("fork");
+            break;
+        }
+        worker_pids[worker_pid_count++] = pid;
+    }
+    printf("Prefork: %d worker processes\n", worker_pid_count + 1);
+    return 0;
+}
+
+// 父进程的事件循环结束(收到SIGTERM或监听socket已交给新进程)时通知所有工作进程，
+// 各进程同时停止accept并排空，不再在父进程排空期间继续接受连接
+static void signal_workers(void) {
+    for (int i = 0; i < worker_pid_count; i++) {
+        if (worker_pids[i] > 0) kill(worker_pids[i], SIGTERM);
+    }
+}
+
+// 工作进程退出后它持有的共享缓存引用不会再释放，由父进程代为归还
+static void worker_exited(int index, int status) {
+    pid_t pid = worker_pids[index];
+    if (global_cache && global_cache->shared) shm_cache_reclaim(global_cache->shared, pid);
+    worker_pids[index] = 0;
+    
+    if (WIFSIGNALED(status)) {
+        log_message(LOG_WARN, "工作进程 %d 被信号 %d 终止", pid, WTERMSIG(status));
+    } else if (WIFEXITED(status) && WEXITSTATUS(status) != 0) {
+        log_message(LOG_WARN, "工作进程 %d 退出，状态 %d", pid, WEXITSTATUS(status));
+    }
+}
+
+// 收到SIGCHLD后回收已退出的工作进程
+static void reap_workers(void) {
+    int status;
+    pid_t pid;
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        for (int i = 0; i < worker_pid_count; i++) {
+            if (worker_pids[i] == pid) worker_exited(i, status);
+        }
+    }
+}
+
+// 父进程退出前等待所有工作进程
+static void stop_workers(void) {
+    for (int i = 0; i < worker_pid_count; i++) {
+        int status;
+        if (worker_pids[i] > 0 && waitpid(worker_pids[i], &status, 0) == worker_pids[i]) {
+            worker_exited(i, status);
+        }
+    }
+    free(worker_pids);
+    worker_pids = NULL;
+    worker_pid_count = 0;
+}
+
+// 缓存快照中的项只有在文件未被修改或替换时才能恢复
+static int validate_cached_file(const struct stat *st, const char *etag) {
+    char current[64];
+    build_etag(st, current, sizeof(current));
+    return strcmp(current, etag) == 0;
+}
+
+// 每个线程缓存当前秒的Date字符串，避免每个请求都格式化
+static const char *current_http_date(void) {
+    static __thread time_t cached_time = 0;
+    static __thread char cached_date[64];
+    time_t now = time(NULL);
+    if (now != cached_time) {
+        format_http_date(now, cached_date, sizeof(cached_date));
+        cached_time = now;
+    }
+    return cached_date;
+}
+
+// 从快照发送: 预构建的响应头前缀 + Connection/Date + 文件内容，一次writev
+// body_bytes得到发送的响应体长度(304为0)
+static int send_snapshot_response(int client_fd, const snapshot_t *snapshot,
+                                  const snapshot_entry_t *entry, const char *request,
+                                  int keep_alive, size_t *body_bytes) {
+    if (is_not_modified(request, entry->etag, entry->mtime)) {
+        STAT_INC(not_modified_sent);
+        *body_bytes = 0;
+        return send_not_modified(client_fd, entry->etag, entry->mtime, keep_alive);
+    }
+    *body_bytes = entry->body_len;
+    
+    char tail[128];
+    int tail_len = snprintf(tail, sizeof(tail), "Connection: %s\r\nDate: %s\r\n\r\n",
+                            keep_alive ? "keep-alive" : "close", current_http_date());
+    struct iovec iov[3] = {
+        { .iov_base = snapshot->buffer + entry->header_offset, .iov_len = entry->header_len },
+        { .iov_base = tail, .iov_len = tail_len },
+        { .iov_base = snapshot->buffer + entry->body_offset, .iov_len = entry->body_len }
+    };
+    return writev_all(client_fd, iov, 3);
+}
+
+// 错误码对应的状态描述
+static const char *status_text(int code) {
+    switch (code) {
+        case 400: return "Bad Request";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 408: return "Request Timeout";
+        case 411: return "Length Required";
+        case 413: return "Payload Too Large";
+        case 414: return "URI Too Long";
+        case 501: return "Not Implemented";
+        case 502: return "Bad Gateway";
+        case 504: return "Gateway Timeout";
+        default: return "Internal Server Error";
+    }
+}
+
+// 请求对应的资源: key为规范化路径(缓存和快照的key，相对文档根目录)，hash在这里算一次
+typedef struct {
+    char key[MAX_PATH_LENGTH];
+    unsigned int hash;
+    char filepath[1024];       // document_root + key
+} request_path_t;
+
+// 解析请求行并映射到文件路径，成功返回0，否则返回HTTP错误码
+static int resolve_request_path(const char *request, const char *document_root,
+                                request_path_t *path) {
+    char method[16], target[1024], protocol[16];
+    if (sscanf(request, "%15s %1023s %15s", method, target, protocol) != 3) {
+        return 400;
+    }
+    
+    // 只处理GET请求
+    if (strcasecmp(method, "GET") != 0) {
+        return 501;
+    }
+    
+    // 等价的URL(查询串、重复斜杠、.和..段、百分号编码)映射到同一个key，..不能越过根目录
+    int status = urlpath_normalize(target, path->key, sizeof(path->key));
+    if (status != 0) return status;
+    
+    // 构建文件路径
+    if (snprintf(path->filepath, sizeof(path->filepath), "%s%s",
+                 document_root, path->key) >= (int)sizeof(path->filepath)) {
+        return 414;
+    }
+    path->hash = cache_key_hash(path->key);
+    return 0;
+}
+
+// 代理路由按规范化后的路径匹配，与本地文件的key一致: //api/x、/a/../api/x都属于/api，
+// /api/../x不属于；无法规范化的路径不转发，按本地请求返回相同的错误
+static upstream_t *route_request(const char *request) {
+    char target[1024], key[MAX_PATH_LENGTH];
+    if (!reverse_proxy || sscanf(request, "%*s %1023s", target) != 1 ||
+        urlpath_normalize(target, key, sizeof(key)) != 0) {
+        return NULL;
+    }
+    return proxy_route(reverse_proxy, key);
+}
+
+// 请求路径属于代理路由时不映射到文档根目录
+static int is_proxied(const char *request) {
+    return route_request(request) != NULL;
+}
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// 计入热点统计: path为文档根目录下的路径或"proxy:"加代理的URL路径，start_us为0时不计耗时
+static void track_request(const char *path, int hit, size_t bytes, uint64_t start_us) {
+    if (!hot_paths) return;
+    hitters_record(hot_paths, path, hit, bytes, start_us ? now_us() - start_us : 0);
+}
+
+// io_uring快速路径: 缓存命中时生成响应头并返回持有引用的缓存项
+// keep_alive传入非0表示后端可以保持连接，返回时为响应头中声明的值
+cache_item_t *prepare_cached_response(cache_t *cache, const char *document_root,
+                                      const char *request, char *header, size_t header_size,
+                                      int *header_len, int *send_body, int *keep_alive) {
+    // 升级到h2c的请求由工作线程处理
+    char value[32];
+    request_path_t path;
+    if (get_header_value(request, "Upgrade", value, sizeof(value)) || is_proxied(request) ||
+        resolve_request_path(request, document_root, &path) != 0) {
+        return NULL;
+    }
+    
+    uint64_t start_us = now_us();
+    cache_item_t *cached = cache_lookup(cache, path.key, path.hash);
+    if (!cached) return NULL;
+    
+    STAT_INC(total_requests);
+    STAT_INC(cache_hits);
+    
+    // 与工作线程相同: 带请求体的请求之后无法确定下一个请求的起点，响应后关闭连接
+    if (*keep_alive) {
+        *keep_alive = wants_keep_alive(request) &&
+                      !(get_header_value(request, "Content-Length", value, sizeof(value)) &&
+                        strcmp(value, "0") != 0) &&
+                      !get_header_value(request, "Transfer-Encoding", value, sizeof(value));
+    }
+    
+    if (is_not_modified(request, cached->etag, cached->mtime)) {
+        STAT_INC(not_modified_sent);
+        *header_len = build_not_modified_header(header, header_size, cached->etag,
+                                                cached->mtime, *keep_alive);
+        *send_body = 0;
+    } else {
+        *header_len = build_file_header(header, header_size, path.filepath, cached->size,
+                                        cached->etag, cached->mtime, *keep_alive);
+        *send_body = 1;
+    }
+    track_request(path.key, 1, *send_body ? cached->size : 0, start_us);
+    return cached;
+}
+
+// 从磁盘读取文件并响应: 提示顺序预读，分块读取的同时把数据流式写给客户端
+// 完整发送了可保持连接的响应时返回0，sent为响应体字节数
+static int serve_from_disk(int client_fd, cache_t *cache, const char *request,
+                           const request_path_t *path, int keep_alive, size_t *sent) {
+    const char *filepath = path->filepath;
+    *sent = 0;
+    int file_fd = open(filepath, O_RDONLY);
+    if (file_fd < 0) {
+        send_error_response(client_fd, 404, "Not Found");
+        return -1;
+    }
+    
+    struct stat file_stat;
+    if (fstat(file_fd, &file_stat) < 0) {
+        send_error_response(client_fd, 500, "Internal Server Error");
+        close(file_fd);
+        return -1;
+    }
+    
+    // 不带结尾'/'的目录(/sub)不是文件，带'/'的已规范化为目录下的index.html
+    if (!S_ISREG(file_stat.st_mode)) {
+        send_error_response(client_fd, 404, "Not Found");
+        close(file_fd);
+        return -1;
+    }
+    
+    char etag[64];
+    build_etag(&file_stat, etag, sizeof(etag));
+    cache_note_miss(cache, file_stat.st_size);
+    
+    // 条件请求命中时直接返回304，无需读取文件内容
+    if (is_not_modified(request, etag, file_stat.st_mtime)) {
+        STAT_INC(not_modified_sent);
+        close(file_fd);
+        return send_not_modified(client_fd, etag, file_stat.st_mtime, keep_alive);
+    }
+    
+    size_t size = file_stat.st_size;
+    *sent = size;
+    posix_fadvise(file_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    readahead(file_fd, 0, DISK_READAHEAD_SIZE);
+    
+    // 超过单项上限的大文件不缓存，从已打开的文件发送
+    if (size >= MAX_CACHE_ITEM_SIZE) {
+        int ret = send_mapped_response(client_fd, filepath, NULL, file_fd, size, etag,
+                                       file_stat.st_mtime, keep_alive);
+        close(file_fd);
+        return ret;
+    }
+    
+    // 较大的文件只读映射后直接进入缓存: 数据只在页缓存中存在一份，内存紧张时可由内核回收
+    // 映射期间文件被原地截断时，内核发送时得到EFAULT，用户态读取(HTTP/2分帧)经mapguard保护
+    if (size >= MMAP_THRESHOLD) {
+        void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, file_fd, 0);
+        if (map != MAP_FAILED) {
+            madvise(map, size, MADV_WILLNEED);
+            int ret = send_mapped_response(client_fd, filepath, map, file_fd, size, etag,
+                                           file_stat.st_mtime, keep_alive);
+            close(file_fd);
+            if (cache_put_mapped(cache, path->key, map, size, file_stat.st_mtime, etag) != 0) {
+                munmap(map, size);
+            }
+            return ret;
+        }
+    }
+    
+    // 读取缓冲区计入内存账目，同时进行的未命中过多时不缓冲，直接从文件发送且不缓存
+    if (cache_reserve_buffer(cache, size) != 0) {
+        int ret = send_mapped_response(client_fd, filepath, NULL, file_fd, size, etag,
+                                       file_stat.st_mtime, keep_alive);
+        close(file_fd);
+        return ret;
+    }
+    void *file_data = size > 0 ? malloc(size) : NULL;
+    if (size > 0 && !file_data) {
+        cache_release_buffer(cache, size);
+        send_error_response(client_fd, 500, "Internal Server Error");
+        close(file_fd);
+        return -1;
+    }
+    
+    char header[1024];
+    int header_len = build_file_header(header, sizeof(header), filepath, size,
+                                       etag, file_stat.st_mtime, keep_alive);
+    int client_ok = write_all(client_fd, header, header_len) == 0;
+    
+    size_t offset = 0;
+    while (offset < size) {
+        size_t chunk = size - offset < DISK_CHUNK_SIZE ? size - offset : DISK_CHUNK_SIZE;
+        
+        // 预读下一个窗口，使磁盘读取与当前块的网络发送重叠
+        if (offset + chunk < size) {
+            readahead(file_fd, offset + chunk, DISK_READAHEAD_SIZE);
+        }
+        
+        ssize_t n = pread(file_fd, (char *)file_data + offset, chunk, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        
+        // 客户端断开后继续读完，数据仍可进入缓存
+        if (client_ok && write_all(client_fd, (char *)file_data + offset, n) < 0) {
+            client_ok = 0;
+        }
+        offset += n;
+    }
+    
+    // 文件在fstat之后变短: 已发出的Content-Length无法兑现，返回-1让调用者关闭连接而不是保持
+    if (offset != size) {
+        log_message(LOG_WARN, "读取 %s 时文件变短(%zu/%zu字节)，关闭连接", filepath, offset, size);
+    } else if (size > 0) {
+        cache_put(cache, path->key, file_data, size, file_stat.st_mtime, etag);
+    }
+    free(file_data);
+    cache_release_buffer(cache, size);
+    close(file_fd);
+    return client_ok && offset == size ? 0 : -1;
+}
+
+// 请求结束: keep-alive且响应完整时把连接交还事件循环，否则关闭
+static void finish_request(client_context_t *ctx, int response_ok) {
+    if (ctx->release) {
+        ctx->release(ctx->owner, ctx->client_fd, response_ok && ctx->keep_alive);
+    } else {
+        close(ctx->client_fd);
+    }
+    free(ctx->request);
+    free(ctx);
+}
+
+// 磁盘I/O线程池任务
+static void disk_io_task(void *arg) {
+    client_context_t *ctx = (client_context_t *)arg;
+    request_path_t path;
+    int ret = -1;
+    
+    if (resolve_request_path(ctx->request, ctx->document_root, &path) == 0) {
+        size_t sent;
+        ret = serve_from_disk(ctx->client_fd, ctx->cache, ctx->request, &path, ctx->keep_alive, &sent);
+        track_request(path.key, 0, sent, ctx->start_us);
+    }
+    
+    finish_request(ctx, ret == 0);
+}
+
+// 读取完整请求头，数据不足时等待到deadline为止(防止慢速发送长期占用工作线程)
+// buffer中已有have字节(上一个请求之后管线化的数据)，其中已有完整请求头时不再读取
+static ssize_t read_request(int client_fd, char *buffer, size_t size, size_t have,
+                            uint64_t deadline_ms) {
+    size_t total = have;
+    buffer[total] = '\0';
+    if (total > 0 && strstr(buffer, "\r\n\r\n")) return total;
+    
+    while (total < size - 1) {
+        ssize_t n = read(client_fd, buffer + total, size - 1 - total);
+        if (n > 0) {
+            total += n;
+            buffer[total] = '\0';
+            if (strstr(buffer, "\r\n\r\n")) break;
+            continue;
+        }
+        if (n == 0) return total > 0 ? (ssize_t)total : -1;
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) return -1;
+        
+        int timeout = -1;
+        if (deadline_ms > 0) {
+            uint64_t now = timer_now_ms();
+            if (now >= deadline_ms) {
+                STAT_INC(header_timeouts);
+                return -1;
+            }
+            timeout = (int)(deadline_ms - now);
+        }
+        struct pollfd pfd = { .fd = client_fd, .events = POLLIN };
+        int ret = poll(&pfd, 1, timeout);
+        if (ret == 0) {
+            STAT_INC(header_timeouts);
+            return -1;
+        }
+        if (ret < 0 && errno != EINTR) return -1;
+    }
+    
+    buffer[total] = '\0';
+    return total;
+}
+
+// HTTP/1.1默认保持连接，HTTP/1.0需显式请求
+static int wants_keep_alive(const char *request) {
+    char protocol[16], connection[64];
+    if (sscanf(request, "%*s %*s %15s", protocol) != 1) return 0;
+    
+    int keep_alive = strcmp(protocol, "HTTP/1.1") == 0;
+    if (get_header_value(request, "Connection", connection, sizeof(connection))) {
+        if (strcasestr(connection, "close")) keep_alive = 0;
+        else if (strcasestr(connection, "keep-alive")) keep_alive = 1;
+    }
+    return keep_alive;
+}
+
+// 当前请求占用了buffer的前consumed字节，之后读到的数据保存到连接上，作为下一个请求的开头
+// 只有保持的连接需要保存，保存失败时返回-1(调用者应关闭连接，否则后续请求会丢失)
+static int keep_pipelined(client_context_t *ctx, const char *buffer, size_t len, size_t consumed) {
+    if (consumed >= len || !ctx->pending || !ctx->keep_alive) return 0;
+    
+    char *data = malloc(len - consumed);
+    if (!data) return -1;
+    memcpy(data, buffer + consumed, len - consumed);
+    free(ctx->pending->data);
+    ctx->pending->data = data;
+    ctx->pending->len = len - consumed;
+    return 0;
+}
+
+// 预先渲染的过载响应，过载时不做任何格式化或分配
+static const char overload_response[] =
+    "HTTP/1.1 503 Service Unavailable\r\n"
+    "Content-Type: text/html\r\n"
+    "Content-Length: 58\r\n"
+    "Retry-After: " OVERLOAD_RETRY_AFTER "\r\n"
+    "Connection: close\r\n"
+    "\r\n"
+    "<html><body><h1>503 Service Unavailable</h1></body></html>";
+
+void send_overload_response(int client_fd) {
+    STAT_INC(overload_rejected);
+    // 尽力而为的非阻塞发送，发不出去也不等待
+    send(client_fd, overload_response, sizeof(overload_response) - 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+}
+
+// 排队时间过长被线程池丢弃的请求: 快速返回503
+void shed_client_request(void *arg) {
+    client_context_t *ctx = (client_context_t *)arg;
+    
+    // 连接上是HTTP/2会话，新到的数据是帧: 发送GOAWAY后关闭，未处理的流客户端可以重试
+    if (ctx->h2 && *ctx->h2) {
+        h2_session_goaway(*ctx->h2, ctx->client_fd);
+        finish_request(ctx, 0);
+        return;
+    }
+    send_overload_response(ctx->client_fd);
+    finish_request(ctx, 0);
+}
+
+// 发送proxy_entry_t布局的代理响应，补上长度、连接和Age头部
+static int send_proxy_response(int client_fd, const char *data, size_t size, int keep_alive,
+                               long age) {
+    proxy_entry_t entry;
+    memcpy(&entry, data, sizeof(entry));
+    const char *headers = data + sizeof(entry);
+    size_t body_len = size - sizeof(entry) - entry.header_len;
+    
+    char extra[128];
+    int extra_len = 0;
+    if (!entry.bodyless) {
+        extra_len += snprintf(extra + extra_len, sizeof(extra) - extra_len,
+                              "Content-Length: %zu\r\n", body_len);
+    }
+    if (age > 0) {
+        extra_len += snprintf(extra + extra_len, sizeof(extra) - extra_len, "Age: %ld\r\n", age);
+    }
+    extra_len += snprintf(extra + extra_len, sizeof(extra) - extra_len, "Connection: %s\r\n\r\n",
+                          keep_alive ? "keep-alive" : "close");
+    
+    struct iovec iov[3] = {
+        { .iov_base = (void *)headers, .iov_len = entry.header_len },
+        { .iov_base = extra, .iov_len = extra_len },
+        { .iov_base = (void *)(headers + entry.header_len), .iov_len = body_len }
+    };
+    return writev_all(client_fd, iov, body_len > 0 ? 3 : 2);
+}
+
+// 一次转发的工作线程侧状态，req必须是第一个成员(complete回调拿到的是req)
+typedef struct {
+    proxy_request_t req;
+    client_context_t *ctx;
+    char key[1200];            // 缓存key，空串表示不缓存
+    char path[1040];           // 热点统计的key: proxy:加请求路径，不会写入预热列表
+} proxy_job_t;
+
+// 上游响应完成后在工作线程中执行: 写给客户端，可缓存的响应同时放入缓存
+static void proxy_response_task(void *arg) {
+    proxy_job_t *job = (proxy_job_t *)arg;
+    proxy_request_t *req = &job->req;
+    client_context_t *ctx = job->ctx;
+    int ret = -1;
+    size_t body_len = 0;
+    
+    if (!req->response) {
+        if (req->status == 503) send_overload_response(ctx->client_fd);
+        else send_error_response(ctx->client_fd, req->status, status_text(req->status));
+    } else {
+        proxy_entry_t entry;
+        memcpy(&entry, req->response, sizeof(entry));
+        body_len = req->response_len - sizeof(entry) - entry.header_len;
+        ret = send_proxy_response(ctx->client_fd, req->response, req->response_len,
+                                  ctx->keep_alive, entry.age);
+        if (entry.expires > 0 && job->key[0] &&
+            cache_put(ctx->cache, job->key, req->response, req->response_len,
+                      entry.stored, "") == 0) {
+            STAT_INC(proxy_cache_stores);
+        }
+    }
+    
+    track_request(job->path, 0, body_len, ctx->start_us);
+    free(req->request);
+    free(req->response);
+    free(job);
+    finish_request(ctx, ret == 0);
+}
+
+// 匹配代理路由的请求: 新鲜的缓存响应直接返回，否则交给事件循环转发给上游
+// 请求不属于任何路由时返回0，否则请求已处理(或已提交)
+static int forward_to_upstream(client_context_t *ctx, const char *buffer, size_t len) {
+    char method[16], raw[1024], path[1024];
+    if (sscanf(buffer, "%15s %1023s", method, raw) != 2) return 0;
+    upstream_t *upstream = route_request(buffer);
+    if (!upstream) return 0;
+    
+    if (ctx->release) ctx->keep_alive = wants_keep_alive(buffer);
+    
+    const char *header_end = strstr(buffer, "\r\n\r\n");
+    int status = 0;
+    char value[128];
+    size_t body_len = 0;
+    // 消息长度有歧义的请求不转发，上游对请求边界的理解可能与这里不同(请求走私)
+    if (!header_end || proxy_check_framing(buffer, header_end + 4 - buffer) != 0) {
+        status = 400;
+    } else if (get_header_value(buffer, "Transfer-Encoding", value, sizeof(value))) {
+        status = 411;  // 分块上传需要边读边转发，不支持
+    } else if (get_header_value(buffer, "Content-Length", value, sizeof(value))) {
+        if (proxy_parse_content_length(value, &body_len) != 0) status = 400;
+        else if (body_len > PROXY_MAX_BODY) status = 413;
+    }
+    // 上游收到规范化后的路径(与路由匹配的一致)而不是原始请求目标
+    // 路由时已经规范化成功，这里只会因重新编码后过长或查询串中的控制字符失败
+    if (status == 0) status = urlpath_forward_target(raw, path, sizeof(path));
+    if (status != 0) {
+        send_error_response(ctx->client_fd, status, status_text(status));
+        finish_request(ctx, 0);
+        return 1;
+    }
+    size_t header_len = header_end + 4 - buffer;
+    
+    // 请求体之后已读到的数据属于下一个请求(请求体没有读完时不会有)
+    if (keep_pipelined(ctx, buffer, len, header_len + body_len) != 0) ctx->keep_alive = 0;
+    
+    // 只缓存不带凭据的GET；no-cache请求跳过查找但可以刷新缓存
+    int is_get = strcasecmp(method, "GET") == 0;
+    int cacheable = is_get && !get_header_value(buffer, "Authorization", value, sizeof(value));
+    int lookup = cacheable;
+    if (get_header_value(buffer, "Cache-Control", value, sizeof(value))) {
+        if (strcasestr(value, "no-store")) cacheable = lookup = 0;
+        if (strcasestr(value, "no-cache")) lookup = 0;
+    }
+    if (get_header_value(buffer, "Pragma", value, sizeof(value)) && strcasestr(value, "no-cache")) {
+        lookup = 0;
+    }
+    
+    proxy_job_t *job = calloc(1, sizeof(proxy_job_t));
+    if (!job) {
+        send_error_response(ctx->client_fd, 500, "Internal Server Error");
+        finish_request(ctx, 0);
+        return 1;
+    }
+    if (cacheable) {
+        snprintf(job->key, sizeof(job->key), "proxy:%s%s", proxy_upstream_name(upstream), path);
+    }
+    snprintf(job->path, sizeof(job->path), "proxy:%s", path);
+    
+    if (lookup) {
+        cache_item_t *cached = cache_get(ctx->cache, job->key);
+        if (cached) {
+            proxy_entry_t entry;
+            memcpy(&entry, cached->data, sizeof(entry));
+            time_t now = time(NULL);
+            if (now < entry.expires) {
+                STAT_INC(cache_hits);
+                STAT_INC(proxy_cache_hits);
+                int ret = send_proxy_response(ctx->client_fd, cached->data, cached->size,
+                                              ctx->keep_alive, entry.age + (now - entry.stored));
+                track_request(job->path, 1, cached->size - sizeof(entry) - entry.header_len,
+                              ctx->start_us);
+                cache_release(ctx->cache, cached);
+                free(job);
+                finish_request(ctx, ret == 0);
+                return 1;
+            }
+            // 已过期，由这次转发的响应替换
+            cache_release(ctx->cache, cached);
+            cache_remove(ctx->cache, job->key);
         }
-        
-        printf("服务器已关闭\n");
-        exit(0);
     }
-    else if (sig == SIGUSR1) {
-        // 切换缓存算法
-        if (current_algorithm == LRU) {
-            current_algorithm = LFU;
-            printf("切换缓存算法为: LFU\n");
-        } else {
-            current_algorithm = LRU;
-            printf("切换缓存算法为: LRU\n");
-        }
-        
-        if (global_cache) {
-            cache_set_algorithm(global_cache, current_algorithm);
-        }
+    
+    // 请求体可能只读到一部分，剩余部分由代理的事件循环读取，工作线程不等待
+    size_t body_have = len - header_len < body_len ? len - header_len : body_len;
+    if (body_have < body_len && get_header_value(buffer, "Expect", value, sizeof(value)) &&
+        strcasecmp(value, "100-continue") == 0) {
+        write_all(ctx->client_fd, "HTTP/1.1 100 Continue\r\n\r\n", 25);
     }
-    else if (sig == SIGUSR2) {
-        // 显示当前状态
-        printf("当前缓存算法: %s\n", current_algorithm == LRU ? "LRU" : "LFU");
-        printf("文档根目录: %s\n", global_document_root);
-        printf("服务器端口: %d\n", global_server_port);
-        
-        if (global_cache) {
-            printf("缓存状态: 大小=%zuMB/%zuMB, 项目数=%u\n", 
-                cache_get_size(global_cache) / (1024 * 1024),
-                (size_t)(MAX_CACHE_SIZE / (1024 * 1024)),  // 确保类型一致
-                cache_get_count(global_cache));
-        }
+    
+    job->ctx = ctx;
+    job->req.client_fd = ctx->client_fd;
+    job->req.upstream = upstream;
+    job->req.head = strcasecmp(method, "HEAD") == 0;
+    job->req.idempotent = is_get || job->req.head || strcasecmp(method, "PUT") == 0 ||
+                          strcasecmp(method, "DELETE") == 0 || strcasecmp(method, "OPTIONS") == 0;
+    job->req.cacheable = cacheable;
+    job->req.complete = proxy_response_task;
+    int ret = proxy_build_request(&job->req, buffer, header_len, path, buffer + header_len, body_have,
+                                  body_len);
+    if (ret != 0) {
+        free(job);
+        send_error_response(ctx->client_fd, 500, "Internal Server Error");
+        finish_request(ctx, 0);
+        return 1;
     }
+    
+    log_message(LOG_DEBUG, "Proxy: %s %s -> %s", method, path, proxy_upstream_name(upstream));
+    proxy_submit(reverse_proxy, &job->req);
+    return 1;
 }
 
-void send_error_response(int client_fd, int code, const char *message) {
-    char response[1024];
-    int len = snprintf(response, sizeof(response),
-        "HTTP/1.1 %d %s\r\n"
-        "Content-Type: text/html\r\n"
-        "Connection: close\r\n"
-        "\r\n"
-        "<html><body><h1>%d %s</h1></body></html>",
-        code, message, code, message);
-    write(client_fd, response, len);
+static void h2_release_free(h2_response_t *resp) {
+    free((void *)resp->body);
 }
 
-void send_file_response(int client_fd, const char *filename, void *data, size_t size) {
-    char header[1024];
-    const char *content_type = "text/plain";
+static void h2_release_cached(h2_response_t *resp) {
+    // 映射的文件已被截断，丢弃失效的缓存项
+    if (resp->failed) cache_remove(resp->owner, ((cache_item_t *)resp->data)->key);
+    cache_release(resp->owner, resp->data);
+}
+
+static void h2_release_snapshot(h2_response_t *resp) {
+    snapshot_release(resp->data);
+}
+
+static void h2_release_mapped(h2_response_t *resp) {
+    munmap((void *)resp->body, resp->body_len);
+}
+
+static void h2_release_buffer(h2_response_t *resp) {
+    free((void *)resp->body);
+    cache_release_buffer(resp->owner, resp->body_len);
+}
+
+static void h2_error_response(h2_response_t *resp, int status) {
+    char *body = malloc(128);
+    resp->status = status;
+    resp->content_type = "text/html";
+    if (body) {
+        resp->body_len = snprintf(body, 128, "<html><body><h1>%d %s</h1></body></html>",
+                                  status, status_text(status));
+        resp->body = body;
+        resp->release = h2_release_free;
+    }
+}
+
+// 未命中: 与serve_from_disk相同的缓存策略，但响应体要保留到流发送完
+static void h2_serve_from_disk(cache_t *cache, const char *request, const request_path_t *path,
+                               h2_response_t *resp) {
+    int file_fd = open(path->filepath, O_RDONLY);
+    if (file_fd < 0) {
+        h2_error_response(resp, 404);
+        return;
+    }
+    struct stat file_stat;
+    if (fstat(file_fd, &file_stat) < 0) {
+        close(file_fd);
+        h2_error_response(resp, 500);
+        return;
+    }
+    if (!S_ISREG(file_stat.st_mode)) {
+        close(file_fd);
+        h2_error_response(resp, 404);
+        return;
+    }
     
-    // 根据文件扩展名设置Content-Type
-    if (strstr(filename, ".html")) content_type = "text/html";
-    else if (strstr(filename, ".css")) content_type = "text/css";
-    else if (strstr(filename, ".js")) content_type = "application/javascript";
-    else if (strstr(filename, ".png")) content_type = "image/png";
-    else if (strstr(filename, ".jpg") || strstr(filename, ".jpeg")) content_type = "image/jpeg";
-    else if (strstr(filename, ".gif")) content_type = "image/gif";
-    else if (strstr(filename, ".ico")) content_type = "image/x-icon";
+    build_etag(&file_stat, resp->etag, sizeof(resp->etag));
+    resp->mtime = file_stat.st_mtime;
+    cache_note_miss(cache, file_stat.st_size);
+    if (is_not_modified(request, resp->etag, resp->mtime)) {
+        STAT_INC(not_modified_sent);
+        resp->status = 304;
+        close(file_fd);
+        return;
+    }
     
-    time_t now = time(NULL);
-    struct tm *tm = gmtime(&now);
-    char date[64];
-    strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", tm);
+    size_t size = file_stat.st_size;
+    resp->status = 200;
+    resp->content_type = get_content_type(path->filepath);
+    if (size == 0) {
+        close(file_fd);
+        return;
+    }
     
-    int header_len = snprintf(header, sizeof(header),
-        "HTTP/1.1 200 OK\r\n"
-        "Content-Type: %s\r\n"
-        "Content-Length: %zu\r\n"
-        "Connection: keep-alive\r\n"
-        "Date: %s\r\n"
-        "Server: MyWebServer/1.0\r\n"
-        "\r\n",
-        content_type, size, date);
-    
-    write(client_fd, header, header_len);
-    
-    // 使用sendfile进行零拷贝传输（如果支持）
-    #ifdef __linux__
-    // 对于大文件，使用sendfile优化
-    if (size > 4096) { // 大于4KB的文件使用sendfile
-        int file_fd = open(filename, O_RDONLY);
-        if (file_fd >= 0) {
-            off_t offset = 0;
-            sendfile(client_fd, file_fd, &offset, size);
+    // 较大的文件或读取缓冲区超出预算时映射发送，流和缓存各持有一份映射
+    if (size >= MMAP_THRESHOLD || cache_reserve_buffer(cache, size) != 0) {
+        void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, file_fd, 0);
+        if (map == MAP_FAILED) {
             close(file_fd);
-            sendfile_used++;
+            h2_error_response(resp, 500);
+            return;
+        }
+        if (size >= MMAP_THRESHOLD && size < MAX_CACHE_ITEM_SIZE) {
+            void *cached = mmap(NULL, size, PROT_READ, MAP_SHARED, file_fd, 0);
+            if (cached != MAP_FAILED &&
+                cache_put_mapped(cache, path->key, cached, size, file_stat.st_mtime, resp->etag) != 0) {
+                munmap(cached, size);
+            }
+        }
+        close(file_fd);
+        STAT_INC(mmap_served);
+        resp->body = map;
+        resp->body_len = size;
+        resp->release = h2_release_mapped;
+        return;
+    }
+    
+    char *data = malloc(size);
+    size_t offset = 0;
+    while (data && offset < size) {
+        ssize_t n = pread(file_fd, data + offset, size - offset, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        offset += n;
+    }
+    close(file_fd);
+    if (!data || offset != size) {
+        free(data);
+        cache_release_buffer(cache, size);
+        h2_error_response(resp, 500);
+        return;
+    }
+    cache_put(cache, path->key, data, size, file_stat.st_mtime, resp->etag);
+    resp->body = data;
+    resp->body_len = size;
+    resp->release = h2_release_buffer;
+    resp->owner = cache;
+}
+
+// HTTP/2会话一次运行中遇到缓存未命中时的处理
+typedef enum {
+    H2_MISS_READ,              // 在本线程读取(磁盘I/O线程池中，或会话本来就占用线程的后端)
+    H2_MISS_DEFER,             // 暂缓，会话换到磁盘I/O线程池后再读取
+    H2_MISS_SHED               // 磁盘I/O队列已满，返回503
+} h2_miss_t;
+
+typedef struct {
+    client_context_t *ctx;
+    h2_session_t *session;
+    h2_miss_t miss;
+} h2_run_t;
+
+// HTTP/2流的请求: 走与HTTP/1.1相同的快照/缓存/磁盘路径，响应体交给会话按帧发送
+// 暂缓的未命中在磁盘I/O线程池中再次调用，请求只在给出响应时计数
+static void h2_respond(void *arg, const char *request, h2_response_t *resp) {
+    h2_run_t *run = (h2_run_t *)arg;
+    client_context_t *ctx = run->ctx;
+    uint64_t start_us = now_us();
+    
+    // 代理路由需要转发请求体和原始响应，只在HTTP/1.1上提供
+    request_path_t path;
+    int status = is_proxied(request) ? 501 :
+                 resolve_request_path(request, ctx->document_root, &path);
+    if (status != 0) {
+        STAT_INC(total_requests);
+        STAT_INC(h2_streams);
+        h2_error_response(resp, status);
+        return;
+    }
+    
+    const snapshot_t *snapshot = snapshot_reader_enter();
+    if (snapshot) {
+        const snapshot_entry_t *entry = snapshot_lookup(snapshot, path.key);
+        if (entry) {
+            // 响应体直接指向快照，快照在流发送期间被重建时由流持有的引用保留
+            STAT_INC(total_requests);
+            STAT_INC(h2_streams);
+            STAT_INC(snapshot_hits);
+            resp->content_type = get_content_type(path.key);
+            snprintf(resp->etag, sizeof(resp->etag), "%s", entry->etag);
+            resp->mtime = entry->mtime;
+            if (is_not_modified(request, entry->etag, entry->mtime)) {
+                STAT_INC(not_modified_sent);
+                resp->status = 304;
+            } else {
+                resp->status = 200;
+                resp->body = snapshot->buffer + entry->body_offset;
+                resp->body_len = entry->body_len;
+                resp->release = h2_release_snapshot;
+                resp->data = (void *)snapshot;
+                snapshot_retain(snapshot);
+            }
+            snapshot_reader_exit();
+            track_request(path.key, 1, resp->body_len, start_us);
+            return;
+        }
+        snapshot_reader_exit();
+    }
+    
+    cache_item_t *cached = cache_lookup(ctx->cache, path.key, path.hash);
+    if (cached) {
+        STAT_INC(total_requests);
+        STAT_INC(h2_streams);
+        STAT_INC(cache_hits);
+        resp->content_type = get_content_type(path.key);
+        snprintf(resp->etag, sizeof(resp->etag), "%s", cached->etag);
+        resp->mtime = cached->mtime;
+        if (is_not_modified(request, cached->etag, cached->mtime)) {
+            STAT_INC(not_modified_sent);
+            resp->status = 304;
+            cache_release(ctx->cache, cached);
+        } else {
+            // 缓存项的引用保持到流发送完
+            resp->status = 200;
+            resp->body = cached->data;
+            resp->body_len = cached->size;
+            resp->release = h2_release_cached;
+            resp->owner = ctx->cache;
+            resp->data = cached;
+        }
+        track_request(path.key, 1, resp->body_len, start_us);
+        return;
+    }
+    
+    // 未命中不在请求线程读取磁盘: status保持0，会话换到磁盘I/O线程池后再调用
+    if (run->miss == H2_MISS_DEFER) return;
+    STAT_INC(total_requests);
+    STAT_INC(h2_streams);
+    if (run->miss == H2_MISS_SHED) {
+        h2_error_response(resp, 503);
+    } else {
+        h2_serve_from_disk(ctx->cache, request, &path, resp);
+    }
+    track_request(path.key, 0, resp->body_len, start_us);
+}
+
+static void run_h2_session(client_context_t *ctx, h2_session_t *session, h2_miss_t miss);
+
+// 磁盘I/O线程池任务: 读取暂缓的未命中，之后会话照常交还事件循环
+static void h2_disk_task(void *arg) {
+    h2_run_t *job = (h2_run_t *)arg;
+    run_h2_session(job->ctx, job->session, H2_MISS_READ);
+    free(job);
+}
+
+// 运行HTTP/2会话: epoll后端在会话空闲或等待对端时把它留在连接上，由事件循环在可读/可写时再分派；
+// 其他后端在本线程等待，会话总时长不超过H2_SESSION_MAX_MS，到期后发送GOAWAY，进行中的流发完即关闭
+static void run_h2_session(client_context_t *ctx, h2_session_t *session, h2_miss_t miss) {
+    h2_run_t run = { ctx, session, miss };
+    uint64_t deadline = timer_now_ms() + H2_SESSION_MAX_MS;
+    int expired = 0;
+    for (;;) {
+        h2_result_t result = h2_session_run(session, ctx->client_fd, &run);
+        run.miss = miss;
+        if (result == H2_DEFER) {
+            h2_run_t *job = malloc(sizeof(h2_run_t));
+            if (job) {
+                *job = run;
+                if (threadpool_add_task(disk_io_pool, h2_disk_task, job) == 0) {
+                    STAT_INC(disk_io_offloaded);
+                    return;
+                }
+                free(job);
+            }
+            // I/O队列已满: 与HTTP/1.1相同，暂缓的流返回503
+            STAT_INC(disk_io_shed);
+            run.miss = H2_MISS_SHED;
+            continue;
+        }
+        if (result != H2_CLOSE && ctx->h2) {
+            *ctx->h2 = session;
+            ctx->keep_alive = 1;
+            finish_request(ctx, 1);
             return;
         }
+        if (result != H2_CLOSE) {
+            uint64_t now = timer_now_ms();
+            if (!expired && now >= deadline) {
+                expired = 1;
+                h2_session_goaway(session, -1);
+                continue;
+            }
+            int timeout = result == H2_IDLE ? KEEPALIVE_TIMEOUT_MS : SEND_STALL_TIMEOUT_MS;
+            if (!expired && deadline - now < (uint64_t)timeout) timeout = (int)(deadline - now);
+            struct pollfd pfd = {
+                .fd = ctx->client_fd,
+                .events = POLLIN | (h2_session_wants_write(session) ? POLLOUT : 0)
+            };
+            // 等待流的期间超时由会话自己判断停滞；空闲超时未到会话期限时关闭
+            int ret = poll(&pfd, 1, timeout);
+            if (ret != 0 || result == H2_BLOCKED || (!expired && timer_now_ms() >= deadline)) continue;
+        }
+        h2_session_free(session);
+        finish_request(ctx, 0);
+        return;
+    }
+}
+
+// 会话能交还事件循环时未命中交给磁盘I/O线程池；其他后端的会话本来就占用本线程，直接读取
+static h2_miss_t h2_miss_policy(const client_context_t *ctx) {
+    return disk_io_pool && ctx->h2 ? H2_MISS_DEFER : H2_MISS_READ;
+}
+
+// 识别h2c: 连接前言(prior knowledge)或带HTTP2-Settings的Upgrade: h2c请求
+// 返回1表示连接已交给HTTP/2会话
+static int start_h2(client_context_t *ctx, const char *buffer, size_t len) {
+    static const char preface_line[] = "PRI * HTTP/2.0\r\n\r\n";
+    char upgrade[64], settings[256];
+    const char *rest = strstr(buffer, "\r\n\r\n");
+    int upgrading = 0;
+    
+    if (len >= sizeof(preface_line) - 1 && memcmp(buffer, preface_line, sizeof(preface_line) - 1) == 0) {
+        rest = buffer;
+    } else if (rest && strncmp(buffer, "GET ", 4) == 0 &&
+               get_header_value(buffer, "Upgrade", upgrade, sizeof(upgrade)) &&
+               strcasestr(upgrade, "h2c") &&
+               get_header_value(buffer, "HTTP2-Settings", settings, sizeof(settings)) &&
+               !is_proxied(buffer)) {
+        rest += 4;
+        upgrading = 1;
+    } else {
+        return 0;
     }
-    #endif
     
-    // 小文件或sendfile不可用时使用普通write
-    write(client_fd, data, size);
+    h2_session_t *session = h2_session_create(h2_respond);
+    if (!session) {
+        finish_request(ctx, 0);
+        return 1;
+    }
+    if (upgrading) {
+        static const char switching[] =
+            "HTTP/1.1 101 Switching Protocols\r\n"
+            "Connection: Upgrade\r\n"
+            "Upgrade: h2c\r\n"
+            "\r\n";
+        // 原请求只保留请求头，作为流1的请求
+        char request[BUFFER_SIZE];
+        snprintf(request, sizeof(request), "%.*s", (int)(rest - buffer), buffer);
+        if (h2_session_upgrade(session, settings, request) != 0) {
+            // HTTP2-Settings无效时按普通HTTP/1.1请求处理
+            h2_session_free(session);
+            return 0;
+        }
+        if (write_all(ctx->client_fd, switching, sizeof(switching) - 1) != 0) {
+            h2_session_free(session);
+            finish_request(ctx, 0);
+            return 1;
+        }
+    }
+    h2_session_feed(session, rest, buffer + len - rest);
+    STAT_INC(h2_connections);
+    run_h2_session(ctx, session, h2_miss_policy(ctx));
+    return 1;
 }
 
 void handle_client_request(void *arg) {
     client_context_t *ctx = (client_context_t *)arg;
     char buffer[BUFFER_SIZE];
+    ssize_t bytes_read;
+    
+    // 连接上有空闲的HTTP/2会话，新到的数据都是帧
+    if (ctx->h2 && *ctx->h2) {
+        h2_session_t *session = *ctx->h2;
+        *ctx->h2 = NULL;
+        run_h2_session(ctx, session, h2_miss_policy(ctx));
+        return;
+    }
     
-    // 读取HTTP请求
-    ssize_t bytes_read = read(ctx->client_fd, buffer, sizeof(buffer)-1);
+    if (ctx->request) {
+        // 事件后端已经读取了请求数据
+        bytes_read = ctx->request_len < sizeof(buffer) ? (ssize_t)ctx->request_len
+                                                       : (ssize_t)sizeof(buffer) - 1;
+        memcpy(buffer, ctx->request, bytes_read);
+        free(ctx->request);
+        ctx->request = NULL;
+    } else {
+        // 上一个请求之后已读到的数据(管线化)作为本次请求的开头，再按需读取
+        size_t have = 0;
+        if (ctx->pending && ctx->pending->len > 0) {
+            have = ctx->pending->len < sizeof(buffer) - 1 ? ctx->pending->len : sizeof(buffer) - 1;
+            memcpy(buffer, ctx->pending->data, have);
+            free(ctx->pending->data);
+            ctx->pending->data = NULL;
+            ctx->pending->len = 0;
+        }
+        bytes_read = read_request(ctx->client_fd, buffer, sizeof(buffer), have, ctx->deadline_ms);
+    }
     if (bytes_read <= 0) {
-        close(ctx->client_fd);
-        free(ctx);
+        finish_request(ctx, 0);
         return;
     }
     buffer[bytes_read] = '\0';
     
-    total_requests++;
+    if (start_h2(ctx, buffer, bytes_read)) return;
     
-    // 解析请求行
-    char method[16], path[256], protocol[16];
-    if (sscanf(buffer, "%15s %255s %15s", method, path, protocol) != 3) {
-        send_error_response(ctx->client_fd, 400, "Bad Request");
-        close(ctx->client_fd);
-        free(ctx);
-        return;
-    }
+    STAT_INC(total_requests);
+    ctx->start_us = now_us();
     
-    // 只处理GET请求
-    if (strcasecmp(method, "GET") != 0) {
-        send_error_response(ctx->client_fd, 501, "Not Implemented");
-        close(ctx->client_fd);
-        free(ctx);
+    // 匹配代理路由的请求转发给上游，不映射到文档根目录
+    if (reverse_proxy && forward_to_upstream(ctx, buffer, bytes_read)) return;
+    
+    request_path_t path;
+    int status = resolve_request_path(buffer, ctx->document_root, &path);
+    if (status != 0) {
+        send_error_response(ctx->client_fd, status, status_text(status));
+        finish_request(ctx, 0);
         return;
     }
     
-    // 安全检查路径
-    if (strstr(path, "..") != NULL) {
-        send_error_response(ctx->client_fd, 403, "Forbidden");
-        close(ctx->client_fd);
-        free(ctx);
-        return;
+    if (ctx->release) ctx->keep_alive = wants_keep_alive(buffer);
+    
+    // 静态文件不读取请求体: 带请求体的请求之后无法确定下一个请求的起点，响应后关闭连接
+    char value[32];
+    const char *header_end = strstr(buffer, "\r\n\r\n");
+    if (!header_end || (get_header_value(buffer, "Content-Length", value, sizeof(value)) &&
+                        strcmp(value, "0") != 0) ||
+        get_header_value(buffer, "Transfer-Encoding", value, sizeof(value))) {
+        ctx->keep_alive = 0;
+    } else if (keep_pipelined(ctx, buffer, bytes_read, header_end + 4 - buffer) != 0) {
+        ctx->keep_alive = 0;
     }
+    int ret;
     
-    // 构建文件路径
-    char filepath[512];
-    if (strcmp(path, "/") == 0) {
-        snprintf(filepath, sizeof(filepath), "%s/index.html", ctx->document_root);
-    } else {
-        snprintf(filepath, sizeof(filepath), "%s%s", ctx->document_root, path);
+    // 快照模式: 无锁查找，命中时不经过缓存
+    const snapshot_t *snapshot = snapshot_reader_enter();
+    if (snapshot) {
+        const snapshot_entry_t *entry = snapshot_lookup(snapshot, path.key);
+        if (entry) {
+            STAT_INC(snapshot_hits);
+            size_t body_bytes;
+            ret = send_snapshot_response(ctx->client_fd, snapshot, entry, buffer, ctx->keep_alive,
+                                         &body_bytes);
+            snapshot_reader_exit();
+            // 热点统计要加锁，放在读者区间之外
+            track_request(path.key, 1, body_bytes, ctx->start_us);
+            finish_request(ctx, ret == 0);
+            return;
+        }
+        snapshot_reader_exit();
     }
     
     // 检查缓存
-    cache_item_t *cached = cache_get(ctx->cache, filepath);
+    cache_item_t *cached = cache_lookup(ctx->cache, path.key, path.hash);
     if (cached) {
-        cache_hits++;
-        printf("Cache HIT: %s (Hit rate: %.2f%%)\n", filepath, 
-               (float)cache_hits / total_requests * 100);
-        send_file_response(ctx->client_fd, filepath, cached->data, cached->size);
+        STAT_INC(cache_hits);
+        printf("Cache HIT: %s (Hit rate: %.2f%%)\n", path.key, 
+               (float)STAT_GET(cache_hits) / STAT_GET(total_requests) * 100);
+        int tracked = 0;
+        size_t body_bytes = cached->size;
+        if (is_not_modified(buffer, cached->etag, cached->mtime)) {
+            STAT_INC(not_modified_sent);
+            body_bytes = 0;
+            ret = send_not_modified(ctx->client_fd, cached->etag, cached->mtime, ctx->keep_alive);
+        } else if (zerocopy_mode && ctx->zc && cached->size >= ZEROCOPY_THRESHOLD &&
+                   zerocopy_enable(ctx->client_fd, ctx->zc) == 0 &&
+                   zerocopy_prepare(ctx->zc) == 0) {
+            ret = send_zerocopy_response(ctx, path.filepath, cached, &tracked);
+        } else if (cached->mapped) {
+            ret = send_mapped_response(ctx->client_fd, path.filepath, cached->data, -1, cached->size,
+                                       cached->etag, cached->mtime, ctx->keep_alive);
+        } else {
+            ret = send_file_response(ctx->client_fd, path.filepath, cached->data, cached->size,
+                                     cached->etag, cached->mtime, ctx->keep_alive);
+        }
+        // 映射的文件被原地截断时内核读取映射得到EFAULT(不会是SIGBUS)，丢弃失效的缓存项
+        if (ret != 0 && cached->mapped && errno == EFAULT) cache_remove(ctx->cache, path.key);
+        track_request(path.key, 1, body_bytes, ctx->start_us);
+        if (!tracked) cache_release(ctx->cache, cached);
     } else {
-        printf("Cache MISS: %s\n", filepath);
+        printf("Cache MISS: %s\n", path.key);
         
-        // 缓存未命中，读取文件
-        int file_fd = open(filepath, O_RDONLY);
-        if (file_fd < 0) {
-            send_error_response(ctx->client_fd, 404, "Not Found");
-        } else {
-            struct stat file_stat;
-            if (fstat(file_fd, &file_stat) < 0) {
-                send_error_response(ctx->client_fd, 500, "Internal Server Error");
-                close(file_fd);
-                close(ctx->client_fd);
-                free(ctx);
-                return;
-            }
-            
-            // 只缓存小文件（小于10MB）
-            if (file_stat.st_size < 10 * 1024 * 1024) {
-                // 读取文件到内存并缓存
-                void *file_data = malloc(file_stat.st_size);
-                if (file_data) {
-                    if (read(file_fd, file_data, file_stat.st_size) == file_stat.st_size) {
-                        cache_put(ctx->cache, filepath, file_data, file_stat.st_size);
-                    }
-                    send_file_response(ctx->client_fd, filepath, file_data, file_stat.st_size);
-                    free(file_data);
-                } else {
-                    // 内存分配失败，回退到普通发送
-                    send_error_response(ctx->client_fd, 500, "Internal Server Error");
+        // 缓存未命中交给磁盘I/O线程池，避免冷存储上的读取阻塞命中请求
+        if (disk_io_pool) {
+            ctx->request = malloc(bytes_read + 1);
+            if (ctx->request) {
+                memcpy(ctx->request, buffer, bytes_read + 1);
+                ctx->request_len = bytes_read;
+                if (threadpool_add_task(disk_io_pool, disk_io_task, ctx) == 0) {
+                    STAT_INC(disk_io_offloaded);
+                    return;
                 }
-            } else {
-                // 大文件直接发送
-                send_file_response(ctx->client_fd, filepath, NULL, file_stat.st_size);
+                free(ctx->request);
+                ctx->request = NULL;
             }
-            close(file_fd);
+            // I/O队列已满: 在本线程读取会让冷读取重新阻塞请求线程，直接返回503由客户端稍后重试
+            STAT_INC(disk_io_shed);
+            send_overload_response(ctx->client_fd);
+            finish_request(ctx, 0);
+            return;
         }
+        size_t sent;
+        ret = serve_from_disk(ctx->client_fd, ctx->cache, buffer, &path, ctx->keep_alive, &sent);
+        track_request(path.key, 0, sent, ctx->start_us);
     }
     
-    close(ctx->client_fd);
-    free(ctx);
+    finish_request(ctx, ret == 0);
 }
 
-int create_server_socket(int port) {
+// 监听socket的公共设置: 非阻塞(事件循环一次接受到EAGAIN为止)，TCP上延迟accept到请求数据到达
+// 交接得到的socket也重新设置，listen可以修改已监听socket的队列长度
+static int setup_listener(int server_fd, int backlog, int tcp) {
+    int flags = fcntl(server_fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(server_fd, F_SETFL, flags | O_NONBLOCK) < 0) return -1;
+    
+    // 只建立了连接还没有发送数据的客户端留在内核中，不唤醒事件循环也不占用请求头计时
+    int defer = HEADER_TIMEOUT_MS / 1000;
+    if (tcp && setsockopt(server_fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &defer, sizeof(defer)) < 0) {
+        log_message(LOG_WARN, "无法设置TCP_DEFER_ACCEPT: %s", strerror(errno));
+    }
+    return listen(server_fd, backlog);
+}
+
+int create_server_socket(int port, int backlog) {
     int server_fd;
     struct sockaddr_in address;
     int opt = 1;
@@ -294,29 +1828,194 @@ int create_server_socket(int port) {
     }
     
     // 开始监听
-    if (listen(server_fd, 128) < 0) {
+    if (setup_listener(server_fd, backlog, 1) < 0) {
+        perror("listen");
+        close(server_fd);
+        exit(EXIT_FAILURE);
+    }
+    
+    printf("Server socket created on port %d (backlog %d)\n", port, backlog);
+    return server_fd;
+}
+
+// 本机反向代理使用的Unix域监听socket，省去回环TCP协议栈的开销
+// 只删除上次异常退出留下的socket文件: 路径必须是socket，且连接被拒绝(没有进程在监听)
+// 普通文件、目录或仍在服务的socket都不动，返回-1
+static int remove_stale_socket(const struct sockaddr_un *address) {
+    const char *path = address->sun_path;
+    struct stat st;
+    if (lstat(path, &st) != 0) {
+        if (errno == ENOENT) return 0;
+        perror("lstat");
+        return -1;
+    }
+    if (!S_ISSOCK(st.st_mode)) {
+        fprintf(stderr, "%s exists and is not a socket\n", path);
+        return -1;
+    }
+    
+    // 非阻塞连接: 对方监听队列满时返回EAGAIN，同样视为仍在使用
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (probe < 0) {
+        perror("socket failed");
+        return -1;
+    }
+    int stale = connect(probe, (const struct sockaddr *)address, sizeof(*address)) != 0 &&
+                errno == ECONNREFUSED;
+    close(probe);
+    if (!stale) {
+        fprintf(stderr, "%s is in use by another process\n", path);
+        return -1;
+    }
+    
+    if (unlink(path) != 0) {
+        perror("unlink");
+        return -1;
+    }
+    return 0;
+}
+
+int create_unix_server_socket(const char *path, int backlog) {
+    struct sockaddr_un address;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Unix socket path too long: %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    
+    int server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server_fd < 0) {
+        perror("socket failed");
+        exit(EXIT_FAILURE);
+    }
+    
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+    
+    if (remove_stale_socket(&address) != 0) {
+        close(server_fd);
+        exit(EXIT_FAILURE);
+    }
+    if (bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        perror("bind failed");
+        close(server_fd);
+        exit(EXIT_FAILURE);
+    }
+    
+    if (setup_listener(server_fd, backlog, 0) < 0) {
         perror("listen");
         close(server_fd);
         exit(EXIT_FAILURE);
     }
     
-    printf("Server socket created on port %d\n", port);
+    printf("Server socket created on unix:%s\n", path);
     return server_fd;
 }
 
-void start_server(int port, const char *document_root, cache_algorithm_t algorithm) {
-    int server_fd = create_server_socket(port);
+// 交接得到的Unix域监听socket只有在仍绑定同一路径时才沿用
+static int unix_socket_matches(int fd, const char *path) {
+    struct sockaddr_un address;
+    socklen_t len = sizeof(address);
+    if (getsockname(fd, (struct sockaddr *)&address, &len) != 0) return 0;
+    return address.sun_family == AF_UNIX && strcmp(address.sun_path, path) == 0;
+}
+
+void start_server(const server_options_t *options) {
+    int port = options->port;
+    const char *document_root = options->document_root;
+    cache_algorithm_t algorithm = options->algorithm;
+    
+    // 平滑升级: 从运行中的旧进程接管监听socket和缓存，没有旧进程时正常创建
+    zerocopy_mode = options->zerocopy;
+    int server_fd = -1;
+    int unix_fd = -1;
+    int handoff_cache_fd = -1;
+    int handoff_conn = -1;
+    if (options->upgrade_socket) {
+        handoff_conn = handoff_receive(options->upgrade_socket, &server_fd, &unix_fd,
+                                       &handoff_cache_fd);
+        if (handoff_conn >= 0) printf("Took over listening socket from running server\n");
+    }
+    if (server_fd < 0) server_fd = create_server_socket(port, options->backlog);
+    else if (setup_listener(server_fd, options->backlog, 1) < 0) perror("listen");
+    if (unix_fd >= 0 && (!options->unix_socket || !unix_socket_matches(unix_fd, options->unix_socket))) {
+        close(unix_fd);
+        unix_fd = -1;
+    }
+    if (unix_fd >= 0 && setup_listener(unix_fd, options->backlog, 0) < 0) perror("listen");
+    if (options->unix_socket && unix_fd < 0) {
+        unix_fd = create_unix_server_socket(options->unix_socket, options->backlog);
+    }
+    
+    // 控制信号只交给事件循环线程，其他线程创建时继承屏蔽字
+    sigset_t control_signals, old_mask;
+    sigemptyset(&control_signals);
+    sigaddset(&control_signals, SIGINT);
+    sigaddset(&control_signals, SIGTERM);
+    sigaddset(&control_signals, SIGUSR1);
+    sigaddset(&control_signals, SIGUSR2);
+    sigaddset(&control_signals, SIGHUP);
+    sigaddset(&control_signals, SIGCHLD);
+    pthread_sigmask(SIG_BLOCK, &control_signals, &old_mask);
+    wait_sigmask = old_mask;
     
     // 创建缓存
-    cache_t *cache = cache_create(MAX_CACHE_SIZE, algorithm);
+    cache_t *cache = cache_create(options->cache_size, algorithm);
     if (!cache) {
         fprintf(stderr, "Failed to create cache\n");
         close(server_fd);
         exit(EXIT_FAILURE);
     }
     
+    // 自适应模式下由影子缓存的命中情况决定使用哪种算法
+    if (options->adaptive_cache && cache_set_adaptive(cache, 1) != 0) {
+        fprintf(stderr, "Failed to enable adaptive cache policy\n");
+    }
+    
+    // 扫描式访问的冷对象不应挤掉热点
+    if (CACHE_ADMISSION && cache_set_admission(cache, 1) != 0) {
+        fprintf(stderr, "Failed to enable cache admission filter\n");
+    }
+    
+    // 共享内存缓存: 多个进程共用一份热点数据和内存预算
+    shm_cache_t *shared_cache = NULL;
+    if (options->shared_cache || options->prefork > 1) {
+        shared_cache = shm_cache_open(options->shared_cache, options->cache_size);
+        if (shared_cache) {
+            // 没有交接时命名段中可能是上次运行留下的内容，对应文件可能已被修改
+            if (handoff_conn < 0 && shm_cache_count(shared_cache) > 0) {
+                printf("Discarding %u stale shared cache entries\n", shm_cache_count(shared_cache));
+                shm_cache_reset(shared_cache);
+            }
+            cache_attach_shared(cache, shared_cache);
+        } else {
+            fprintf(stderr, "Failed to open shared cache, using a private cache\n");
+        }
+    }
+    
+    // 恢复上次退出时保存的缓存(共享缓存本身可跨进程重启保留)，交接的快照优先
+    if (handoff_cache_fd >= 0) {
+        if (!shared_cache) {
+            int restored = cache_load_fd(cache, handoff_cache_fd, document_root, validate_cached_file);
+            if (restored >= 0) printf("Restored %d cache entries from previous server\n", restored);
+        }
+        close(handoff_cache_fd);
+    } else if (options->cache_file && !shared_cache) {
+        int restored = cache_load(cache, options->cache_file, document_root, validate_cached_file);
+        if (restored >= 0) {
+            printf("Restored %d cache entries from %s\n", restored, options->cache_file);
+        }
+    }
+    
+    // 预派生工作进程: 必须在创建任何线程之前fork，各进程共享监听socket和缓存段
+    int worker_index = 0;
+    if (options->prefork > 1) {
+        worker_index = fork_workers(options->prefork);
+        if (worker_index > 0 && shared_cache) shm_cache_attach(shared_cache);
+    }
+    
     // 创建线程池
-    threadpool_t *pool = threadpool_create(8);
+    threadpool_t *pool = threadpool_create_bounded(options->threads, MAX_QUEUE);
     if (!pool) {
         fprintf(stderr, "Failed to create thread pool\n");
         cache_destroy(cache);
@@ -324,9 +2023,50 @@ void start_server(int port, const char *document_root, cache_algorithm_t algorit
         exit(EXIT_FAILURE);
     }
     
+    // 排队时间持续超标时丢弃请求并快速返回503
+    threadpool_set_shedding(pool, QUEUE_TARGET_MS, QUEUE_INTERVAL_MS);
+    
+    // 创建有界的磁盘I/O线程池
+    disk_io_pool = threadpool_create_bounded(DISK_IO_THREADS, DISK_IO_QUEUE);
+    if (!disk_io_pool) {
+        fprintf(stderr, "Failed to create disk I/O pool, misses are served inline\n");
+    }
+    
+    // 热点路径统计，创建失败时不统计
+    hot_paths = hitters_create(HITTERS_CAPACITY);
+    
+    // 反向代理: 上游连接由事件循环驱动，每个工作进程各自维护连接池
+    if (options->proxy_route_count > 0) {
+        reverse_proxy = proxy_create(pool, options->proxy_routes, options->proxy_route_count);
+        if (!reverse_proxy) {
+            fprintf(stderr, "Failed to set up reverse proxy\n");
+            threadpool_destroy(pool);
+            cache_destroy(cache);
+            close(server_fd);
+            exit(EXIT_FAILURE);
+        }
+    }
+    
+    // 创建io_uring处理器，内核不支持时回退到epoll
+    uring_handler_t *uring_handler = NULL;
+    if (options->backend == IO_BACKEND_URING) {
+        uring_handler = uring_handler_create(server_fd, unix_fd, cache, document_root, pool);
+        if (!uring_handler) {
+            fprintf(stderr, "io_uring unavailable, falling back to epoll\n");
+        }
+    }
+    
     // 创建epoll处理器
-    epoll_handler_t *epoll_handler = epoll_handler_create(server_fd, cache, document_root, pool);
-    if (!epoll_handler) {
+    epoll_handler_t *epoll_handler = NULL;
+    if (!uring_handler) {
+        epoll_handler = epoll_handler_create(server_fd, unix_fd, cache, document_root, pool);
+    }
+    if (reverse_proxy) {
+        int ret = uring_handler ? uring_handler_add_proxy(uring_handler, reverse_proxy)
+                                : epoll_handler ? epoll_handler_add_proxy(epoll_handler, reverse_proxy) : 0;
+        if (ret != 0) fprintf(stderr, "Failed to attach reverse proxy to the event loop\n");
+    }
+    if (!uring_handler && !epoll_handler) {
         fprintf(stderr, "Failed to create epoll handler\n");
         threadpool_destroy(pool);
         cache_destroy(cache);
@@ -337,14 +2077,57 @@ void start_server(int port, const char *document_root, cache_algorithm_t algorit
     printf("Web server started successfully!\n");
     printf("Port: %d\n", port);
     printf("Document root: %s\n", document_root);
-    printf("Cache algorithm: %s\n", algorithm == LRU ? "LRU" : "LFU");
-    printf("Cache size: %d MB\n", MAX_CACHE_SIZE / (1024 * 1024));
+    printf("Cache algorithm: %s%s\n", cache_algorithm_name(algorithm),
+           cache->adaptive ? " (adaptive)" : "");
+    if (options->cache_size % (1024 * 1024)) printf("Cache size: %zu KB\n", options->cache_size / 1024);
+    else printf("Cache size: %zu MB\n", options->cache_size / (1024 * 1024));
+    printf("I/O backend: %s\n", uring_handler ? "io_uring" : "epoll");
+    if (options->unix_socket) printf("Unix socket: %s\n", options->unix_socket);
+    for (int i = 0; i < options->proxy_route_count; i++) {
+        printf("Proxy: %s\n", options->proxy_routes[i]);
+    }
+    
+    // 已可以接受连接，通知旧进程开始排空；之后等待下一次升级
+    handoff_confirm(handoff_conn);
+    if (options->upgrade_socket && worker_index == 0 &&
+        handoff_start(options->upgrade_socket, server_fd, unix_fd, cache) != 0) {
+        fprintf(stderr, "Failed to listen for upgrades on %s\n", options->upgrade_socket);
+    }
+    
+    // 管理接口只在主进程运行，共享缓存的容量调整对所有工作进程生效
+    if (options->admin_socket && worker_index == 0 &&
+        admin_start(options->admin_socket, cache, pool, disk_io_pool, hot_paths) != 0) {
+        fprintf(stderr, "Failed to open admin socket %s\n", options->admin_socket);
+    }
+    
+    // 共享缓存的容量对所有工作进程生效，同样只在主进程监控
+    if (options->memory_watch && worker_index == 0 && memwatch_start(cache) != 0) {
+        fprintf(stderr, "No cgroup v2 memory controller or PSI, memory watch disabled\n");
+    }
+    
+    // 快照模式: 打包失败时仍可以普通模式提供服务
+    if (options->snapshot && snapshot_enable(document_root) != 0) {
+        fprintf(stderr, "Failed to build document root snapshot, serving from cache\n");
+    }
+    
+    // 预热与接受连接同时进行，未加载到的文件照常走未命中路径
+    if (options->preload && worker_index == 0 && cache_preload(cache, pool, document_root, options->preload_list,
+                                          options->preload_budget) != 0) {
+        fprintf(stderr, "Cache preload failed, starting cold\n");
+    }
     
     // 设置信号处理
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
     signal(SIGUSR1, signal_handler);  // 切换缓存算法
     signal(SIGUSR2, signal_handler);  // 显示状态
+    signal(SIGHUP, signal_handler);   // 重建快照
+    signal(SIGCHLD, signal_handler);  // 回收工作进程
+    signal(SIGPIPE, SIG_IGN);         // 客户端提前断开时由write返回错误
+    if (mapguard_init() != 0) {       // 缓存的文件映射被截断时不终止进程
+        log_message(LOG_WARN, "无法安装SIGBUS处理函数: %s", strerror(errno));
+    }
+    hpack_init();                     // HTTP/2头部解码表
     
     // 保存全局状态
     global_cache = cache;
@@ -355,16 +2138,65 @@ void start_server(int port, const char *document_root, cache_algorithm_t algorit
     
     printf("信号处理已设置:\n");
     printf("  SIGINT/SIGTERM - 优雅关闭服务器\n");
-    printf("  SIGUSR1 - 切换缓存算法 (当前: %s)\n", algorithm == LRU ? "LRU" : "LFU");
+    printf("  SIGUSR1 - 切换缓存算法 (当前: %s)\n", cache_algorithm_name(algorithm));
     printf("  SIGUSR2 - 显示服务器状态\n");
+    if (options->snapshot) printf("  SIGHUP - 重建文档根目录快照\n");
     printf("使用命令: kill -SIGUSR1 %d 切换缓存算法\n", getpid());
     
-    // 进入事件循环
-    epoll_handler_loop(epoll_handler);
+    // 进入事件循环，收到SIGINT/SIGTERM后返回；控制信号保持屏蔽，只在等待事件时解除
+    if (uring_handler) {
+        uring_handler_loop(uring_handler);
+    } else {
+        epoll_handler_loop(epoll_handler);
+    }
     
-    // 清理资源（通常不会执行到这里）
-    epoll_handler_destroy(epoll_handler);
+    printf("正在关闭服务器...\n");
+    signal_workers();
+    handoff_stop();
+    admin_stop();
+    memwatch_stop();
+    
+    // 停止接受新连接，已接受的请求处理完再退出
+    if (uring_handler) {
+        uring_handler_drain(uring_handler, DRAIN_TIMEOUT_MS);
+    } else {
+        epoll_handler_drain(epoll_handler, DRAIN_TIMEOUT_MS);
+    }
+    close(server_fd);
+    if (unix_fd >= 0) {
+        close(unix_fd);
+        // 交接后socket文件仍由新进程使用
+        if (worker_index == 0 && !handoff_completed()) unlink(options->unix_socket);
+    }
+    
+    // 先等工作线程结束，之后缓存不再被访问；排空超时后仍未完成的转发以502结束
     threadpool_destroy(pool);
+    threadpool_destroy(disk_io_pool);
+    if (reverse_proxy) {
+        proxy_get_stats(reverse_proxy, &proxy_final_stats);
+        proxy_destroy(reverse_proxy);
+        reverse_proxy = NULL;
+    }
+    hitters_destroy(hot_paths);
+    hot_paths = NULL;
+    uring_handler_destroy(uring_handler);
+    epoll_handler_destroy(epoll_handler);
+    
+    print_final_stats();
+    
+    stop_workers();
+    
+    // 交接后缓存已由新进程接管
+    if (options->cache_file && !shared_cache && !handoff_completed()) {
+        if (cache_save(cache, options->cache_file) == 0) {
+            printf("缓存已保存到 %s\n", options->cache_file);
+        } else {
+            fprintf(stderr, "Failed to save cache to %s\n", options->cache_file);
+        }
+    }
+    
     cache_destroy(cache);
-    close(server_fd);
+    shm_cache_close(shared_cache);
+    global_cache = NULL;
+    printf("服务器已关闭\n");
 }
\ No newline at end of file
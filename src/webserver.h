@@ -1,23 +1,87 @@
 #ifndef WEBSERVER_H
 #define WEBSERVER_H
 
+#include <stdint.h>
+#include <signal.h>
+#include <sys/stat.h>
 #include "cache.h"
 #include "threadpool.h"
 #include "config.h"  // 包含配置头文件
+#include "zerocopy.h"
+#include "h2.h"
 
 // 使用config.h中的定义，不再重复定义
 // #define BUFFER_SIZE 8196  // 移动到config.h
 
+// 连接上已读取但尚未处理的数据: 管线化的客户端一次发来多个请求时，
+// 当前请求之后的字节留在连接上作为下一个请求的开头
+typedef struct {
+    char *data;
+    size_t len;
+} pending_input_t;
+
 typedef struct {
     int client_fd;
     char *document_root;
     cache_t *cache;
+    char *request;             // 事件后端已读取的请求数据(可为NULL)
+    size_t request_len;
+    uint64_t deadline_ms;      // 请求头必须读完的时间点(单调时钟，0表示不限)
+    int keep_alive;            // 响应后是否保持连接
+    void (*release)(void *owner, int client_fd, int keep_alive); // 请求结束时归还连接(可为NULL)
+    void *owner;
+    zc_state_t *zc;            // 连接的零拷贝状态(后端不跟踪完成通知时为NULL)
+    uint64_t start_us;         // 读完请求的时间(单调时钟，微秒)，用于统计服务耗时
+    h2_session_t **h2;         // 连接上空闲的HTTP/2会话(后端无法保存会话时为NULL)
+    pending_input_t *pending;  // 连接上管线化的后续请求数据(后端不保持连接时为NULL)
 } client_context_t;
 
+// 服务器启动参数
+typedef struct {
+    int port;
+    const char *document_root;
+    cache_algorithm_t algorithm;
+    int adaptive_cache;        // 根据影子缓存命中率自动选择算法
+    io_backend_t backend;
+    int snapshot;              // 把文档根目录打包为只读快照(SIGHUP重建)
+    int preload;               // 启动时预热缓存
+    const char *preload_list;  // 热点列表文件，NULL表示遍历文档根目录
+    size_t preload_budget;     // 预热字节数上限
+    size_t cache_size;         // 缓存容量(字节)
+    const char *cache_file;    // 缓存持久化文件，启动时加载、退出时保存(NULL表示不持久化)
+    const char *shared_cache;  // 共享内存缓存段名称(shm_open)，NULL且prefork>1时使用memfd
+    int prefork;               // 工作进程数，大于1时预派生并共享缓存
+    const char *upgrade_socket; // 平滑升级用的Unix socket路径(NULL表示不支持)
+    const char *admin_socket;  // 管理接口Unix socket路径(NULL表示不启用)
+    int threads;               // 请求线程池初始线程数
+    int zerocopy;              // 大的缓存命中用MSG_ZEROCOPY发送
+    const char *unix_socket;   // 额外监听的Unix域socket路径(NULL表示只监听TCP)
+    const char *proxy_routes[MAX_PROXY_ROUTES]; // 反向代理路由"前缀=上游"
+    int proxy_route_count;
+    int memory_watch;          // 按cgroup内存压力缩小/恢复缓存容量
+    int backlog;               // 监听队列长度
+} server_options_t;
+
+const char *get_content_type(const char *filename);
+void build_etag(const struct stat *st, char *buf, size_t len);
+void format_http_date(time_t t, char *buf, size_t len);
+
 void send_error_response(int client_fd, int code, const char *message);
-void send_file_response(int client_fd, const char *filename, void *data, size_t size);
+int send_file_response(int client_fd, const char *filename, void *data, size_t size,
+                       const char *etag, time_t mtime, int keep_alive);
 void handle_client_request(void *arg);
-int create_server_socket(int port);
-void start_server(int port, const char *document_root, cache_algorithm_t algorithm);
+void shed_client_request(void *arg);
+void send_overload_response(int client_fd);
+cache_item_t *prepare_cached_response(cache_t *cache, const char *document_root,
+                                      const char *request, char *header, size_t header_size,
+                                      int *header_len, int *send_body, int *keep_alive);
+int create_server_socket(int port, int backlog);
+int create_unix_server_socket(const char *path, int backlog);
+// 处理挂起的控制信号，返回非0表示应退出事件循环
+int server_process_signals(void);
+// 事件循环线程平时屏蔽控制信号，只在等待事件期间(epoll_pwait/io_uring_enter)换成该屏蔽字，
+// 信号因此只会打断等待，不会落在检查标志与进入等待之间
+const sigset_t *server_wait_sigmask(void);
+void start_server(const server_options_t *options);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <linux/errqueue.h>
+#include "zerocopy.h"
+#include "logging.h"
+
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+
+static unsigned long zerocopy_sent = 0;
+static unsigned long zerocopy_copied = 0;
+
+int zerocopy_enable(int fd, zc_state_t *zc) {
+    if (zc->enabled) return 0;
+    
+    int one = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) != 0) return -1;
+    zc->enabled = 1;
+    return 0;
+}
+
+int zerocopy_prepare(zc_state_t *zc) {
+    if (!zc->spare) zc->spare = malloc(sizeof(zc_pending_t));
+    return zc->spare ? 0 : -1;
+}
+
+ssize_t zerocopy_send(int fd, zc_state_t *zc, const void *buf, size_t len) {
+    ssize_t n = send(fd, buf, len, MSG_ZEROCOPY | MSG_NOSIGNAL);
+    // 每次成功的调用占用一个通知序号
+    if (n > 0) {
+        zc->next_seq++;
+        __atomic_add_fetch(&zerocopy_sent, 1, __ATOMIC_RELAXED);
+    }
+    return n;
+}
+
+int zerocopy_track(zc_state_t *zc, cache_item_t *item) {
+    if (zc->next_seq == zc->sent_seq) return 0;
+    
+    zc_pending_t *pending = zc->spare;
+    zc->spare = NULL;
+    pending->item = item;
+    pending->last_seq = zc->next_seq - 1;
+    pending->next = NULL;
+    if (zc->tail) zc->tail->next = pending;
+    else zc->head = pending;
+    zc->tail = pending;
+    zc->sent_seq = zc->next_seq;
+    return 1;
+}
+
+// 序号a是否不晚于b(32位回绕比较)
+static int seq_before_eq(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) <= 0;
+}
+
+int zerocopy_reap(int fd, zc_state_t *zc, cache_t *cache) {
+    while (zc->head) {
+        char control[128];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        
+        if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) break;
+        
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            struct sock_extended_err *err = (struct sock_extended_err *)CMSG_DATA(cmsg);
+            if (err->ee_errno != 0 || err->ee_origin != SO_EE_ORIGIN_ZEROCOPY) continue;
+            
+            // [ee_info, ee_data]区间内的发送已完成，TCP按顺序通知
+            if (err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                __atomic_add_fetch(&zerocopy_copied, err->ee_data - err->ee_info + 1,
+                                   __ATOMIC_RELAXED);
+            }
+            while (zc->head && seq_before_eq(zc->head->last_seq, err->ee_data)) {
+                zc_pending_t *done = zc->head;
+                zc->head = done->next;
+                if (!zc->head) zc->tail = NULL;
+                cache_release(cache, done->item);
+                free(done);
+            }
+        }
+    }
+    
+    int remaining = 0;
+    for (zc_pending_t *p = zc->head; p; p = p->next) remaining++;
+    return remaining;
+}
+
+void zerocopy_release_all(zc_state_t *zc, cache_t *cache) {
+    while (zc->head) {
+        zc_pending_t *done = zc->head;
+        zc->head = done->next;
+        cache_release(cache, done->item);
+        free(done);
+    }
+    zc->tail = NULL;
+    free(zc->spare);
+    zc->spare = NULL;
+    zc->enabled = 0;
+    zc->next_seq = zc->sent_seq = 0;
+}
+
+void zerocopy_get_stats(unsigned long *sent, unsigned long *copied) {
+    *sent = __atomic_load_n(&zerocopy_sent, __ATOMIC_RELAXED);
+    *copied = __atomic_load_n(&zerocopy_copied, __ATOMIC_RELAXED);
+}
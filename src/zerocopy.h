@@ -0,0 +1,41 @@
+#ifndef ZEROCOPY_H
+#define ZEROCOPY_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include "cache.h"
+
+// 等待内核发送完成的缓存项(按发送顺序排列)
+typedef struct zc_pending {
+    cache_item_t *item;
+    uint32_t last_seq;         // 该响应最后一次零拷贝发送的通知序号
+    struct zc_pending *next;
+} zc_pending_t;
+
+// 每个连接的MSG_ZEROCOPY状态，同一时刻只由持有连接的线程访问
+typedef struct {
+    int enabled;               // 已在socket上设置SO_ZEROCOPY
+    uint32_t next_seq;         // 下一次零拷贝发送的通知序号(内核按socket从0计数)
+    uint32_t sent_seq;         // 上次登记缓存项时的next_seq
+    zc_pending_t *head;
+    zc_pending_t *tail;
+    zc_pending_t *spare;       // 发送前预先分配的登记节点
+} zc_state_t;
+
+// 在socket上开启SO_ZEROCOPY，内核不支持时返回-1
+int zerocopy_enable(int fd, zc_state_t *zc);
+// 发送前调用，预先分配登记节点，失败时应改用普通发送
+int zerocopy_prepare(zc_state_t *zc);
+// 一次MSG_ZEROCOPY发送，返回值同send；数据在内核通知完成前不得修改或释放
+ssize_t zerocopy_send(int fd, zc_state_t *zc, const void *buf, size_t len);
+// 把缓存项引用转交给连接，直到覆盖本次发送的通知到达；本次没有零拷贝发送时返回0(调用者自行释放)
+// 必须先成功调用zerocopy_prepare
+int zerocopy_track(zc_state_t *zc, cache_item_t *item);
+// 读取socket错误队列中的完成通知并释放对应的缓存项，返回仍未完成的项数
+int zerocopy_reap(int fd, zc_state_t *zc, cache_t *cache);
+// 连接关闭时释放全部引用(调用者须保证内核已不再引用这些数据，如已用RST中止连接)
+void zerocopy_release_all(zc_state_t *zc, cache_t *cache);
+// 累计零拷贝发送次数和内核回退为复制的次数
+void zerocopy_get_stats(unsigned long *sent, unsigned long *copied);
+
+#endif